@@ -10,6 +10,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 using namespace std;
 using namespace hal;
@@ -34,20 +35,80 @@ using namespace hal;
  * So if a base in the reference genome is aligned to a base in a genome
  * that is not under root or in the target list, it will not count to the
  * alignment depth.
+ *
+ * Rather than building every alignment column, the depth is computed
+ * from segments: the reference segments in a range are mapped to each
+ * target genome, and every mapped segment adds one to the depth of the
+ * reference interval it covers (using a difference array).  Without
+ * --countDupes, the intervals mapped to a genome are merged first so it
+ * is counted only once per base.  The reference is split into shards
+ * that are counted on --numThreads worker threads and written in order.
+ *
+ * A column contains everything aligned to the highest ancestor of the
+ * reference base (up to the root of the tree spanning the reference and
+ * targets), so segments are mapped through that ancestor.  It differs
+ * between bases because of insertions, so each shard is first divided
+ * into runs of bases that have the same highest ancestor.
  */
 
-/** Print the alignment depth wiggle for a subrange of a given sequence to
- * the output stream. */
-static void printSequence(ostream &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
-                          hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors);
+/** A target genome and the paths used to map reference segments to it
+ * through each of the reference's ancestors */
+struct DepthTarget {
+    const Genome *_genome;
+    // index of the lowest ancestor of the reference that is also an
+    // ancestor of the target
+    size_t _firstLevel;
+    // spanning tree of each ancestor from _firstLevel up and the target
+    vector<set<const Genome *>> _downwardPaths;
+};
+
+/** Everything needed to count the depth of a shard, shared read-only
+ * between threads */
+struct DepthParams {
+    const Genome *_refGenome;
+    // the reference and its ancestors, up to the coalescence limit
+    vector<const Genome *> _levels;
+    vector<DepthTarget> _targets;
+    // the reference is one of the targets, so paralogs in it are counted
+    bool _countSelf;
+    hal_size_t _step;
+    bool _countDupes;
+};
+
+/** A range [_start, _last] of a reference sequence, in genome coordinates,
+ * that is counted by one task.  The first shard of each range writes the
+ * wig header */
+struct DepthShard {
+    const Sequence *_sequence;
+    hal_index_t _start;
+    hal_index_t _last;
+    bool _first;
+};
+
+/** A run of bases in a shard with the same highest ancestor */
+struct DepthRun {
+    hal_index_t _first;
+    hal_index_t _last;
+    size_t _level;
+};
+
+/** Split a (sequence-relative) subrange of a sequence into shards */
+static void addSequenceShards(vector<DepthShard> &shards, const Sequence *sequence, hal_size_t start, hal_size_t length,
+                              hal_size_t shardLength);
 
 /** If given genome-relative coordinates, map them to a series of
- * sequence subranges */
-static void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence,
-                        const set<const Genome *> &targetSet, hal_size_t start, hal_size_t length, hal_size_t step,
-                        bool countDupes, bool noAncestors);
+ * sequence subranges and split those into shards */
+static void addGenomeShards(vector<DepthShard> &shards, const Genome *genome, const Sequence *sequence, hal_size_t start,
+                            hal_size_t length, hal_size_t shardLength);
+
+/** Choose the genomes to count and how to map to them */
+static void initDepthParams(DepthParams &params, const Alignment *alignment, const Genome *refGenome,
+                            const set<const Genome *> &targetSet, hal_size_t step, bool countDupes, bool noAncestors);
+
+/** Print the alignment depth wiggle for a shard to the output string */
+static void printShard(string &output, const DepthParams &params, const DepthShard &shard);
 
-static const hal_size_t StringBufferSize = 1024;
+static const hal_size_t DefaultShardLength = 1000000;
 
 static void initParser(CLParser &optionsParser) {
     /** It is convenient to use the HAL command line parser for the command
@@ -55,7 +116,9 @@ static void initParser(CLParser &optionsParser) {
      * parser is by no means required however */
     optionsParser.addArgument("halPath", "input hal file");
     optionsParser.addArgument("refGenome", "reference genome to scan");
-    optionsParser.addOption("outWiggle", "output wig file (stdout if none)", "stdout");
+    optionsParser.addOption("outWiggle", "output wig file (stdout if none).  Written BGZF compressed if the name "
+                                         "ends in .gz or .bgz",
+                            "stdout");
     optionsParser.addOption("refSequence", "sequence name to export ("
                                            "all sequences by default)",
                             "\"\"");
@@ -78,6 +141,12 @@ static void initParser(CLParser &optionsParser) {
                                               "height of the MAF column created with hal2maf.",
                                 false);
     optionsParser.addOptionFlag("noAncestors", "do not count ancestral genomes.", false);
+    optionsParser.addOption("numThreads", "number of threads used to count the depth.  The reference is split "
+                                          "into shards of --shardLength bases, which are written in order. "
+                                          "Requires an mmap HAL file.  Also the number of threads compressing "
+                                          ".gz or .bgz output",
+                            1);
+    optionsParser.addOption("shardLength", "length of reference shards counted by each thread", DefaultShardLength);
     optionsParser.setDescription("Make alignment depth wiggle plot for a genome. "
                                  "By default, this is a count of the number of "
                                  "other unique genomes each base aligns to, "
@@ -99,6 +168,8 @@ int main(int argc, char **argv) {
     hal_size_t step;
     bool countDupes;
     bool noAncestors;
+    hal_size_t numThreads;
+    hal_size_t shardLength;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halPath");
@@ -112,11 +183,19 @@ int main(int argc, char **argv) {
         step = optionsParser.getOption<hal_size_t>("step");
         countDupes = optionsParser.getFlag("countDupes");
         noAncestors = optionsParser.getFlag("noAncestors");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        shardLength = optionsParser.getOption<hal_size_t>("shardLength");
 
         if (rootGenomeName != "\"\"" && targetGenomes != "\"\"") {
             throw hal_exception("--rootGenome and --targetGenomes options are "
                                 " mutually exclusive");
         }
+        if (step == 0) {
+            throw hal_exception("--step must be greater than 0");
+        }
+        if (shardLength == 0) {
+            throw hal_exception("--shardLength must be greater than 0");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -128,7 +207,8 @@ int main(int argc, char **argv) {
          * via a path to a .hal file.  Options don't necessarily need to
          * come from the optionsParser -- see other interfaces in
          * hal/api/inc/halAlignmentInstance.h */
-        AlignmentConstPtr alignment(openHalAlignment(halPath, &optionsParser));
+        AlignmentConstPtr alignment(
+            openHalAlignment(halPath, &optionsParser, (numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
         if (alignment->getNumGenomes() == 0) {
             throw hal_exception("input hal alignmenet is empty");
         }
@@ -187,16 +267,25 @@ int main(int argc, char **argv) {
                                 refGenome->getName() + string(") is ancetral"));
         }
 
-        ofstream ofile;
-        ostream &outStream = wigPath == "stdout" ? cout : ofile;
-        if (wigPath != "stdout") {
-            ofile.open(wigPath.c_str());
-            if (!ofile) {
-                throw hal_exception(string("Error opening output file ") + wigPath);
-            }
-        }
+        OutputFile wigFile(wigPath, numThreads);
+        ostream &outStream = wigFile.getStream();
+
+        DepthParams params;
+        initDepthParams(params, alignment.get(), refGenome, targetSet, step, countDupes, noAncestors);
+
+        /** Shards are a multiple of the step so the sampled positions
+         * don't depend on the shard boundaries */
+        shardLength = ((shardLength + step - 1) / step) * step;
+        vector<DepthShard> shards;
+        addGenomeShards(shards, refGenome, refSequence, start, length, shardLength);
 
-        printGenome(outStream, refGenome, refSequence, targetSet, start, length, step, countDupes, noAncestors);
+        if (numThreads > 1) {
+            checkSharedAccess(alignment.get());
+        }
+        auto countShard = [&](size_t i, string &output) { printShard(output, params, shards[i]); };
+        auto writeShard = [&](size_t i, string &output) { outStream << output; };
+        runOrderedTasks(shards.size(), numThreads, countShard, writeShard);
+        wigFile.close();
 
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
@@ -209,11 +298,61 @@ int main(int argc, char **argv) {
     return 0;
 }
 
-/** Given a Sequence (chromosome) and a (sequence-relative) coordinate
- * range, print the alignmability wiggle with respect to the genomes
- * in the target set */
-void printSequence(ostream &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
-                   hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors) {
+void initDepthParams(DepthParams &params, const Alignment *alignment, const Genome *refGenome,
+                     const set<const Genome *> &targetSet, hal_size_t step, bool countDupes, bool noAncestors) {
+    params._refGenome = refGenome;
+    params._step = step;
+    params._countDupes = countDupes;
+
+    /** As with the column iterator, we never look above the root of the
+     * tree spanning the reference and the targets (or of the whole
+     * alignment if there are no targets) */
+    set<const Genome *> genomes;
+    const Genome *coalescenceLimit;
+    if (targetSet.empty()) {
+        coalescenceLimit = alignment->openGenome(alignment->getRootName());
+        getGenomesInSubTree(coalescenceLimit, genomes);
+    } else {
+        genomes = targetSet;
+        genomes.insert(refGenome);
+        coalescenceLimit = getLowestCommonAncestor(genomes);
+    }
+    for (const Genome *genome = refGenome; genome != coalescenceLimit; genome = genome->getParent()) {
+        params._levels.push_back(genome);
+    }
+    params._levels.push_back(coalescenceLimit);
+
+    /** Every genome counts once for a base aligned to the reference, but
+     * the reference itself is subtracted from the depth.  So it only needs
+     * to be mapped when counting its paralogs, which requires going above
+     * it */
+    params._countSelf = countDupes && coalescenceLimit != refGenome;
+    for (set<const Genome *>::const_iterator i = genomes.begin(); i != genomes.end(); ++i) {
+        const Genome *genome = *i;
+        if ((genome == refGenome && !params._countSelf) || (noAncestors && genome->getNumChildren() > 0)) {
+            continue;
+        }
+        DepthTarget target;
+        target._genome = genome;
+        set<const Genome *> inputSet;
+        inputSet.insert(refGenome);
+        inputSet.insert(genome);
+        const Genome *mrca = getLowestCommonAncestor(inputSet);
+        target._firstLevel = find(params._levels.begin(), params._levels.end(), mrca) - params._levels.begin();
+        assert(target._firstLevel < params._levels.size());
+        for (size_t level = target._firstLevel; level < params._levels.size(); ++level) {
+            inputSet.clear();
+            inputSet.insert(params._levels[level]);
+            inputSet.insert(genome);
+            target._downwardPaths.push_back(set<const Genome *>());
+            getGenomesInSpanningTree(inputSet, target._downwardPaths.back());
+        }
+        params._targets.push_back(target);
+    }
+}
+
+void addSequenceShards(vector<DepthShard> &shards, const Sequence *sequence, hal_size_t start, hal_size_t length,
+                       hal_size_t shardLength) {
     hal_size_t seqLen = sequence->getSequenceLength();
     if (seqLen == 0) {
         return;
@@ -230,81 +369,171 @@ void printSequence(ostream &outStream, const Sequence *sequence, const set<const
                             std::to_string(seqLen));
     }
 
-    const Genome *genome = sequence->getGenome();
-    string sequenceName = sequence->getName();
-    string genomeName = genome->getName();
-
-    /** The ColumnIterator is fundamental structure used in this example to
-     * traverse the alignment.  It essientially generates the multiple alignment
-     * on the fly according to the given reference (in this case the target
-     * sequence).  Since this is the sequence interface, the positions
-     * are sequence relative.  Note that we must specify the last position
-     * in advance when we get the iterator.  This will limit it following
-     * duplications out of the desired range while we are iterating. */
-    hal_size_t pos = start;
-    ColumnIteratorPtr colIt = sequence->getColumnIterator(&targetSet, 0, pos, last - 1, false, noAncestors);
-    // note wig coordinates are 1-based for some reason so we shift to right
-    outStream << "fixedStep chrom=" << sequenceName << " start=" << start + 1 << " step=" << step << "\n";
-
-    /** Since the column iterator stores coordinates in Genome coordinates
-     * internally, we have to switch back to genome coordinates.  */
-    // convert to genome coordinates
-    pos += sequence->getStartPosition();
-    last += sequence->getStartPosition();
-    // keep track of unique genomes
-    set<const Genome *> genomeSet;
-    while (pos <= last) {
-        genomeSet.clear();
-        hal_size_t count = 0;
-        /** ColumnIterator::ColumnMap maps a Sequence to a list of bases
-         * the bases in the map form the alignment column.  Some sequences
-         * in the map can have no bases (for efficiency reasons) */
-        const ColumnIterator::ColumnMap *cmap = colIt->getColumnMap();
-
-        /** For every sequence in the map */
-        for (ColumnIterator::ColumnMap::const_iterator i = cmap->begin(); i != cmap->end(); ++i) {
-            if (countDupes == true) {
-                // countDupes enabled: we just count everything
-                count += i->second->size();
-            } else if (!i->second->empty()) {
-                // just counting unique genomes: add it if there's at least one base
-                genomeSet.insert(i->first->getGenome());
-            }
+    /** Shards are kept in genome coordinates, like the segments they
+     * are mapped from */
+    hal_index_t startPosition = sequence->getStartPosition() + (hal_index_t)start;
+    hal_index_t endPosition = startPosition + (hal_index_t)length;
+    vector<hal_index_t> shardStarts = shardRange(startPosition, length, shardLength);
+    for (size_t i = 0; i < shardStarts.size(); ++i) {
+        DepthShard shard;
+        shard._sequence = sequence;
+        shard._start = shardStarts[i];
+        shard._last = ((i + 1 < shardStarts.size()) ? shardStarts[i + 1] : endPosition) - 1;
+        shard._first = i == 0;
+        shards.push_back(shard);
+    }
+}
+
+/** Map the reference segments in [first, last] to a genome through one
+ * of the reference's ancestors, which must also be an ancestor of the
+ * genome */
+static void mapRange(MappedSegmentSet &mappedSegments, const Genome *refGenome, hal_index_t first, hal_index_t last,
+                     const Genome *genome, const Genome *ancestor, const set<const Genome *> *downwardPath,
+                     bool doDupes) {
+    SegmentIteratorPtr refSeg;
+    hal_index_t lastIndex;
+    if (ancestor == refGenome) {
+        refSeg = refGenome->getBottomSegmentIterator();
+        lastIndex = refGenome->getNumBottomSegments();
+    } else {
+        refSeg = refGenome->getTopSegmentIterator();
+        lastIndex = refGenome->getNumTopSegments();
+    }
+    if (lastIndex == 0) {
+        return;
+    }
+
+    refSeg->toSite(first, false);
+    hal_offset_t startOffset = first - refSeg->getStartPosition();
+    hal_offset_t endOffset = 0;
+    if (last <= refSeg->getEndPosition()) {
+        endOffset = refSeg->getEndPosition() - last;
+    }
+    refSeg->slice(startOffset, endOffset);
+
+    while (refSeg->getArrayIndex() < lastIndex && refSeg->getStartPosition() <= last) {
+        halMapSegment(refSeg.get(), mappedSegments, genome, downwardPath, doDupes, 0, ancestor, ancestor);
+        refSeg->toRight(last);
+    }
+}
+
+/** Add the reference intervals covered by mapped segments to a list, in
+ * shard coordinates */
+static void addSourceIntervals(vector<pair<hal_index_t, hal_index_t>> &intervals,
+                               const MappedSegmentSet &mappedSegments, const DepthShard &shard) {
+    for (MappedSegmentSet::const_iterator i = mappedSegments.begin(); i != mappedSegments.end(); ++i) {
+        const SlicedSegment *source = (*i)->getSource();
+        hal_index_t first = min(source->getStartPosition(), source->getEndPosition());
+        hal_index_t last = max(source->getStartPosition(), source->getEndPosition());
+        assert(first >= shard._start && last <= shard._last);
+        intervals.push_back(make_pair(first - shard._start, last - shard._start));
+    }
+}
+
+/** Divide a shard into runs of bases with the same highest ancestor.  A
+ * base that has an ancestor in a genome also has one in every genome
+ * below it, so the levels are found by mapping the shard to each
+ * ancestor from the bottom up */
+static void getShardRuns(vector<DepthRun> &runs, const DepthParams &params, const DepthShard &shard) {
+    hal_size_t length = shard._last - shard._start + 1;
+    vector<size_t> levels(length, 0);
+    set<const Genome *> downwardPath;
+    MappedSegmentSet mappedSegments;
+    vector<pair<hal_index_t, hal_index_t>> intervals;
+    for (size_t level = 1; level < params._levels.size(); ++level) {
+        const Genome *ancestor = params._levels[level];
+        downwardPath.clear();
+        downwardPath.insert(ancestor);
+        mappedSegments.clear();
+        mapRange(mappedSegments, params._refGenome, shard._start, shard._last, ancestor, ancestor, &downwardPath, false);
+        if (mappedSegments.empty()) {
+            break;
         }
-        if (countDupes == false) {
-            count = genomeSet.size();
+        intervals.clear();
+        addSourceIntervals(intervals, mappedSegments, shard);
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            fill(levels.begin() + intervals[i].first, levels.begin() + intervals[i].second + 1, level);
         }
-        // don't want to include reference base in output
-        --count;
+    }
 
-        outStream << count << '\n';
+    runs.clear();
+    for (hal_size_t i = 0; i < length; ++i) {
+        hal_index_t pos = shard._start + (hal_index_t)i;
+        if (runs.empty() || runs.back()._level != levels[i]) {
+            DepthRun run = {pos, pos, levels[i]};
+            runs.push_back(run);
+        } else {
+            runs.back()._last = pos;
+        }
+    }
+}
 
-        /** lastColumn checks if we are at the last column (inclusive)
-         * in range.  So we need to check at end of iteration instead
-         * of beginning (which would be more convenient).  Need to
-         * merge global fix from other branch */
-        if (colIt->lastColumn() == true) {
-            break;
+void printShard(string &output, const DepthParams &params, const DepthShard &shard) {
+    hal_size_t length = shard._last - shard._start + 1;
+    vector<DepthRun> runs;
+    getShardRuns(runs, params, shard);
+
+    // depth[i] - depth[i - 1] for every position of the shard
+    vector<hal_index_t> delta(length + 1, 0);
+    MappedSegmentSet mappedSegments;
+    vector<pair<hal_index_t, hal_index_t>> intervals;
+
+    for (size_t i = 0; i < params._targets.size(); ++i) {
+        const DepthTarget &target = params._targets[i];
+
+        /** Bases whose highest ancestor is below the target's common
+         * ancestor with the reference are not aligned to it */
+        intervals.clear();
+        for (size_t j = 0; j < runs.size(); ++j) {
+            if (runs[j]._level == 0 && target._genome == params._refGenome) {
+                // a base with no ancestor is aligned only to itself
+                intervals.push_back(make_pair(runs[j]._first - shard._start, runs[j]._last - shard._start));
+            } else if (runs[j]._level >= target._firstLevel) {
+                mappedSegments.clear();
+                mapRange(mappedSegments, params._refGenome, runs[j]._first, runs[j]._last, target._genome,
+                         params._levels[runs[j]._level], &target._downwardPaths[runs[j]._level - target._firstLevel],
+                         true);
+                addSourceIntervals(intervals, mappedSegments, shard);
+            }
         }
 
-        pos += step;
-        if (step == 1) {
-            /** Move the iterator one position to the right */
-            colIt->toRight();
-
-            /** This is some tuning code that will probably be hidden from
-             * the interface at some point.  It is a good idea to use for now
-             * though */
-            // erase empty entries from the column.  helps when there are
-            // millions of sequences (ie from fastas with lots of scaffolds)
-            if (pos % 1000 == 0) {
-                colIt->defragment();
+        if (params._countDupes) {
+            /** count every position a base aligns to */
+            for (size_t j = 0; j < intervals.size(); ++j) {
+                ++delta[intervals[j].first];
+                --delta[intervals[j].second + 1];
             }
         } else {
-            /** Reset the iterator to a non-contiguous position */
-            colIt->toSite(pos, last);
+            /** merge the intervals so the genome is counted only once */
+            sort(intervals.begin(), intervals.end());
+            for (size_t j = 0; j < intervals.size();) {
+                hal_index_t first = intervals[j].first;
+                hal_index_t last = intervals[j].second;
+                for (++j; j < intervals.size() && intervals[j].first <= last + 1; ++j) {
+                    last = max(last, intervals[j].second);
+                }
+                ++delta[first];
+                --delta[last + 1];
+            }
+        }
+    }
+
+    ostringstream outStream;
+    if (shard._first) {
+        // note wig coordinates are 1-based for some reason so we shift to right
+        hal_index_t start = shard._start - shard._sequence->getStartPosition();
+        outStream << "fixedStep chrom=" << shard._sequence->getName() << " start=" << start + 1
+                  << " step=" << params._step << "\n";
+    }
+    // don't want to include reference base in output
+    hal_index_t depth = params._countSelf ? -1 : 0;
+    for (hal_size_t i = 0; i < length; ++i) {
+        depth += delta[i];
+        if (i % params._step == 0) {
+            outStream << depth << '\n';
         }
     }
+    output = outStream.str();
 }
 
 /** Map a range of genome-level coordinates to potentially multiple sequence
@@ -315,10 +544,10 @@ void printSequence(ostream &outStream, const Sequence *sequence, const set<const
  * for the hal::Sequence interface.  We can convert between the two by
  * adding or subtracting the sequence start position (in the example it woudl
  * be 0 for ChrA and 500 for ChrB) */
-void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence, const set<const Genome *> &targetSet,
-                 hal_size_t start, hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors) {
+void addGenomeShards(vector<DepthShard> &shards, const Genome *genome, const Sequence *sequence, hal_size_t start,
+                     hal_size_t length, hal_size_t shardLength) {
     if (sequence != NULL) {
-        printSequence(outStream, sequence, targetSet, start, length, step, countDupes, noAncestors);
+        addSequenceShards(shards, sequence, start, length, shardLength);
     } else {
         if (start + length > genome->getSequenceLength()) {
             throw hal_exception("Specified range [" + std::to_string(start) + "," + std::to_string(length) + "] is" +
@@ -339,7 +568,7 @@ void printGenome(ostream &outStream, const Genome *genome, const Sequence *seque
                 hal_size_t readStart = seqStart >= start ? 0 : start - seqStart;
                 hal_size_t readLen = min(seqLen - readStart, length);
                 readLen = min(readLen, length - runningLength);
-                printSequence(outStream, sequence, targetSet, readStart, readLen, step, countDupes, noAncestors);
+                addSequenceShards(shards, sequence, readStart, readLen, shardLength);
                 runningLength += readLen;
             }
         }
@@ -71,6 +71,7 @@ Hdf5Alignment::Hdf5Alignment(const string &alignmentPath, unsigned mode, const H
                              bool inMemory)
     : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _file(NULL), _flags(hdf5DefaultFlags(_mode)),
       _inMemory(inMemory), _metaData(NULL), _tree(NULL), _dirty(false) {
+    checkAccessMode();
     _cprops.copy(fileCreateProps);
     _aprops.copy(fileAccessProps);
     _dcprops.copy(datasetCreateProps);
@@ -87,6 +88,7 @@ Hdf5Alignment::Hdf5Alignment(const string &alignmentPath, unsigned mode, const H
 Hdf5Alignment::Hdf5Alignment(const std::string &alignmentPath, unsigned mode, const CLParser *parser)
     : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _file(NULL), _flags(hdf5DefaultFlags(_mode)),
       _inMemory(false), _metaData(NULL), _tree(NULL), _dirty(false) {
+    checkAccessMode();
     initializeFromOptions(parser);
     if (_inMemory) {
         setInMemory();
@@ -577,6 +579,14 @@ string Hdf5Alignment::getVersion() const {
     }
 }
 
+void Hdf5Alignment::checkAccessMode() const {
+    if (_mode & READ_SHARED_ACCESS) {
+        throw hal_exception(_alignmentPath + ": READ_SHARED_ACCESS is not supported for HAL files in " + STORAGE_FORMAT_HDF5 +
+                            " format, the HDF5 library is not thread-safe (use halExtract to convert to " +
+                            STORAGE_FORMAT_MMAP + ")");
+    }
+}
+
 bool Hdf5Alignment::isReadOnly() const {
     return (_flags & (H5F_ACC_RDWR | H5F_ACC_TRUNC)) == 0;
 }
@@ -81,10 +81,15 @@ namespace hal {
 
         bool isReadOnly() const;
 
+        bool isSharedAccess() const {
+            return false;
+        }
+
         void replaceNewickTree(const std::string &newNewickString);
 
       private:
         // FIXME: should these be private?
+        void checkAccessMode() const;
         void loadTree();
         void writeTree();
         void writeVersion();
@@ -73,6 +73,10 @@ namespace hal {
 
         Alignment *getAlignment(); // can't be inlined due to mutual include
 
+        void adviseAccessPattern(AccessPattern pattern) const {
+            // HDF5 reads through its own chunk cache
+        }
+
         void rename(const std::string &newName);
 
         // SEGMENTED SEQUENCE INTERFACE
@@ -157,6 +157,9 @@ void ColumnIterator::toSite(hal_index_t columnIndex, hal_index_t lastColumnIndex
     if (clearCache == true) {
         clearVisitCache();
     }
+    // drop the current column so it isn't reported again if every site
+    // in the new range has already been visited
+    resetColMap();
     defragment();
     // note columnIndex in genome (not sequence) coordinates
     _stack.push(sequence, columnIndex, lastColumnIndex);
@@ -190,18 +193,7 @@ hal_index_t ColumnIterator::getArrayIndex() const {
 }
 
 void ColumnIterator::defragment() {
-    ColumnMap::iterator i = _colMap.begin();
-    ColumnMap::iterator next;
-    while (i != _colMap.end()) {
-        next = i;
-        ++next;
-        if (i->second->empty()) {
-            delete i->second;
-            _colMap.erase(i);
-        }
-        i = next;
-    }
-
+    _colMap.removeEmpty();
     _stack.resetLinks();
 }
 
@@ -801,14 +793,7 @@ bool ColumnIterator::colMapInsert(DnaIteratorPtr dnaIt) {
     // insert into the column data structure to pass out to client
     if (found == false && (!_noAncestors || genome->getNumChildren() == 0) &&
         (_targets.empty() || _targets.find(genome) != _targets.end())) {
-        ColumnMap::iterator i = _colMap.lower_bound(sequence);
-        if (i != _colMap.end() && !(_colMap.key_comp()(sequence, i->first))) {
-            i->second->push_back(dnaIt);
-        } else {
-            DNASet *dnaSet = new DNASet();
-            dnaSet->push_back(dnaIt);
-            _colMap.insert(i, ColumnMap::value_type(sequence, dnaSet));
-        }
+        _colMap.get(sequence)->push_back(dnaIt);
     }
 
     // update leftmost ref pos which is used by isCanonicalOnRef()
@@ -819,14 +804,95 @@ bool ColumnIterator::colMapInsert(DnaIteratorPtr dnaIt) {
 }
 
 void ColumnIterator::resetColMap() {
-    for (ColumnMap::iterator i = _colMap.begin(); i != _colMap.end(); ++i) {
-        i->second->clear();
-    }
+    _colMap.reset();
 }
 
 void ColumnIterator::eraseColMap() {
-    for (ColumnMap::iterator i = _colMap.begin(); i != _colMap.end(); ++i) {
-        delete i->second;
-    }
     _colMap.clear();
 }
+
+ColumnIterator::ColumnMap::const_iterator ColumnIterator::ColumnMap::find(const Sequence *sequence) const {
+    unordered_map<const Genome *, hal_size_t>::const_iterator rankIt = _genomeRanks.find(sequence->getGenome());
+    if (rankIt == _genomeRanks.end()) {
+        return end();
+    }
+    Key key(rankIt->second, sequence->getArrayIndex());
+    vector<Key>::const_iterator i = lower_bound(_keys.begin(), _keys.end(), key);
+    if (i == _keys.end() || *i != key) {
+        return end();
+    }
+    return begin() + (i - _keys.begin());
+}
+
+ColumnIterator::DNASet *ColumnIterator::ColumnMap::get(const Sequence *sequence) {
+    Key key(getGenomeRank(sequence->getGenome()), sequence->getArrayIndex());
+    vector<Key>::iterator i = lower_bound(_keys.begin(), _keys.end(), key);
+    size_t index = i - _keys.begin();
+    if (i == _keys.end() || *i != key) {
+        _keys.insert(i, key);
+        _entries.insert(_entries.begin() + index, value_type(sequence, new DNASet()));
+    }
+    assert(_entries[index].first == sequence);
+    return _entries[index].second;
+}
+
+void ColumnIterator::ColumnMap::reset() {
+    size_t numEmpty = 0;
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        numEmpty += _entries[i].second->empty();
+    }
+    // compacting costs a pass over the map, which is paid for by the columns
+    // that left half of it empty
+    if (_entries.size() >= MinCompactSize && 2 * numEmpty >= _entries.size()) {
+        removeEmpty();
+    }
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        _entries[i].second->clear();
+    }
+}
+
+void ColumnIterator::ColumnMap::removeEmpty() {
+    size_t j = 0;
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        if (_entries[i].second->empty()) {
+            delete _entries[i].second;
+        } else {
+            _entries[j] = _entries[i];
+            _keys[j] = _keys[i];
+            ++j;
+        }
+    }
+    _entries.resize(j);
+    _keys.resize(j);
+}
+
+void ColumnIterator::ColumnMap::clear() {
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        delete _entries[i].second;
+    }
+    _entries.clear();
+    _keys.clear();
+}
+
+hal_size_t ColumnIterator::ColumnMap::getGenomeRank(const Genome *genome) {
+    unordered_map<const Genome *, hal_size_t>::iterator rankIt = _genomeRanks.find(genome);
+    if (rankIt != _genomeRanks.end()) {
+        return rankIt->second;
+    }
+    // a new genome shifts the ranks of the genomes after it in name order
+    vector<string>::iterator nameIt = lower_bound(_genomeNames.begin(), _genomeNames.end(), genome->getName());
+    hal_size_t rank = nameIt - _genomeNames.begin();
+    _genomeNames.insert(nameIt, genome->getName());
+    for (rankIt = _genomeRanks.begin(); rankIt != _genomeRanks.end(); ++rankIt) {
+        if (rankIt->second >= rank) {
+            ++rankIt->second;
+        }
+    }
+    for (size_t i = 0; i < _keys.size(); ++i) {
+        if (_keys[i].first >= rank) {
+            ++_keys[i].first;
+        }
+    }
+    _genomeRanks[genome] = rank;
+    return rank;
+}
@@ -233,3 +233,169 @@ const uint8_t hal::dnaPackMap[256] = {
 /* map of 4 bit encoding to character */
 const char hal::dnaUnpackMap[16] = {'a', 'c', 'g', 't', 'n', '\x00', '\x00', '\x00',
                                     'A', 'C', 'G', 'T', 'N', '\x00', '\x00', '\x00'};
+
+/* both characters packed in each byte, for the scalar decoder */
+namespace {
+    struct DnaUnpackPairs {
+        char pairs[256][2];
+        DnaUnpackPairs() {
+            for (int i = 0; i < 256; i++) {
+                pairs[i][0] = dnaUnpack(0, i);
+                pairs[i][1] = dnaUnpack(1, i);
+            }
+        }
+    };
+}
+static const DnaUnpackPairs dnaUnpackPairs;
+
+typedef void (*DnaUnpackBytesFunc)(const unsigned char *packed, hal_size_t numBytes, char *out);
+
+/* decode numBytes bytes to 2 * numBytes characters */
+static void dnaUnpackBytesScalar(const unsigned char *packed, hal_size_t numBytes, char *out) {
+    for (hal_size_t i = 0; i < numBytes; i++) {
+        memcpy(out + 2 * i, dnaUnpackPairs.pairs[packed[i]], 2);
+    }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+/* SSSE3 decode, looking up 16 nibbles at a time with pshufb */
+__attribute__((target("ssse3"))) static void dnaUnpackBytesSsse3(const unsigned char *packed, hal_size_t numBytes,
+                                                                 char *out) {
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dnaUnpackMap));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    hal_size_t i = 0;
+    for (; i + 16 <= numBytes; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i));
+        __m128i hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(table, _mm_and_si128(bytes, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    dnaUnpackBytesScalar(packed + i, numBytes - i, out + 2 * i);
+}
+
+/* AVX2 decode, 32 bytes at a time.  Unpacking works within 128-bit lanes,
+ * so the lanes are put back in order before storing. */
+__attribute__((target("avx2"))) static void dnaUnpackBytesAvx2(const unsigned char *packed, hal_size_t numBytes,
+                                                               char *out) {
+    const __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dnaUnpackMap)));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    hal_size_t i = 0;
+    for (; i + 32 <= numBytes; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(packed + i));
+        __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(bytes, mask));
+        __m256i first = _mm256_unpacklo_epi8(hi, lo);
+        __m256i second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    dnaUnpackBytesScalar(packed + i, numBytes - i, out + 2 * i);
+}
+#endif
+
+/* pick the fastest decoder supported by the CPU */
+static DnaUnpackBytesFunc selectDnaUnpackBytes() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return dnaUnpackBytesAvx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        return dnaUnpackBytesSsse3;
+    }
+#endif
+    return dnaUnpackBytesScalar;
+}
+
+void hal::dnaUnpackBases(const char *packed, hal_index_t index, hal_size_t length, char *out) {
+    static const DnaUnpackBytesFunc dnaUnpackBytes = selectDnaUnpackBytes();
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(packed) + index / 2;
+    if ((length > 0) && (index & 1)) {
+        // odd start is the second nibble
+        *out++ = dnaUnpack(1, *bytes++);
+        length--;
+    }
+    hal_size_t numBytes = length / 2;
+    dnaUnpackBytes(bytes, numBytes, out);
+    if (length & 1) {
+        out[length - 1] = dnaUnpack(0, bytes[numBytes]);
+    }
+}
+
+typedef void (*DnaCountIdenticalFunc)(const char *a, const char *b, hal_size_t length, hal_size_t &outAligned,
+                                      hal_size_t &outIdentical);
+
+/* upper-case a DNA character (all of them are letters) */
+static inline char dnaUpper(char c) {
+    return c & 0xDF;
+}
+
+static void dnaCountIdenticalScalar(const char *a, const char *b, hal_size_t length, hal_size_t &outAligned,
+                                    hal_size_t &outIdentical) {
+    for (hal_size_t i = 0; i < length; i++) {
+        char ua = dnaUpper(a[i]);
+        char ub = dnaUpper(b[i]);
+        if (ua != 'N' && ub != 'N') {
+            outAligned++;
+            outIdentical += ua == ub;
+        }
+    }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/* SSE2 comparison, 16 characters at a time */
+static void dnaCountIdenticalSse2(const char *a, const char *b, hal_size_t length, hal_size_t &outAligned,
+                                  hal_size_t &outIdentical) {
+    const __m128i upper = _mm_set1_epi8((char)0xDF);
+    const __m128i n = _mm_set1_epi8('N');
+    hal_size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i ua = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), upper);
+        __m128i ub = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)), upper);
+        __m128i isN = _mm_or_si128(_mm_cmpeq_epi8(ua, n), _mm_cmpeq_epi8(ub, n));
+        unsigned aligned = ~_mm_movemask_epi8(isN) & 0xFFFF;
+        unsigned identical = _mm_movemask_epi8(_mm_cmpeq_epi8(ua, ub)) & aligned;
+        outAligned += __builtin_popcount(aligned);
+        outIdentical += __builtin_popcount(identical);
+    }
+    dnaCountIdenticalScalar(a + i, b + i, length - i, outAligned, outIdentical);
+}
+
+/* AVX2 comparison, 32 characters at a time */
+__attribute__((target("avx2,popcnt"))) static void dnaCountIdenticalAvx2(const char *a, const char *b, hal_size_t length,
+                                                                        hal_size_t &outAligned, hal_size_t &outIdentical) {
+    const __m256i upper = _mm256_set1_epi8((char)0xDF);
+    const __m256i n = _mm256_set1_epi8('N');
+    hal_size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i ua = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)), upper);
+        __m256i ub = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)), upper);
+        __m256i isN = _mm256_or_si256(_mm256_cmpeq_epi8(ua, n), _mm256_cmpeq_epi8(ub, n));
+        unsigned aligned = ~(unsigned)_mm256_movemask_epi8(isN);
+        unsigned identical = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ua, ub)) & aligned;
+        outAligned += __builtin_popcount(aligned);
+        outIdentical += __builtin_popcount(identical);
+    }
+    dnaCountIdenticalSse2(a + i, b + i, length - i, outAligned, outIdentical);
+}
+#endif
+
+/* pick the fastest comparison supported by the CPU */
+static DnaCountIdenticalFunc selectDnaCountIdentical() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return dnaCountIdenticalAvx2;
+    }
+    return dnaCountIdenticalSse2;
+#endif
+    return dnaCountIdenticalScalar;
+}
+
+void hal::dnaCountIdentical(const char *a, const char *b, hal_size_t length, hal_size_t &outAligned,
+                            hal_size_t &outIdentical) {
+    static const DnaCountIdenticalFunc dnaCountIdenticalFunc = selectDnaCountIdentical();
+    dnaCountIdenticalFunc(a, b, length, outAligned, outIdentical);
+}
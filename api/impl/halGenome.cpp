@@ -246,9 +246,7 @@ void hal::Genome::copySequence(Genome *dest) const {
     DnaIteratorPtr outDna = dest->getDnaIterator();
     hal_size_t n = getSequenceLength();
     assert(n == dest->getSequenceLength());
-    for (; (hal_size_t)inDna->getArrayIndex() < n; inDna->toRight(), outDna->toRight()) {
-        outDna->setBase(inDna->getBase());
-    }
+    outDna->copyBases(inDna.get(), n);
     outDna->flush();
 }
 
@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halOutputFile.h"
+#include "halCommon.h"
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <zlib.h>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    /* a BGZF block is a gzip member with an extra field, BC, holding the
+     * size of the block minus one */
+    const size_t MaxCompressedSize = 0x10000;
+    const size_t HeaderSize = 18;
+    const size_t FooterSize = 8;
+    const unsigned char BlockHeader[HeaderSize] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 0, 0};
+
+    /* empty block marking the end of the file */
+    const unsigned char EofBlock[28] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0,
+                                        27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    /* compressed output is written to the file in pieces of this size */
+    const size_t OutputBufferSize = 4 * 1024 * 1024;
+
+    void putLittleEndian32(char *dest, uint32_t value) {
+        for (size_t i = 0; i < 4; ++i) {
+            dest[i] = (char)((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    /* deflate stream reused for all the blocks compressed by a thread */
+    class BlockDeflater {
+      public:
+        BlockDeflater(int level) {
+            memset(&_stream, 0, sizeof(_stream));
+            if (deflateInit2(&_stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw hal_exception("error initializing zlib compression");
+            }
+        }
+        ~BlockDeflater() {
+            deflateEnd(&_stream);
+        }
+
+        /* compress size bytes of text into a complete BGZF block */
+        void compress(const char *text, size_t size, vector<char> &block) {
+            assert(size <= BgzfStreamBuf::BlockSize);
+            block.resize(MaxCompressedSize);
+            if (deflateReset(&_stream) != Z_OK) {
+                throw hal_exception("error resetting zlib compression");
+            }
+            _stream.next_in = (Bytef *)text;
+            _stream.avail_in = size;
+            _stream.next_out = (Bytef *)&block[HeaderSize];
+            _stream.avail_out = MaxCompressedSize - HeaderSize - FooterSize;
+            if (deflate(&_stream, Z_FINISH) != Z_STREAM_END) {
+                throw hal_exception("error compressing BGZF block");
+            }
+            size_t blockSize = HeaderSize + _stream.total_out + FooterSize;
+            memcpy(&block[0], BlockHeader, HeaderSize);
+            block[16] = (char)((blockSize - 1) & 0xff);
+            block[17] = (char)((blockSize - 1) >> 8);
+            putLittleEndian32(&block[blockSize - FooterSize], crc32(crc32(0L, Z_NULL, 0), (const Bytef *)text, size));
+            putLittleEndian32(&block[blockSize - 4], size);
+            block.resize(blockSize);
+        }
+
+      private:
+        z_stream _stream;
+    };
+}
+
+namespace hal {
+    /* compresses blocks of text on a pool of threads and writes them to the
+     * file in the order they were added.  At most _maxPending blocks are
+     * queued or compressed but not yet written, which bounds memory. */
+    class BgzfWriter {
+      public:
+        BgzfWriter(const string &path, size_t numThreads, bool append, int level);
+        ~BgzfWriter();
+
+        hal_size_t getInitialSize() const {
+            return _initialSize;
+        }
+
+        /* queue the first size bytes of text to be compressed.  text is
+         * swapped with a buffer that is no longer used */
+        void addBlock(vector<char> &text, size_t size);
+
+        /* write all the blocks and the end-of-file block and close the file */
+        void close();
+
+      private:
+        struct Block {
+            vector<char> _text;
+            size_t _size;
+            vector<char> _compressed;
+            bool _done;
+        };
+
+        void compressWorker();
+        void writeCompleted(size_t maxPending);
+        void writeOutput(const void *data, size_t size);
+        void flushOutput();
+        void stopWorkers();
+
+        string _path;
+        FILE *_file;
+        hal_size_t _initialSize;
+        int _level;
+        unique_ptr<BlockDeflater> _deflater;
+        vector<char> _output;
+        size_t _maxPending;
+        vector<unique_ptr<Block>> _blocks;
+        vector<Block *> _free;
+        // blocks in output order, and those not yet picked up by a worker
+        deque<Block *> _pending;
+        deque<Block *> _toCompress;
+        bool _stopping;
+        exception_ptr _error;
+        mutex _mutex;
+        condition_variable _workCond;
+        condition_variable _doneCond;
+        vector<thread> _workers;
+    };
+}
+
+BgzfWriter::BgzfWriter(const string &path, size_t numThreads, bool append, int level)
+    : _path(path), _file(NULL), _initialSize(0), _level(level), _maxPending(4 * numThreads), _stopping(false) {
+    _file = fopen(path.c_str(), append ? "ab" : "wb");
+    if (_file == NULL) {
+        throw hal_exception("Error opening " + path + ": " + strerror(errno));
+    }
+    if (append) {
+        fseek(_file, 0, SEEK_END);
+        _initialSize = ftell(_file);
+    }
+    // compressed blocks are already collected into large writes
+    setvbuf(_file, NULL, _IONBF, 0);
+    _output.reserve(OutputBufferSize);
+    if (numThreads == 0) {
+        _deflater.reset(new BlockDeflater(level));
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        _workers.push_back(thread(&BgzfWriter::compressWorker, this));
+    }
+}
+
+BgzfWriter::~BgzfWriter() {
+    stopWorkers();
+    if (_file != NULL) {
+        fclose(_file);
+    }
+}
+
+void BgzfWriter::addBlock(vector<char> &text, size_t size) {
+    Block *block;
+    if (_free.empty()) {
+        _blocks.push_back(unique_ptr<Block>(new Block()));
+        block = _blocks.back().get();
+    } else {
+        block = _free.back();
+        _free.pop_back();
+    }
+    block->_text.swap(text);
+    block->_size = size;
+    block->_done = false;
+    if (_workers.empty()) {
+        _deflater->compress(&block->_text[0], block->_size, block->_compressed);
+        writeOutput(&block->_compressed[0], block->_compressed.size());
+        _free.push_back(block);
+        return;
+    }
+    {
+        lock_guard<mutex> lock(_mutex);
+        _pending.push_back(block);
+        _toCompress.push_back(block);
+    }
+    _workCond.notify_one();
+    writeCompleted(_maxPending);
+}
+
+/* write the compressed blocks at the head of the queue, waiting for them
+ * while more than maxPending are left */
+void BgzfWriter::writeCompleted(size_t maxPending) {
+    while (!_pending.empty()) {
+        Block *block = _pending.front();
+        {
+            unique_lock<mutex> lock(_mutex);
+            if (!block->_done && _pending.size() <= maxPending && !_error) {
+                return;
+            }
+            _doneCond.wait(lock, [this, block] { return block->_done || _error; });
+            if (_error) {
+                rethrow_exception(_error);
+            }
+            _pending.pop_front();
+        }
+        writeOutput(&block->_compressed[0], block->_compressed.size());
+        _free.push_back(block);
+    }
+}
+
+void BgzfWriter::compressWorker() {
+    try {
+        BlockDeflater deflater(_level);
+        while (true) {
+            Block *block;
+            {
+                unique_lock<mutex> lock(_mutex);
+                _workCond.wait(lock, [this] { return _stopping || _error || !_toCompress.empty(); });
+                if (_error || _toCompress.empty()) {
+                    return;
+                }
+                block = _toCompress.front();
+                _toCompress.pop_front();
+            }
+            deflater.compress(&block->_text[0], block->_size, block->_compressed);
+            {
+                lock_guard<mutex> lock(_mutex);
+                block->_done = true;
+            }
+            _doneCond.notify_all();
+        }
+    } catch (...) {
+        lock_guard<mutex> lock(_mutex);
+        if (!_error) {
+            _error = current_exception();
+        }
+        _workCond.notify_all();
+        _doneCond.notify_all();
+    }
+}
+
+void BgzfWriter::writeOutput(const void *data, size_t size) {
+    if (_output.size() + size > OutputBufferSize) {
+        flushOutput();
+    }
+    _output.insert(_output.end(), (const char *)data, (const char *)data + size);
+}
+
+void BgzfWriter::flushOutput() {
+    if (!_output.empty() && fwrite(&_output[0], 1, _output.size(), _file) != _output.size()) {
+        throw hal_exception("Error writing " + _path + ": " + strerror(errno));
+    }
+    _output.clear();
+}
+
+void BgzfWriter::stopWorkers() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _workCond.notify_all();
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i].join();
+    }
+    _workers.clear();
+}
+
+void BgzfWriter::close() {
+    writeCompleted(0);
+    stopWorkers();
+    writeOutput(EofBlock, sizeof(EofBlock));
+    flushOutput();
+    FILE *file = _file;
+    _file = NULL;
+    if (fclose(file) != 0) {
+        throw hal_exception("Error closing " + _path + ": " + strerror(errno));
+    }
+}
+
+BgzfStreamBuf::BgzfStreamBuf(const string &path, size_t numThreads, bool append, int level)
+    : _writer(new BgzfWriter(path, numThreads, append, level)), _block(BlockSize) {
+    _position = _writer->getInitialSize();
+    setp(&_block[0], &_block[0] + BlockSize);
+}
+
+BgzfStreamBuf::~BgzfStreamBuf() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void BgzfStreamBuf::close() {
+    if (_writer.get() == NULL) {
+        return;
+    }
+    writeBlock();
+    unique_ptr<BgzfWriter> writer(_writer.release());
+    setp(NULL, NULL);
+    writer->close();
+}
+
+/* hand the text in the put area to the writer and start a new block */
+bool BgzfStreamBuf::writeBlock() {
+    if (_writer.get() == NULL) {
+        return false;
+    }
+    size_t size = pptr() - pbase();
+    if (size > 0) {
+        try {
+            _writer->addBlock(_block, size);
+        } catch (...) {
+            // the stream is unusable after an error
+            _writer.reset();
+            setp(NULL, NULL);
+            throw;
+        }
+        _block.resize(BlockSize);
+        _position += size;
+    }
+    setp(&_block[0], &_block[0] + BlockSize);
+    return true;
+}
+
+BgzfStreamBuf::int_type BgzfStreamBuf::overflow(int_type c) {
+    if (!writeBlock()) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+streamsize BgzfStreamBuf::xsputn(const char *s, streamsize n) {
+    streamsize written = 0;
+    while (written < n) {
+        if (pptr() == epptr() && !writeBlock()) {
+            break;
+        }
+        streamsize size = min(n - written, (streamsize)(epptr() - pptr()));
+        memcpy(pptr(), s + written, size);
+        pbump((int)size);
+        written += size;
+    }
+    return written;
+}
+
+int BgzfStreamBuf::sync() {
+    return _writer.get() != NULL ? 0 : -1;
+}
+
+BgzfStreamBuf::pos_type BgzfStreamBuf::seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode which) {
+    if (off != 0 || dir != ios_base::cur || !(which & ios_base::out)) {
+        return pos_type(off_type(-1));
+    }
+    return pos_type(off_type(_position + (pptr() - pbase())));
+}
+
+OutputFile::OutputFile(const string &path, size_t numCompressThreads, bool append)
+    : _path(path), _stream(NULL), _closed(false) {
+    if (isStdout()) {
+        _stream = &cout;
+    } else if (isCompressedPath(path)) {
+        _bgzfBuf.reset(new BgzfStreamBuf(path, numCompressThreads, append));
+        _bgzfStream.reset(new ostream(_bgzfBuf.get()));
+        _stream = _bgzfStream.get();
+    } else {
+        _file.open(path.c_str(), append ? (ios_base::out | ios_base::app) : ios_base::out);
+        if (!_file) {
+            throw hal_exception("Error opening " + path);
+        }
+        _stream = &_file;
+    }
+}
+
+OutputFile::~OutputFile() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void OutputFile::close() {
+    if (_closed) {
+        return;
+    }
+    _closed = true;
+    _stream->flush();
+    if (_stream->bad()) {
+        throw hal_exception("Error writing " + _path);
+    }
+    if (_bgzfBuf.get() != NULL) {
+        _bgzfBuf->close();
+    } else if (!isStdout()) {
+        _file.close();
+        if (_file.fail()) {
+            throw hal_exception("Error writing " + _path);
+        }
+    }
+}
+
+bool OutputFile::isCompressedPath(const string &path) {
+    return (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) ||
+           (path.size() > 4 && path.compare(path.size() - 4, 4, ".bgz") == 0);
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halParallel.h"
+#include "halAlignment.h"
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    /* state shared between the workers and the writer */
+    class OrderedTaskQueue {
+      public:
+        OrderedTaskQueue(size_t numTasks, size_t maxPending)
+            : _numTasks(numTasks), _maxPending(maxPending), _nextTask(0), _nextWrite(0), _outputs(numTasks),
+              _done(numTasks, false), _failed(false) {
+        }
+
+        /* get the next task to run, waiting if too many outputs are pending.
+         * returns false when there is no more work. */
+        bool nextTask(size_t &taskIndex) {
+            unique_lock<mutex> lock(_mutex);
+            _taskCond.wait(lock, [this] { return _failed || _nextTask >= _numTasks || _nextTask < _nextWrite + _maxPending; });
+            if (_failed || _nextTask >= _numTasks) {
+                return false;
+            }
+            taskIndex = _nextTask++;
+            return true;
+        }
+
+        void taskDone(size_t taskIndex, string &output) {
+            lock_guard<mutex> lock(_mutex);
+            _outputs[taskIndex].swap(output);
+            _done[taskIndex] = true;
+            _writeCond.notify_one();
+        }
+
+        void taskFailed(exception_ptr error) {
+            lock_guard<mutex> lock(_mutex);
+            if (!_failed) {
+                _failed = true;
+                _error = error;
+            }
+            _taskCond.notify_all();
+            _writeCond.notify_one();
+        }
+
+        /* wait for the next output in order, returns false on error */
+        bool nextOutput(size_t taskIndex, string &output) {
+            unique_lock<mutex> lock(_mutex);
+            _writeCond.wait(lock, [this, taskIndex] { return _failed || _done[taskIndex]; });
+            if (_failed) {
+                return false;
+            }
+            output.swap(_outputs[taskIndex]);
+            string().swap(_outputs[taskIndex]);
+            _nextWrite = taskIndex + 1;
+            _taskCond.notify_all();
+            return true;
+        }
+
+        void rethrowIfFailed() {
+            if (_error) {
+                rethrow_exception(_error);
+            }
+        }
+
+      private:
+        size_t _numTasks;
+        size_t _maxPending;
+        size_t _nextTask;
+        size_t _nextWrite;
+        vector<string> _outputs;
+        vector<bool> _done;
+        bool _failed;
+        exception_ptr _error;
+        mutex _mutex;
+        condition_variable _taskCond;
+        condition_variable _writeCond;
+    };
+}
+
+static void orderedTaskWorker(OrderedTaskQueue *queue, const ParallelTaskFunc *taskFunc) {
+    size_t taskIndex;
+    string output;
+    while (queue->nextTask(taskIndex)) {
+        try {
+            output.clear();
+            (*taskFunc)(taskIndex, output);
+            queue->taskDone(taskIndex, output);
+        } catch (...) {
+            queue->taskFailed(current_exception());
+            return;
+        }
+    }
+}
+
+void hal::runOrderedTasks(size_t numTasks, size_t numThreads, const ParallelTaskFunc &taskFunc,
+                          const OrderedOutputFunc &writeFunc, size_t maxPending) {
+    if (numThreads <= 1 || numTasks <= 1) {
+        string output;
+        for (size_t i = 0; i < numTasks; ++i) {
+            output.clear();
+            taskFunc(i, output);
+            writeFunc(i, output);
+        }
+        return;
+    }
+    numThreads = min(numThreads, numTasks);
+    if (maxPending == 0) {
+        maxPending = 4 * numThreads;
+    }
+    OrderedTaskQueue queue(numTasks, max(maxPending, numThreads));
+    vector<thread> workers;
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers.push_back(thread(orderedTaskWorker, &queue, &taskFunc));
+    }
+    string output;
+    try {
+        for (size_t i = 0; i < numTasks && queue.nextOutput(i, output); ++i) {
+            writeFunc(i, output);
+        }
+    } catch (...) {
+        queue.taskFailed(current_exception());
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    queue.rethrowIfFailed();
+}
+
+vector<hal_index_t> hal::shardRange(hal_index_t start, hal_size_t length, hal_size_t shardLength) {
+    vector<hal_index_t> shardStarts;
+    if (shardLength == 0) {
+        shardLength = length;
+    }
+    for (hal_size_t offset = 0; offset < length; offset += shardLength) {
+        shardStarts.push_back(start + (hal_index_t)offset);
+    }
+    return shardStarts;
+}
+
+void hal::checkSharedAccess(const Alignment *alignment) {
+    if (not alignment->isSharedAccess()) {
+        throw hal_exception("multi-threaded access requires the alignment to be opened with READ_SHARED_ACCESS");
+    }
+}
@@ -5,101 +5,207 @@
  * Released under the MIT license, see LICENSE.txt
  */
 #include "halPositionCache.h"
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 using namespace hal;
 
-bool PositionCache::insert(hal_index_t pos) {
-    IntervalSet::iterator i;
-    if (_prev != _set.end() && _prev->first == pos - 1) {
-        ++_prev;
-        i = _prev;
-        assert(i == _set.lower_bound(pos));
-    } else {
-        i = _set.lower_bound(pos);
-    }
-    _prev = i;
+typedef PositionCache::Interval Interval;
+typedef PositionCache::IntervalSet IntervalSet;
 
-    IntervalSet::iterator j;
-    if (i != _set.end() && i->second <= pos) {
-        assert(i->first >= pos);
-        return false;
+const size_t PositionCache::NoHint;
+const size_t PositionCache::MinPendingSize;
+
+/* index of the first interval ending at or after pos */
+static size_t lowerBound(const IntervalSet &set, hal_index_t pos) {
+    return lower_bound(set.begin(), set.end(), pos, [](const Interval &i, hal_index_t p) { return i._last < p; }) -
+           set.begin();
+}
+
+static bool findInSet(const IntervalSet &set, hal_index_t pos) {
+    size_t i = lowerBound(set, pos);
+    return i < set.size() && set[i]._first <= pos;
+}
+
+/* lower bound of pos, given the lower bound of a neighbouring position
+ * when there is one, so runs of inserts don't need to search */
+static size_t lowerBound(const IntervalSet &set, hal_index_t pos, hal_index_t hintPos, size_t hint) {
+    if (hint != PositionCache::NoHint && pos == hintPos + 1) {
+        return (hint == set.size() || set[hint]._last >= pos) ? hint : hint + 1;
+    } else if (hint != PositionCache::NoHint && pos == hintPos - 1) {
+        return (hint > 0 && set[hint - 1]._last >= pos) ? hint - 1 : hint;
     }
+    return lowerBound(set, pos);
+}
 
-    // merge to beginning of existing interval
-    if (i != _set.end() && i->second == pos + 1) {
-        --i->second;
+/* add pos, which must not already be present, to a set at its lower bound
+ * i, merging with the intervals on either side.  returns the index of the
+ * interval containing pos */
+static size_t insertInSet(IntervalSet &set, hal_index_t pos, size_t i) {
+    bool joinsLeft = i > 0 && set[i - 1]._last + 1 == pos;
+    bool joinsRight = i < set.size() && set[i]._first == pos + 1;
+    if (joinsLeft && joinsRight) {
+        set[i - 1]._last = set[i]._last;
+        set.erase(set.begin() + i);
+        return i - 1;
+    } else if (joinsLeft) {
+        set[i - 1]._last = pos;
+        return i - 1;
+    } else if (joinsRight) {
+        set[i]._first = pos;
     } else {
-        // set hint to position before pos in set.  according to the docs, the
-        // hint works differently in C++11 where it wants the position *after*
-        // so we try to detect the compiler below...
-        j = i;
-#if __cplusplus < 201103L
-        if (j != _set.begin()) {
-            --j;
-        }
-#endif
-        // create new unit interval
-        i = _set.insert(j, pair<hal_index_t, hal_index_t>(pos, pos));
-        _prev = i;
+        Interval interval = {pos, pos};
+        set.insert(set.begin() + i, interval);
     }
-    assert(i->second <= i->first);
-    // merge abutting left interval
-    if (i != _set.begin()) {
-        j = i;
-        --j;
-        if (j->first == i->second - 1) {
-            i->second = j->second;
-            assert(i->second <= i->first);
-            _set.erase(j);
+    return i;
+}
+
+/* union of two sorted interval lists, which may overlap or abut */
+static void unionInto(const IntervalSet &a, const IntervalSet &b, IntervalSet &out) {
+    out.clear();
+    out.reserve(a.size() + b.size());
+    IntervalSet::const_iterator i = a.begin();
+    IntervalSet::const_iterator j = b.begin();
+    while (i != a.end() || j != b.end()) {
+        const Interval &next = (j == b.end() || (i != a.end() && i->_first <= j->_first)) ? *i++ : *j++;
+        if (!out.empty() && out.back()._last + 1 >= next._first) {
+            out.back()._last = max(out.back()._last, next._last);
+        } else {
+            out.push_back(next);
         }
     }
+}
+
+static hal_size_t countPositions(const IntervalSet &set) {
+    hal_size_t size = 0;
+    for (IntervalSet::const_iterator i = set.begin(); i != set.end(); ++i) {
+        size += (i->_last + 1) - i->_first;
+    }
+    return size;
+}
 
-    // merge abutting right interval
-    j = i;
-    ++j;
-    if (j != _set.end() && j->second == i->first + 1) {
-        j->second = i->second;
-        assert(j->second <= j->first);
-        _set.erase(i);
+bool PositionCache::insert(hal_index_t pos) {
+    // inserts tend to run left to right (or right to left), so the search
+    // starts from where the previous position was found
+    size_t i = lowerBound(_set, pos, _prevPos, _prevIndex);
+    size_t j = lowerBound(_pending, pos, _prevPos, _prevPendingIndex);
+    _prevPos = pos;
+    _prevIndex = i;
+    _prevPendingIndex = j;
+    if ((i < _set.size() && _set[i]._first <= pos) || (j < _pending.size() && _pending[j]._first <= pos)) {
+        return false;
     }
 
+    // extend a neighbouring interval in place, unless that would join two
+    // intervals, which needs an erase from the vector and is left to the
+    // next flush
+    bool joinsLeft = i > 0 && _set[i - 1]._last + 1 == pos;
+    bool joinsRight = i < _set.size() && _set[i]._first == pos + 1;
+    if (joinsLeft && !joinsRight) {
+        _set[i - 1]._last = pos;
+        _prevIndex = i - 1;
+    } else if (joinsRight && !joinsLeft) {
+        _set[i]._first = pos;
+    } else {
+        _prevPendingIndex = insertInSet(_pending, pos, j);
+        if (_pending.size() > max(MinPendingSize, (size_t)sqrt((double)_set.size()))) {
+            flushPending();
+        }
+    }
     ++_size;
     assert(find(pos) == true);
     return true;
 }
 
-bool PositionCache::find(hal_index_t pos) const {
-    IntervalSet::const_iterator i = _set.lower_bound(pos);
-    if (i != _set.end() && i->second <= pos) {
-        return true;
+void PositionCache::insert(hal_index_t first, hal_index_t last) {
+    assert(first <= last);
+    flushPending();
+    // all intervals that overlap or abut [first, last] get absorbed
+    size_t i = lowerBound(_set, first - 1);
+    size_t j = i;
+    while (j < _set.size() && _set[j]._first <= last + 1) {
+        first = min(first, _set[j]._first);
+        last = max(last, _set[j]._last);
+        _size -= (_set[j]._last + 1) - _set[j]._first;
+        ++j;
     }
-    return false;
+    Interval interval = {first, last};
+    if (i == j) {
+        _set.insert(_set.begin() + i, interval);
+    } else {
+        _set[i] = interval;
+        _set.erase(_set.begin() + i + 1, _set.begin() + j);
+    }
+    _size += (last + 1) - first;
+    resetHints();
+}
+
+void PositionCache::merge(const PositionCache &other) {
+    flushPending();
+    IntervalSet merged;
+    if (other._pending.empty()) {
+        unionInto(_set, other._set, merged);
+    } else {
+        IntervalSet otherSet;
+        unionInto(other._set, other._pending, otherSet);
+        unionInto(_set, otherSet, merged);
+    }
+    _set.swap(merged);
+    _size = countPositions(_set);
+    resetHints();
+}
+
+bool PositionCache::find(hal_index_t pos) const {
+    return findInSet(_set, pos) || (!_pending.empty() && findInSet(_pending, pos));
 }
 
 void PositionCache::clear() {
     _set.clear();
+    _pending.clear();
     _size = 0;
-    _prev = _set.begin();
+    resetHints();
+}
+
+void PositionCache::resetHints() {
+    _prevIndex = NoHint;
+    _prevPendingIndex = NoHint;
+}
+
+void PositionCache::flushPending() {
+    if (!_pending.empty()) {
+        IntervalSet merged;
+        unionInto(_set, _pending, merged);
+        _set.swap(merged);
+        _pending.clear();
+        resetHints();
+    }
 }
 
 // for debugging
+static bool checkSet(const IntervalSet &set) {
+    for (size_t i = 0; i < set.size(); ++i) {
+        if (set[i]._first > set[i]._last) {
+            return false;
+        }
+        // test overlap and merge
+        if (i + 1 < set.size() && set[i + 1]._first <= set[i]._last + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool PositionCache::check() const {
-    hal_size_t size = 0;
-    for (IntervalSet::const_iterator i = _set.begin(); i != _set.end(); ++i) {
-        size += (i->first + 1) - i->second;
-        IntervalSet::const_iterator j = i;
-        ++j;
-        if (j != _set.end()) {
-            // test overlap
-            if (j->second <= i->first || i->second >= j->first) {
-                return false;
-            }
-            // test merge
-            if (j->second == i->first + 1) {
-                return false;
-            }
+    if (!checkSet(_set) || !checkSet(_pending)) {
+        return false;
+    }
+    // pending intervals may abut but not overlap the main set
+    for (IntervalSet::const_iterator i = _pending.begin(); i != _pending.end(); ++i) {
+        size_t j = lowerBound(_set, i->_first);
+        if (j < _set.size() && _set[j]._first <= i->_last) {
+            return false;
         }
     }
-    return size == _size;
+    return countPositions(_set) + countPositions(_pending) == _size;
 }
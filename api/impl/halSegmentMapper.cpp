@@ -12,323 +12,15 @@
 #include "halSegmentIterator.h"
 #include "halTopSegmentIterator.h"
 #include <cassert>
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 using namespace std;
 using namespace hal;
 
 enum OverlapCat { Same, Disjoint, AContainsB, BContainsA, AOverlapsLeftOfB, BOverlapsLeftOfA };
 
-static hal_size_t mapSelf(MappedSegmentPtr mappedSeg, list<MappedSegmentPtr> &results, hal_size_t minLength);
-
-// note: takes smart pointer as it maybe added to the results
-static hal_size_t mapUp(MappedSegmentPtr mappedSeg, list<MappedSegmentPtr> &results, bool doDupes, hal_size_t minLength) {
-    const Genome *parent = mappedSeg->getGenome()->getParent();
-    assert(parent != NULL);
-    hal_size_t added = 0;
-    if (mappedSeg->isTop() == true) {
-        BottomSegmentIteratorPtr botSegIt = parent->getBottomSegmentIterator();
-        TopSegmentIteratorPtr topSegIt = mappedSeg->targetAsTop();
-        if (topSegIt->tseg()->hasParent() == true && topSegIt->getLength() >= minLength &&
-            (doDupes == true || topSegIt->tseg()->isCanonicalParalog() == true)) {
-            botSegIt->toParent(topSegIt);
-            mappedSeg->setTarget(std::dynamic_pointer_cast<SegmentIterator>(botSegIt));
-            results.push_back(mappedSeg);
-            ++added;
-        }
-    } else {
-        hal_index_t rightCutoff = mappedSeg->getEndPosition();
-        BottomSegmentIteratorPtr botSegIt = mappedSeg->targetAsBottom();
-        hal_index_t startOffset = (hal_index_t)botSegIt->getStartOffset();
-        hal_index_t endOffset = (hal_index_t)botSegIt->getEndOffset();
-        TopSegmentIteratorPtr topSegIt = mappedSeg->getGenome()->getTopSegmentIterator();
-        topSegIt->toParseUp(botSegIt);
-        do {
-            TopSegmentIteratorPtr newTopSegIt = topSegIt->clone();
-
-            // we map the new target back to see how the offsets have
-            // changed.  these changes are then applied to the source segment
-            // as deltas
-            BottomSegmentIteratorPtr backBotSegIt = botSegIt->clone();
-            backBotSegIt->toParseDown(newTopSegIt);
-            hal_index_t startBack = (hal_index_t)backBotSegIt->getStartOffset();
-            hal_index_t endBack = (hal_index_t)backBotSegIt->getEndOffset();
-            assert(startBack >= startOffset);
-            assert(endBack >= endOffset);
-            SegmentIteratorPtr newSourceSegIt = mappedSeg->sourceClone();
-            hal_index_t startDelta = startBack - startOffset;
-            hal_index_t endDelta = endBack - endOffset;
-            assert((hal_index_t)newSourceSegIt->getLength() > startDelta + endDelta);
-            newSourceSegIt->slice(newSourceSegIt->getStartOffset() + startDelta, newSourceSegIt->getEndOffset() + endDelta);
-
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSourceSegIt, newTopSegIt));
-
-            assert(newMappedSeg->isTop() == true);
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-
-            added += mapUp(newMappedSeg, results, doDupes, minLength);
-            // stupid that we have to make this check but odn't want to
-            // make fundamental api change now
-            if (topSegIt->getEndPosition() != rightCutoff) {
-                topSegIt->toRight(rightCutoff);
-            } else {
-                break;
-            }
-        } while (true);
-    }
-    return added;
-}
-
-// Map the input segments up until reaching the target genome. If the
-// target genome is below the source genome, fail miserably.
-// Destructive to any data in the input or results list.
-static hal_size_t mapRecursiveUp(list<MappedSegmentPtr> &input, list<MappedSegmentPtr> &results, const Genome *tgtGenome,
-                                 hal_size_t minLength) {
-    list<MappedSegmentPtr> *inputPtr = &input;
-    list<MappedSegmentPtr> *outputPtr = &results;
-
-    if (inputPtr->empty() || (*inputPtr->begin())->getGenome() == tgtGenome) {
-        results = *inputPtr;
-        return 0;
-    }
-
-    const Genome *curGenome = (*inputPtr->begin())->getGenome();
-    assert(curGenome != NULL);
-    const Genome *nextGenome = curGenome->getParent();
-
-    if (nextGenome == NULL) {
-        throw hal_exception("Reached top of tree when attempting to recursively map up from " + curGenome->getName() + " to " +
-                            tgtGenome->getName());
-    }
-
-    // Map all segments to the parent.
-    list<MappedSegmentPtr>::iterator i = inputPtr->begin();
-    for (; i != inputPtr->end(); ++i) {
-        assert((*i)->getGenome() == curGenome);
-        mapUp(*i, *outputPtr, true, minLength);
-    }
-
-    if (nextGenome != tgtGenome) {
-        // Continue the recursion.
-        swap(inputPtr, outputPtr);
-        outputPtr->clear();
-        mapRecursiveUp(*inputPtr, *outputPtr, tgtGenome, minLength);
-    }
-
-    if (outputPtr != &results) {
-        results = *outputPtr;
-    }
-
-    results.sort(MappedSegment::LessSourcePtr());
-    results.unique(MappedSegment::EqualToPtr());
-    return results.size();
-}
-
-// note: takes smart pointer as it maybe added to the results
-static hal_size_t mapDown(MappedSegmentPtr mappedSeg, hal_size_t childIndex, list<MappedSegmentPtr> &results,
-                          hal_size_t minLength) {
-    const Genome *child = mappedSeg->getGenome()->getChild(childIndex);
-    assert(child != NULL);
-    hal_size_t added = 0;
-    if (mappedSeg->isTop() == false) {
-        TopSegmentIteratorPtr topSegIt = child->getTopSegmentIterator();
-        SegmentIteratorPtr targetSegIt = mappedSeg->getTargetIteratorPtr();
-        BottomSegmentIteratorPtr botSegIt = std::dynamic_pointer_cast<BottomSegmentIterator>(targetSegIt);
-
-        if (botSegIt->bseg()->hasChild(childIndex) == true && botSegIt->getLength() >= minLength) {
-            topSegIt->toChild(botSegIt, childIndex);
-            mappedSeg->setTarget(std::dynamic_pointer_cast<SegmentIterator>(topSegIt));
-            results.push_back(MappedSegmentPtr(mappedSeg));
-            ++added;
-        }
-    } else {
-        hal_index_t rightCutoff = mappedSeg->getEndPosition();
-        TopSegmentIteratorPtr topSegIt = mappedSeg->targetAsTop();
-        hal_index_t startOffset = (hal_index_t)topSegIt->getStartOffset();
-        hal_index_t endOffset = (hal_index_t)topSegIt->getEndOffset();
-        BottomSegmentIteratorPtr botSegIt = mappedSeg->getGenome()->getBottomSegmentIterator();
-        botSegIt->toParseDown(topSegIt);
-        do {
-            BottomSegmentIteratorPtr newBotSegIt = botSegIt->clone();
-
-            // we map the new target back to see how the offsets have
-            // changed.  these changes are then applied to the source segment
-            // as deltas
-            TopSegmentIteratorPtr backTopSegIt = topSegIt->clone();
-            backTopSegIt->toParseUp(newBotSegIt);
-            hal_index_t startBack = (hal_index_t)backTopSegIt->getStartOffset();
-            hal_index_t endBack = (hal_index_t)backTopSegIt->getEndOffset();
-            assert(startBack >= startOffset);
-            assert(endBack >= endOffset);
-            SegmentIteratorPtr newSourceSegIt = mappedSeg->sourceClone();
-            hal_index_t startDelta = startBack - startOffset;
-            hal_index_t endDelta = endBack - endOffset;
-            assert((hal_index_t)newSourceSegIt->getLength() > startDelta + endDelta);
-            newSourceSegIt->slice(newSourceSegIt->getStartOffset() + startDelta, newSourceSegIt->getEndOffset() + endDelta);
-
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSourceSegIt, newBotSegIt));
-
-            assert(newMappedSeg->isTop() == false);
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-
-            added += mapDown(newMappedSeg, childIndex, results, minLength);
-
-            // stupid that we have to make this check but odn't want to
-            // make fundamental api change now
-            if (botSegIt->getEndPosition() != rightCutoff) {
-                botSegIt->toRight(rightCutoff);
-            } else {
-                break;
-            }
-        } while (true);
-    }
-    return added;
-}
-
-// Map the input segments down until reaching the target genome. If the
-// target genome is above the source genome, fail miserably.
-// Destructive to any data in the input or results list.
-static hal_size_t mapRecursiveDown(list<MappedSegmentPtr> &input, list<MappedSegmentPtr> &results, const Genome *tgtGenome,
-                                   const set<string> &namesOnPath, bool doDupes, hal_size_t minLength) {
-    list<MappedSegmentPtr> *inputPtr = &input;
-    list<MappedSegmentPtr> *outputPtr = &results;
-
-    if (inputPtr->empty()) {
-        results = *inputPtr;
-        return 0;
-    }
-
-    const Genome *curGenome = (*inputPtr->begin())->getGenome();
-    assert(curGenome != NULL);
-    if (curGenome == tgtGenome) {
-        results = *inputPtr;
-        return 0;
-    }
-
-    // Find the correct child to move down into.
-    const Genome *nextGenome = NULL;
-    hal_size_t nextChildIndex = numeric_limits<hal_size_t>::max();
-    const Alignment *alignment = curGenome->getAlignment();
-    vector<string> childNames = alignment->getChildNames(curGenome->getName());
-    for (hal_size_t child = 0; nextGenome == NULL && child < childNames.size(); ++child) {
-        if (childNames[child] == tgtGenome->getName() || namesOnPath.find(childNames[child]) != namesOnPath.end()) {
-            const Genome *childGenome = curGenome->getChild(child);
-            nextGenome = childGenome;
-            nextChildIndex = child;
-        }
-    }
-
-    if (nextGenome == NULL) {
-        throw hal_exception("Could not find correct child that leads from " + curGenome->getName() + " to " +
-                            tgtGenome->getName());
-    }
-
-    assert(nextGenome->getParent() == curGenome);
-
-    // Map the actual segments down.
-    list<MappedSegmentPtr>::iterator i = inputPtr->begin();
-    for (; i != inputPtr->end(); ++i) {
-        assert((*i)->getGenome() == curGenome);
-        mapDown(*i, nextChildIndex, *outputPtr, minLength);
-    }
-
-    // Find paralogs.
-    if (doDupes == true) {
-        swap(inputPtr, outputPtr);
-        outputPtr->clear();
-        list<MappedSegmentPtr>::iterator i = inputPtr->begin();
-        for (; i != inputPtr->end(); ++i) {
-            assert((*i)->getGenome() == nextGenome);
-            mapSelf(*i, *outputPtr, minLength);
-        }
-    }
-
-    if (nextGenome != tgtGenome) {
-        // Continue the recursion.
-        swap(inputPtr, outputPtr);
-        outputPtr->clear();
-        mapRecursiveDown(*inputPtr, *outputPtr, tgtGenome, namesOnPath, doDupes, minLength);
-    }
-
-    if (outputPtr != &results) {
-        results = *outputPtr;
-    }
-
-    results.sort(MappedSegment::LessSourcePtr());
-    results.unique(MappedSegment::EqualToPtr());
-    return results.size();
-}
-
-// note: takes smart pointer as it maybe added to the results
-static hal_size_t mapSelf(MappedSegmentPtr mappedSeg, list<MappedSegmentPtr> &results, hal_size_t minLength) {
-    hal_size_t added = 0;
-    if (mappedSeg->isTop() == true) {
-        SegmentIteratorPtr target = mappedSeg->getTargetIteratorPtr();
-        SegmentIteratorPtr source = mappedSeg->getSourceIteratorPtr();
-        TopSegmentIteratorPtr top = std::dynamic_pointer_cast<TopSegmentIterator>(target);
-        TopSegmentIteratorPtr topCopy = top->clone();
-        do {
-            // FIXME: why isn't clone() polymorphic?
-            SegmentIteratorPtr newSource;
-            if (source->isTop()) {
-                newSource = std::dynamic_pointer_cast<TopSegmentIterator>(source)->clone();
-            } else {
-                newSource = std::dynamic_pointer_cast<BottomSegmentIterator>(source)->clone();
-            }
-            TopSegmentIteratorPtr newTop = topCopy->clone();
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSource, newTop));
-            assert(newMappedSeg->getGenome() == mappedSeg->getGenome());
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-            results.push_back(newMappedSeg);
-            ++added;
-            if (topCopy->tseg()->hasNextParalogy()) {
-                topCopy->toNextParalogy();
-            }
-        } while (topCopy->tseg()->hasNextParalogy() == true && topCopy->getLength() >= minLength &&
-                 topCopy->getArrayIndex() != top->getArrayIndex());
-    } else if (mappedSeg->getGenome()->getParent() != NULL) {
-        hal_index_t rightCutoff = mappedSeg->getEndPosition();
-        BottomSegmentIteratorPtr bottom = mappedSeg->targetAsBottom();
-        hal_index_t startOffset = (hal_index_t)bottom->getStartOffset();
-        hal_index_t endOffset = (hal_index_t)bottom->getEndOffset();
-        TopSegmentIteratorPtr top = mappedSeg->getGenome()->getTopSegmentIterator();
-        top->toParseUp(bottom);
-        do {
-            TopSegmentIteratorPtr topNew = top->clone();
-
-            // we map the new target back to see how the offsets have
-            // changed.  these changes are then applied to the source segment
-            // as deltas
-            BottomSegmentIteratorPtr bottomBack = bottom->clone();
-            bottomBack->toParseDown(topNew);
-            hal_index_t startBack = (hal_index_t)bottomBack->getStartOffset();
-            hal_index_t endBack = (hal_index_t)bottomBack->getEndOffset();
-            assert(startBack >= startOffset);
-            assert(endBack >= endOffset);
-            SegmentIteratorPtr newSource = mappedSeg->sourceClone();
-            hal_index_t startDelta = startBack - startOffset;
-            hal_index_t endDelta = endBack - endOffset;
-            assert((hal_index_t)newSource->getLength() > startDelta + endDelta);
-            newSource->slice(newSource->getStartOffset() + startDelta, newSource->getEndOffset() + endDelta);
-
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSource, topNew));
-
-            assert(newMappedSeg->isTop() == true);
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-
-            added += mapSelf(newMappedSeg, results, minLength);
-            // stupid that we have to make this check but odn't want to
-            // make fundamental api change now
-            if (top->getEndPosition() != rightCutoff) {
-                top->toRight(rightCutoff);
-            } else {
-                break;
-            }
-        } while (true);
-    }
-    return added;
-}
-
 static OverlapCat slowOverlap(const SlicedSegment *sA, const SlicedSegment *sB) {
     hal_index_t startA = sA->getStartPosition();
     hal_index_t endA = sA->getEndPosition();
@@ -519,156 +211,666 @@ static void insertAndBreakOverlaps(MappedSegmentPtr seg, MappedSegmentSet &resul
     results.insert(inputSegs.begin(), inputSegs.end());
 }
 
-// Map all segments from the input to any segments in the same genome
-// that coalesce in or before the given "coalescence limit" genome.
-// Destructive to any data in the input list.
-static hal_size_t mapRecursiveParalogies(const Genome *srcGenome, list<MappedSegmentPtr> &input,
-                                         list<MappedSegmentPtr> &results, const set<string> &namesOnPath,
-                                         const Genome *coalescenceLimit, hal_size_t minLength) {
-    if (input.empty()) {
-        results = input;
-        return 0;
+
+//////////////////////////////////////////////////////////////////////////////
+// SEGMENT MAPPER
+//////////////////////////////////////////////////////////////////////////////
+
+SegmentMapper::SegmentMapper()
+    : _lastSrcGenome(NULL), _lastTgtGenome(NULL), _lastMrca(NULL), _pathTgtGenome(NULL), _pathMrca(NULL),
+      _genomesOnPath(NULL) {
+}
+
+SegmentMapper::~SegmentMapper() {
+}
+
+void SegmentMapper::clear() {
+    _iterators.clear();
+    _lastSrcGenome = NULL;
+    _lastTgtGenome = NULL;
+    _lastMrca = NULL;
+    _pathTgtGenome = NULL;
+    _pathMrca = NULL;
+    _path.clear();
+}
+
+SegmentMapper::GenomeIterators &SegmentMapper::getIterators(const Genome *genome) {
+    // few genomes are visited, so a linear search beats a map
+    for (size_t i = 0; i < _iterators.size(); ++i) {
+        if (_iterators[i]._genome == genome) {
+            return _iterators[i];
+        }
+    }
+    GenomeIterators iterators;
+    iterators._genome = genome;
+    if (genome->getParent() != NULL) {
+        iterators._top = genome->getTopSegmentIterator();
+    }
+    if (genome->getNumChildren() > 0) {
+        iterators._bottom = genome->getBottomSegmentIterator();
     }
+    _iterators.push_back(iterators);
+    return _iterators.back();
+}
 
-    const Genome *curGenome = (*input.begin())->getGenome();
-    assert(curGenome != NULL);
-    if (curGenome == coalescenceLimit) {
-        results = input;
-        return 0;
+const TopSegment *SegmentMapper::getTopSegment(const Genome *genome, hal_index_t arrayIndex) {
+    TopSegmentIterator *top = getIterators(genome)._top.get();
+    top->setArrayIndex(top->getGenome(), arrayIndex);
+    return top->tseg();
+}
+
+const BottomSegment *SegmentMapper::getBottomSegment(const Genome *genome, hal_index_t arrayIndex) {
+    BottomSegmentIterator *bottom = getIterators(genome)._bottom.get();
+    bottom->setArrayIndex(bottom->getGenome(), arrayIndex);
+    return bottom->bseg();
+}
+
+const Segment *SegmentMapper::getSegment(const SegmentInterval &interval) {
+    if (interval._top) {
+        return getTopSegment(interval._genome, interval._arrayIndex);
+    } else {
+        return getBottomSegment(interval._genome, interval._arrayIndex);
     }
+}
 
-    const Genome *nextGenome = curGenome->getParent();
+hal_index_t SegmentMapper::getStartPosition(const SegmentInterval &interval) {
+    const Segment *segment = getSegment(interval);
+    if (not interval._reversed) {
+        return segment->getStartPosition() + interval._startOffset;
+    } else {
+        return segment->getStartPosition() + segment->getLength() - interval._startOffset - 1;
+    }
+}
 
-    if (nextGenome == NULL) {
-        throw hal_exception("Hit root genome when attempting to map paralogies");
+hal_index_t SegmentMapper::getEndPosition(const SegmentInterval &interval) {
+    if (not interval._reversed) {
+        return getStartPosition(interval) + (hal_index_t)(getLength(interval) - 1);
+    } else {
+        return getStartPosition(interval) - (hal_index_t)(getLength(interval) - 1);
     }
-    list<MappedSegmentPtr> paralogs;
-    // Map to any paralogs in the current genome.
-    // FIXME: I think the original segments are included in this, which is a waste.
-    list<MappedSegmentPtr>::iterator i = input.begin();
-    for (; i != input.end(); ++i) {
-        assert((*i)->getGenome() == curGenome);
-        mapSelf(*i, paralogs, minLength);
+}
+
+hal_size_t SegmentMapper::getLength(const SegmentInterval &interval) {
+    return getSegment(interval)->getLength() - interval._endOffset - interval._startOffset;
+}
+
+SegmentIteratorPtr SegmentMapper::getIterator(const SegmentInterval &interval) const {
+    SegmentIteratorPtr it;
+    if (interval._top) {
+        it = interval._genome->getTopSegmentIterator(interval._arrayIndex);
+    } else {
+        it = interval._genome->getBottomSegmentIterator(interval._arrayIndex);
+    }
+    if (interval._reversed) {
+        it->toReverse();
     }
+    it->slice(interval._startOffset, interval._endOffset);
+    return it;
+}
 
-    if (nextGenome != coalescenceLimit) {
-        list<MappedSegmentPtr> nextSegments;
-        // Map all of the original segments (not the paralogs, which is a
-        // waste) up to the next genome.
-        i = input.begin();
-        for (; i != input.end(); ++i) {
-            assert((*i)->getGenome() == curGenome);
-            mapUp(*i, nextSegments, true, minLength);
-        }
+// The moves below are those of the segment iterators (toParent(),
+// toChild(), toParseUp(), ...), applied to intervals in place
 
-        // Recurse on the mapped segments.
-        mapRecursiveParalogies(srcGenome, nextSegments, results, namesOnPath, coalescenceLimit, minLength);
+void SegmentMapper::toParent(SegmentInterval &interval) {
+    const TopSegment *top = getTopSegment(interval._genome, interval._arrayIndex);
+    interval._genome = interval._genome->getParent();
+    interval._arrayIndex = top->getParentIndex();
+    interval._top = false;
+    if (top->getParentReversed() == true) {
+        interval._reversed = !interval._reversed;
     }
+}
 
-    // Map all the paralogs we found in this genome back to the source.
-    list<MappedSegmentPtr> paralogsMappedToSrc;
-    mapRecursiveDown(paralogs, paralogsMappedToSrc, srcGenome, namesOnPath, false, minLength);
-
-    results.splice(results.begin(), paralogsMappedToSrc);
-    results.sort(MappedSegment::LessSourcePtr());
-    results.unique(MappedSegment::EqualToPtr());
-    return results.size();
-}
-
-static hal_size_t mapSource(const SegmentIterator *source, MappedSegmentSet &results, const Genome *tgtGenome,
-                            const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
-                            const Genome *coalescenceLimit, const Genome *mrca) {
-    assert(source != NULL);
-
-    // FIXME: why does target start out as source??  This is all a bit clunky
-    SegmentIteratorPtr startSourceSegIt;
-    SegmentIteratorPtr startTargetSegIt;
-    if (source->isTop()) {
-        startSourceSegIt = dynamic_cast<const TopSegmentIterator *>(source)->clone();
-        startTargetSegIt = dynamic_cast<const TopSegmentIterator *>(source)->clone();
-    } else {
-        startSourceSegIt = dynamic_cast<const BottomSegmentIterator *>(source)->clone();
-        startTargetSegIt = dynamic_cast<const BottomSegmentIterator *>(source)->clone();
+void SegmentMapper::toChild(SegmentInterval &interval, hal_size_t childIndex) {
+    const BottomSegment *bottom = getBottomSegment(interval._genome, interval._arrayIndex);
+    interval._genome = interval._genome->getChild(childIndex);
+    interval._arrayIndex = bottom->getChildIndex(childIndex);
+    interval._top = true;
+    if (bottom->getChildReversed(childIndex) == true) {
+        interval._reversed = !interval._reversed;
     }
+}
 
-    MappedSegmentPtr newMappedSeg(new MappedSegment(startSourceSegIt, startTargetSegIt));
+void SegmentMapper::toParseUp(SegmentInterval &interval) {
+    assert(!interval._top);
+    hal_index_t startPos = getStartPosition(interval);
+    hal_index_t botLength = (hal_index_t)getLength(interval);
+    hal_index_t index = getBottomSegment(interval._genome, interval._arrayIndex)->getTopParseIndex();
+    const TopSegment *top = getTopSegment(interval._genome, index);
+    while (startPos >= top->getStartPosition() + (hal_index_t)top->getLength()) {
+        top = getTopSegment(interval._genome, ++index);
+    }
+    interval._arrayIndex = index;
+    interval._top = true;
+    if (interval._reversed == false) {
+        interval._startOffset = startPos - top->getStartPosition();
+        hal_index_t topEnd = top->getStartPosition() + (hal_index_t)top->getLength();
+        hal_index_t botEnd = startPos + botLength;
+        interval._endOffset = max((hal_index_t)0, topEnd - botEnd);
+    } else {
+        interval._startOffset = top->getStartPosition() + top->getLength() - 1 - startPos;
+        hal_index_t topEnd = top->getStartPosition();
+        hal_index_t botEnd = startPos - botLength + 1;
+        interval._endOffset = max((hal_index_t)0, botEnd - topEnd);
+    }
+    assert(interval._startOffset + interval._endOffset <= top->getLength());
+}
 
-    list<MappedSegmentPtr> input;
-    input.push_back(newMappedSeg);
-    list<MappedSegmentPtr> output;
+void SegmentMapper::toParseDown(SegmentInterval &interval) {
+    assert(interval._top);
+    hal_index_t startPos = getStartPosition(interval);
+    hal_index_t topLength = (hal_index_t)getLength(interval);
+    hal_index_t index = getTopSegment(interval._genome, interval._arrayIndex)->getBottomParseIndex();
+    const BottomSegment *bottom = getBottomSegment(interval._genome, index);
+    while (startPos >= bottom->getStartPosition() + (hal_index_t)bottom->getLength()) {
+        bottom = getBottomSegment(interval._genome, ++index);
+    }
+    interval._arrayIndex = index;
+    interval._top = false;
+    if (interval._reversed == false) {
+        interval._startOffset = startPos - bottom->getStartPosition();
+        hal_index_t botEnd = bottom->getStartPosition() + (hal_index_t)bottom->getLength();
+        hal_index_t topEnd = startPos + topLength;
+        interval._endOffset = max((hal_index_t)0, botEnd - topEnd);
+    } else {
+        interval._startOffset = bottom->getStartPosition() + bottom->getLength() - 1 - startPos;
+        hal_index_t botEnd = bottom->getStartPosition();
+        hal_index_t topEnd = startPos - topLength + 1;
+        interval._endOffset = max((hal_index_t)0, topEnd - botEnd);
+    }
+    assert(interval._startOffset + interval._endOffset <= bottom->getLength());
+}
 
-    set<string> namesOnPath;
-    assert(genomesOnPath != NULL);
-    for (set<const Genome *>::const_iterator i = genomesOnPath->begin(); i != genomesOnPath->end(); ++i) {
-        namesOnPath.insert((*i)->getName());
+bool SegmentMapper::overlaps(const SegmentInterval &interval, hal_index_t genomePos) {
+    hal_index_t startPos = getStartPosition(interval);
+    hal_index_t length = (hal_index_t)getLength(interval);
+    if (interval._reversed == false) {
+        return !(startPos + length <= genomePos) && !(startPos > genomePos);
+    } else {
+        return !(startPos < genomePos) && !(startPos - length >= genomePos);
     }
+}
 
-    // FIXME: using multiple lists is probably much slower than just
-    // reusing the results list over and over.
-    list<MappedSegmentPtr> upResults;
-    // Map all segments up to the MRCA of src and tgt.
-    if (source->getGenome() != mrca) {
-        mapRecursiveUp(input, upResults, mrca, minLength);
+void SegmentMapper::toRight(SegmentInterval &interval, hal_index_t rightCutoff) {
+    hal_size_t segLength = getSegment(interval)->getLength();
+    hal_index_t numSegments = interval._top ? interval._genome->getNumTopSegments()
+                                            : interval._genome->getNumBottomSegments();
+    if (interval._reversed == false) {
+        if (interval._endOffset == 0) {
+            ++interval._arrayIndex;
+            interval._startOffset = 0;
+        } else {
+            interval._startOffset = segLength - interval._endOffset;
+            interval._endOffset = 0;
+        }
+        if (interval._arrayIndex < numSegments && rightCutoff != NULL_INDEX && overlaps(interval, rightCutoff)) {
+            const Segment *segment = getSegment(interval);
+            interval._endOffset = segment->getStartPosition() + segment->getLength() - rightCutoff - 1;
+        }
     } else {
-        upResults = input;
+        if (interval._endOffset == 0) {
+            --interval._arrayIndex;
+            interval._startOffset = 0;
+        } else {
+            interval._startOffset = segLength - interval._endOffset;
+            interval._endOffset = 0;
+        }
+        if (rightCutoff != NULL_INDEX && overlaps(interval, rightCutoff)) {
+            interval._endOffset = rightCutoff - getSegment(interval)->getStartPosition();
+        }
     }
+}
 
-    list<MappedSegmentPtr> paralogResults;
-    // Map to all paralogs that coalesce in or below the coalescenceLimit.
-    if (mrca != coalescenceLimit && doDupes) {
-        mapRecursiveParalogies(mrca, upResults, paralogResults, namesOnPath, coalescenceLimit, minLength);
+void SegmentMapper::toNextParalogy(SegmentInterval &interval) {
+    const TopSegment *top = getTopSegment(interval._genome, interval._arrayIndex);
+    assert(top->getNextParalogyIndex() != NULL_INDEX);
+    bool rev = top->getParentReversed();
+    interval._arrayIndex = top->getNextParalogyIndex();
+    top = getTopSegment(interval._genome, interval._arrayIndex);
+    if (top->getParentReversed() != rev) {
+        interval._reversed = !interval._reversed;
+    }
+}
+
+// Same as MappedSegment::fastComp, which only looks at the segment and
+// the offsets unless the intervals are in different arrays
+int SegmentMapper::compare(const SegmentInterval &a, const SegmentInterval &b) {
+    assert(a._genome == b._genome);
+    if (a._top != b._top) {
+        hal_index_t sa = getStartPosition(a);
+        hal_index_t ea = getEndPosition(a);
+        hal_index_t sb = getStartPosition(b);
+        hal_index_t eb = getEndPosition(b);
+        if (a._reversed) {
+            swap(sa, ea);
+        }
+        if (b._reversed) {
+            swap(sb, eb);
+        }
+        if (sa != sb) {
+            return sa < sb ? -1 : 1;
+        }
+        return ea < eb ? -1 : (ea > eb ? 1 : 0);
+    }
+    if (a._arrayIndex != b._arrayIndex) {
+        return a._arrayIndex < b._arrayIndex ? -1 : 1;
+    }
+    hal_offset_t soa = a._startOffset;
+    hal_offset_t eoa = a._endOffset;
+    if (a._reversed) {
+        swap(soa, eoa);
+    }
+    hal_offset_t sob = b._startOffset;
+    hal_offset_t eob = b._endOffset;
+    if (b._reversed) {
+        swap(sob, eob);
+    }
+    if (soa != sob) {
+        return soa < sob ? -1 : 1;
+    }
+    return eoa > eob ? -1 : (eoa < eob ? 1 : 0);
+}
+
+// Sort by source then target, and drop duplicates, as the lists of mapped
+// segments were with LessSourcePtr and EqualToPtr
+void SegmentMapper::sortUnique(vector<MappedInterval> &intervals) {
+    stable_sort(intervals.begin(), intervals.end(), [this](const MappedInterval &a, const MappedInterval &b) {
+        int res = compare(a._source, b._source);
+        if (res == 0) {
+            res = compare(a._target, b._target);
+        }
+        return res == -1;
+    });
+    intervals.erase(unique(intervals.begin(), intervals.end(),
+                           [this](const MappedInterval &a, const MappedInterval &b) {
+                               return compare(a._source, b._source) == 0 && compare(a._target, b._target) == 0;
+                           }),
+                    intervals.end());
+}
+
+hal_size_t SegmentMapper::mapUp(const MappedInterval &mapped, vector<MappedInterval> &results, bool doDupes,
+                                hal_size_t minLength) {
+    const Genome *parent = mapped._target._genome->getParent();
+    assert(parent != NULL);
+    hal_size_t added = 0;
+    if (mapped._target._top == true) {
+        const TopSegment *top = getTopSegment(mapped._target._genome, mapped._target._arrayIndex);
+        if (top->hasParent() == true && getLength(mapped._target) >= minLength &&
+            (doDupes == true || top->isCanonicalParalog() == true)) {
+            results.push_back(mapped);
+            toParent(results.back()._target);
+            ++added;
+        }
     } else {
-        paralogResults = upResults;
+        hal_index_t rightCutoff = getEndPosition(mapped._target);
+        hal_index_t startOffset = (hal_index_t)mapped._target._startOffset;
+        hal_index_t endOffset = (hal_index_t)mapped._target._endOffset;
+        SegmentInterval top = mapped._target;
+        toParseUp(top);
+        do {
+            // we map the new target back to see how the offsets have
+            // changed.  these changes are then applied to the source segment
+            // as deltas
+            SegmentInterval back = top;
+            toParseDown(back);
+            hal_index_t startBack = (hal_index_t)back._startOffset;
+            hal_index_t endBack = (hal_index_t)back._endOffset;
+            assert(startBack >= startOffset);
+            assert(endBack >= endOffset);
+            MappedInterval newMapped = {mapped._source, top};
+            newMapped._source._startOffset += startBack - startOffset;
+            newMapped._source._endOffset += endBack - endOffset;
+
+            added += mapUp(newMapped, results, doDupes, minLength);
+            if (getEndPosition(top) != rightCutoff) {
+                toRight(top, rightCutoff);
+            } else {
+                break;
+            }
+        } while (true);
     }
+    return added;
+}
 
-    // Finally, map back down to the target genome.
-    if (tgtGenome != mrca) {
-        mapRecursiveDown(paralogResults, output, tgtGenome, namesOnPath, doDupes, minLength);
+hal_size_t SegmentMapper::mapDown(const MappedInterval &mapped, hal_size_t childIndex, vector<MappedInterval> &results,
+                                  hal_size_t minLength) {
+    hal_size_t added = 0;
+    if (mapped._target._top == false) {
+        const BottomSegment *bottom = getBottomSegment(mapped._target._genome, mapped._target._arrayIndex);
+        if (bottom->hasChild(childIndex) == true && getLength(mapped._target) >= minLength) {
+            results.push_back(mapped);
+            toChild(results.back()._target, childIndex);
+            ++added;
+        }
     } else {
-        output = paralogResults;
+        hal_index_t rightCutoff = getEndPosition(mapped._target);
+        hal_index_t startOffset = (hal_index_t)mapped._target._startOffset;
+        hal_index_t endOffset = (hal_index_t)mapped._target._endOffset;
+        SegmentInterval bottom = mapped._target;
+        toParseDown(bottom);
+        do {
+            // we map the new target back to see how the offsets have
+            // changed.  these changes are then applied to the source segment
+            // as deltas
+            SegmentInterval back = bottom;
+            toParseUp(back);
+            hal_index_t startBack = (hal_index_t)back._startOffset;
+            hal_index_t endBack = (hal_index_t)back._endOffset;
+            assert(startBack >= startOffset);
+            assert(endBack >= endOffset);
+            MappedInterval newMapped = {mapped._source, bottom};
+            newMapped._source._startOffset += startBack - startOffset;
+            newMapped._source._endOffset += endBack - endOffset;
+
+            added += mapDown(newMapped, childIndex, results, minLength);
+            if (getEndPosition(bottom) != rightCutoff) {
+                toRight(bottom, rightCutoff);
+            } else {
+                break;
+            }
+        } while (true);
+    }
+    return added;
+}
+
+hal_size_t SegmentMapper::mapSelf(const MappedInterval &mapped, vector<MappedInterval> &results, hal_size_t minLength) {
+    hal_size_t added = 0;
+    if (mapped._target._top == true) {
+        MappedInterval paralog = mapped;
+        do {
+            results.push_back(paralog);
+            ++added;
+            if (getTopSegment(paralog._target._genome, paralog._target._arrayIndex)->hasNextParalogy()) {
+                toNextParalogy(paralog._target);
+            }
+        } while (getTopSegment(paralog._target._genome, paralog._target._arrayIndex)->hasNextParalogy() == true &&
+                 getLength(paralog._target) >= minLength &&
+                 paralog._target._arrayIndex != mapped._target._arrayIndex);
+    } else if (mapped._target._genome->getParent() != NULL) {
+        hal_index_t rightCutoff = getEndPosition(mapped._target);
+        hal_index_t startOffset = (hal_index_t)mapped._target._startOffset;
+        hal_index_t endOffset = (hal_index_t)mapped._target._endOffset;
+        SegmentInterval top = mapped._target;
+        toParseUp(top);
+        do {
+            SegmentInterval back = top;
+            toParseDown(back);
+            hal_index_t startBack = (hal_index_t)back._startOffset;
+            hal_index_t endBack = (hal_index_t)back._endOffset;
+            assert(startBack >= startOffset);
+            assert(endBack >= endOffset);
+            MappedInterval newMapped = {mapped._source, top};
+            newMapped._source._startOffset += startBack - startOffset;
+            newMapped._source._endOffset += endBack - endOffset;
+
+            added += mapSelf(newMapped, results, minLength);
+            if (getEndPosition(top) != rightCutoff) {
+                toRight(top, rightCutoff);
+            } else {
+                break;
+            }
+        } while (true);
     }
+    return added;
+}
 
-    list<MappedSegmentPtr>::iterator outIt = output.begin();
-    for (; outIt != output.end(); ++outIt) {
-        insertAndBreakOverlaps(*outIt, results);
+// Map the input up until reaching the target genome. If the target genome
+// is below the source genome, fail miserably.
+void SegmentMapper::mapRecursiveUp(const vector<MappedInterval> &input, vector<MappedInterval> &results,
+                                   const Genome *tgtGenome, hal_size_t minLength) {
+    if (input.empty() || input[0]._target._genome == tgtGenome) {
+        results = input;
+        return;
+    }
+    vector<MappedInterval> *inputPtr = &_levels[0];
+    vector<MappedInterval> *outputPtr = &_levels[1];
+    *inputPtr = input;
+    const Genome *curGenome = input[0]._target._genome;
+    while (true) {
+        const Genome *nextGenome = curGenome->getParent();
+        if (nextGenome == NULL) {
+            throw hal_exception("Reached top of tree when attempting to recursively map up from " + curGenome->getName() +
+                                " to " + tgtGenome->getName());
+        }
+        // Map all segments to the parent.
+        outputPtr->clear();
+        for (size_t i = 0; i < inputPtr->size(); ++i) {
+            assert((*inputPtr)[i]._target._genome == curGenome);
+            mapUp((*inputPtr)[i], *outputPtr, true, minLength);
+        }
+        if (nextGenome == tgtGenome || outputPtr->empty()) {
+            break;
+        }
+        swap(inputPtr, outputPtr);
+        curGenome = nextGenome;
     }
+    results = *outputPtr;
+    sortUnique(results);
+}
 
-    return output.size();
+// The index of the child to move down into from a genome to reach
+// tgtGenome.  Paralogs are only mapped down to the MRCA from genomes above
+// it, and everything else from the MRCA and below, so the index only
+// depends on the genome during a call of map()
+hal_size_t SegmentMapper::getNextChildIndex(const Genome *genome, const Genome *tgtGenome) {
+    for (size_t i = 0; i < _nextChildren.size(); ++i) {
+        if (_nextChildren[i].first == genome) {
+            return _nextChildren[i].second;
+        }
+    }
+    hal_size_t nextChildIndex = numeric_limits<hal_size_t>::max();
+    vector<string> childNames = genome->getAlignment()->getChildNames(genome->getName());
+    for (hal_size_t child = 0; nextChildIndex == numeric_limits<hal_size_t>::max() && child < childNames.size(); ++child) {
+        bool onPath = childNames[child] == tgtGenome->getName();
+        for (set<const Genome *>::const_iterator i = _genomesOnPath->begin(); !onPath && i != _genomesOnPath->end(); ++i) {
+            onPath = (*i)->getName() == childNames[child];
+        }
+        if (onPath) {
+            nextChildIndex = child;
+        }
+    }
+    _nextChildren.push_back(make_pair(genome, nextChildIndex));
+    return nextChildIndex;
 }
 
-hal_size_t hal::halMapSegment(const SegmentIterator *source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
+// Map the input down until reaching the target genome. If the target
+// genome is above the source genome, fail miserably.
+void SegmentMapper::mapRecursiveDown(const vector<MappedInterval> &input, vector<MappedInterval> &results,
+                                     const Genome *tgtGenome, bool doDupes, hal_size_t minLength) {
+    if (input.empty() || input[0]._target._genome == tgtGenome) {
+        results = input;
+        return;
+    }
+    vector<MappedInterval> *inputPtr = &_levels[0];
+    vector<MappedInterval> *outputPtr = &_levels[1];
+    *inputPtr = input;
+    const Genome *curGenome = input[0]._target._genome;
+    while (true) {
+        // Find the correct child to move down into.
+        hal_size_t nextChildIndex = getNextChildIndex(curGenome, tgtGenome);
+        if (nextChildIndex == numeric_limits<hal_size_t>::max()) {
+            throw hal_exception("Could not find correct child that leads from " + curGenome->getName() + " to " +
+                                tgtGenome->getName());
+        }
+        const Genome *nextGenome = curGenome->getChild(nextChildIndex);
+        assert(nextGenome->getParent() == curGenome);
+
+        // Map the actual segments down.
+        outputPtr->clear();
+        for (size_t i = 0; i < inputPtr->size(); ++i) {
+            assert((*inputPtr)[i]._target._genome == curGenome);
+            mapDown((*inputPtr)[i], nextChildIndex, *outputPtr, minLength);
+        }
+
+        // Find paralogs.
+        if (doDupes == true) {
+            swap(inputPtr, outputPtr);
+            outputPtr->clear();
+            for (size_t i = 0; i < inputPtr->size(); ++i) {
+                assert((*inputPtr)[i]._target._genome == nextGenome);
+                mapSelf((*inputPtr)[i], *outputPtr, minLength);
+            }
+        }
+        if (nextGenome == tgtGenome || outputPtr->empty()) {
+            break;
+        }
+        swap(inputPtr, outputPtr);
+        curGenome = nextGenome;
+    }
+    results = *outputPtr;
+    sortUnique(results);
+}
+
+// Map all intervals from the input to any intervals in the same genome
+// that coalesce in or before the given "coalescence limit" genome.
+void SegmentMapper::mapRecursiveParalogies(const Genome *srcGenome, const vector<MappedInterval> &input,
+                                           vector<MappedInterval> &results, const Genome *coalescenceLimit,
+                                           hal_size_t minLength, size_t depth) {
+    if (input.empty() || input[0]._target._genome == coalescenceLimit) {
+        results = input;
+        return;
+    }
+    const Genome *curGenome = input[0]._target._genome;
+    const Genome *nextGenome = curGenome->getParent();
+    if (nextGenome == NULL) {
+        throw hal_exception("Hit root genome when attempting to map paralogies");
+    }
+    while (_paralogLevels.size() < 3 * (depth + 1)) {
+        _paralogLevels.push_back(vector<MappedInterval>());
+    }
+    vector<MappedInterval> &paralogs = _paralogLevels[3 * depth];
+    vector<MappedInterval> &nextIntervals = _paralogLevels[3 * depth + 1];
+    vector<MappedInterval> &paralogsMappedToSrc = _paralogLevels[3 * depth + 2];
+    paralogs.clear();
+    nextIntervals.clear();
+    results.clear();
+
+    // Map to any paralogs in the current genome.
+    for (size_t i = 0; i < input.size(); ++i) {
+        assert(input[i]._target._genome == curGenome);
+        mapSelf(input[i], paralogs, minLength);
+    }
+
+    if (nextGenome != coalescenceLimit) {
+        // Map all of the original intervals (not the paralogs) up to the
+        // next genome, and recurse on them.
+        for (size_t i = 0; i < input.size(); ++i) {
+            mapUp(input[i], nextIntervals, true, minLength);
+        }
+        mapRecursiveParalogies(srcGenome, nextIntervals, results, coalescenceLimit, minLength, depth + 1);
+    }
+
+    // Map all the paralogs we found in this genome back to the source.
+    mapRecursiveDown(paralogs, paralogsMappedToSrc, srcGenome, false, minLength);
+    results.insert(results.begin(), paralogsMappedToSrc.begin(), paralogsMappedToSrc.end());
+    sortUnique(results);
+}
+
+hal_size_t SegmentMapper::map(const SegmentIterator *source, vector<MappedInterval> &outIntervals, const Genome *tgtGenome,
                               const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
                               const Genome *coalescenceLimit, const Genome *mrca) {
-    assert(tgtGenome != NULL);
-
+    assert(source != NULL && tgtGenome != NULL);
+    const Genome *srcGenome = source->getGenome();
     if (mrca == NULL) {
-        set<const Genome *> inputSet;
-        inputSet.insert(source->getGenome());
-        inputSet.insert(tgtGenome);
-        mrca = getLowestCommonAncestor(inputSet);
+        if (srcGenome != _lastSrcGenome || tgtGenome != _lastTgtGenome) {
+            set<const Genome *> inputSet;
+            inputSet.insert(srcGenome);
+            inputSet.insert(tgtGenome);
+            _lastMrca = getLowestCommonAncestor(inputSet);
+            _lastSrcGenome = srcGenome;
+            _lastTgtGenome = tgtGenome;
+        }
+        mrca = _lastMrca;
     }
-
     if (coalescenceLimit == NULL) {
         coalescenceLimit = mrca;
     }
-
     // Get the path from the coalescence limit to the target (necessary
     // for choosing which children to move through to get to the
     // target).
-    set<const Genome *> pathSet;
     if (genomesOnPath == NULL) {
-        set<const Genome *> inputSet;
-        inputSet.insert(tgtGenome);
-        inputSet.insert(mrca);
-        getGenomesInSpanningTree(inputSet, pathSet);
-        genomesOnPath = &pathSet;
+        if (tgtGenome != _pathTgtGenome || mrca != _pathMrca) {
+            set<const Genome *> inputSet;
+            inputSet.insert(tgtGenome);
+            inputSet.insert(mrca);
+            _path.clear();
+            getGenomesInSpanningTree(inputSet, _path);
+            _pathTgtGenome = tgtGenome;
+            _pathMrca = mrca;
+        }
+        genomesOnPath = &_path;
     }
+    _genomesOnPath = genomesOnPath;
+    _nextChildren.clear();
+
+    SegmentInterval sourceInterval = {srcGenome, source->getArrayIndex(), source->getStartOffset(),
+                                      source->getEndOffset(), source->isTop(), source->getReversed()};
+    MappedInterval start = {sourceInterval, sourceInterval};
+    _input.assign(1, start);
 
+    // Map the source up to the MRCA of src and tgt.
+    const vector<MappedInterval> *upResults = &_input;
+    if (srcGenome != mrca) {
+        mapRecursiveUp(_input, _upResults, mrca, minLength);
+        upResults = &_upResults;
+    }
+
+    // Map to all paralogs that coalesce in or below the coalescenceLimit.
+    const vector<MappedInterval> *paralogResults = upResults;
+    if (mrca != coalescenceLimit && doDupes) {
+        mapRecursiveParalogies(mrca, *upResults, _paralogResults, coalescenceLimit, minLength, 0);
+        paralogResults = &_paralogResults;
+    }
+
+    // Finally, map back down to the target genome.
+    const vector<MappedInterval> *output = paralogResults;
+    if (tgtGenome != mrca) {
+        mapRecursiveDown(*paralogResults, _output, tgtGenome, doDupes, minLength);
+        output = &_output;
+    }
+    outIntervals.insert(outIntervals.end(), output->begin(), output->end());
+    return output->size();
+}
+
+hal_size_t SegmentMapper::mapToSet(const SegmentIterator *source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
+                                   const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
+                                   const Genome *coalescenceLimit, const Genome *mrca) {
+    _intervals.clear();
     hal_size_t numResults =
-        mapSource(source, outSegments, tgtGenome, genomesOnPath, doDupes, minLength, coalescenceLimit, mrca);
+        map(source, _intervals, tgtGenome, genomesOnPath, doDupes, minLength, coalescenceLimit, mrca);
+    for (size_t i = 0; i < _intervals.size(); ++i) {
+        MappedSegmentPtr mappedSeg(new MappedSegment(getIterator(_intervals[i]._source), getIterator(_intervals[i]._target)));
+        insertAndBreakOverlaps(mappedSeg, outSegments);
+    }
     return numResults;
 }
 
+hal_size_t hal::halMapSegment(const SegmentIterator *source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
+                              const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
+                              const Genome *coalescenceLimit, const Genome *mrca) {
+    assert(tgtGenome != NULL);
+
+    // the mapper's vectors are kept between calls, but not its iterators
+    // or cached genomes, as the alignment may be closed before the next
+    // call
+    static thread_local SegmentMapper mapper;
+    hal_size_t numResults;
+    try {
+        numResults =
+            mapper.mapToSet(source, outSegments, tgtGenome, genomesOnPath, doDupes, minLength, coalescenceLimit, mrca);
+    } catch (...) {
+        mapper.clear();
+        throw;
+    }
+    mapper.clear();
+    return numResults;
+}
+
+/* insert a segment, clipping overlaps, as halMapSegment does with its results */
+void hal::halInsertMappedSegment(MappedSegmentPtr segment, MappedSegmentSet &outSegments) {
+    insertAndBreakOverlaps(segment, outSegments);
+}
+
 /* call main function with smart pointer */
 hal_size_t hal::halMapSegmentSP(const SegmentIteratorPtr &source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
                                 const std::set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
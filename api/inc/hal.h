@@ -73,6 +73,8 @@
 #include "halGenome.h"
 #include "halMappedSegment.h"
 #include "halMetaData.h"
+#include "halOutputFile.h"
+#include "halParallel.h"
 #include "halPositionCache.h"
 #include "halRearrangement.h"
 #include "halSegment.h"
@@ -157,6 +157,12 @@ namespace hal {
         /** Is this file open for read-only? */
         virtual bool isReadOnly() const = 0;
 
+        /** Was this file opened with READ_SHARED_ACCESS, so that it may be
+         * read concurrently from multiple threads?  Iterators, DnaAccess and
+         * other objects obtained from the alignment are not shared and must
+         * each be used by a single thread. */
+        virtual bool isSharedAccess() const = 0;
+
         /** Replace the newick tree with a new string */
         virtual void replaceNewickTree(const std::string &newick) = 0;
     };
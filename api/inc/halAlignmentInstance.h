@@ -34,14 +34,21 @@ namespace hal {
      * Open modes for files.
      */
     enum {
-        READ_ACCESS = 0x01,  // read-access
-        WRITE_ACCESS = 0x02, // write-access
-        CREATE_ACCESS = 0x04 // initialize a new file, truncate if exist
+        READ_ACCESS = 0x01,       // read-access
+        WRITE_ACCESS = 0x02,      // write-access
+        CREATE_ACCESS = 0x04,     // initialize a new file, truncate if exist
+        READ_SHARED_ACCESS = 0x08 // read-only, may be read concurrently from multiple threads (mmap only)
     };
 
     /* Default values and validate HAL mode. */
     static inline unsigned halDefaultAccessMode(unsigned mode) {
         // make mode sane and validate
+        if (mode & READ_SHARED_ACCESS) {
+            if (mode & (WRITE_ACCESS | CREATE_ACCESS)) {
+                throw hal_exception("READ_SHARED_ACCESS can't be combined with WRITE_ACCESS or CREATE_ACCESS");
+            }
+            mode |= READ_ACCESS;
+        }
         if (mode & CREATE_ACCESS) {
             mode |= WRITE_ACCESS;
         }
@@ -17,6 +17,7 @@
 #include <list>
 #include <map>
 #include <set>
+#include <unordered_map>
 
 namespace hal {
 
@@ -51,7 +52,69 @@ namespace hal {
         /// @endcond
 
         typedef std::vector<DnaIteratorPtr> DNASet;
-        typedef std::map<const Sequence *, DNASet *, SequenceLess> ColumnMap;
+
+        /** Bases in the current column, grouped by sequence.  Entries are
+         * ordered as by SequenceLess (genome name, then sequence index), but
+         * are kept in a flat vector keyed by the genome's rank in name
+         * order, so only the names of newly seen genomes are compared.
+         * Iteration has the same interface as a std::map<const Sequence *,
+         * DNASet *>.  Entries may have an empty DNASet if the sequence was
+         * in a recent column. */
+        class ColumnMap {
+          public:
+            typedef std::pair<const Sequence *, DNASet *> value_type;
+            typedef std::vector<value_type>::const_iterator const_iterator;
+            typedef std::vector<value_type>::iterator iterator;
+
+            ColumnMap() {
+            }
+            ~ColumnMap() {
+                clear();
+            }
+
+            const_iterator begin() const {
+                return _entries.begin();
+            }
+            const_iterator end() const {
+                return _entries.end();
+            }
+            iterator begin() {
+                return _entries.begin();
+            }
+            iterator end() {
+                return _entries.end();
+            }
+            size_t size() const {
+                return _entries.size();
+            }
+            bool empty() const {
+                return _entries.empty();
+            }
+            const_iterator find(const Sequence *sequence) const;
+
+            /* get the bases for a sequence, adding an entry if needed */
+            DNASet *get(const Sequence *sequence);
+            /* clear the bases of every entry, removing entries left empty by
+             * the previous column if they are at least half of the map */
+            void reset();
+            /* remove entries with no bases */
+            void removeEmpty();
+            void clear();
+
+          private:
+            typedef std::pair<hal_size_t, hal_index_t> Key;
+            static const size_t MinCompactSize = 32;
+
+            hal_size_t getGenomeRank(const Genome *genome);
+
+            std::vector<value_type> _entries;
+            // sorted keys, parallel to _entries
+            std::vector<Key> _keys;
+            // names of the genomes seen so far in sorted order, and the rank
+            // of each genome in that order
+            std::vector<std::string> _genomeNames;
+            std::unordered_map<const Genome *, hal_size_t> _genomeRanks;
+        };
 
         /** Move column iterator one column to the right along reference
          * genoem sequence */
@@ -92,13 +155,12 @@ namespace hal {
         virtual hal_index_t getArrayIndex() const;
 
         /** As we iterate along, we keep a column map entry for each sequence
-         * visited.  This works out pretty well except for extreme cases (such
-         * as iterating over entire fly genomes where we can accumulate 10s of
-         * thousands of empty entries for all the different scaffolds when
-         * in truth we only need a handful at any given time). Under these
-         * circumstances, calling this method every 1M bases or so will help
-         * reduce memory as well as speed up queries on the column map. Perhaps
-         * this should eventually be built in and made transparent? */
+         * visited.  Entries left empty (such as for the 10s of thousands of
+         * scaffolds of a fly genome, when only a handful are needed at any
+         * given time) are removed automatically once they make up half of
+         * the map, so calling this is no longer required.  It removes them
+         * immediately and also frees the iterators linking the genomes,
+         * which are rebuilt on the next column. */
         virtual void defragment();
 
         /** Check whether the column iterator's left-most reference coordinate
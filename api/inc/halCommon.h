@@ -189,6 +189,20 @@ namespace hal {
         return dnaUnpackMap[code];
     }
 
+    /** Unpack length DNA characters starting at index from a nibble-packed
+     * buffer, where character i is in byte i / 2.  Decodes two characters
+     * per byte using SSSE3 or AVX2 when the CPU supports them.  The output
+     * is not NUL terminated. */
+    void dnaUnpackBases(const char *packed, hal_index_t index, hal_size_t length, char *out);
+
+    /** Compare two runs of length DNA characters, ignoring case.  Adds the
+     * number of positions where neither character is an N to outAligned,
+     * and the number of those where the characters are the same to
+     * outIdentical.  Compares 16 or 32 characters at a time with SSE2 or
+     * AVX2 when the CPU supports them. */
+    void dnaCountIdentical(const char *a, const char *b, hal_size_t length, hal_size_t &outAligned,
+                           hal_size_t &outIdentical);
+
     /** Pack a DNA character */
     inline unsigned char dnaPack(char unpackedChar, hal_index_t index, unsigned char packedChar) {
         uint8_t code = dnaPackMap[uint8_t(unpackedChar)];
@@ -71,6 +71,15 @@ namespace hal {
 
     extern const hal_index_t NULL_INDEX; /// FIXME: make inline.
 
+    /** Expected pattern of access to a genome's data, passed to storage
+     * formats that can use it to tune readahead (see madvise(2)). */
+    enum AccessPattern {
+        ACCESS_PATTERN_NORMAL,     // no special treatment
+        ACCESS_PATTERN_SEQUENTIAL, // scanned in order, read ahead aggressively
+        ACCESS_PATTERN_RANDOM,     // random probes, don't read ahead
+        ACCESS_PATTERN_WILLNEED    // will be needed soon, start reading now
+    };
+
 // FORWARD DECLARATIONS
 #define HAL_FORWARD_DEC_CLASS(T)                                                                                               \
     class T;                                                                                                                   \
@@ -8,6 +8,8 @@
 #ifndef _HALDNADRIVER_H
 #define _HALDNADRIVER_H
 #include "halCommon.h"
+#include <algorithm>
+#include <cstring>
 
 namespace hal {
     /**
@@ -15,6 +17,8 @@ namespace hal {
      * to the storage layer when the buffer needs filled, inlining of base access.
      * There can be multiple object active independently on a given genome.  Assumes
      * that DNA is nibble-encode and handles encoding and decoding.
+     * The buffer is not shared, so an object must only be used by one thread,
+     * even when the alignment was opened with READ_SHARED_ACCESS.
      */
     class DnaAccess {
       public:
@@ -34,6 +38,19 @@ namespace hal {
             return dnaUnpack(relIndex, _buffer[relIndex / 2]);
         }
 
+        /* get length bases starting at index into out, decoding them in bulk.
+         * The output is not NUL terminated. */
+        void getBases(hal_index_t index, hal_size_t length, char *out) const {
+            while (length > 0) {
+                hal_index_t relIndex = access(index);
+                hal_size_t count = std::min(length, hal_size_t(_endIndex - index));
+                dnaUnpackBases(_buffer, relIndex, count, out);
+                index += count;
+                out += count;
+                length -= count;
+            }
+        }
+
         /* set a base at the specified index. */
         inline void setBase(hal_index_t index, char base) {
             hal_index_t relIndex = access(index);
@@ -41,6 +58,40 @@ namespace hal {
             _dirty = true;
         }
 
+        /* copy length bases starting at sourceIndex in source to index.
+         * Both use the same nibble encoding, so once index is even the
+         * packed bytes are copied as they are when sourceIndex is even too,
+         * or rebuilt from the low and high nibbles of adjacent source bytes
+         * when it is odd.  Only a first base at an odd index is copied on
+         * its own. */
+        void copyBases(const DnaAccess &source, hal_index_t sourceIndex, hal_index_t index, hal_size_t length) {
+            while (length > 0) {
+                hal_index_t relIndex = access(index);
+                hal_index_t sourceRelIndex = source.access(sourceIndex);
+                hal_size_t count =
+                    std::min(length, std::min(hal_size_t(_endIndex - index), hal_size_t(source._endIndex - sourceIndex)));
+                if (relIndex % 2 == 0 && count >= 2) {
+                    count -= count % 2;
+                    char *out = _buffer + relIndex / 2;
+                    const unsigned char *in = reinterpret_cast<const unsigned char *>(source._buffer + sourceRelIndex / 2);
+                    if (sourceRelIndex % 2 == 0) {
+                        memcpy(out, in, count / 2);
+                    } else {
+                        for (hal_size_t i = 0; i < count / 2; i++) {
+                            out[i] = char((in[i] << 4) | (in[i + 1] >> 4));
+                        }
+                    }
+                } else {
+                    count = 1;
+                    _buffer[relIndex / 2] = dnaPack(source.getBase(sourceIndex), relIndex, _buffer[relIndex / 2]);
+                }
+                _dirty = true;
+                index += count;
+                sourceIndex += count;
+                length -= count;
+            }
+        }
+
       protected:
         /* constructor */
         DnaAccess(hal_index_t startIndex, hal_index_t endIndex, char *buffer)
@@ -111,6 +111,12 @@ namespace hal {
         /* write a DNA string */
         void writeString(const std::string &inString, hal_size_t length);
 
+        /* copy length bases from the position of source, which may be in
+         * another alignment, to this position without decoding them.
+         * Neither iterator may be reversed, both are moved past the copied
+         * bases.  flush() must be called afterwards. */
+        void copyBases(DnaIterator *source, hal_size_t length);
+
         /** Compare (array indexes) of two iterators */
         bool equals(DnaIteratorPtr &other) const;
 
@@ -165,11 +171,31 @@ namespace hal {
     inline void DnaIterator::readString(std::string &outString, hal_size_t length) {
         assert(length == 0 || inRange() == true);
         outString.resize(length);
+        if (length == 0) {
+            return;
+        }
+        if (not _reversed) {
+            _dnaAccess->getBases(_index, length, &outString[0]);
+            _index += length;
+        } else {
+            _dnaAccess->getBases(_index - (length - 1), length, &outString[0]);
+            reverseComplement(outString);
+            _index -= length;
+        }
+    }
 
-        for (hal_size_t i = 0; i < length; ++i) {
-            outString[i] = getBase();
-            toRight();
+    inline void DnaIterator::copyBases(DnaIterator *source, hal_size_t length) {
+        assert(not _reversed && not source->_reversed);
+        if (length == 0) {
+            return;
+        }
+        if (_index < 0 || _index + length > _genome->getSequenceLength()) {
+            throw hal_exception("Trying to copy bases out of range");
         }
+        assert(source->inRange() && source->_index + length <= source->_genome->getSequenceLength());
+        _dnaAccess->copyBases(*source->_dnaAccess, source->_index, _index, length);
+        source->_index += length;
+        _index += length;
     }
 
     inline void DnaIterator::writeString(const std::string &inString, hal_size_t length) {
@@ -148,6 +148,12 @@ namespace hal {
         /** Get a pointer to the alignment object that contains the genome. */
         virtual Alignment *getAlignment() = 0;
 
+        /** Hint how the genome's DNA and segment arrays are about to be
+         * accessed.  Only a hint, it is ignored by storage formats that
+         * can't use it.
+         * @param pattern expected access pattern */
+        virtual void adviseAccessPattern(AccessPattern pattern) const = 0;
+
         /** Copy all information from this genome to another. The genomes
          * must be in different alignments. The genome must not have
          * uninitialized data.
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALOUTPUTFILE_H
+#define _HALOUTPUTFILE_H
+
+#include "halDefs.h"
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace hal {
+    class BgzfWriter;
+
+    /** Stream buffer that writes a file in the BGZF format (as written by
+     * bgzip): a series of gzip members, each compressing at most 64KB of
+     * text, followed by an empty end-of-file member.  The file can be read
+     * with gzip -d, samtools, tabix or htslib.
+     *
+     * Full blocks are compressed on a pool of numThreads threads while the
+     * caller carries on writing, and the compressed blocks are written to
+     * the file in order through a large buffer.  With numThreads 0, blocks
+     * are compressed on the writing thread.  Flushing the stream doesn't
+     * end the current block, so std::endl costs no more than '\n'. */
+    class BgzfStreamBuf : public std::streambuf {
+      public:
+        /** level is the zlib compression level, -1 for zlib's default */
+        BgzfStreamBuf(const std::string &path, size_t numThreads = 1, bool append = false, int level = -1);
+        ~BgzfStreamBuf();
+
+        /** Compress and write the rest of the text and the end-of-file
+         * block, then close the file.  Throws a hal_exception if any of the
+         * output could not be written */
+        void close();
+
+        /* maximum uncompressed size of a block, as used by bgzip, which
+         * guarantees the compressed block fits in 64KB */
+        static const size_t BlockSize = 0xff00;
+
+      protected:
+        int_type overflow(int_type c);
+        std::streamsize xsputn(const char *s, std::streamsize n);
+        int sync();
+        /* only reports the position: the size of the file when opened plus
+         * the uncompressed length written since */
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which);
+
+      private:
+        BgzfStreamBuf(const BgzfStreamBuf &);
+        const BgzfStreamBuf &operator=(const BgzfStreamBuf &);
+
+        bool writeBlock();
+
+        std::unique_ptr<BgzfWriter> _writer;
+        std::vector<char> _block;
+        hal_size_t _position;
+    };
+
+    /** Text output of a command: standard output if the path is "stdout",
+     * a BGZF compressed file if the path ends in .gz or .bgz, and a plain
+     * file otherwise.  numCompressThreads is the number of threads used to
+     * compress the output (see BgzfStreamBuf). */
+    class OutputFile {
+      public:
+        OutputFile(const std::string &path, size_t numCompressThreads = 1, bool append = false);
+        /* closes the file, ignoring errors */
+        ~OutputFile();
+
+        std::ostream &getStream() {
+            return *_stream;
+        }
+        const std::string &getPath() const {
+            return _path;
+        }
+        bool isStdout() const {
+            return _path == "stdout";
+        }
+
+        /** Flush the output and close the file.  Throws a hal_exception if
+         * any of the output could not be written */
+        void close();
+
+        /** Does the path name a BGZF compressed file */
+        static bool isCompressedPath(const std::string &path);
+
+      private:
+        OutputFile(const OutputFile &);
+        const OutputFile &operator=(const OutputFile &);
+
+        std::string _path;
+        std::ofstream _file;
+        std::unique_ptr<BgzfStreamBuf> _bgzfBuf;
+        std::unique_ptr<std::ostream> _bgzfStream;
+        std::ostream *_stream;
+        bool _closed;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
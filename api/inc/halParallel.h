@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALPARALLEL_H
+#define _HALPARALLEL_H
+
+#include "halDefs.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hal {
+    class Alignment;
+
+    /** Callback that produces the output of one task into a string buffer.
+     * Called on a worker thread. */
+    typedef std::function<void(size_t taskIndex, std::string &output)> ParallelTaskFunc;
+
+    /** Callback that consumes the output of one task. Always called on the
+     * calling thread, in increasing task order. */
+    typedef std::function<void(size_t taskIndex, std::string &output)> OrderedOutputFunc;
+
+    /** Run numTasks independent tasks on a pool of numThreads worker threads
+     * and hand their outputs to writeFunc in task order (an ordered output
+     * queue).  At most maxPending tasks may be completed but not yet written,
+     * which bounds memory; 0 selects a default based on the number of
+     * threads.  If numThreads <= 1, tasks are run serially on the calling
+     * thread.  The first exception thrown by any task is re-thrown after all
+     * workers have stopped. */
+    void runOrderedTasks(size_t numTasks, size_t numThreads, const ParallelTaskFunc &taskFunc,
+                         const OrderedOutputFunc &writeFunc, size_t maxPending = 0);
+
+    /** Split the range [start, start + length) into shards of at most
+     * shardLength bases, returning the start of each shard.  */
+    std::vector<hal_index_t> shardRange(hal_index_t start, hal_size_t length, hal_size_t shardLength);
+
+    /** Throw an exception unless the alignment was opened with
+     * READ_SHARED_ACCESS and may be read from multiple threads. */
+    void checkSharedAccess(const Alignment *alignment);
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
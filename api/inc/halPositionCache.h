@@ -10,7 +10,6 @@
 
 #include "halDefs.h"
 #include <cassert>
-#include <map>
 #include <string>
 #include <vector>
 
@@ -19,36 +18,73 @@ namespace hal {
     /** keep track of bases by storing 2d intervals
      * For example, if we want to flag positions in a genome
      * that we have visited, this structure will be fairly
-     * efficient provided positions are clustered into intervals */
+     * efficient provided positions are clustered into intervals
+     *
+     * The intervals are kept in a flat sorted vector.  Positions
+     * that extend an existing interval are added in place; others
+     * are buffered in a small sorted pending vector that is merged
+     * into the main one in a single pass once it grows past about
+     * the square root of the number of intervals.  This keeps single
+     * position inserts cheap without the per-node overhead of a
+     * std::map, and lets caches be copied and merged linearly. */
     class PositionCache {
       public:
-        PositionCache() : _size(0), _prev(_set.begin()) {
-        }
-        PositionCache(const PositionCache &positionCache)
-            : _set(*positionCache.getIntervalSet()), _size(positionCache.size()), _prev(_set.begin()) {
+        /* closed interval [_first, _last] */
+        struct Interval {
+            hal_index_t _first;
+            hal_index_t _last;
+        };
+        // sorted, non-overlapping and non-abutting
+        typedef std::vector<Interval> IntervalSet;
+
+        PositionCache() : _size(0), _prevPos(0), _prevIndex(NoHint), _prevPendingIndex(NoHint) {
         }
-        // sorted by last index, so each interval is (last, first)
-        typedef std::map<hal_index_t, hal_index_t> IntervalSet;
 
         bool insert(hal_index_t pos);
+        /* add the closed interval [first, last], merging with existing intervals */
+        void insert(hal_index_t first, hal_index_t last);
+        /* add all positions in another cache to this one */
+        void merge(const PositionCache &other);
         bool find(hal_index_t pos) const;
         void clear();
         bool check() const;
         hal_size_t size() const {
             return _size;
         }
-        hal_size_t numIntervals() const {
+        hal_size_t numIntervals() {
+            flushPending();
             return _set.size();
         }
+        /* approximate heap memory used, in bytes */
+        size_t getMemoryUsage() const {
+            return (_set.capacity() + _pending.capacity()) * sizeof(Interval);
+        }
 
-        const IntervalSet *getIntervalSet() const {
+        /* folds in any pending intervals, so not safe to call while other
+         * threads are reading the cache */
+        const IntervalSet *getIntervalSet() {
+            flushPending();
             return &_set;
         }
 
+        static const size_t NoHint = (size_t)-1;
+
       private:
+        static const size_t MinPendingSize = 64;
+
+        void resetHints();
+        void flushPending();
+
         IntervalSet _set;
+        // intervals not yet merged into _set.  they never overlap _set but
+        // may abut its intervals
+        IntervalSet _pending;
         hal_size_t _size;
-        IntervalSet::iterator _prev;
+        // last position inserted and its lower bounds in _set and _pending,
+        // to make runs of inserts O(1)
+        hal_index_t _prevPos;
+        size_t _prevIndex;
+        size_t _prevPendingIndex;
     };
 }
 
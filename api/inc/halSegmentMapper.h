@@ -9,7 +9,9 @@
 #define _HALSEGMENTMAPPER_H
 #include "halDefs.h"
 #include "halSegmentIterator.h"
+#include <deque>
 #include <set>
+#include <vector>
 
 namespace hal {
     class Segment;
@@ -43,6 +45,133 @@ namespace hal {
                              const std::set<const Genome *> *genomesOnPath = NULL, bool doDupes = true,
                              hal_size_t minLength = 0, const Genome *coalescenceLimit = NULL, const Genome *mrca = NULL);
 
+    /** Add a mapped segment to a set of mapped segments, clipping it and the
+     * segments already in the set wherever they overlap in the target, as
+     * halMapSegment does with the segments it finds.  This lets mappings
+     * computed once, by halMapSegment, be combined later as if they had
+     * been found together. */
+    void halInsertMappedSegment(MappedSegmentPtr segment, MappedSegmentSet &outSegments);
+
+    /** A sliced segment as plain values: what a top or bottom segment
+     * iterator holds, without the iterator. */
+    struct SegmentInterval {
+        const Genome *_genome;
+        hal_index_t _arrayIndex;
+        hal_offset_t _startOffset;
+        hal_offset_t _endOffset;
+        bool _top;
+        bool _reversed;
+    };
+
+    /** A source interval and the homologous target interval it maps to */
+    struct MappedInterval {
+        SegmentInterval _source;
+        SegmentInterval _target;
+    };
+
+    /** The mapping core of halMapSegment.  Segments are mapped through the
+     * tree as MappedIntervals held in vectors that are reused from one call
+     * to the next, and the segments of each genome are read through one
+     * iterator kept for that genome, so mapping allocates next to nothing
+     * once the vectors have grown.  halMapSegment uses a SegmentMapper per
+     * thread, and wraps its results in MappedSegments.
+     *
+     * A SegmentMapper must only be used by one thread at a time, and the
+     * iterators it keeps must be dropped with clear() before the alignment
+     * they come from is closed. */
+    class SegmentMapper {
+      public:
+        SegmentMapper();
+        ~SegmentMapper();
+
+        /** Map source to tgtGenome, with the same parameters as
+         * halMapSegment.  The homologous intervals are added to
+         * outIntervals in no particular order, and unlike the segments
+         * halMapSegment returns, are not clipped where they overlap in
+         * the target.  Returns the number of intervals found. */
+        hal_size_t map(const SegmentIterator *source, std::vector<MappedInterval> &outIntervals, const Genome *tgtGenome,
+                       const std::set<const Genome *> *genomesOnPath = NULL, bool doDupes = true,
+                       hal_size_t minLength = 0, const Genome *coalescenceLimit = NULL, const Genome *mrca = NULL);
+
+        /** Map source to tgtGenome exactly as halMapSegment does */
+        hal_size_t mapToSet(const SegmentIterator *source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
+                            const std::set<const Genome *> *genomesOnPath = NULL, bool doDupes = true,
+                            hal_size_t minLength = 0, const Genome *coalescenceLimit = NULL, const Genome *mrca = NULL);
+
+        /** Drop the segment iterators kept for each genome */
+        void clear();
+
+        hal_index_t getStartPosition(const SegmentInterval &interval);
+        hal_index_t getEndPosition(const SegmentInterval &interval);
+        hal_size_t getLength(const SegmentInterval &interval);
+
+        /** Get a new segment iterator over an interval */
+        SegmentIteratorPtr getIterator(const SegmentInterval &interval) const;
+
+      private:
+        struct GenomeIterators {
+            const Genome *_genome;
+            TopSegmentIteratorPtr _top;
+            BottomSegmentIteratorPtr _bottom;
+        };
+
+        GenomeIterators &getIterators(const Genome *genome);
+        const TopSegment *getTopSegment(const Genome *genome, hal_index_t arrayIndex);
+        const BottomSegment *getBottomSegment(const Genome *genome, hal_index_t arrayIndex);
+        const Segment *getSegment(const SegmentInterval &interval);
+        hal_size_t getNextChildIndex(const Genome *genome, const Genome *tgtGenome);
+
+        void toParent(SegmentInterval &interval);
+        void toChild(SegmentInterval &interval, hal_size_t childIndex);
+        void toParseUp(SegmentInterval &interval);
+        void toParseDown(SegmentInterval &interval);
+        void toRight(SegmentInterval &interval, hal_index_t rightCutoff);
+        void toNextParalogy(SegmentInterval &interval);
+        bool overlaps(const SegmentInterval &interval, hal_index_t genomePos);
+        int compare(const SegmentInterval &a, const SegmentInterval &b);
+        void sortUnique(std::vector<MappedInterval> &intervals);
+
+        hal_size_t mapUp(const MappedInterval &mapped, std::vector<MappedInterval> &results, bool doDupes,
+                         hal_size_t minLength);
+        hal_size_t mapDown(const MappedInterval &mapped, hal_size_t childIndex, std::vector<MappedInterval> &results,
+                           hal_size_t minLength);
+        hal_size_t mapSelf(const MappedInterval &mapped, std::vector<MappedInterval> &results, hal_size_t minLength);
+        void mapRecursiveUp(const std::vector<MappedInterval> &input, std::vector<MappedInterval> &results,
+                            const Genome *tgtGenome, hal_size_t minLength);
+        void mapRecursiveDown(const std::vector<MappedInterval> &input, std::vector<MappedInterval> &results,
+                              const Genome *tgtGenome, bool doDupes, hal_size_t minLength);
+        void mapRecursiveParalogies(const Genome *srcGenome, const std::vector<MappedInterval> &input,
+                                    std::vector<MappedInterval> &results, const Genome *coalescenceLimit,
+                                    hal_size_t minLength, size_t depth);
+
+        std::vector<GenomeIterators> _iterators;
+        // MRCA of the last source and target genomes, and path from the
+        // last MRCA to the last target, for calls that don't give them
+        const Genome *_lastSrcGenome;
+        const Genome *_lastTgtGenome;
+        const Genome *_lastMrca;
+        const Genome *_pathTgtGenome;
+        const Genome *_pathMrca;
+        std::set<const Genome *> _path;
+        // the genomes on the path to the target, and the index of the
+        // child to follow from each genome mapped down from
+        const std::set<const Genome *> *_genomesOnPath;
+        std::vector<std::pair<const Genome *, hal_size_t>> _nextChildren;
+        // scratch vectors, reused between calls
+        std::vector<MappedInterval> _input;
+        std::vector<MappedInterval> _upResults;
+        std::vector<MappedInterval> _paralogResults;
+        std::vector<MappedInterval> _output;
+        std::vector<MappedInterval> _intervals;
+        std::vector<MappedInterval> _levels[2];
+        // paralogs, segments mapped up, and paralogs mapped back, at
+        // each level of mapRecursiveParalogies
+        std::deque<std::vector<MappedInterval>> _paralogLevels;
+
+        SegmentMapper(const SegmentMapper &);
+        const SegmentMapper &operator=(const SegmentMapper &) const;
+    };
+
     /* call main function with smart pointer */
     hal_size_t halMapSegmentSP(const SegmentIteratorPtr &source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
                                const std::set<const Genome *> *genomesOnPath = NULL, bool doDupes = true,
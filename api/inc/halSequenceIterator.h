@@ -36,10 +36,12 @@ namespace hal {
          * movement? */
         virtual bool atEnd() const = 0;
 
-        /** Return pointer to the sequence */
+        /** Return pointer to the sequence.  It is owned by the genome, and
+         * stays valid when the iterator moves */
         virtual const Sequence *getSequence() const = 0;
 
-        /** Return pointer to the sequence */
+        /** Return pointer to the sequence.  It is owned by the genome, and
+         * stays valid when the iterator moves */
         virtual Sequence *getSequence() = 0;
 
         /** Test if iterator points to same sequence as other iterator */
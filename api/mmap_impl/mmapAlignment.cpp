@@ -8,9 +8,9 @@ using namespace std;
 static const int NAME_HASH_GROWTH_FACTOR = 1024; // allow lots of initial space
 
 MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, size_t fileSize)
-    : _alignmentPath(alignmentPath), _mode(mode), _fileSize(fileSize), _file(NULL), _data(NULL), _genomeNameHash(NULL),
-      _tree(NULL) {
-    _file = MMapFile::factory(alignmentPath, mode, fileSize);
+    : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _fileSize(fileSize),
+      _createMinorVersion(MMAP_API_MINOR_VERSION), _file(NULL), _data(NULL), _genomeNameHash(NULL), _tree(NULL) {
+    _file = MMapFile::factory(alignmentPath, _mode, fileSize);
     if (mode & CREATE_ACCESS) {
         create();
     } else {
@@ -19,10 +19,10 @@ MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, si
 }
 
 MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, const CLParser *parser)
-    : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _fileSize(0), _file(NULL), _data(NULL),
-      _genomeNameHash(NULL), _tree(NULL) {
+    : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _fileSize(0),
+      _createMinorVersion(MMAP_API_MINOR_VERSION), _file(NULL), _data(NULL), _genomeNameHash(NULL), _tree(NULL) {
     initializeFromOptions(parser);
-    _file = MMapFile::factory(alignmentPath, _mode, _fileSize);
+    _file = MMapFile::factory(alignmentPath, _mode, _fileSize, _createMinorVersion, _mapOptions);
     if (mode & CREATE_ACCESS) {
         create();
     } else {
@@ -44,15 +44,45 @@ void MMapAlignment::close() {
 void MMapAlignment::defineOptions(CLParser *parser, unsigned mode) {
     if (mode & CREATE_ACCESS) {
         parser->addOption("mmapFileSize", "mmap HAL file initial size (in gigabytes)", MMAP_DEFAULT_FILE_SIZE_GB);
+        parser->addOption("mmapFormatVersion",
+                          "mmap format version to create, 1.1 can be read by older versions of HAL, 1.2 stores "
+                          "segment arrays as columns, which uses less memory, 1.3 stores the map from genome "
+                          "positions to sequences as a sorted array, which is faster to search",
+                          std::to_string(MMAP_API_MAJOR_VERSION) + "." + std::to_string(MMAP_API_MINOR_VERSION));
     } else if (mode & WRITE_ACCESS) {
         parser->addOption("mmapSizeIncrease", "additional space to reserve at end of file (in gigabytes)", 1);
     }
+    parser->addOption("mmapAccess",
+                      "kernel access pattern hint for the whole mmap HAL file: normal, sequential, random or "
+                      "willneed.  Anything other than normal overrides the hints tools give for the genomes they scan",
+                      "normal");
+    parser->addOptionFlag("mmapPopulate", "read the whole mmap HAL file into memory when opening it", false);
+    parser->addOptionFlag("mmapHugePages", "request transparent huge pages for the mmap HAL file", false);
+}
+
+static AccessPattern parseAccessPattern(const string &name) {
+    if (name == "normal") {
+        return ACCESS_PATTERN_NORMAL;
+    } else if (name == "sequential") {
+        return ACCESS_PATTERN_SEQUENTIAL;
+    } else if (name == "random") {
+        return ACCESS_PATTERN_RANDOM;
+    } else if (name == "willneed") {
+        return ACCESS_PATTERN_WILLNEED;
+    } else {
+        throw hal_exception("invalid --mmapAccess value '" + name +
+                            "', expected one of normal, sequential, random or willneed");
+    }
 }
 
 /* initialize class from options */
 void MMapAlignment::initializeFromOptions(const CLParser *parser) {
+    _mapOptions.accessPattern = parseAccessPattern(parser->getOption<string>("mmapAccess"));
+    _mapOptions.populate = parser->getFlag("mmapPopulate");
+    _mapOptions.hugePages = parser->getFlag("mmapHugePages");
     if (_mode & CREATE_ACCESS) {
         _fileSize = GIGABYTE * parser->get<size_t>("mmapFileSize");
+        _createMinorVersion = MMapFile::parseCreateVersion(parser->getOption<std::string>("mmapFormatVersion"));
     } else if (_mode & WRITE_ACCESS) {
         // TODO: this causes _fileSize's meaning to be far too
         // overloaded: sometimes (CREATE_ACCESS) it is a requested
@@ -77,6 +107,27 @@ void MMapAlignment::open() {
         _genomeNameHash = new MMapPerfectHashTable(_file, _data->_genomeNameHashOffset, NAME_HASH_GROWTH_FACTOR);
     }
     loadTree();
+    if (_mode & READ_SHARED_ACCESS) {
+        loadShared();
+    }
+}
+
+/* Open every genome and sequence and fill all lazily built caches, so that
+ * nothing in the alignment is modified by later read access and it may be
+ * used from multiple threads. */
+void MMapAlignment::loadShared() {
+    vector<string> names(1, getRootName());
+    for (size_t i = 0; i < names.size(); ++i) {
+        const vector<string> &childNames = getChildNamesRef(names[i]);
+        names.insert(names.end(), childNames.begin(), childNames.end());
+    }
+    for (size_t i = 0; i < names.size(); ++i) {
+        MMapGenome *genome = dynamic_cast<MMapGenome *>(_openGenome(names[i]));
+        if (genome == NULL) {
+            throw hal_exception("genome " + names[i] + " in tree not found in " + _alignmentPath);
+        }
+        genome->loadShared();
+    }
 }
 
 MMapGenome *MMapAlignmentData::addGenome(MMapAlignment *alignment, const std::string &name) {
@@ -161,9 +212,11 @@ Genome *MMapAlignment::addRootGenome(const string &name, double branchLength) {
 }
 
 Genome *MMapAlignment::_openGenome(const string &name) const {
-    if (_openGenomes.find(name) != _openGenomes.end()) {
+    // lookup without insertion, so READ_SHARED_ACCESS doesn't modify the map
+    map<string, MMapGenome *>::const_iterator it = _openGenomes.find(name);
+    if (it != _openGenomes.end()) {
         // Already loaded.
-        return _openGenomes[name];
+        return it->second;
     }
     if (_genomeNameHash == NULL) {
         return NULL;
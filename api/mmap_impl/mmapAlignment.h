@@ -63,6 +63,9 @@ namespace hal {
         MMapFile *getMMapFile() {
             return _file;
         }
+        const MMapMapOptions &getMapOptions() const {
+            return _mapOptions;
+        }
 
         Genome *addLeafGenome(const std::string &name, const std::string &parentName, double branchLength);
 
@@ -125,8 +128,10 @@ namespace hal {
         };
 
         std::vector<std::string> getChildNames(const std::string &name) const {
-            if (_childNames.find(name) != _childNames.end()) {
-                return _childNames[name];
+            // lookup without insertion, so READ_SHARED_ACCESS doesn't modify the map
+            auto it = _childNames.find(name);
+            if (it != _childNames.end()) {
+                return it->second;
             } else {
                 _fillChildNames(name);
                 return _childNames[name];
@@ -134,8 +139,10 @@ namespace hal {
         }
 
         std::vector<std::string> &getChildNamesRef(const std::string &name) const {
-            if (_childNames.find(name) != _childNames.end()) {
-                return _childNames[name];
+            // lookup without insertion, so READ_SHARED_ACCESS doesn't modify the map
+            auto it = _childNames.find(name);
+            if (it != _childNames.end()) {
+                return it->second;
             } else {
                 _fillChildNames(name);
                 return _childNames[name];
@@ -195,6 +202,10 @@ namespace hal {
             return _file->isReadOnly();
         };
 
+        bool isSharedAccess() const {
+            return (_mode & READ_SHARED_ACCESS) != 0;
+        };
+
         void replaceNewickTree(const std::string &newNewickString) {
             _data->setNewickString(this, newNewickString.c_str());
             loadTree();
@@ -204,6 +215,7 @@ namespace hal {
         void initializeFromOptions(const CLParser *parser);
         void create();
         void open();
+        void loadShared();
         void addGenomeToNameHash(const MMapGenome *genome, vector<string> &existingNames);
         Genome *_openGenome(const std::string &name) const;
         stTree *getGenomeNode(const std::string &name) const {
@@ -232,6 +244,8 @@ namespace hal {
         std::string _alignmentPath;
         unsigned _mode;
         size_t _fileSize;
+        unsigned _createMinorVersion; // minor version of format for CREATE_ACCESS
+        MMapMapOptions _mapOptions;
         MMapFile *_file;
         MMapAlignmentData *_data;
         MMapPerfectHashTable *_genomeNameHash;
@@ -10,8 +10,13 @@ void MMapBottomSegment::setCoordinates(hal_index_t startPos, hal_size_t length)
         throw hal_exception("Trying to set top segment coordinate out of range");
     }
 
-    _data->setStartPosition(startPos);
-    getNextData()->setStartPosition(startPos + length);
+    if (_columns != NULL) {
+        _columns->setStartPosition(_index, startPos);
+        _columns->setStartPosition(_index + 1, startPos + length);
+    } else {
+        _data->setStartPosition(startPos);
+        getNextData()->setStartPosition(startPos + length);
+    }
 }
 
 hal_offset_t MMapBottomSegment::getTopParseOffset() const {
@@ -10,18 +10,20 @@ namespace hal {
     class MMapBottomSegment : public BottomSegment {
       public:
         MMapBottomSegment(MMapGenome *genome, hal_index_t arrayIndex)
-            : BottomSegment(genome, arrayIndex), _data(genome->getBottomSegmentPointer(arrayIndex)) {
+            : BottomSegment(genome, arrayIndex), _columns(genome->getBottomSegmentColumns()),
+              _data((_columns == NULL) ? genome->getBottomSegmentPointer(arrayIndex) : NULL) {
         }
 
         // SEGMENT INTERFACE
         void setArrayIndex(Genome *genome, hal_index_t arrayIndex) {
             _genome = genome;
-            _data = getMMapGenome()->getBottomSegmentPointer(arrayIndex);
+            _columns = getMMapGenome()->getBottomSegmentColumns();
+            _data = (_columns == NULL) ? getMMapGenome()->getBottomSegmentPointer(arrayIndex) : NULL;
             _index = arrayIndex;
         };
         const Sequence *getSequence() const;
         hal_index_t getStartPosition() const {
-            return _data->getStartPosition();
+            return (_columns != NULL) ? _columns->getStartPosition(_index) : _data->getStartPosition();
         };
         hal_index_t getEndPosition() const;
         hal_size_t getLength() const;
@@ -34,25 +36,38 @@ namespace hal {
         // BOTTOM SEGMENT INTERFACE
         hal_size_t getNumChildren() const;
         hal_index_t getChildIndex(hal_size_t i) const {
-            return _data->getChildIndex(i);
+            return (_columns != NULL) ? _columns->getChildIndex(_index, i) : _data->getChildIndex(i);
         };
         hal_index_t getChildIndexG(const Genome *childGenome) const;
         bool hasChild(hal_size_t child) const;
         bool hasChildG(const Genome *childGenome) const;
         void setChildIndex(hal_size_t i, hal_index_t childIndex) {
-            _data->setChildIndex(i, childIndex);
+            if (_columns != NULL) {
+                _columns->setChildIndex(_index, i, childIndex);
+            } else {
+                _data->setChildIndex(i, childIndex);
+            }
         };
         bool getChildReversed(hal_size_t i) const {
-            return _data->getChildReversed(_genome->getNumChildren(), i);
+            return (_columns != NULL) ? _columns->getChildReversed(_index, i)
+                                      : _data->getChildReversed(_genome->getNumChildren(), i);
         };
         void setChildReversed(hal_size_t child, bool isReversed) {
-            _data->setChildReversed(_genome->getNumChildren(), child, isReversed);
+            if (_columns != NULL) {
+                _columns->setChildReversed(_index, child, isReversed);
+            } else {
+                _data->setChildReversed(_genome->getNumChildren(), child, isReversed);
+            }
         };
         hal_index_t getTopParseIndex() const {
-            return _data->getTopParseIndex();
+            return (_columns != NULL) ? _columns->getTopParseIndex(_index) : _data->getTopParseIndex();
         };
         void setTopParseIndex(hal_index_t parseIndex) {
-            _data->setTopParseIndex(parseIndex);
+            if (_columns != NULL) {
+                _columns->setTopParseIndex(_index, parseIndex);
+            } else {
+                _data->setTopParseIndex(parseIndex);
+            }
         };
         hal_offset_t getTopParseOffset() const;
         bool hasParseUp() const;
@@ -68,7 +83,8 @@ namespace hal {
         MMapBottomSegmentData *getNextData() const {
             return (MMapBottomSegmentData *)(((char *)_data) + MMapBottomSegmentData::getSize(_genome));
         };
-        MMapBottomSegmentData *_data;
+        MMapBottomSegmentColumns *_columns; // column layout (mmap format 1.2), or NULL
+        MMapBottomSegmentData *_data;       // array of structures layout, or NULL
     };
 
     inline hal_index_t MMapBottomSegment::getEndPosition() const {
@@ -76,7 +92,11 @@ namespace hal {
     }
 
     inline hal_size_t MMapBottomSegment::getLength() const {
-        return getNextData()->getStartPosition() - _data->getStartPosition();
+        if (_columns != NULL) {
+            return _columns->getStartPosition(_index + 1) - _columns->getStartPosition(_index);
+        } else {
+            return getNextData()->getStartPosition() - _data->getStartPosition();
+        }
     }
 
     inline const Sequence *MMapBottomSegment::getSequence() const {
@@ -7,6 +7,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #ifdef ENABLE_UDC
+#include <mutex>
 extern "C" {
 #include "common.h"
 #include "udc2.h"
@@ -25,6 +26,21 @@ static const std::string& getMmapApiVersion() {
     return version;
 }
 
+/* parse a major.minor version string, return false if not valid */
+static bool parseVersion(const std::string &version, unsigned &majorVersion, unsigned &minorVersion) {
+    size_t dotPos = version.find('.');
+    if (dotPos == std::string::npos) {
+        return false;
+    }
+    try {
+        majorVersion = std::stoi(version.substr(0, dotPos));
+        minorVersion = std::stoi(version.substr(dotPos + 1));
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
 /* check if first bit of file has MMAP header */
 bool hal::MMapFile::isMmapFile(const std::string &initialBytes) {
     return initialBytes.compare(0, FORMAT_NAME.size(), FORMAT_NAME) == 0;
@@ -52,24 +68,34 @@ void hal::MMapFile::setHeaderPtr() {
 /* Check that major version is compatible and store in object */
 void hal::MMapFile::parseCheckVersion() {
     std::string fileVersion(_header->mmapVersion);
-    size_t dotPos = fileVersion.find('.');
-    try {
-        if (dotPos == std::string::npos) {
-            throw hal_exception("dot not found");
-        }
-        _majorVersion = std::stoi(fileVersion.substr(0, dotPos));
-        _minorVersion = std::stoi(fileVersion.substr(dotPos+1));
-        _version = std::to_string(_majorVersion) + "." + std::to_string(_minorVersion);
-    } catch(std::exception) {
+    if (not parseVersion(fileVersion, _majorVersion, _minorVersion)) {
         // truncate to avoid tons of garbage
         throw hal_exception(_alignmentPath + ": doesn't have a valid mmap version string: "
                             + fileVersion.substr(0, 20));
     }
+    _version = std::to_string(_majorVersion) + "." + std::to_string(_minorVersion);
     
     if (_majorVersion != MMAP_API_MAJOR_VERSION) {
         throw hal_exception(_alignmentPath + ": incompatible mmap major versions: " + "file version " + _version +
                             ", mmap API version " + getMmapApiVersion());
     }
+    // minor versions may change the layout of data (1.2 segment columns), so
+    // a newer file can't be read safely
+    if (_minorVersion > MMAP_API_MINOR_VERSION) {
+        throw hal_exception(_alignmentPath + ": file mmap version " + _version +
+                            " is newer than the mmap API version " + getMmapApiVersion() + ", upgrade HAL");
+    }
+}
+
+/* parse a version to create, returning the minor version */
+unsigned hal::MMapFile::parseCreateVersion(const std::string &version) {
+    unsigned majorVersion, minorVersion;
+    if ((not parseVersion(version, majorVersion, minorVersion)) || (majorVersion != MMAP_API_MAJOR_VERSION) ||
+        (minorVersion < 1) || (minorVersion > MMAP_API_MINOR_VERSION)) {
+        throw hal_exception("invalid mmap format version to create '" + version + "', expected 1.1 to " +
+                            getMmapApiVersion());
+    }
+    return minorVersion;
 }
 
 /* validate the file header and save a pointer to it. */
@@ -102,13 +128,16 @@ void hal::MMapFile::loadHeader(bool markDirty) {
 }
 
 /* create the header */
-void hal::MMapFile::createHeader() {
+void hal::MMapFile::createHeader(unsigned minorVersion) {
     assert(_mode & WRITE_ACCESS);
     setHeaderPtr();
+    _majorVersion = MMAP_API_MAJOR_VERSION;
+    _minorVersion = minorVersion;
+    _version = std::to_string(_majorVersion) + "." + std::to_string(_minorVersion);
     assert(FORMAT_NAME.size() < sizeof(_header->format));
     strncpy(_header->format, FORMAT_NAME.c_str(), sizeof(_header->format) - 1);
-    assert(getMmapApiVersion().size() < sizeof(_header->mmapVersion));
-    strncpy(_header->mmapVersion, getMmapApiVersion().c_str(), sizeof(_header->mmapVersion) - 1);
+    assert(_version.size() < sizeof(_header->mmapVersion));
+    strncpy(_header->mmapVersion, _version.c_str(), sizeof(_header->mmapVersion) - 1);
     assert(HAL_VERSION.size() < sizeof(_header->halVersion));
     strncpy(_header->halVersion, HAL_VERSION.c_str(), sizeof(_header->halVersion) - 1);
     _header->nextOffset = alignRound(sizeof(MMapHeader));
@@ -120,31 +149,36 @@ namespace hal {
     /* Class that implements local file version of MMapFile */
     class MMapFileLocal : public MMapFile {
       public:
-        MMapFileLocal(const std::string &alignmentPath, unsigned mode, size_t fileSize);
+        MMapFileLocal(const std::string &alignmentPath, unsigned mode, size_t fileSize, unsigned createMinorVersion,
+                      const MMapMapOptions &mapOptions);
         virtual void close();
         virtual ~MMapFileLocal();
         virtual bool isUdcProtocol() const {
             return false;
         }
+        virtual void advise(size_t offset, size_t length, AccessPattern pattern) const;
 
       private:
         int openFile();
         void closeFile();
         void adjustFileSize(size_t size);
         void *mapFile(void *requiredAddr = NULL);
+        void adviseMapping();
         void unmapFile();
         void openRead();
-        void openWrite(size_t fileSize);
+        void openWrite(size_t fileSize, unsigned createMinorVersion);
 
         int _fd; // open file descriptor
+        MMapMapOptions _mapOptions;
     };
 }
 
 /* Constructor. Open or create the specified file. */
-hal::MMapFileLocal::MMapFileLocal(const std::string &alignmentPath, unsigned mode, size_t fileSize)
-    : MMapFile(alignmentPath, mode, false), _fd(-1) {
+hal::MMapFileLocal::MMapFileLocal(const std::string &alignmentPath, unsigned mode, size_t fileSize,
+                                  unsigned createMinorVersion, const MMapMapOptions &mapOptions)
+    : MMapFile(alignmentPath, mode, false), _fd(-1), _mapOptions(mapOptions) {
     if (_mode & WRITE_ACCESS) {
-        openWrite(fileSize);
+        openWrite(fileSize, createMinorVersion);
     } else {
         openRead();
     }
@@ -199,6 +233,9 @@ void *hal::MMapFileLocal::mapFile(void *requiredAddr) {
     assert(_basePtr == NULL);
     unsigned prot = PROT_READ | ((_mode & WRITE_ACCESS) ? PROT_WRITE : 0);
     int flags = MAP_SHARED | MAP_FILE;
+    if (_mapOptions.populate) {
+        flags |= MAP_POPULATE;
+    }
     if (requiredAddr != NULL) {
         // We don't want MAP_FIXED when we don't have an address we
         // need, as that will, apparently, happily map NULL to the
@@ -216,6 +253,45 @@ void *hal::MMapFileLocal::mapFile(void *requiredAddr) {
     return ptr;
 }
 
+/* pass huge page and access pattern options for the whole file to the kernel */
+void hal::MMapFileLocal::adviseMapping() {
+#ifdef MADV_HUGEPAGE
+    if (_mapOptions.hugePages) {
+        // fails if the kernel doesn't support huge pages for this file system, which is ok
+        madvise(_basePtr, _fileSize, MADV_HUGEPAGE);
+    }
+#endif
+    if (_mapOptions.accessPattern != ACCESS_PATTERN_NORMAL) {
+        advise(0, _fileSize, _mapOptions.accessPattern);
+    }
+}
+
+/* advise the kernel of the access pattern of a range, rounded out to pages */
+void hal::MMapFileLocal::advise(size_t offset, size_t length, AccessPattern pattern) const {
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    if ((_basePtr == NULL) || (offset >= _fileSize)) {
+        return;
+    }
+    size_t end = std::min(offset + length, _fileSize);
+    size_t pageOffset = (offset / pageSize) * pageSize;
+    int advice = MADV_NORMAL;
+    switch (pattern) {
+    case ACCESS_PATTERN_NORMAL:
+        advice = MADV_NORMAL;
+        break;
+    case ACCESS_PATTERN_SEQUENTIAL:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case ACCESS_PATTERN_RANDOM:
+        advice = MADV_RANDOM;
+        break;
+    case ACCESS_PATTERN_WILLNEED:
+        advice = MADV_WILLNEED;
+        break;
+    }
+    madvise(static_cast<char *>(_basePtr) + pageOffset, end - pageOffset, advice);
+}
+
 /* unmap file, if mapped */
 void hal::MMapFileLocal::unmapFile() {
     if (_basePtr != NULL) {
@@ -231,11 +307,12 @@ void hal::MMapFileLocal::openRead() {
     _fd = openFile();
     _fileSize = getFileStatSize(_fd);
     _basePtr = mapFile();
+    adviseMapping();
     loadHeader(false);
 }
 
 /* open the file for write access */
-void hal::MMapFileLocal::openWrite(size_t fileSize) {
+void hal::MMapFileLocal::openWrite(size_t fileSize, unsigned createMinorVersion) {
     _fd = openFile();
     if (_mode & CREATE_ACCESS) {
         adjustFileSize(0); // clear out existing data
@@ -244,8 +321,9 @@ void hal::MMapFileLocal::openWrite(size_t fileSize) {
         adjustFileSize(getFileStatSize(_fd) + fileSize);
     }
     _basePtr = mapFile();
+    adviseMapping();
     if (_mode & CREATE_ACCESS) {
-        createHeader();
+        createHeader(createMinorVersion);
     } else {
         loadHeader(true);
     }
@@ -278,6 +356,7 @@ namespace hal {
 
       private:
         struct udc2File *_udcFile;
+        mutable std::mutex _fetchMutex; // UDC isn't thread-safe, serialize fetches for READ_SHARED_ACCESS
     };
 }
 
@@ -322,13 +401,15 @@ void hal::MMapFileUdc::fetch(size_t offset, size_t accessSize) const {
         accessSize = _fileSize - offset;
     }
 
+    std::lock_guard<std::mutex> lock(_fetchMutex);
     udc2MMapFetch(_udcFile, offset, accessSize);
 }
 
 #endif
 
 /** create a MMapFile object, opening a local file */
-hal::MMapFile *hal::MMapFile::factory(const std::string &alignmentPath, unsigned mode, size_t fileSize) {
+hal::MMapFile *hal::MMapFile::factory(const std::string &alignmentPath, unsigned mode, size_t fileSize,
+                                      unsigned createMinorVersion, const MMapMapOptions &mapOptions) {
     if (isUrl(alignmentPath)) {
         if (mode & (CREATE_ACCESS | WRITE_ACCESS)) {
             throw hal_exception("create or write access not support with URL: " + alignmentPath);
@@ -339,6 +420,6 @@ hal::MMapFile *hal::MMapFile::factory(const std::string &alignmentPath, unsigned
         throw hal_exception("URL access requires UDC support to be compiled into HAL library: " + alignmentPath);
 #endif
     } else {
-        return new MMapFileLocal(alignmentPath, mode, fileSize);
+        return new MMapFileLocal(alignmentPath, mode, fileSize, createMinorVersion, mapOptions);
     }
 }
@@ -10,7 +10,13 @@
 namespace hal {
     /* Current API major and minor versions */
     static const unsigned MMAP_API_MAJOR_VERSION = 1;
-    static const unsigned MMAP_API_MINOR_VERSION = 1;
+    static const unsigned MMAP_API_MINOR_VERSION = 3;
+
+    /* First minor version storing the segment arrays in the column layout */
+    static const unsigned MMAP_SEGMENT_COLUMNS_MINOR_VERSION = 2;
+
+    /* First minor version storing the genome site maps as flat sorted arrays */
+    static const unsigned MMAP_FLAT_SITE_MAP_MINOR_VERSION = 3;
 
     /* get current mmap version as a string */
     const std::string& getMmapCurentVersion();
@@ -31,6 +37,15 @@ namespace hal {
     };
     typedef struct MMapHeader MMapHeader;
 
+    /* options controlling how a local file is mapped into memory */
+    struct MMapMapOptions {
+        MMapMapOptions() : accessPattern(ACCESS_PATTERN_NORMAL), populate(false), hugePages(false) {
+        }
+        AccessPattern accessPattern; // madvise hint for the whole file
+        bool populate;               // pre-fault the whole file when mapping (MAP_POPULATE)
+        bool hugePages;              // request transparent huge pages (MADV_HUGEPAGE)
+    };
+
     /**
      * An mmapped HAL file.  This handles creation and opening of mapped
      * file.
@@ -58,12 +73,32 @@ namespace hal {
             return _minorVersion;
         }
         
+        /* are segment arrays stored as columns rather than an array of structures */
+        bool hasSegmentColumns() const {
+            return _minorVersion >= MMAP_SEGMENT_COLUMNS_MINOR_VERSION;
+        }
+
+        /* are genome site maps stored as flat sorted arrays rather than trees */
+        bool hasFlatSiteMap() const {
+            return _minorVersion >= MMAP_FLAT_SITE_MAP_MINOR_VERSION;
+        }
+
+        /* parse a version to create, which must be in the range 1.1 to the
+         * current version, returning the minor version */
+        static unsigned parseCreateVersion(const std::string &version);
+
         std::string getStorageFormat() const {
             return STORAGE_FORMAT_MMAP;
         }
 
         virtual bool isUdcProtocol() const = 0;
 
+        /* advise the kernel of the access pattern of a range of the file.
+         * This is only a hint, errors are ignored, and it is a no-op unless
+         * the file is mapped locally. */
+        virtual void advise(size_t offset, size_t length, AccessPattern pattern) const {
+        }
+
         inline size_t getRootOffset() const;
         inline void *toPtr(size_t offset, size_t accessSize);
         inline const void *toPtr(size_t offset, size_t accessSize) const;
@@ -90,7 +125,7 @@ namespace hal {
         }
 
         void setHeaderPtr();
-        void createHeader();
+        void createHeader(unsigned minorVersion);
         void loadHeader(bool markDirty);
         void validateWriteAccess() const;
         inline void fetchIfNeeded(size_t offset, size_t accessSize) const;
@@ -109,7 +144,9 @@ namespace hal {
         void parseCheckVersion();
 
         static MMapFile *factory(const std::string &alignmentPath, unsigned mode = READ_ACCESS,
-                                 size_t fileSize = MMAP_DEFAULT_FILE_SIZE);
+                                 size_t fileSize = MMAP_DEFAULT_FILE_SIZE,
+                                 unsigned createMinorVersion = MMAP_API_MINOR_VERSION,
+                                 const MMapMapOptions &mapOptions = MMapMapOptions());
 
         std::string _version;
         unsigned _majorVersion;
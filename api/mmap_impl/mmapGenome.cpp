@@ -138,7 +138,8 @@ void MMapGenome::updateTopDimensions(const vector<Sequence::UpdateInfo> &updated
     }
     _data->_numTopSegments = numTopSegments;
 
-    _data->_topSegmentsOffset = _alignment->allocateNewArray((_data->_numTopSegments + 1) * sizeof(MMapTopSegmentData));
+    _data->_topSegmentsOffset = _alignment->allocateNewArray(getTopSegmentArraySize());
+    updateSegmentColumns();
     hal_index_t topSegmentStartIndex = 0;
     for (size_t i = 0; i < topDimensions.size(); i++) {
         MMapSequence seq(this, getSequenceData(i));
@@ -156,8 +157,8 @@ void MMapGenome::updateBottomDimensions(const vector<Sequence::UpdateInfo> &upda
         numBottomSegments += i._numSegments;
     }
     _data->_numBottomSegments = numBottomSegments;
-    _data->_bottomSegmentsOffset =
-        _alignment->allocateNewArray((_data->_numBottomSegments + 1) * MMapBottomSegmentData::getSize(this));
+    _data->_bottomSegmentsOffset = _alignment->allocateNewArray(getBottomSegmentArraySize());
+    updateSegmentColumns();
     hal_index_t bottomSegmentStartIndex = 0;
     for (size_t i = 0; i < bottomDimensions.size(); i++) {
         MMapSequence seq(this, getSequenceData(i));
@@ -168,6 +169,31 @@ void MMapGenome::updateBottomDimensions(const vector<Sequence::UpdateInfo> &upda
     reload();
 }
 
+/* size of the top segment array, including the terminating segment */
+size_t MMapGenome::getTopSegmentArraySize() const {
+    if (_alignment->getMMapFile()->hasSegmentColumns()) {
+        return MMapTopSegmentColumns::getSize(_data->_numTopSegments + 1);
+    } else {
+        return (_data->_numTopSegments + 1) * sizeof(MMapTopSegmentData);
+    }
+}
+
+/* size of the bottom segment array, including the terminating segment */
+size_t MMapGenome::getBottomSegmentArraySize() const {
+    if (_alignment->getMMapFile()->hasSegmentColumns()) {
+        return MMapBottomSegmentColumns::getSize(_data->_numBottomSegments + 1, getNumChildren());
+    } else {
+        return (_data->_numBottomSegments + 1) * MMapBottomSegmentData::getSize(this);
+    }
+}
+
+/* point the column accessors at the current segment arrays */
+void MMapGenome::updateSegmentColumns() {
+    _topSegmentColumns.setLocation(_alignment->getMMapFile(), _data->_topSegmentsOffset, _data->_numTopSegments + 1);
+    _bottomSegmentColumns.setLocation(_alignment->getMMapFile(), _data->_bottomSegmentsOffset,
+                                      _data->_numBottomSegments + 1);
+}
+
 hal_size_t MMapGenome::getNumSequences() const {
     return _data->_numSequences;
 }
@@ -179,6 +205,16 @@ Sequence *MMapGenome::getSequenceByIndex(hal_index_t index) {
     return _sequenceObjCache[index];
 }
 
+void MMapGenome::loadShared() {
+    getParent();
+    for (hal_size_t i = 0; i < getNumChildren(); ++i) {
+        getChild(i);
+    }
+    for (size_t i = 0; i < _sequenceObjCache.size(); ++i) {
+        getSequenceByIndex(i);
+    }
+}
+
 const Sequence *MMapGenome::getSequenceByIndex(hal_index_t index) const {
     return const_cast<MMapGenome *>(this)->getSequenceByIndex(index);
 }
@@ -224,6 +260,18 @@ const MetaData *MMapGenome::getMetaData() const {
     return &_metaData;
 }
 
+/* an access pattern given with --mmapAccess applies to the whole file and
+ * takes precedence */
+void MMapGenome::adviseAccessPattern(AccessPattern pattern) const {
+    if (_alignment->getMapOptions().accessPattern != ACCESS_PATTERN_NORMAL) {
+        return;
+    }
+    MMapFile *file = _alignment->getMMapFile();
+    file->advise(_data->_dnaOffset, (_data->_totalSequenceLength + 1) / 2, pattern);
+    file->advise(_data->_topSegmentsOffset, getTopSegmentArraySize(), pattern);
+    file->advise(_data->_bottomSegmentsOffset, getBottomSegmentArraySize(), pattern);
+}
+
 bool MMapGenome::containsDNAArray() const {
     // FIXME: this will cause issues when there really isn't any DNA to
     // show, but I"m not sure we really want to support those use cases
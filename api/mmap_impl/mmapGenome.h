@@ -6,6 +6,7 @@
 #include "mmapGenomeSiteMap.h"
 #include "mmapMetaData.h"
 #include "mmapPerfectHashTable.h"
+#include "mmapSegmentColumns.h"
 #include "mmapString.h"
 #include "mmapTopSegmentData.h"
 #include <map>
@@ -53,6 +54,7 @@ namespace hal {
               _sequenceNameHash(alignment->getMMapFile(), data->_sequenceHashOffset),
               _genomeSiteMap(alignment->getMMapFile(), data->_genomeSiteMapOffset) {
             _sequenceObjCache.resize(data->_numSequences);
+            updateSegmentColumns();
         };
         MMapGenome(MMapAlignment *alignment, MMapGenomeData *data, size_t arrayIndex, const std::string &name)
             : Genome(alignment, name), _alignment(alignment), _data(data), _arrayIndex(arrayIndex), _name(name),
@@ -61,10 +63,24 @@ namespace hal {
             _data->initializeName(_alignment, _name);
             _data->_metadataOffset = _metaData.getOffset();
             _sequenceObjCache.resize(data->_numSequences);
+            updateSegmentColumns();
         };
 
         virtual ~MMapGenome();
 
+        /* fill the parent, child and sequence object caches; used for
+         * READ_SHARED_ACCESS */
+        void loadShared();
+
+        /* segment arrays in the column layout, NULL if the file uses the
+         * array of structures layout (mmap format before 1.2) */
+        MMapTopSegmentColumns *getTopSegmentColumns() {
+            return _alignment->getMMapFile()->hasSegmentColumns() ? &_topSegmentColumns : NULL;
+        }
+        MMapBottomSegmentColumns *getBottomSegmentColumns() {
+            return _alignment->getMMapFile()->hasSegmentColumns() ? &_bottomSegmentColumns : NULL;
+        }
+
         MMapTopSegmentData *getTopSegmentPointer(hal_index_t index) {
             return _data->getTopSegmentData(_alignment, index);
         };
@@ -116,6 +132,8 @@ namespace hal {
 
         Alignment *getAlignment(); // can't be inlined due to mutual include
 
+        void adviseAccessPattern(AccessPattern pattern) const;
+
         void rename(const std::string &newName);
 
         // SEGMENTED SEQUENCE INTERFACE
@@ -173,6 +191,9 @@ namespace hal {
         std::vector<Sequence::UpdateInfo> getCompleteInputDimensions(const std::vector<Sequence::UpdateInfo> &inputDimensions,
                                                                      bool isTop);
         void deleteSequenceCache();
+        void updateSegmentColumns();
+        size_t getTopSegmentArraySize() const;
+        size_t getBottomSegmentArraySize() const;
 
         MMapGenomeData *_data;
         size_t _arrayIndex; // Index within the alignment's genome array.
@@ -180,6 +201,8 @@ namespace hal {
         MMapMetaData _metaData;
         MMapPerfectHashTable _sequenceNameHash;
         MMapGenomeSiteMap _genomeSiteMap;
+        MMapTopSegmentColumns _topSegmentColumns;
+        MMapBottomSegmentColumns _bottomSegmentColumns;
 
         mutable std::vector<MMapSequence *> _sequenceObjCache;
     };
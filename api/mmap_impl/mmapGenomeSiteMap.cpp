@@ -1,6 +1,7 @@
 #include "mmapGenomeSiteMap.h"
 #include "mmapRbTree.h"
 #include "mmapSequence.h"
+#include <stdint.h>
 using namespace std;
 using namespace hal;
 
@@ -28,6 +29,18 @@ namespace hal {
             return 0;
         }
     }
+
+    /* Entry found by the last lookup in a flat site map, for each thread.
+     * Lookups alternate between genomes (e.g. in the column iterator), so a
+     * few are kept, chosen by the address of the map's array.  An entry
+     * left by another map at the same address is checked against the
+     * array, so it can only cause a miss. */
+    struct SiteMapHit {
+        const size_t *_starts;
+        size_t _entry;
+    };
+    static const size_t NUM_SITE_MAP_HITS = 64;
+    static thread_local SiteMapHit siteMapHits[NUM_SITE_MAP_HITS];
 }
 
 /* calculate space required for the map in bytes */
@@ -37,14 +50,34 @@ size_t hal::MMapGenomeSiteMap::calcRequiredSpace(size_t numSequences) {
            ((numSequences - 1) * MMapFile::alignRound(sizeof(MMapGenomeSiteMapNode)));
 }
 
+/* calculate space required for the flat array in bytes */
+size_t hal::MMapGenomeSiteMap::calcRequiredArraySpace(size_t numEntries) {
+    return MMapFile::alignRound(sizeof(MMapGenomeSiteArrayData)) + ((numEntries + 1) * sizeof(size_t)) +
+           (numEntries * sizeof(hal_index_t));
+}
+
 /* read header information */
 void hal::MMapGenomeSiteMap::readGsm(size_t gsmOffset) {
     _gsmOffset = gsmOffset;
+    if (_file->hasFlatSiteMap()) {
+        readArray(gsmOffset);
+        return;
+    }
     _data = static_cast<MMapGenomeSiteMapData *>(_file->toPtr(gsmOffset, sizeof(MMapGenomeSiteMapData)));
     // prefetch full table
     _file->toPtr(gsmOffset, calcRequiredSpace(_data->_numSequences));
 }
 
+/* set up pointers to the flat array, fetching all of it */
+void hal::MMapGenomeSiteMap::readArray(size_t gsmOffset) {
+    const MMapGenomeSiteArrayData *arrayData =
+        static_cast<const MMapGenomeSiteArrayData *>(_file->toPtr(gsmOffset, sizeof(MMapGenomeSiteArrayData)));
+    _numEntries = arrayData->_numEntries;
+    char *arrayPtr = static_cast<char *>(_file->toPtr(gsmOffset, calcRequiredArraySpace(_numEntries)));
+    _starts = reinterpret_cast<const size_t *>(arrayPtr + MMapFile::alignRound(sizeof(MMapGenomeSiteArrayData)));
+    _sequenceIndexes = reinterpret_cast<const hal_index_t *>(_starts + _numEntries + 1);
+}
+
 void hal::MMapGenomeSiteMap::createGsm(size_t numSequences) {
     _gsmOffset = _file->allocMem(calcRequiredSpace(numSequences));
     _data = static_cast<MMapGenomeSiteMapData *>(_file->toPtr(_gsmOffset, calcRequiredSpace(numSequences)));
@@ -84,7 +117,7 @@ hal_index_t hal::MMapGenomeSiteMap::copyTree(struct rb_tree_node *tmpNode, int &
     return nodeIdx;
 }
 
-size_t hal::MMapGenomeSiteMap::build(const vector<MMapSequence *> &sequences) {
+void hal::MMapGenomeSiteMap::buildTree(const vector<MMapSequence *> &sequences) {
     struct rb_tree tmpTree;
     TmpTreeNodes tmpTreeNodes; // manages memory for tmp tree
 
@@ -93,11 +126,84 @@ size_t hal::MMapGenomeSiteMap::build(const vector<MMapSequence *> &sequences) {
     createGsm(sequences.size());
     int nextNodeIdx = 0;
     copyTree(tmpTree.root, nextNodeIdx);
+}
+
+/* sequences are laid out in the genome in index order, so the start
+ * positions of the non-empty ones are already sorted */
+void hal::MMapGenomeSiteMap::buildArray(const vector<MMapSequence *> &sequences) {
+    size_t numEntries = 0;
+    for (auto seq : sequences) {
+        if (seq->getSequenceLength() > 0) {
+            numEntries++;
+        }
+    }
+    _gsmOffset = _file->allocMem(calcRequiredArraySpace(numEntries));
+    MMapGenomeSiteArrayData *arrayData =
+        static_cast<MMapGenomeSiteArrayData *>(_file->toPtr(_gsmOffset, sizeof(MMapGenomeSiteArrayData)));
+    arrayData->_numEntries = numEntries;
+    readArray(_gsmOffset);
+
+    size_t *starts = const_cast<size_t *>(_starts);
+    hal_index_t *sequenceIndexes = const_cast<hal_index_t *>(_sequenceIndexes);
+    size_t iEntry = 0;
+    size_t endPosition = 0;
+    for (auto seq : sequences) {
+        if (seq->getSequenceLength() > 0) {
+            if ((size_t)seq->getStartPosition() != endPosition) {
+                throw hal_exception("sequence " + seq->getName() + " is not adjacent to the previous sequence in genome");
+            }
+            starts[iEntry] = seq->getStartPosition();
+            sequenceIndexes[iEntry] = seq->getArrayIndex();
+            endPosition = seq->getStartPosition() + seq->getSequenceLength();
+            iEntry++;
+        }
+    }
+    starts[numEntries] = endPosition;
+}
+
+size_t hal::MMapGenomeSiteMap::build(const vector<MMapSequence *> &sequences) {
+    if (_file->hasFlatSiteMap()) {
+        buildArray(sequences);
+    } else {
+        buildTree(sequences);
+    }
     return _gsmOffset;
 }
 
 hal_index_t MMapGenomeSiteMap::getSequenceIndexBySite(size_t position) {
     assert(_gsmOffset != MMAP_NULL_OFFSET);
+    if (_starts != NULL) {
+        return getSequenceIndexInArray(position);
+    } else {
+        return getSequenceIndexInTree(position);
+    }
+}
+
+hal_index_t MMapGenomeSiteMap::getSequenceIndexInArray(size_t position) const {
+    if (position >= _starts[_numEntries]) {
+        return NULL_INDEX;
+    }
+    SiteMapHit &hit = siteMapHits[(reinterpret_cast<uintptr_t>(_starts) / sizeof(size_t)) % NUM_SITE_MAP_HITS];
+    if (hit._starts == _starts && hit._entry < _numEntries && _starts[hit._entry] <= position &&
+        position < _starts[hit._entry + 1]) {
+        return _sequenceIndexes[hit._entry];
+    }
+
+    // find the last start <= position; _starts[0] is zero so there is one.
+    // the conditional move avoids mispredicted branches
+    const size_t *base = _starts;
+    size_t count = _numEntries;
+    while (count > 1) {
+        size_t half = count / 2;
+        base = (base[half] <= position) ? base + half : base;
+        count -= half;
+    }
+    hit._starts = _starts;
+    hit._entry = base - _starts;
+    return _sequenceIndexes[hit._entry];
+}
+
+hal_index_t MMapGenomeSiteMap::getSequenceIndexInTree(size_t position) {
     const MMapGenomeSiteMapNode *node = getNodePtr(0);
     while (node != NULL) {
         int dir = node->positionCmp(position);
@@ -47,17 +47,30 @@ namespace hal {
         MMapGenomeSiteMapNode _root;
     };
 
+    /* header of the flat site map (mmap format 1.3 and later).  It is
+     * followed by the start positions of the non-empty sequences in
+     * increasing order, then the genome length, then the index of each of
+     * those sequences. */
+    class MMapGenomeSiteArrayData {
+      public:
+        size_t _numEntries;
+    };
+
     /**
      * MMap file structure used to map position in genome to specific
-     * sequence.  This builds a balance binary tree and stores it in the
-     * mmapped file for direct access.
+     * sequence.  Files in mmap format 1.3 and later store a flat sorted
+     * array of sequence start positions, which is searched with a
+     * branchless binary search after checking the sequence found by the
+     * previous lookup on the same thread; most lookups come from iterators
+     * that move along a sequence.  Older files store a balanced binary tree.
      */
     class MMapGenomeSiteMap {
       public:
         /** Construct new object for accessing site map in HAL file.
          * If the hash table is being created, then gsmOffset
          * should be MMAP_NULL_OFFSET.  */
-        MMapGenomeSiteMap(MMapFile *mmapFile, size_t gsmOffset) : _file(mmapFile), _gsmOffset(gsmOffset), _data(NULL) {
+        MMapGenomeSiteMap(MMapFile *mmapFile, size_t gsmOffset)
+            : _file(mmapFile), _gsmOffset(gsmOffset), _data(NULL), _numEntries(0), _starts(NULL), _sequenceIndexes(NULL) {
             if (gsmOffset != MMAP_NULL_OFFSET) {
                 readGsm(gsmOffset);
             }
@@ -77,10 +90,16 @@ namespace hal {
 
       private:
         static size_t calcRequiredSpace(size_t numSequences);
+        static size_t calcRequiredArraySpace(size_t numEntries);
         void readGsm(size_t gsmOffset);
+        void readArray(size_t gsmOffset);
         void createGsm(size_t numSequences);
+        void buildTree(const std::vector<MMapSequence *> &sequences);
+        void buildArray(const std::vector<MMapSequence *> &sequences);
         void loadTmpTree(const std::vector<MMapSequence *> &sequences, struct rb_tree *tmpTree, TmpTreeNodes &tmpTreeNodes);
         hal_index_t copyTree(struct rb_tree_node *tmpNode, int &nextNodeIdx);
+        hal_index_t getSequenceIndexInTree(size_t position);
+        hal_index_t getSequenceIndexInArray(size_t position) const;
 
         /* returns null for NULL_INDEX */
         MMapGenomeSiteMapNode *getNodePtr(int nodeIndex) {
@@ -98,7 +117,12 @@ namespace hal {
 
         MMapFile *_file;
         size_t _gsmOffset;
-        MMapGenomeSiteMapData *_data;
+        MMapGenomeSiteMapData *_data; // tree, or NULL for the flat array
+
+        /* flat array, in the mmapped file */
+        size_t _numEntries;
+        const size_t *_starts;
+        const hal_index_t *_sequenceIndexes;
     };
 }
 #endif
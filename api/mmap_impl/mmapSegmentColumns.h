@@ -0,0 +1,150 @@
+#ifndef _MMAPSEGMENTCOLUMNS_H
+#define _MMAPSEGMENTCOLUMNS_H
+#include "mmapFile.h"
+#include <stdint.h>
+
+namespace hal {
+    /* Base for segment arrays stored in the column layout used by mmap
+     * format 1.2 and later.  Each field is a separate column with an entry for
+     * every segment plus the terminating segment, and boolean fields are
+     * packed into bitmaps.  This is smaller than the older array of
+     * structures and scans of one field only touch the pages of that column.
+     * Values are resolved through the MMapFile on each access so remote (UDC)
+     * files are fetched as needed. */
+    class MMapSegmentColumns {
+      public:
+        MMapSegmentColumns() : _file(NULL), _offset(MMAP_NULL_OFFSET), _numElements(0) {
+        }
+
+        /* set the location of the array, numElements includes the
+         * terminating segment */
+        void setLocation(MMapFile *file, size_t offset, size_t numElements) {
+            _file = file;
+            _offset = offset;
+            _numElements = numElements;
+        }
+
+      protected:
+        static size_t getColumnSize(size_t numElements) {
+            return numElements * sizeof(hal_index_t);
+        }
+        static size_t getBitmapSize(size_t numElements) {
+            return ((numElements + 63) / 64) * sizeof(uint64_t);
+        }
+        size_t getColumnSize() const {
+            return getColumnSize(_numElements);
+        }
+        size_t getBitmapSize() const {
+            return getBitmapSize(_numElements);
+        }
+        hal_index_t *getValueLocation(size_t columnOffset, hal_index_t index) const {
+            return static_cast<hal_index_t *>(
+                _file->toPtr(_offset + columnOffset + index * sizeof(hal_index_t), sizeof(hal_index_t)));
+        }
+        uint64_t *getBitmapWord(size_t bitmapOffset, hal_index_t index) const {
+            return static_cast<uint64_t *>(
+                _file->toPtr(_offset + bitmapOffset + (index / 64) * sizeof(uint64_t), sizeof(uint64_t)));
+        }
+        bool getBit(size_t bitmapOffset, hal_index_t index) const {
+            return (*getBitmapWord(bitmapOffset, index) >> (index % 64)) & 1;
+        }
+        void setBit(size_t bitmapOffset, hal_index_t index, bool value) {
+            uint64_t *word = getBitmapWord(bitmapOffset, index);
+            uint64_t mask = uint64_t(1) << (index % 64);
+            *word = value ? (*word | mask) : (*word & ~mask);
+        }
+
+      private:
+        MMapFile *_file;
+        size_t _offset;
+        size_t _numElements;
+    };
+
+    /* Top segment columns: start position, bottom parse index, next
+     * paralogy index and parent index, followed by the parent reversed
+     * bitmap. */
+    class MMapTopSegmentColumns : public MMapSegmentColumns {
+      public:
+        static size_t getSize(size_t numElements) {
+            return 4 * getColumnSize(numElements) + getBitmapSize(numElements);
+        }
+
+        void setStartPosition(hal_index_t index, hal_index_t startPosition) {
+            *getValueLocation(0, index) = startPosition;
+        };
+        void setBottomParseIndex(hal_index_t index, hal_index_t parseIndex) {
+            *getValueLocation(getColumnSize(), index) = parseIndex;
+        };
+        void setNextParalogyIndex(hal_index_t index, hal_index_t paralogyIndex) {
+            *getValueLocation(2 * getColumnSize(), index) = paralogyIndex;
+        };
+        void setParentIndex(hal_index_t index, hal_index_t parentIndex) {
+            *getValueLocation(3 * getColumnSize(), index) = parentIndex;
+        };
+        void setReversed(hal_index_t index, bool reversed) {
+            setBit(4 * getColumnSize(), index, reversed);
+        };
+
+        hal_index_t getStartPosition(hal_index_t index) const {
+            return *getValueLocation(0, index);
+        };
+        hal_index_t getBottomParseIndex(hal_index_t index) const {
+            return *getValueLocation(getColumnSize(), index);
+        };
+        hal_index_t getNextParalogyIndex(hal_index_t index) const {
+            return *getValueLocation(2 * getColumnSize(), index);
+        };
+        hal_index_t getParentIndex(hal_index_t index) const {
+            return *getValueLocation(3 * getColumnSize(), index);
+        };
+        bool getReversed(hal_index_t index) const {
+            return getBit(4 * getColumnSize(), index);
+        };
+    };
+
+    /* Bottom segment columns: start position and top parse index, then for
+     * each child a child index column followed by its reversed bitmap.
+     * Keeping each child's data together means the offsets don't depend on
+     * the number of children. */
+    class MMapBottomSegmentColumns : public MMapSegmentColumns {
+      public:
+        static size_t getSize(size_t numElements, size_t numChildren) {
+            return 2 * getColumnSize(numElements) + numChildren * (getColumnSize(numElements) + getBitmapSize(numElements));
+        }
+
+        void setStartPosition(hal_index_t index, hal_index_t startPosition) {
+            *getValueLocation(0, index) = startPosition;
+        };
+        void setTopParseIndex(hal_index_t index, hal_index_t parseIndex) {
+            *getValueLocation(getColumnSize(), index) = parseIndex;
+        };
+        void setChildIndex(hal_index_t index, hal_size_t child, hal_index_t childIndex) {
+            *getValueLocation(getChildOffset(child), index) = childIndex;
+        };
+        void setChildReversed(hal_index_t index, hal_size_t child, bool childReversed) {
+            setBit(getChildOffset(child) + getColumnSize(), index, childReversed);
+        };
+
+        hal_index_t getStartPosition(hal_index_t index) const {
+            return *getValueLocation(0, index);
+        };
+        hal_index_t getTopParseIndex(hal_index_t index) const {
+            return *getValueLocation(getColumnSize(), index);
+        };
+        hal_index_t getChildIndex(hal_index_t index, hal_size_t child) const {
+            return *getValueLocation(getChildOffset(child), index);
+        };
+        bool getChildReversed(hal_index_t index, hal_size_t child) const {
+            return getBit(getChildOffset(child) + getColumnSize(), index);
+        };
+
+      private:
+        size_t getChildOffset(hal_size_t child) const {
+            return 2 * getColumnSize() + child * (getColumnSize() + getBitmapSize());
+        }
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
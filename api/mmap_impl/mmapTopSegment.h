@@ -10,18 +10,20 @@ namespace hal {
     class MMapTopSegment : public TopSegment {
       public:
         MMapTopSegment(MMapGenome *genome, hal_index_t arrayIndex)
-            : TopSegment(genome, arrayIndex), _data(getMMapGenome()->getTopSegmentPointer(arrayIndex)) {
+            : TopSegment(genome, arrayIndex), _columns(genome->getTopSegmentColumns()),
+              _data((_columns == NULL) ? genome->getTopSegmentPointer(arrayIndex) : NULL) {
         }
 
         // SEGMENT INTERFACE
         void setArrayIndex(Genome *genome, hal_index_t arrayIndex) {
             _genome = genome;
-            _data = getMMapGenome()->getTopSegmentPointer(arrayIndex);
+            _columns = getMMapGenome()->getTopSegmentColumns();
+            _data = (_columns == NULL) ? getMMapGenome()->getTopSegmentPointer(arrayIndex) : NULL;
             _index = arrayIndex;
         }
         const Sequence *getSequence() const;
         hal_index_t getStartPosition() const {
-            return _data->getStartPosition();
+            return (_columns != NULL) ? _columns->getStartPosition(_index) : _data->getStartPosition();
         };
         hal_index_t getEndPosition() const;
         hal_size_t getLength() const;
@@ -33,32 +35,48 @@ namespace hal {
 
         // TOP SEGMENT INTERFACE
         hal_index_t getParentIndex() const {
-            return _data->getParentIndex();
+            return (_columns != NULL) ? _columns->getParentIndex(_index) : _data->getParentIndex();
         };
         bool hasParent() const;
         void setParentIndex(hal_index_t parIdx) {
-            _data->setParentIndex(parIdx);
+            if (_columns != NULL) {
+                _columns->setParentIndex(_index, parIdx);
+            } else {
+                _data->setParentIndex(parIdx);
+            }
         };
         bool getParentReversed() const {
-            return _data->getReversed();
+            return (_columns != NULL) ? _columns->getReversed(_index) : _data->getReversed();
         };
         void setParentReversed(bool isReversed) {
-            _data->setReversed(isReversed);
+            if (_columns != NULL) {
+                _columns->setReversed(_index, isReversed);
+            } else {
+                _data->setReversed(isReversed);
+            }
         };
         hal_index_t getBottomParseIndex() const {
-            return _data->getBottomParseIndex();
+            return (_columns != NULL) ? _columns->getBottomParseIndex(_index) : _data->getBottomParseIndex();
         };
         void setBottomParseIndex(hal_index_t botParseIdx) {
-            _data->setBottomParseIndex(botParseIdx);
+            if (_columns != NULL) {
+                _columns->setBottomParseIndex(_index, botParseIdx);
+            } else {
+                _data->setBottomParseIndex(botParseIdx);
+            }
         };
         hal_offset_t getBottomParseOffset() const;
         bool hasParseDown() const;
         hal_index_t getNextParalogyIndex() const {
-            return _data->getNextParalogyIndex();
+            return (_columns != NULL) ? _columns->getNextParalogyIndex(_index) : _data->getNextParalogyIndex();
         }
         bool hasNextParalogy() const;
         void setNextParalogyIndex(hal_index_t parIdx) {
-            _data->setNextParalogyIndex(parIdx);
+            if (_columns != NULL) {
+                _columns->setNextParalogyIndex(_index, parIdx);
+            } else {
+                _data->setNextParalogyIndex(parIdx);
+            }
         };
         hal_index_t getLeftParentIndex() const;
         hal_index_t getRightParentIndex() const;
@@ -68,7 +86,8 @@ namespace hal {
         MMapGenome *getMMapGenome() const {
             return static_cast<MMapGenome *>(_genome);
         }
-        MMapTopSegmentData *_data;
+        MMapTopSegmentColumns *_columns; // column layout (mmap format 1.2), or NULL
+        MMapTopSegmentData *_data;       // array of structures layout, or NULL
     };
 
     inline hal_index_t MMapTopSegment::getEndPosition() const {
@@ -76,7 +95,11 @@ namespace hal {
     }
 
     inline hal_size_t MMapTopSegment::getLength() const {
-        return (_data + 1)->getStartPosition() - _data->getStartPosition();
+        if (_columns != NULL) {
+            return _columns->getStartPosition(_index + 1) - _columns->getStartPosition(_index);
+        } else {
+            return (_data + 1)->getStartPosition() - _data->getStartPosition();
+        }
     }
 
     inline const Sequence *MMapTopSegment::getSequence() const {
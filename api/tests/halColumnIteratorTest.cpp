@@ -962,6 +962,47 @@ struct ColumnIteratorPositionCacheTest : public AlignmentTest {
             truth.clear();
             cache.clear();
         }
+
+        // ranges and merging
+        for (size_t i = 0; i < trials; ++i) {
+            PositionCache other;
+            for (size_t j = 0; j < entries / 10; ++j) {
+                hal_index_t first = (hal_index_t)rand() % sizes[i];
+                hal_index_t last = first + (hal_index_t)rand() % 20;
+                PositionCache &target = j % 2 ? cache : other;
+                if (j % 3 == 0) {
+                    target.insert(first, last);
+                } else {
+                    target.insert(first);
+                    last = first;
+                }
+                for (hal_index_t k = first; k <= last; ++k) {
+                    truth.insert(k);
+                }
+            }
+            CuAssertTrue(_testCase, other.check());
+            cache.merge(other);
+            CuAssertTrue(_testCase, cache.check());
+            CuAssertTrue(_testCase, truth.size() == cache.size());
+            for (size_t j = 0; j < entries * 2; ++j) {
+                hal_index_t val = (hal_index_t)rand() % (sizes[i] + 20);
+                CuAssertTrue(_testCase, cache.find(val) == (truth.find(val) != truth.end()));
+            }
+            // intervals must cover exactly the truth set
+            hal_size_t total = 0;
+            const PositionCache::IntervalSet *intervals = cache.getIntervalSet();
+            for (size_t j = 0; j < intervals->size(); ++j) {
+                const PositionCache::Interval &interval = intervals->at(j);
+                CuAssertTrue(_testCase, truth.find(interval._first) != truth.end());
+                CuAssertTrue(_testCase, truth.find(interval._first - 1) == truth.end());
+                CuAssertTrue(_testCase, truth.find(interval._last + 1) == truth.end());
+                total += interval._last - interval._first + 1;
+            }
+            CuAssertTrue(_testCase, total == truth.size());
+            CuAssertTrue(_testCase, cache.check());
+            truth.clear();
+            cache.clear();
+        }
     }
 };
 
@@ -141,6 +141,60 @@ struct GenomeStringTest : public AlignmentTest {
         string genomeString;
         ancGenome->getString(genomeString);
         CuAssertTrue(_testCase, genomeString == _string);
+
+        // bulk reads starting at odd and even positions, in both directions
+        for (hal_size_t start = 0; start < 70; start += 7) {
+            string subString;
+            ancGenome->getSubString(subString, start, 101);
+            CuAssertTrue(_testCase, subString == _string.substr(start, 101));
+
+            DnaIteratorPtr dnaIt = ancGenome->getDnaIterator(start + 100);
+            dnaIt->toReverse();
+            dnaIt->readString(subString, 101);
+            string expected = _string.substr(start, 101);
+            reverseComplement(expected);
+            CuAssertTrue(_testCase, subString == expected);
+            CuAssertTrue(_testCase, dnaIt->getArrayIndex() == (hal_index_t)start - 1);
+        }
+    }
+};
+
+struct GenomeCopyBasesTest : public AlignmentTest {
+    std::string _copyString;
+    void createCallBack(AlignmentPtr alignment) {
+        hal_size_t alignmentSize = alignment->getNumGenomes();
+        CuAssertTrue(_testCase, alignmentSize == 0);
+        hal_size_t seqLength = 21000000;
+        Genome *ancGenome = alignment->addRootGenome("AncGenome", 0);
+        vector<Sequence::Info> seqVec(1);
+        seqVec[0] = Sequence::Info("Sequence", seqLength, 0, 0);
+        ancGenome->setDimensions(seqVec);
+        string ancString = randomString(seqLength);
+        ancGenome->setString(ancString);
+
+        // copy pieces between the genomes starting at every combination of
+        // odd and even positions, crossing buffer boundaries
+        Genome *copyGenome = alignment->addLeafGenome("CopyGenome", "AncGenome", 0.1);
+        seqVec[0] = Sequence::Info("Sequence", 2100001, 0, 0);
+        copyGenome->setDimensions(seqVec);
+        hal_index_t pieces[][3] = {{0, 2, 1000001}, {1000001, 5000000, 1000000}, {2000001, 20000001, 99999},
+                                   {2100000, 1, 1}};
+        _copyString.clear();
+        for (size_t i = 0; i < 4; ++i) {
+            DnaIteratorPtr inDna = ancGenome->getDnaIterator(pieces[i][1]);
+            DnaIteratorPtr outDna = copyGenome->getDnaIterator(pieces[i][0]);
+            outDna->copyBases(inDna.get(), pieces[i][2]);
+            outDna->flush();
+            CuAssertTrue(_testCase, outDna->getArrayIndex() == pieces[i][0] + pieces[i][2]);
+            CuAssertTrue(_testCase, inDna->getArrayIndex() == pieces[i][1] + pieces[i][2]);
+            _copyString += ancString.substr(pieces[i][1], pieces[i][2]);
+        }
+    }
+
+    void checkCallBack(AlignmentConstPtr alignment) {
+        string genomeString;
+        alignment->openGenome("CopyGenome")->getString(genomeString);
+        CuAssertTrue(_testCase, genomeString == _copyString);
     }
 };
 
@@ -556,6 +610,11 @@ static void halGenomeStringTest(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halGenomeCopyBasesTest(CuTest *testCase) {
+    GenomeCopyBasesTest tester;
+    tester.check(testCase);
+}
+
 static void halGenomeCopyTest(CuTest *testCase) {
     GenomeCopyTest tester;
     tester.check(testCase);
@@ -572,15 +631,65 @@ static void halGenomeDNAPackUnpackTest(CuTest *testCase) {
     }
 }
 
+static void halGenomeDNABulkUnpackTest(CuTest *testCase) {
+    const char *bases = "acgtnACGTN";
+    string dna;
+    for (int i = 0; i < 300; i++) {
+        dna.push_back(bases[(i * 7 + i / 10) % 10]);
+    }
+    vector<char> packed(dna.size() / 2 + 1, 0);
+    for (uint64_t i = 0; i < dna.size(); i++) {
+        packed[i / 2] = dnaPack(dna[i], i, packed[i / 2]);
+    }
+    // cover odd starts, odd lengths and the vector and scalar paths
+    for (hal_index_t start = 0; start < 40; start++) {
+        for (hal_size_t length = 0; start + length <= dna.size(); length += 13) {
+            string out(length, '?');
+            dnaUnpackBases(packed.data(), start, length, &out[0]);
+            CuAssertTrue(testCase, out == dna.substr(start, length));
+        }
+    }
+}
+
+static void halGenomeDNACountIdenticalTest(CuTest *testCase) {
+    const char *bases = "acgtnACGTN";
+    string dna1, dna2;
+    for (int i = 0; i < 300; i++) {
+        dna1.push_back(bases[(i * 7 + i / 10) % 10]);
+        dna2.push_back(bases[(i * 3 + i / 7) % 10]);
+    }
+    // cover unaligned starts and the vector and scalar paths
+    for (hal_size_t start = 0; start < 40; start++) {
+        for (hal_size_t length = 0; start + length <= dna1.size(); length += 11) {
+            hal_size_t aligned = 0, identical = 0;
+            for (hal_size_t i = start; i < start + length; i++) {
+                char c1 = toupper(dna1[i]);
+                char c2 = toupper(dna2[i]);
+                if (c1 != 'N' && c2 != 'N') {
+                    aligned++;
+                    identical += c1 == c2 ? 1 : 0;
+                }
+            }
+            hal_size_t outAligned = 1, outIdentical = 2;
+            dnaCountIdentical(dna1.data() + start, dna2.data() + start, length, outAligned, outIdentical);
+            CuAssertTrue(testCase, outAligned == aligned + 1);
+            CuAssertTrue(testCase, outIdentical == identical + 2);
+        }
+    }
+}
+
 static CuSuite *halGenomeTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, halGenomeMetaTest);
     SUITE_ADD_TEST(suite, halGenomeCreateTest);
     SUITE_ADD_TEST(suite, halGenomeUpdateTest);
     SUITE_ADD_TEST(suite, halGenomeStringTest);
+    SUITE_ADD_TEST(suite, halGenomeCopyBasesTest);
     SUITE_ADD_TEST(suite, halGenomeCopyTest);
     SUITE_ADD_TEST(suite, halGenomeCopySegmentsWhenSequencesOutOfOrderTest);
     SUITE_ADD_TEST(suite, halGenomeDNAPackUnpackTest);
+    SUITE_ADD_TEST(suite, halGenomeDNABulkUnpackTest);
+    SUITE_ADD_TEST(suite, halGenomeDNACountIdenticalTest);
     return suite;
 }
 
@@ -796,6 +796,73 @@ struct MappedSegmentColCompareTest3 : public MappedSegmentColCompareTest {
     }
 };
 
+/* map every segment of a random alignment to every genome with a reused
+ * SegmentMapper, and check it agrees with halMapSegment */
+struct MappedSegmentSegmentMapperTest : virtual public AlignmentTest {
+    void createCallBack(AlignmentPtr alignment) {
+        createRandomAlignment(rng, alignment, 2, 0.1, 2, 6, 10, 1000, 5, 10);
+    }
+
+    void checkSegment(SegmentMapper &mapper, const SegmentIterator *source, const Genome *tgtGenome, bool doDupes) {
+        MappedSegmentSet expected;
+        hal_size_t numExpected = halMapSegment(source, expected, tgtGenome, NULL, doDupes);
+        vector<MappedInterval> intervals;
+        CuAssertTrue(_testCase, mapper.map(source, intervals, tgtGenome, NULL, doDupes) == numExpected);
+        CuAssertTrue(_testCase, intervals.size() == numExpected);
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            CuAssertTrue(_testCase, intervals[i]._target._genome == tgtGenome);
+            CuAssertTrue(_testCase, mapper.getLength(intervals[i]._source) == mapper.getLength(intervals[i]._target));
+        }
+        MappedSegmentSet results;
+        CuAssertTrue(_testCase, mapper.mapToSet(source, results, tgtGenome, NULL, doDupes) == numExpected);
+        CuAssertTrue(_testCase, results.size() == expected.size());
+        MappedSegmentSet::iterator i = results.begin();
+        MappedSegmentSet::iterator j = expected.begin();
+        for (; i != results.end(); ++i, ++j) {
+            CuAssertTrue(_testCase, (*i)->getSource()->getStartPosition() == (*j)->getSource()->getStartPosition());
+            CuAssertTrue(_testCase, (*i)->getSource()->getEndPosition() == (*j)->getSource()->getEndPosition());
+            CuAssertTrue(_testCase, (*i)->getStartPosition() == (*j)->getStartPosition());
+            CuAssertTrue(_testCase, (*i)->getEndPosition() == (*j)->getEndPosition());
+            CuAssertTrue(_testCase, (*i)->getReversed() == (*j)->getReversed());
+        }
+    }
+
+    void checkCallBack(AlignmentConstPtr alignment) {
+        vector<const Genome *> genomes;
+        getGenomes(alignment, alignment->getRootName(), genomes);
+        SegmentMapper mapper;
+        for (size_t i = 0; i < genomes.size(); ++i) {
+            const Genome *genome = genomes[i];
+            for (size_t j = 0; j < genomes.size(); ++j) {
+                if (genome->getParent() != NULL) {
+                    for (TopSegmentIteratorPtr top = genome->getTopSegmentIterator(); not top->atEnd(); top->toRight()) {
+                        checkSegment(mapper, top.get(), genomes[j], true);
+                        checkSegment(mapper, top.get(), genomes[j], false);
+                    }
+                }
+                if (genome->getNumChildren() > 0) {
+                    for (BottomSegmentIteratorPtr bottom = genome->getBottomSegmentIterator(); not bottom->atEnd();
+                         bottom->toRight()) {
+                        bottom->slice(bottom->getLength() > 2 ? 1 : 0, 0);
+                        bottom->toReverse();
+                        checkSegment(mapper, bottom.get(), genomes[j], true);
+                        bottom->toReverse();
+                        bottom->slice(0, 0);
+                    }
+                }
+            }
+        }
+    }
+
+    void getGenomes(AlignmentConstPtr alignment, const string &name, vector<const Genome *> &genomes) {
+        genomes.push_back(alignment->openGenome(name));
+        vector<string> childNames = alignment->getChildNames(name);
+        for (size_t i = 0; i < childNames.size(); ++i) {
+            getGenomes(alignment, childNames[i], genomes);
+        }
+    }
+};
+
 static void halMappedSegmentMapUpTest(CuTest *testCase) {
     MappedSegmentMapUpTest tester;
     tester.check(testCase);
@@ -851,6 +918,11 @@ static void halMappedSegmentColCompareTest3(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halMappedSegmentSegmentMapperTest(CuTest *testCase) {
+    MappedSegmentSegmentMapperTest tester;
+    tester.check(testCase);
+}
+
 static CuSuite *halMappedSegmentTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, halMappedSegmentMapExtraParalogsTest);
@@ -862,6 +934,7 @@ static CuSuite *halMappedSegmentTestSuite(void) {
     SUITE_ADD_TEST(suite, halMappedSegmentColCompareTestCheck1);
     SUITE_ADD_TEST(suite, halMappedSegmentColCompareTestCheck2);
     SUITE_ADD_TEST(suite, halMappedSegmentColCompareTest1);
+    SUITE_ADD_TEST(suite, halMappedSegmentSegmentMapperTest);
     // FIXME: why are these disabled?
     if (false) {
         SUITE_ADD_TEST(suite, halMappedSegmentColCompareTest2);
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halOutputFile.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <zlib.h>
+extern "C" {
+#include "commonC.h"
+}
+
+using namespace std;
+using namespace hal;
+
+static string readFile(const string &path) {
+    ifstream file(path.c_str(), ios_base::in | ios_base::binary);
+    stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/* decompress all the gzip members of data, checking that each one is a
+ * BGZF block of the size given in its header */
+static bool inflateBgzf(CuTest *testCase, const string &data, string &text) {
+    text.clear();
+    size_t offset = 0;
+    while (offset < data.size()) {
+        CuAssertTrue(testCase, data.size() - offset >= 28);
+        CuAssertTrue(testCase, (unsigned char)data[offset] == 31 && (unsigned char)data[offset + 1] == 139);
+        CuAssertTrue(testCase, data[offset + 12] == 'B' && data[offset + 13] == 'C');
+        size_t blockSize = 1 + (unsigned char)data[offset + 16] + 256 * (unsigned char)data[offset + 17];
+        CuAssertTrue(testCase, offset + blockSize <= data.size());
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        CuAssertTrue(testCase, inflateInit2(&stream, 15 + 16) == Z_OK);
+        vector<char> buffer(BgzfStreamBuf::BlockSize);
+        stream.next_in = (Bytef *)&data[offset];
+        stream.avail_in = blockSize;
+        stream.next_out = (Bytef *)&buffer[0];
+        stream.avail_out = buffer.size();
+        int ret = inflate(&stream, Z_FINISH);
+        size_t consumed = blockSize - stream.avail_in;
+        text.append(&buffer[0], stream.total_out);
+        inflateEnd(&stream);
+        if (ret != Z_STREAM_END || consumed != blockSize) {
+            return false;
+        }
+        offset += blockSize;
+    }
+    return true;
+}
+
+static string makeText(size_t numLines) {
+    stringstream text;
+    for (size_t i = 0; i < numLines; ++i) {
+        text << "line\t" << i << "\t" << AlignmentTest::randomString(i % 97) << "\n";
+    }
+    return text.str();
+}
+
+static void halOutputFileBgzfTest(CuTest *testCase) {
+    string text = makeText(50000);
+    for (size_t numThreads = 0; numThreads <= 3; ++numThreads) {
+        string path = string(getTempFile()) + ".gz";
+        OutputFile outFile(path, numThreads);
+        ostream &outStream = outFile.getStream();
+        CuAssertTrue(testCase, outStream.tellp() == streampos(0));
+        // mix of small and large writes
+        outStream << text.substr(0, 1000) << endl;
+        outStream.write(text.data() + 1000, text.size() - 1000);
+        CuAssertTrue(testCase, outStream.tellp() == streampos(text.size() + 1));
+        outFile.close();
+
+        string data = readFile(path);
+        string result;
+        CuAssertTrue(testCase, data.size() < text.size());
+        CuAssertTrue(testCase, inflateBgzf(testCase, data, result));
+        CuAssertTrue(testCase, result == text.substr(0, 1000) + "\n" + text.substr(1000));
+        // ends with an empty block
+        CuAssertTrue(testCase, (unsigned char)data[data.size() - 28 + 16] == 27);
+        remove(path.c_str());
+    }
+}
+
+static void halOutputFileAppendTest(CuTest *testCase) {
+    string path = string(getTempFile()) + ".bgz";
+    {
+        OutputFile outFile(path, 2);
+        outFile.getStream() << "first\n";
+    }
+    {
+        OutputFile outFile(path, 2, true);
+        CuAssertTrue(testCase, outFile.getStream().tellp() > streampos(0));
+        outFile.getStream() << "second\n";
+        outFile.close();
+    }
+    string result;
+    CuAssertTrue(testCase, inflateBgzf(testCase, readFile(path), result));
+    CuAssertTrue(testCase, result == "first\nsecond\n");
+    remove(path.c_str());
+}
+
+static void halOutputFilePlainTest(CuTest *testCase) {
+    string path = getTempFile();
+    CuAssertTrue(testCase, !OutputFile::isCompressedPath(path));
+    CuAssertTrue(testCase, OutputFile::isCompressedPath("out.maf.gz"));
+    CuAssertTrue(testCase, OutputFile::isCompressedPath("out.wig.bgz"));
+    {
+        OutputFile outFile(path, 2);
+        outFile.getStream() << "plain\n";
+    }
+    CuAssertTrue(testCase, readFile(path) == "plain\n");
+    remove(path.c_str());
+}
+
+static CuSuite *halOutputFileTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halOutputFileBgzfTest);
+    SUITE_ADD_TEST(suite, halOutputFileAppendTest);
+    SUITE_ADD_TEST(suite, halOutputFilePlainTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halOutputFileTestSuite());
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Benchmark PositionCache against the std::map interval set it replaced.
+ * Positions are inserted the way the column iterator visits them on a
+ * fragmented assembly: short runs, mostly left to right, starting at random
+ * places.  Insert, find, copy and merge times and memory are reported.
+ */
+#include "halCLParser.h"
+#include "halPositionCache.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdio.h>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    /* the previous implementation: a map of intervals keyed on their last
+     * position, so each interval is (last, first) */
+    class MapPositionCache {
+      public:
+        typedef map<hal_index_t, hal_index_t> IntervalSet;
+
+        bool insert(hal_index_t pos) {
+            IntervalSet::iterator i = _set.lower_bound(pos);
+            if (i != _set.end() && i->second <= pos) {
+                return false;
+            }
+            if (i != _set.end() && i->second == pos + 1) {
+                --i->second;
+            } else {
+                i = _set.insert(i, pair<hal_index_t, hal_index_t>(pos, pos));
+            }
+            if (i != _set.begin()) {
+                IntervalSet::iterator j = i;
+                --j;
+                if (j->first == i->second - 1) {
+                    i->second = j->second;
+                    _set.erase(j);
+                }
+            }
+            IntervalSet::iterator j = i;
+            ++j;
+            if (j != _set.end() && j->second == i->first + 1) {
+                j->second = i->second;
+                _set.erase(i);
+            }
+            return true;
+        }
+        void insert(hal_index_t first, hal_index_t last) {
+            IntervalSet::iterator i = _set.lower_bound(first - 1);
+            while (i != _set.end() && i->second <= last + 1) {
+                first = min(first, i->second);
+                last = max(last, i->first);
+                _set.erase(i++);
+            }
+            _set.insert(i, pair<hal_index_t, hal_index_t>(last, first));
+        }
+        void merge(const MapPositionCache &other) {
+            for (IntervalSet::const_iterator i = other._set.begin(); i != other._set.end(); ++i) {
+                insert(i->second, i->first);
+            }
+        }
+        bool find(hal_index_t pos) const {
+            IntervalSet::const_iterator i = _set.lower_bound(pos);
+            return i != _set.end() && i->second <= pos;
+        }
+        size_t numIntervals() const {
+            return _set.size();
+        }
+        size_t getMemoryUsage() const {
+            // red-black tree node: three pointers, a color and the value
+            return _set.size() * (4 * sizeof(void *) + sizeof(IntervalSet::value_type));
+        }
+
+      private:
+        IntervalSet _set;
+    };
+
+    struct BenchArgs {
+        hal_size_t genomeLength;
+        hal_size_t numRuns;
+        hal_size_t runLength;
+        unsigned seed;
+    };
+
+    double elapsed(chrono::steady_clock::time_point startTime) {
+        return chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    }
+
+    /* build the list of positions: numRuns runs of up to runLength bases
+     * at random starts, one in eight running right to left */
+    vector<hal_index_t> makePositions(const BenchArgs &args, unsigned seed) {
+        mt19937 rng(seed);
+        uniform_int_distribution<hal_index_t> startDist(0, args.genomeLength - args.runLength);
+        uniform_int_distribution<hal_index_t> lengthDist(1, args.runLength);
+        vector<hal_index_t> positions;
+        for (hal_size_t i = 0; i < args.numRuns; ++i) {
+            hal_index_t start = startDist(rng);
+            hal_index_t length = lengthDist(rng);
+            bool reversed = rng() % 8 == 0;
+            for (hal_index_t j = 0; j < length; ++j) {
+                positions.push_back(reversed ? start + length - 1 - j : start + j);
+            }
+        }
+        return positions;
+    }
+
+    template <typename Cache> void runBench(const char *name, const BenchArgs &args) {
+        vector<hal_index_t> positions = makePositions(args, args.seed);
+        vector<hal_index_t> otherPositions = makePositions(args, args.seed + 1);
+        Cache cache;
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        hal_size_t numInserted = 0;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            numInserted += cache.insert(positions[i]);
+        }
+        double insertTime = elapsed(startTime);
+
+        startTime = chrono::steady_clock::now();
+        hal_size_t numFound = 0;
+        for (size_t i = 0; i < otherPositions.size(); ++i) {
+            numFound += cache.find(otherPositions[i]);
+        }
+        double findTime = elapsed(startTime);
+
+        Cache other;
+        for (size_t i = 0; i < otherPositions.size(); ++i) {
+            other.insert(otherPositions[i]);
+        }
+        startTime = chrono::steady_clock::now();
+        Cache copy(cache);
+        double copyTime = elapsed(startTime);
+
+        startTime = chrono::steady_clock::now();
+        copy.merge(other);
+        double mergeTime = elapsed(startTime);
+
+        printf("%s\t%zu\t%zu\t%zu\t%.3f\t%.3f\t%.3f\t%.3f\t%.1f\n", name, (size_t)numInserted, (size_t)numFound,
+               (size_t)cache.numIntervals(), insertTime, findTime, copyTime, mergeTime,
+               cache.getMemoryUsage() / (1024. * 1024.));
+    }
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    optionsParser.setDescription("Benchmark PositionCache against a std::map interval set.  Reports the "
+                                 "number of positions inserted and found, the number of intervals, the time "
+                                 "in seconds to insert, find, copy and merge, and the memory used in MB.");
+    optionsParser.addOption("genomeLength", "length of the simulated genome", 1000000000);
+    optionsParser.addOption("numRuns", "number of runs of positions to insert", 2000000);
+    optionsParser.addOption("runLength", "maximum length of each run", 100);
+    optionsParser.addOption("seed", "random seed", 0);
+    BenchArgs args;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        args.genomeLength = optionsParser.getOption<hal_size_t>("genomeLength");
+        args.numRuns = optionsParser.getOption<hal_size_t>("numRuns");
+        args.runLength = optionsParser.getOption<hal_size_t>("runLength");
+        args.seed = optionsParser.getOption<unsigned>("seed");
+        if (args.runLength == 0 || args.genomeLength < args.runLength) {
+            throw hal_exception("runLength must be between 1 and genomeLength");
+        }
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+    printf("cache\tinserted\tfound\tintervals\tinsert\tfind\tcopy\tmerge\tMB\n");
+    runBench<MapPositionCache>("map", args);
+    runBench<PositionCache>("flat", args);
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Benchmark segment mapping on an alignment.  Top and bottom segments of
+ * every genome are mapped to every genome, with and without duplications,
+ * by halMapSegment, by a SegmentMapper kept across calls giving
+ * MappedSegments, and by the same SegmentMapper giving MappedIntervals.
+ * The number of results and the time for each are reported.
+ */
+#include "hal.h"
+#include "halCLParser.h"
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    enum Method { MapSegment, MapperSet, MapperIntervals };
+
+    double elapsed(chrono::steady_clock::time_point startTime) {
+        return chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    }
+
+    void getGenomes(AlignmentConstPtr alignment, const string &name, vector<const Genome *> &genomes) {
+        genomes.push_back(alignment->openGenome(name));
+        vector<string> childNames = alignment->getChildNames(name);
+        for (size_t i = 0; i < childNames.size(); ++i) {
+            getGenomes(alignment, childNames[i], genomes);
+        }
+    }
+
+    hal_size_t mapSegment(Method method, SegmentMapper &mapper, const SegmentIterator *source, const Genome *tgtGenome,
+                          bool doDupes) {
+        if (method == MapSegment) {
+            MappedSegmentSet results;
+            halMapSegment(source, results, tgtGenome, NULL, doDupes);
+            return results.size();
+        } else if (method == MapperSet) {
+            MappedSegmentSet results;
+            mapper.mapToSet(source, results, tgtGenome, NULL, doDupes);
+            return results.size();
+        } else {
+            vector<MappedInterval> results;
+            return mapper.map(source, results, tgtGenome, NULL, doDupes);
+        }
+    }
+
+    void runBench(const char *name, Method method, const vector<const Genome *> &genomes, hal_size_t step) {
+        SegmentMapper mapper;
+        hal_size_t numMapped = 0;
+        hal_size_t numResults = 0;
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        for (size_t i = 0; i < genomes.size(); ++i) {
+            const Genome *srcGenome = genomes[i];
+            for (int top = 0; top < 2; ++top) {
+                if ((top && srcGenome->getParent() == NULL) || (!top && srcGenome->getNumChildren() == 0)) {
+                    continue;
+                }
+                hal_size_t numSegments = top ? srcGenome->getNumTopSegments() : srcGenome->getNumBottomSegments();
+                for (hal_size_t j = 0; j < numSegments; j += step) {
+                    SegmentIteratorPtr source;
+                    if (top) {
+                        source = srcGenome->getTopSegmentIterator(j);
+                    } else {
+                        source = srcGenome->getBottomSegmentIterator(j);
+                    }
+                    for (size_t k = 0; k < genomes.size(); ++k) {
+                        numResults += mapSegment(method, mapper, source.get(), genomes[k], true);
+                        numResults += mapSegment(method, mapper, source.get(), genomes[k], false);
+                        numMapped += 2;
+                    }
+                }
+            }
+        }
+        printf("%s\t%zu\t%zu\t%.3f\n", name, (size_t)numMapped, (size_t)numResults, elapsed(startTime));
+    }
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    optionsParser.setDescription("Benchmark halMapSegment against a reused SegmentMapper by mapping segments of "
+                                 "every genome to every genome.  Reports the number of segments mapped, the number "
+                                 "of results and the time in seconds.");
+    optionsParser.addArgument("halFile", "input hal file");
+    optionsParser.addOption("step", "map every step-th segment of each genome", 1);
+    string halPath;
+    hal_size_t step;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        halPath = optionsParser.getArgument<string>("halFile");
+        step = optionsParser.getOption<hal_size_t>("step");
+        if (step == 0) {
+            throw hal_exception("step must be at least 1");
+        }
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+    try {
+        AlignmentConstPtr alignment(openHalAlignment(halPath, &optionsParser));
+        vector<const Genome *> genomes;
+        getGenomes(alignment, alignment->getRootName(), genomes);
+        printf("method\tmapped\tresults\ttime\n");
+        runBench("halMapSegment", MapSegment, genomes, step);
+        runBench("mapToSet", MapperSet, genomes, step);
+        runBench("map", MapperIntervals, genomes, step);
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -53,6 +53,8 @@ struct SequenceCreateTest : public AlignmentTest {
             hal_size_t len = 1 + i * 5 + i;
             string name = "sequence" + std::to_string(i);
             const Sequence *seq = seqIt->getSequence();
+            // the iterator gives the genome's own sequence object
+            CuAssertTrue(_testCase, seq == ancGenome->getSequence(name));
             CuAssertTrue(_testCase, seq->getName() == name);
             CuAssertTrue(_testCase, seq->getSequenceLength() == len);
             CuAssertTrue(_testCase, seq->getNumTopSegments() == i);
@@ -69,6 +71,7 @@ struct SequenceCreateTest : public AlignmentTest {
             } else {
                 CuAssertTrue(_testCase, seq->getStartPosition() - lastStart == lastLength);
             }
+            CuAssertTrue(_testCase, seq->getEndPosition() == seq->getStartPosition() + (hal_index_t)len - 1);
 
             lastStart = seq->getStartPosition();
             lastLength = seq->getSequenceLength();
@@ -263,6 +266,47 @@ struct SequenceRenameTest : public AlignmentTest {
     }
 };
 
+struct SequenceBySiteTest : public AlignmentTest {
+    // every third sequence is empty, including the first and last
+    static hal_size_t seqLength(size_t i) {
+        return (i % 3 == 0) ? 0 : 1 + (i * 7) % 13;
+    }
+
+    void createCallBack(AlignmentPtr alignment) {
+        Genome *ancGenome = alignment->addRootGenome("AncGenome", 0);
+
+        vector<Sequence::Info> seqVec;
+        for (size_t i = 0; i < 301; ++i) {
+            seqVec.push_back(Sequence::Info("sequence" + std::to_string(i), seqLength(i), 0, 0));
+        }
+        ancGenome->setDimensions(seqVec);
+    }
+
+    void checkCallBack(AlignmentConstPtr alignment) {
+        const Genome *ancGenome = alignment->openGenome("AncGenome");
+
+        // positions in order, as an iterator would look them up
+        vector<string> siteNames;
+        for (size_t i = 0; i < 301; ++i) {
+            for (hal_size_t j = 0; j < seqLength(i); ++j) {
+                siteNames.push_back("sequence" + std::to_string(i));
+            }
+        }
+        CuAssertTrue(_testCase, ancGenome->getSequenceLength() == siteNames.size());
+        for (size_t pos = 0; pos < siteNames.size(); ++pos) {
+            const Sequence *seq = ancGenome->getSequenceBySite(pos);
+            CuAssertTrue(_testCase, seq != NULL);
+            CuAssertTrue(_testCase, seq->getName() == siteNames[pos]);
+        }
+
+        // jumping around
+        for (size_t i = 0; i < siteNames.size(); ++i) {
+            size_t pos = (i * 7919) % siteNames.size();
+            CuAssertTrue(_testCase, ancGenome->getSequenceBySite(pos)->getName() == siteNames[pos]);
+        }
+    }
+};
+
 static void halSequenceCreateTest(CuTest *testCase) {
     SequenceCreateTest tester;
     tester.check(testCase);
@@ -283,12 +327,18 @@ static void halSequenceRenameTest(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halSequenceBySiteTest(CuTest *testCase) {
+    SequenceBySiteTest tester;
+    tester.check(testCase);
+}
+
 static CuSuite *halSequenceTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, halSequenceCreateTest);
     SUITE_ADD_TEST(suite, halSequenceIteratorTest);
     SUITE_ADD_TEST(suite, halSequenceUpdateTest);
     SUITE_ADD_TEST(suite, halSequenceRenameTest);
+    SUITE_ADD_TEST(suite, halSequenceBySiteTest);
     return suite;
 }
 
@@ -19,45 +19,79 @@
 #include <deque>
 #include <limits>
 #include <map>
+#include <mutex>
+#include <pthread.h>
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unordered_map>
 
-#ifdef ENABLE_UDC
-#include <pthread.h>
-static pthread_mutex_t HAL_MUTEX = PTHREAD_MUTEX_INITIALIZER;
-static inline void halLock() {
-    if (pthread_mutex_lock(&HAL_MUTEX) != 0) {
-        throw hal_exception("pthread_mutex_lock failed: " + std::string(std::strerror(errno)));
-    }
-}
-static inline void halUnlock() {
-    if (pthread_mutex_unlock(&HAL_MUTEX) != 0) {
-        throw hal_exception("pthread_mutex_unlock failed: " + std::string(std::strerror(errno)));
-    }
-}
-#else
-static inline void halLock() {
-}
-static inline void halUnlock() {
-}
-#endif
-
 using namespace std;
 using namespace hal;
 
-typedef map<int, pair<string, LodManagerPtr>> HandleMap;
+/* An open HAL or LOD file */
+struct HalHandle {
+    HalHandle(const string &path, LodManagerPtr lodManager) : _path(path), _lodManager(lodManager) {
+    }
+    string _path;
+    LodManagerPtr _lodManager;
+};
+typedef shared_ptr<HalHandle> HalHandlePtr;
+
+/* The handle map is protected by a reader/writer lock that is only held
+ * while looking up, adding or removing handles.  Queries keep a reference
+ * to their handle, so it stays valid if halClose() is called concurrently. */
+typedef map<int, HalHandlePtr> HandleMap;
 static HandleMap handleMap;
+static pthread_rwlock_t handleMapLock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* Queries on handles whose alignments were opened with READ_SHARED_ACCESS
+ * (mmap) run concurrently.  Others (HDF5) are serialized by this mutex,
+ * across all handles, as the HDF5 library is not thread-safe. */
+static mutex serialQueryMutex;
+
+namespace {
+    /* RAII read or write lock on the handle map */
+    class HandleMapLock {
+      public:
+        HandleMapLock(bool write) {
+            int err = write ? pthread_rwlock_wrlock(&handleMapLock) : pthread_rwlock_rdlock(&handleMapLock);
+            if (err != 0) {
+                throw hal_exception("pthread_rwlock lock failed: " + std::string(std::strerror(err)));
+            }
+        }
+        ~HandleMapLock() {
+            pthread_rwlock_unlock(&handleMapLock);
+        }
+    };
+
+    /* Look up a handle for the duration of a query, holding the serial
+     * query lock if its alignments can't be read concurrently. */
+    class HandleQuery {
+      public:
+        HandleQuery(int handle);
+        ~HandleQuery() {
+            // release while still locked, as this may close the alignments
+            _halHandle.reset();
+        }
+        AlignmentConstPtr getAlignment(hal_size_t queryLength, bool needDNASequence) {
+            return _halHandle->_lodManager->getAlignment(queryLength, needDNASequence);
+        }
+        bool isAlignmentLod0(hal_size_t queryLength) const {
+            return _halHandle->_lodManager->isLod0(queryLength);
+        }
 
-static int openLodOrHal(char *inputPath, bool isLod, char **errStr);
-static void checkHandle(int handle);
+      private:
+        unique_lock<mutex> _serialLock;
+        HalHandlePtr _halHandle;
+    };
+}
+
+static int openLodOrHal(char *inputPath, bool isLod, bool sharedAccess, char **errStr);
 static void checkGenomes(int halHandle, AlignmentConstPtr alignment, const string &qSpecies, const string &tSpecies,
                          const string &tChrom);
 
-static AlignmentConstPtr getExistingAlignment(int handle, hal_size_t queryLength, bool needSequence);
-static bool isAlignmentLod0(int handle, hal_size_t queryLength);
 static char *copyCString(const string &inString);
 
 static hal_block_results_t *readBlocks(AlignmentConstPtr seqAlignment, const Sequence *tSequence, hal_index_t absStart,
@@ -83,28 +117,31 @@ static void handleError(const string &msg, char **errStr) {
 }
 
 static bool isHalFile(char *lodFilePath) {
-    // must be locked
     return not hal::detectHalAlignmentFormat(lodFilePath).empty();
 }
 
-extern "C" int halOpenHalOrLod(char *lodFilePath, char **errStr) {
-    halLock();
+static int openHalOrLodFile(char *lodFilePath, bool sharedAccess, char **errStr) {
     try {
         bool isHal = isHalFile(lodFilePath);
-        int handle = openLodOrHal(lodFilePath, !isHal, errStr);
-        halUnlock();
+        int handle = openLodOrHal(lodFilePath, !isHal, sharedAccess, errStr);
         return handle;
     } catch (exception &e) {
-        halUnlock();
         handleError("halOpenLodOrHal error: " + string(lodFilePath) + ": " + e.what(), errStr);
         return -1;
     } catch (...) {
-        halUnlock();
         handleError("halOpenLodOrHal error: " + string(lodFilePath) + ": Unknown exception", errStr);
         return -1;
     }
 }
 
+extern "C" int halOpenHalOrLod(char *lodFilePath, char **errStr) {
+    return openHalOrLodFile(lodFilePath, false, errStr);
+}
+
+extern "C" int halOpenHalOrLodShared(char *lodFilePath, char **errStr) {
+    return openHalOrLodFile(lodFilePath, true, errStr);
+}
+
 /* Deprecated, maintain for browser code compatibility */
 extern "C" int halOpenLOD(char *lodFilePath, char **errStr) {
     // FIXME remove when browser is migrated
@@ -112,20 +149,13 @@ extern "C" int halOpenLOD(char *lodFilePath, char **errStr) {
 }
 
 extern "C" int halOpen(char *halFilePath, char **errStr) {
-    halLock();
-    try {
-        int handle = openLodOrHal(halFilePath, false, errStr);
-        halUnlock();
-        return handle;
-    } catch (...) {
-        halUnlock();
-        throw;
-    }
+    return openLodOrHal(halFilePath, false, false, errStr);
 }
 
+/* must hold the handle map write lock */
 static int findOrAllocHandle(char *inputPath) {
     for (HandleMap::iterator mapIt = handleMap.begin(); mapIt != handleMap.end(); ++mapIt) {
-        if (mapIt->second.first == string(inputPath)) {
+        if (mapIt->second->_path == string(inputPath)) {
             return mapIt->first;
         }
     }
@@ -137,16 +167,19 @@ static int findOrAllocHandle(char *inputPath) {
     }
 }
 
-static int openLodOrHal(char *inputPath, bool isLod, char **errStr) {
-    int handle = findOrAllocHandle(inputPath);
+static int openLodOrHal(char *inputPath, bool isLod, bool sharedAccess, char **errStr) {
+    int handle = -1;
     try {
+        // load outside of the lock, as this may be slow for URLs
         LodManagerPtr lodManager(new LodManager());
         if (isLod == true) {
-            lodManager->loadLODFile(inputPath);
+            lodManager->loadLODFile(inputPath, NULL, sharedAccess);
         } else {
-            lodManager->loadSingeHALFile(inputPath);
+            lodManager->loadSingeHALFile(inputPath, NULL, sharedAccess);
         }
-        handleMap.insert(pair<int, pair<string, LodManagerPtr>>(handle, pair<string, LodManagerPtr>(inputPath, lodManager)));
+        HandleMapLock mapLock(true);
+        handle = findOrAllocHandle(inputPath);
+        handleMap.insert(pair<int, HalHandlePtr>(handle, HalHandlePtr(new HalHandle(inputPath, lodManager))));
     } catch (exception &e) {
         handleError("openLodOrHal error: " + string(inputPath) + ": " + e.what(), errStr);
         return -1;
@@ -158,36 +191,40 @@ static int openLodOrHal(char *inputPath, bool isLod, char **errStr) {
 }
 
 extern "C" int halClose(int handle, char **errStr) {
-    halLock();
     int ret = 0;
     try {
-        HandleMap::iterator mapIt = handleMap.find(handle);
-        if (mapIt == handleMap.end()) {
-            halUnlock();
-            handleError("halClose error on handle: " + std::to_string(handle) + ": not found", errStr);
-            return -1;
+        HalHandlePtr halHandle;
+        {
+            HandleMapLock mapLock(true);
+            HandleMap::iterator mapIt = handleMap.find(handle);
+            if (mapIt == handleMap.end()) {
+                handleError("halClose error on handle: " + std::to_string(handle) + ": not found", errStr);
+                return -1;
+            }
+            halHandle = mapIt->second;
+            handleMap.erase(mapIt);
+        }
+        // closes the alignments, unless a query still holds the handle
+        if (not halHandle->_lodManager->isSharedAccess()) {
+            lock_guard<mutex> serialLock(serialQueryMutex);
+            halHandle.reset();
         }
-        handleMap.erase(mapIt);
     } catch (exception &e) {
-        halUnlock();
         handleError("halClose error on handle: " + std::to_string(handle) + ": " + e.what(), errStr);
         return -1;
     } catch (...) {
-        halUnlock();
         handleError("halClose error on handle: " + std::to_string(handle) + ": unknown exception", errStr);
         return -1;
     }
-    halUnlock();
     return ret;
 }
 
 extern "C" int halCloseGenome(int handle, const char *genomeName, char**errStr) {
-    halLock();
     try {
-        AlignmentConstPtr alignment = getExistingAlignment(handle, 0, true);
+        HandleQuery query(handle);
+        AlignmentConstPtr alignment = query.getAlignment(0, true);
         const Genome *genome = alignment->openGenome(genomeName);
         if (genome == NULL) {
-            halUnlock();
             handleError("halCloseGenome: genome with name " + string(genomeName) + " not found in alignment with handle " +
                         std::to_string(handle),
                         errStr);
@@ -195,15 +232,12 @@ extern "C" int halCloseGenome(int handle, const char *genomeName, char**errStr)
         }
         alignment->closeGenome(genome);
     } catch (exception &e) {
-        halUnlock();
         handleError("halCloseGenome: " + string(e.what()), errStr);
         return -1;
     } catch (...) {
-        halUnlock();
         handleError("halCloseGenome: unknown exception", errStr);
         return -1;
     }
-    halUnlock();
     return 0;
 }
 
@@ -245,27 +279,24 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
                                                                  hal_seqmode_type_t seqMode, hal_dup_type_t dupMode,
                                                                  int mapBackAdjacencies, const char *coalescenceLimitName,
                                                                  char **errStr) {
-    halLock();
     hal_block_results_t *results = NULL;
     try {
         hal_int_t rangeLength = tEnd - tStart;
         if (rangeLength < 0) {
-            halUnlock();
             handleError("halGetBlocksInTargetRange invalid query range [" + std::to_string(tStart) + "," +
                             std::to_string(tEnd) + ")",
                         errStr);
             return NULL;
         }
         if (tReversed != 0 && mapBackAdjacencies != 0) {
-            halUnlock();
             handleError("halGetBlocksInTargetRange tReversed can only be set when mapBackAdjacencies is 0", errStr);
             return NULL;
         }
         if (tReversed != 0 && dupMode == HAL_QUERY_AND_TARGET_DUPS) {
-            halUnlock();
             handleError("tReversed cannot be set in conjunction with dupMode=HAL_QUERY_AND_TARGET_DUPS", errStr);
             return NULL;
         }
+        HandleQuery query(halHandle);
         bool getSequenceString;
         switch (seqMode) {
         case HAL_NO_SEQUENCE:
@@ -276,10 +307,10 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
             break;
         case HAL_LOD0_SEQUENCE:
         default:
-            getSequenceString = isAlignmentLod0(halHandle, hal_size_t(rangeLength));
+            getSequenceString = query.isAlignmentLod0(hal_size_t(rangeLength));
         }
 
-        AlignmentConstPtr alignment = getExistingAlignment(halHandle, hal_size_t(rangeLength), getSequenceString);
+        AlignmentConstPtr alignment = query.getAlignment(hal_size_t(rangeLength), getSequenceString);
         checkGenomes(halHandle, alignment, qSpecies, tSpecies, tChrom);
 
         const Genome *qGenome = alignment->openGenome(qSpecies);
@@ -290,18 +321,16 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
         hal_index_t absStart = tSequence->getStartPosition() + tStart;
         hal_index_t absEnd = tSequence->getStartPosition() + myEnd - 1;
         if (absStart > absEnd) {
-            halUnlock();
             handleError("halGetBlocksInTargetRange invalid range", errStr);
             return NULL;
         }
         if (absEnd > tSequence->getEndPosition()) {
-            halUnlock();
             handleError("halGetBlocksInTargetRange target end position outside of target sequence", errStr);
             return NULL;
         }
         // We now know the query length so we can do a proper lod query
         if (tEnd == 0) {
-            alignment = getExistingAlignment(halHandle, absEnd - absStart, false);
+            alignment = query.getAlignment(absEnd - absStart, false);
             checkGenomes(halHandle, alignment, qSpecies, tSpecies, tChrom);
             qGenome = alignment->openGenome(qSpecies);
             tGenome = alignment->openGenome(tSpecies);
@@ -315,7 +344,7 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
             // getting rid of it since it allows us to easily revert back to
             // the previous functionaly of allowing lod-blocks to acces lod-0
             // sequence (FIXME: delete)
-            seqAlignment = getExistingAlignment(halHandle, absEnd - absStart, true);
+            seqAlignment = query.getAlignment(absEnd - absStart, true);
         }
 
         results = readBlocks(seqAlignment, tSequence, absStart, absEnd, tReversed != 0, qGenome, getSequenceString,
@@ -323,15 +352,12 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
                              mapBackAdjacencies != 0,
                              coalescenceLimitName);
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetBlocksInTargetRange error reading blocks: " + string(e.what()), errStr);
         return NULL;
     } catch (...) {
-        halUnlock();
         handleError("halGetBlocksInTargetRange error reading blocks: unknown exception", errStr);
         return NULL;
     }
-    halUnlock();
     return results;
 }
 
@@ -407,16 +433,15 @@ halGetBlocksInTargetRange_filterByChrom(int halHandle, char *qSpecies, char *tSp
 extern "C" hal_int_t halGetMaf(FILE *outFile, int halHandle, hal_species_t *qSpeciesNames, char *tSpecies, char *tChrom,
                                hal_int_t tStart, hal_int_t tEnd, int maxRefGap, int maxBlockLength, int doDupes,
                                char **errStr) {
-    halLock();
     hal_int_t numBytes = 0;
     try {
         hal_int_t rangeLength = tEnd - tStart;
         if (rangeLength < 0) {
-            halUnlock();
             handleError("halGetMaf invalid query range [" + std::to_string(tStart) + "," + std::to_string(tEnd) + ")", errStr);
             return -1;
         }
-        AlignmentConstPtr alignment(getExistingAlignment(halHandle, hal_size_t(0), true));
+        HandleQuery query(halHandle);
+        AlignmentConstPtr alignment(query.getAlignment(hal_size_t(0), true));
 
         set<const Genome *> qGenomeSet;
         for (hal_species_t *qSpecies = qSpeciesNames; qSpecies != NULL; qSpecies = qSpecies->next) {
@@ -432,12 +457,10 @@ extern "C" hal_int_t halGetMaf(FILE *outFile, int halHandle, hal_species_t *qSpe
         hal_index_t absStart = tSequence->getStartPosition() + tStart;
         hal_index_t absEnd = tSequence->getStartPosition() + myEnd - 1;
         if (absStart > absEnd) {
-            halUnlock();
             handleError("halGetMaf invalid range", errStr);
             return -1;
         }
         if (absEnd > tSequence->getEndPosition()) {
-            halUnlock();
             handleError("halGetMaf target end position outside of target sequence", errStr);
             return -1;
         }
@@ -459,15 +482,12 @@ extern "C" hal_int_t halGetMaf(FILE *outFile, int halHandle, hal_species_t *qSpe
             numBytes = (hal_int_t)fwrite(mafStringBuffer.c_str(), mafStringBuffer.length(), sizeof(char), outFile);
         }
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetMaf error writing MAF blocks: " + string(e.what()), errStr);
         return -1;
     } catch (...) {
-        halUnlock();
         handleError("halGetMaf error writing MAF blocks: unknown exception", errStr);
         return -1;
     }
-    halUnlock();
     return numBytes;
 }
 
@@ -479,11 +499,11 @@ extern "C" hal_int_t halGetMAF(FILE *outFile, int halHandle, struct hal_species_
 }
 
 extern "C" struct hal_species_t *halGetSpecies(int halHandle, char **errStr) {
-    halLock();
     hal_species_t *head = NULL;
     try {
         // read the lowest level of detail because it's fastest
-        AlignmentConstPtr alignment = getExistingAlignment(halHandle, numeric_limits<hal_size_t>::max(), false);
+        HandleQuery query(halHandle);
+        AlignmentConstPtr alignment = query.getAlignment(numeric_limits<hal_size_t>::max(), false);
         hal_species_t *prev = NULL;
         if (alignment->getNumGenomes() > 0) {
             string rootName = alignment->getRootName();
@@ -519,25 +539,22 @@ extern "C" struct hal_species_t *halGetSpecies(int halHandle, char **errStr) {
             }
         }
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetSpecies: " + string(e.what()), errStr);
         return NULL;
     } catch (...) {
-        halUnlock();
         handleError("halGetSpecies: unknown exception", errStr);
         return NULL;
     }
-    halUnlock();
     return head;
 }
 
 extern "C" struct hal_species_t *halGetPossibleCoalescenceLimits(int halHandle, const char *qSpecies, const char *tSpecies,
                                                                  char **errStr) {
-    halLock();
     hal_species_t *head = NULL;
     try {
         // read the lowest level of detail because it's fastest
-        AlignmentConstPtr alignment = getExistingAlignment(halHandle, numeric_limits<hal_size_t>::max(), false);
+        HandleQuery query(halHandle);
+        AlignmentConstPtr alignment = query.getAlignment(numeric_limits<hal_size_t>::max(), false);
         hal_species_t *prev = NULL;
         const Genome *qGenome = alignment->openGenome(qSpecies);
         const Genome *tGenome = alignment->openGenome(tSpecies);
@@ -569,15 +586,12 @@ extern "C" struct hal_species_t *halGetPossibleCoalescenceLimits(int halHandle,
             prev = cur;
         } while ((curGenome = curGenome->getParent()) != NULL);
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetPossibleCoalescenceLimits: " + string(e.what()), errStr);
         return NULL;
     } catch (...) {
-        halUnlock();
         handleError("halGetPossibleCoalescenceLimits: unknown exception", errStr);
         return NULL;
     }
-    halUnlock();
     return head;
 }
 
@@ -592,15 +606,14 @@ extern "C" void halFreeSpeciesList(struct hal_species_t *species) {
 }
 
 extern "C" struct hal_chromosome_t *halGetChroms(int halHandle, char *speciesName, char **errStr) {
-    halLock();
     hal_chromosome_t *head = NULL;
     try {
         // read the lowest level of detail because it's fastest
-        AlignmentConstPtr alignment = getExistingAlignment(halHandle, numeric_limits<hal_size_t>::max(), false);
+        HandleQuery query(halHandle);
+        AlignmentConstPtr alignment = query.getAlignment(numeric_limits<hal_size_t>::max(), false);
 
         const Genome *genome = alignment->openGenome(speciesName);
         if (genome == NULL) {
-            halUnlock();
             handleError("halGetChroms: species with name " + string(speciesName) + " not found in alignment with handle " +
                             std::to_string(halHandle),
                         errStr);
@@ -626,26 +639,22 @@ extern "C" struct hal_chromosome_t *halGetChroms(int halHandle, char *speciesNam
             }
         }
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetChroms: " + string(e.what()), errStr);
         return NULL;
     } catch (...) {
-        halUnlock();
         handleError("halGetChroms: unknown exception", errStr);
         return NULL;
     }
-    halUnlock();
     return head;
 }
 
 extern "C" char *halGetDna(int halHandle, char *speciesName, char *chromName, hal_int_t start, hal_int_t end, char **errStr) {
-    halLock();
     char *dna = NULL;
     try {
-        AlignmentConstPtr alignment = getExistingAlignment(halHandle, 0, true);
+        HandleQuery query(halHandle);
+        AlignmentConstPtr alignment = query.getAlignment(0, true);
         const Genome *genome = alignment->openGenome(speciesName);
         if (genome == NULL) {
-            halUnlock();
             handleError("halGetChroms: species with name " + string(speciesName) + " not found in alignment with handle " +
                         std::to_string(halHandle),
                         errStr);
@@ -653,13 +662,11 @@ extern "C" char *halGetDna(int halHandle, char *speciesName, char *chromName, ha
         }
         const Sequence *sequence = genome->getSequence(chromName);
         if (sequence == NULL) {
-            halUnlock();
             handleError("halGetDna: chromosome with name " + string(chromName) + " not found in species " + speciesName,
                         errStr);
             return NULL;
         }
         if (start > end || end > (hal_index_t)sequence->getSequenceLength()) {
-            halUnlock();
             handleError("halGetDna: specified range [" + std::to_string(start) + "," + std::to_string(end) + ") is invalid " +
                             "for chromsome " + chromName + " in species " + speciesName + " which is of length " +
                             std::to_string(sequence->getSequenceLength()),
@@ -671,54 +678,37 @@ extern "C" char *halGetDna(int halHandle, char *speciesName, char *chromName, ha
         sequence->getSubString(buffer, start, end - start);
         dna = copyCString(buffer);
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetDna: " + string(e.what()), errStr);
         return NULL;
     } catch (...) {
-        halUnlock();
         handleError("halGetDna: unknown exception", errStr);
         return NULL;
     }
-    halUnlock();
     return dna;
 }
 
 extern "C" hal_int_t halGetMaxLODQueryLength(int halHandle, char **errStr) {
-    halLock();
     hal_int_t ret = 0;
     try {
+        HandleMapLock mapLock(false);
         HandleMap::iterator mapIt = handleMap.find(halHandle);
         if (mapIt == handleMap.end()) {
-            halUnlock();
             handleError("halGetMaxLODQueryLength error getting Max LOD Query Length.  handle " + std::to_string(halHandle) +
                             ": not found",
                         errStr);
             return -1;
         }
-        ret = (hal_int_t)mapIt->second.second->getMaxQueryLength();
+        ret = (hal_int_t)mapIt->second->_lodManager->getMaxQueryLength();
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetMaxLODQueryLength: " + string(e.what()), errStr);
         return -1;
     } catch (...) {
-        halUnlock();
         handleError("halGetMaxLODQueryLength: unknown exception", errStr);
         return -1;
     }
-    halUnlock();
     return ret;
 }
 
-static void checkHandle(int handle) {
-    HandleMap::iterator mapIt = handleMap.find(handle);
-    if (mapIt == handleMap.end()) {
-        throw hal_exception("Handle " + std::to_string(handle) + "not found in alignment map");
-    }
-    if (mapIt->second.second.get() == NULL) {
-        throw hal_exception("Handle " + std::to_string(handle) + "points to NULL alignment");
-    }
-}
-
 static void checkGenomes(int halHandle, AlignmentConstPtr alignment, const string &qSpecies, const string &tSpecies,
                          const string &tChrom) {
     const Genome *qGenome = alignment->openGenome(qSpecies);
@@ -738,16 +728,18 @@ static void checkGenomes(int halHandle, AlignmentConstPtr alignment, const strin
     }
 }
 
-static AlignmentConstPtr getExistingAlignment(int handle, hal_size_t queryLength, bool needDNASequence) {
-    checkHandle(handle);
-    HandleMap::iterator mapIt = handleMap.find(handle);
-    return mapIt->second.second->getAlignment(queryLength, needDNASequence);
-}
-
-static bool isAlignmentLod0(int handle, hal_size_t queryLength) {
-    checkHandle(handle);
-    HandleMap::iterator mapIt = handleMap.find(handle);
-    return mapIt->second.second->isLod0(queryLength);
+HandleQuery::HandleQuery(int handle) {
+    {
+        HandleMapLock mapLock(false);
+        HandleMap::iterator mapIt = handleMap.find(handle);
+        if (mapIt == handleMap.end()) {
+            throw hal_exception("Handle " + std::to_string(handle) + "not found in alignment map");
+        }
+        _halHandle = mapIt->second;
+    }
+    if (not _halHandle->_lodManager->isSharedAccess()) {
+        _serialLock = unique_lock<mutex>(serialQueryMutex);
+    }
 }
 
 static char *copyCString(const string &inString) {
@@ -1175,10 +1167,10 @@ static void chainReferenceParalogies(MappedSegmentSet& segMap, hal_index_t absSt
 }
 
 extern "C" struct hal_metadata_t *halGetGenomeMetadata(int halHandle, const char *genomeName, char **errStr) {
-    halLock();
     struct hal_metadata_t *ret = NULL;
     try {
-        AlignmentConstPtr alignment = getExistingAlignment(halHandle, numeric_limits<hal_size_t>::max(), false);
+        HandleQuery query(halHandle);
+        AlignmentConstPtr alignment = query.getAlignment(numeric_limits<hal_size_t>::max(), false);
 
         const Genome *genome = alignment->openGenome(genomeName);
         if (genome == NULL) {
@@ -1200,15 +1192,12 @@ extern "C" struct hal_metadata_t *halGetGenomeMetadata(int halHandle, const char
             prevMetadata = curMetadata;
         }
     } catch (exception &e) {
-        halUnlock();
         handleError("halGetGenomeMetadata: " + string(e.what()), errStr);
         return NULL;
     } catch (...) {
-        halUnlock();
         handleError("halGetGenomeMetadata: unknown exception", errStr);
         return NULL;
     }
-    halUnlock();
     return ret;
 }
 
@@ -133,6 +133,21 @@ typedef enum {
 */
 int halOpenHalOrLod(char *lodFilePath, char **errStr);
 
+/** Open a HAL file or LOD text file as halOpenHalOrLod does, for queries
+ * from several threads at once.  If all the HAL files are in mmap format,
+ * they are opened for shared access and queries on the handle run
+ * concurrently.  This reads every genome of a file when it is first used,
+ * rather than only those queried, so is best avoided for remote files
+ * queried from one thread.  Otherwise, queries are run one at a time as
+ * with halOpenHalOrLod.
+ *
+ * @param lodFilePath path to location of HAL LOD file on disk
+ * @param errStr pointer to a string that contains an error message on
+ * failure. If NULL, throws an exception on failure instead.
+ * @return new handle or -1 of open failed.
+*/
+int halOpenHalOrLodShared(char *lodFilePath, char **errStr);
+
 /* Deprecated, maintain for browser code compatibility */
 int halOpenLOD(char *lodFilePath, char **errStr);
 
@@ -0,0 +1,142 @@
+/*
+ * Benchmark concurrent halGetBlocksInTargetRange queries on a single handle.
+ * Each thread issues random range queries in the target sequence; the total
+ * query rate is reported for each number of threads from 1 to --numThreads
+ * (doubling), so the scaling of the blockViz locking can be measured.
+ */
+#include "halBlockViz.h"
+#include "halCLParser.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+struct bench_args_t {
+    std::string path;
+    std::string qSpecies;
+    std::string tSpecies;
+    std::string tChrom;
+    hal_int_t tStart;
+    hal_int_t tEnd;
+    hal_int_t queryLength;
+    int numThreads;
+    int numQueries;
+    int doSeq;
+    unsigned seed;
+};
+
+static void initParser(hal::CLParser &optionsParser) {
+    optionsParser.setDescription("Benchmark concurrent blockViz queries.  Reports queries per second "
+                                 "for 1, 2, 4, ... up to numThreads threads querying one handle.");
+    optionsParser.addOption("numThreads", "maximum number of query threads", 4);
+    optionsParser.addOption("numQueries", "number of queries run by each thread", 100);
+    optionsParser.addOption("queryLength", "length of each query range", 1000);
+    optionsParser.addOption("seed", "random seed for query ranges", 0);
+    optionsParser.addOptionFlag("doSeq", "get sequence", false);
+    optionsParser.addArgument("halLodPath", "path to HAL or LOD file");
+    optionsParser.addArgument("qSpecies", "query species name");
+    optionsParser.addArgument("tSpecies", "target species name");
+    optionsParser.addArgument("tChrom", "target chromosome");
+    optionsParser.addArgument("tStart", "zero based start of region to query in target");
+    optionsParser.addArgument("tEnd", "half-open end of region to query in target");
+}
+
+static bool parseArgs(int argc, char **argv, bench_args_t *args) {
+    hal::CLParser optionsParser(hal::READ_ACCESS);
+    initParser(optionsParser);
+    try {
+        optionsParser.parseOptions(argc, argv);
+        args->path = optionsParser.getArgument<std::string>("halLodPath");
+        args->qSpecies = optionsParser.getArgument<std::string>("qSpecies");
+        args->tSpecies = optionsParser.getArgument<std::string>("tSpecies");
+        args->tChrom = optionsParser.getArgument<std::string>("tChrom");
+        args->tStart = optionsParser.getArgument<hal_int_t>("tStart");
+        args->tEnd = optionsParser.getArgument<hal_int_t>("tEnd");
+        args->queryLength = optionsParser.getOption<hal_int_t>("queryLength");
+        args->numThreads = optionsParser.getOption<int>("numThreads");
+        args->numQueries = optionsParser.getOption<int>("numQueries");
+        args->seed = optionsParser.getOption<unsigned>("seed");
+        args->doSeq = optionsParser.getFlag("doSeq");
+        if (args->tEnd <= args->tStart || args->queryLength <= 0 || args->numThreads < 1 || args->numQueries < 1) {
+            throw hal_exception("invalid region, query length, number of threads or number of queries");
+        }
+    } catch (hal_exception &e) {
+        std::cerr << e.what() << std::endl;
+        optionsParser.printUsage(std::cerr);
+        return false;
+    }
+    return true;
+}
+
+static std::atomic<int> failedQueries(0);
+
+static void queryThread(const bench_args_t *args, int handle, unsigned seed) {
+    std::mt19937 rng(seed);
+    hal_int_t maxLength = std::min(args->queryLength, args->tEnd - args->tStart);
+    std::uniform_int_distribution<hal_int_t> startDist(args->tStart, args->tEnd - maxLength);
+    hal_seqmode_type_t sm = args->doSeq ? HAL_LOD0_SEQUENCE : HAL_NO_SEQUENCE;
+    for (int i = 0; i < args->numQueries; ++i) {
+        hal_int_t start = startDist(rng);
+        char *errStr = NULL;
+        struct hal_block_results_t *results = halGetBlocksInTargetRange(
+            handle, const_cast<char *>(args->qSpecies.c_str()), const_cast<char *>(args->tSpecies.c_str()),
+            const_cast<char *>(args->tChrom.c_str()), start, start + maxLength, 0, sm, HAL_QUERY_AND_TARGET_DUPS, 1, NULL,
+            &errStr);
+        if (results == NULL) {
+            if (failedQueries++ == 0) {
+                std::cerr << "query failed: " << (errStr != NULL ? errStr : "unknown error") << std::endl;
+            }
+            free(errStr);
+        }
+        halFreeBlockResults(results);
+    }
+}
+
+/* run the queries on numThreads threads, returning the elapsed seconds */
+static double runQueries(const bench_args_t *args, int handle, int numThreads) {
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.push_back(std::thread(queryThread, args, handle, args->seed + t));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+int main(int argc, char **argv) {
+    bench_args_t args;
+    if (!parseArgs(argc, argv, &args)) {
+        return 1;
+    }
+    char *errStr = NULL;
+    int handle = halOpenHalOrLodShared(const_cast<char *>(args.path.c_str()), &errStr);
+    if (handle < 0) {
+        std::cerr << "ERROR: open failed: " << (errStr != NULL ? errStr : args.path) << std::endl;
+        return 1;
+    }
+
+    // warm up caches, so the first timing isn't penalized
+    runQueries(&args, handle, 1);
+    printf("threads\tqueries\tseconds\tqueries/sec\n");
+    for (int numThreads = 1;; numThreads = std::min(2 * numThreads, args.numThreads)) {
+        double seconds = runQueries(&args, handle, numThreads);
+        int numQueries = numThreads * args.numQueries;
+        printf("%d\t%d\t%.3f\t%.1f\n", numThreads, numQueries, seconds, numQueries / seconds);
+        if (numThreads == args.numThreads) {
+            break;
+        }
+    }
+    halClose(handle, NULL);
+    if (failedQueries > 0) {
+        std::cerr << "ERROR: " << failedQueries << " queries failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -35,6 +35,7 @@ struct bv_args_t {
     int doSeq;
     int doDupes;
     int numThreads;
+    int sharedAccess;
     char *coalescenceLimit;
     int verbose;
     int udcVerbose;
@@ -46,6 +47,7 @@ static void initParser(hal::CLParser &optionsParser) {
     optionsParser.addOptionFlag("doSeq", "get seqeuence", false);
     optionsParser.addOptionFlag("doDupes", "get duplicate regions", false);
     optionsParser.addOption("numThreads", "number of threads for thread tests", 10);
+    optionsParser.addOptionFlag("sharedAccess", "open with halOpenHalOrLodShared", false);
     optionsParser.addOption("coalescenceLimit", "coalescence limit specices, default is none", "");
     optionsParser.addArgument("halLodPath", "path to HAL or LOD file");
     optionsParser.addArgument("qSpecies", "query species name");
@@ -90,6 +92,7 @@ static bool parseArgs(int argc, char **argv, bv_args_t *args) {
     args->doSeq = optionsParser.get<bool>("doSeq");
     args->doDupes = optionsParser.get<bool>("doDupes");
     args->numThreads = optionsParser.get<int>("numThreads");
+    args->sharedAccess = optionsParser.get<bool>("sharedAccess");
     args->coalescenceLimit = optionStrOrNull(optionsParser, "coalescenceLimit");
     args->verbose = optionsParser.get<bool>("verbose");
     return true;
@@ -244,7 +247,7 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    int handle = halOpenHalOrLod(args.path, NULL);
+    int handle = args.sharedAccess ? halOpenHalOrLodShared(args.path, NULL) : halOpenHalOrLod(args.path, NULL);
     if (handle < 0) {
         std::cerr << "ERROR: open failed: " << args.path << std::endl;
         return 1;
@@ -100,9 +100,8 @@ void copyGenome(const Genome *inGenome, Genome *outGenome) {
     DnaIteratorPtr outDna = outGenome->getDnaIterator();
     hal_size_t n = inGenome->getSequenceLength();
     assert(n == outGenome->getSequenceLength());
-    for (; (hal_size_t)inDna->getArrayIndex() < n; inDna->toRight(), outDna->toRight()) {
-        outDna->setBase(inDna->getBase());
-    }
+    // both formats store the same packed bases, which are copied in blocks
+    outDna->copyBases(inDna.get(), n);
     outDna->flush();
 
     TopSegmentIteratorPtr inTop = inGenome->getTopSegmentIterator();
@@ -123,13 +122,14 @@ void copyGenome(const Genome *inGenome, Genome *outGenome) {
     assert(n == 0 || n == inGenome->getNumBottomSegments());
     hal_size_t nc = inGenome->getNumChildren();
     assert(nc == outGenome->getNumChildren());
+    bool isRoot = outGenome->getAlignment()->getRootName() == outGenome->getName();
     for (; (hal_size_t)inBot->getArrayIndex() < n; inBot->toRight(), outBot->toRight()) {
         outBot->setCoordinates(inBot->getStartPosition(), inBot->getLength());
         for (hal_size_t child = 0; child < nc; ++child) {
             outBot->bseg()->setChildIndex(child, inBot->bseg()->getChildIndex(child));
             outBot->bseg()->setChildReversed(child, inBot->bseg()->getChildReversed(child));
         }
-        if (outGenome->getAlignment()->getRootName() == outGenome->getName()) {
+        if (isRoot) {
             outBot->bseg()->setTopParseIndex(NULL_INDEX);
         } else {
             outBot->bseg()->setTopParseIndex(inBot->bseg()->getTopParseIndex());
@@ -60,22 +60,21 @@ void MaskExtractor::extendCachedIntervals() {
 
     const PositionCache::IntervalSet *intervalSet = _posCache.getIntervalSet();
     PositionCache::IntervalSet::const_iterator i;
-    vector<hal_index_t> padding;
+    // the padding is built separately, in order, then merged in one pass
+    PositionCache padding;
     for (i = intervalSet->begin(); i != intervalSet->end(); ++i) {
-        hal_size_t len = (hal_size_t)(i->first - i->second) + 1;
+        hal_size_t len = (hal_size_t)(i->_last - i->_first) + 1;
         hal_size_t pad = _extend ? _extend : (hal_size_t)(_extendPct * len);
-        hal_size_t newFirst = max(start, i->second - pad);
-        for (hal_size_t j = newFirst; j < (hal_size_t)i->second; ++j) {
-            padding.push_back(j);
+        hal_size_t newFirst = max(start, i->_first - pad);
+        if (newFirst < (hal_size_t)i->_first) {
+            padding.insert(newFirst, i->_first - 1);
         }
-        hal_size_t newLast = min(last, i->first + pad);
-        for (hal_size_t j = i->first + 1; j <= newLast; ++j) {
-            padding.push_back(j);
+        hal_size_t newLast = min(last, i->_last + pad);
+        if (newLast > (hal_size_t)i->_last) {
+            padding.insert(i->_last + 1, newLast);
         }
     }
-    for (hal_size_t k = 0; k < padding.size(); ++k) {
-        _posCache.insert(padding[k]);
-    }
+    _posCache.merge(padding);
 }
 
 void MaskExtractor::writeCachedIntervals() {
@@ -83,6 +82,6 @@ void MaskExtractor::writeCachedIntervals() {
     const PositionCache::IntervalSet *intervalSet = _posCache.getIntervalSet();
     PositionCache::IntervalSet::const_iterator i;
     for (i = intervalSet->begin(); i != intervalSet->end(); ++i) {
-        *_bedStream << _sequence->getName() << '\t' << i->second - start << '\t' << (i->first + 1) - start << '\n';
+        *_bedStream << _sequence->getName() << '\t' << i->_first - start << '\t' << (i->_last + 1) - start << '\n';
     }
 }
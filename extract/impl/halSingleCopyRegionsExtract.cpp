@@ -141,9 +141,6 @@ int main(int argc, char *argv[]) {
             curBedLine._end = pos;
             curBedLine.write(os);
         }
-        if (colIt->getReferenceSequencePosition() % 10000 == 0) {
-            colIt->defragment();
-        }
         prevSequence = colIt->getReferenceSequence();
         prevPos = colIt->getReferenceSequencePosition();
         colIt->toSite(colIt->getReferenceSequencePosition() + colIt->getReferenceSequence()->getStartPosition() + 1,
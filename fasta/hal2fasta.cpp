@@ -15,14 +15,13 @@
 using namespace std;
 using namespace hal;
 
-static void printSequenceLine(ostream &outStream, const Sequence *sequence, hal_size_t start, hal_size_t length,
-                              string &buffer, bool upper);
 static void printSequence(ostream &outStream, const Sequence *sequence, hal_size_t lineWidth, hal_size_t start,
                           hal_size_t length, bool fullNames, bool upper);
 static void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence, hal_size_t lineWidth,
                         hal_size_t start, hal_size_t length, bool fullNames, bool upper);
 
-static const hal_size_t StringBufferSize = 1024;
+// number of bases to read at a time, rounded to whole lines
+static const hal_size_t StringBufferSize = 1024 * 1024;
 
 static void initParser(CLParser &optionsParser) {
     optionsParser.addArgument("inHalPath", "input hal file");
@@ -75,6 +74,9 @@ int main(int argc, char **argv) {
         subtree = optionsParser.getFlag("subtree");
         upper = optionsParser.getFlag("upper");
 
+        if (lineWidth == 0) {
+            throw hal_exception("--lineWidth must be greater than 0");
+        }
         if (subtree) {
             if (start != 0) {
                 throw hal_exception("--start cannot be used with --subtree");
@@ -116,6 +118,7 @@ int main(int argc, char **argv) {
             if (genome == NULL) {
                 throw hal_exception(string("Genome ") + curName + " not found");
             }
+            genome->adviseAccessPattern(ACCESS_PATTERN_SEQUENTIAL);
 
             const Sequence *sequence = NULL;
             if (sequenceName != "\"\"") {
@@ -148,21 +151,6 @@ int main(int argc, char **argv) {
     return 0;
 }
 
-void printSequenceLine(ostream &outStream, const Sequence *sequence, hal_size_t start, hal_size_t length, string &buffer, bool upper) {
-    hal_size_t last = start + length;
-    hal_size_t readLen;
-    for (hal_size_t i = start; i < last; i += StringBufferSize) {
-        readLen = std::min(StringBufferSize, last - i);
-        sequence->getSubString(buffer, i, readLen);
-        if (upper) {
-            for (int j = 0; j < buffer.size(); ++j) {
-                buffer[j] = std::toupper(buffer[j]);
-            }
-        }
-        outStream << buffer;
-    }
-}
-
 void printSequence(ostream &outStream, const Sequence *sequence, hal_size_t lineWidth, hal_size_t start, hal_size_t length, bool fullNames, bool upper) {
     hal_size_t seqLen = sequence->getSequenceLength();
     if (length == 0) {
@@ -175,12 +163,22 @@ void printSequence(ostream &outStream, const Sequence *sequence, hal_size_t line
                             std::to_string(seqLen));
     }
     outStream << '>' << (fullNames ? sequence->getFullName() : sequence->getName()) << '\n';
+    // read many lines at a time, so the DNA is decoded in bulk
+    hal_size_t bufferLength = std::max(lineWidth, (StringBufferSize / lineWidth) * lineWidth);
     hal_size_t readLen;
     string buffer;
-    for (hal_size_t i = start; i < last; i += lineWidth) {
-        readLen = std::min(lineWidth, last - i);
-        printSequenceLine(outStream, sequence, i, readLen, buffer, upper);
-        outStream << '\n';
+    for (hal_size_t i = start; i < last; i += bufferLength) {
+        readLen = std::min(bufferLength, last - i);
+        sequence->getSubString(buffer, i, readLen);
+        if (upper) {
+            for (hal_size_t j = 0; j < readLen; ++j) {
+                buffer[j] = std::toupper(buffer[j]);
+            }
+        }
+        for (hal_size_t j = 0; j < readLen; j += lineWidth) {
+            outStream.write(buffer.data() + j, std::min(lineWidth, readLen - j));
+            outStream << '\n';
+        }
     }
 }
 
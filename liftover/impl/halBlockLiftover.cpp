@@ -14,7 +14,7 @@
 using namespace std;
 using namespace hal;
 
-BlockLiftover::BlockLiftover() : Liftover() {
+BlockLiftover::BlockLiftover(const PairIndex *pairIndex) : Liftover(), _pairIndex(pairIndex) {
 }
 
 BlockLiftover::~BlockLiftover() {
@@ -49,7 +49,7 @@ void BlockLiftover::liftInterval(BedList &mappedBedLines) {
     hal_index_t globalEnd = _bedLine._end - 1 + _srcSequence->getStartPosition();
     bool flip = _bedLine._strand == '-';
 
-    _refSeg->toSite(globalStart, false);
+    moveToSite(globalStart);
     hal_offset_t startOffset = globalStart - _refSeg->getStartPosition();
     hal_offset_t endOffset = 0;
     if (globalEnd <= _refSeg->getEndPosition()) {
@@ -61,6 +61,11 @@ void BlockLiftover::liftInterval(BedList &mappedBedLines) {
     assert(_refSeg->getEndPosition() <= globalEnd);
 
     while (_refSeg->getArrayIndex() < _lastIndex && _refSeg->getStartPosition() <= globalEnd) {
+        if (_pairIndex != NULL) {
+            _pairIndex->mapSegment(_refSeg.get(), _tgtGenome, flip, _mappedSegments);
+            _refSeg->toRight(globalEnd);
+            continue;
+        }
         if (flip == true) {
             _refSeg->toReverseInPlace();
         }
@@ -112,6 +117,26 @@ void BlockLiftover::liftInterval(BedList &mappedBedLines) {
     }
 }
 
+/* move the unsliced iterator to the segment containing position.  when
+ * intervals are lifted in source order, the previous one leaves the iterator
+ * in or a few segments away from the next, so walk from there before
+ * falling back on a search of the whole genome */
+void BlockLiftover::moveToSite(hal_index_t position) {
+    hal_index_t index = _refSeg->getArrayIndex();
+    if (index >= 0 && index < _lastIndex && position >= 0 &&
+        position < (hal_index_t)_refSeg->getGenome()->getSequenceLength()) {
+        _refSeg->slice(0, 0);
+        hal_index_t delta = _refSeg->rightOf(position) ? -1 : 1;
+        for (hal_size_t i = 0; i < MaxSweepSteps && index >= 0 && index < _lastIndex; ++i, index += delta) {
+            _refSeg->setArrayIndex(_refSeg->getGenome(), index);
+            if (_refSeg->overlaps(position)) {
+                return;
+            }
+        }
+    }
+    _refSeg->toSite(position, false);
+}
+
 void BlockLiftover::readPSLInfo(vector<MappedSegmentPtr> &fragments, BedLine &outBedLine) {
     const Sequence *srcSequence = fragments[0]->getSource()->getSequence();
     const Sequence *tSequence = fragments[0]->getSequence();
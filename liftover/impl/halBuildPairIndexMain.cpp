@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halPairIndex.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("halFile", "input hal file");
+    optionsParser.addArgument("srcGenome", "source genome name");
+    optionsParser.addArgument("tgtGenome", "target genome name");
+    optionsParser.addOption("outIndex", "path of output index (default: halFile.srcGenome.tgtGenome.pairIndex, "
+                                        "where halLiftover looks for it)",
+                            "");
+    optionsParser.addOptionFlag("noDupes", "do not map between duplications in"
+                                           " graph.",
+                                false);
+    optionsParser.addOption("coalescenceLimit", "coalescence limit genome:"
+                                                " the genome at or above the MRCA of source"
+                                                " and target at which we stop looking for"
+                                                " homologies (default: MRCA)",
+                            "");
+    optionsParser.addOption("numThreads", "number of threads used to map the source genome.  Only supported for mmap "
+                            "HAL files", 1);
+    optionsParser.setDescription("Map every segment of a source genome to a target genome and save the mappings "
+                                 "in an index, which halLiftover uses to lift intervals between the pair without "
+                                 "walking the tree.  The index is only used by halLiftover runs with the same "
+                                 "--noDupes and --coalescenceLimit options, on the same HAL file.");
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    initParser(optionsParser);
+
+    string halPath;
+    string srcGenomeName;
+    string tgtGenomeName;
+    string indexPath;
+    string coalescenceLimitName;
+    bool noDupes;
+    hal_size_t numThreads;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        halPath = optionsParser.getArgument<string>("halFile");
+        srcGenomeName = optionsParser.getArgument<string>("srcGenome");
+        tgtGenomeName = optionsParser.getArgument<string>("tgtGenome");
+        indexPath = optionsParser.getOption<string>("outIndex");
+        coalescenceLimitName = optionsParser.getOption<string>("coalescenceLimit");
+        noDupes = optionsParser.getFlag("noDupes");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        exit(1);
+    }
+
+    try {
+        AlignmentConstPtr alignment(
+            openHalAlignment(halPath, &optionsParser, (numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
+        const Genome *srcGenome = alignment->openGenome(srcGenomeName);
+        if (srcGenome == NULL) {
+            throw hal_exception(string("srcGenome, ") + srcGenomeName + ", not found in alignment");
+        }
+        const Genome *tgtGenome = alignment->openGenome(tgtGenomeName);
+        if (tgtGenome == NULL) {
+            throw hal_exception(string("tgtGenome, ") + tgtGenomeName + ", not found in alignment");
+        }
+        const Genome *coalescenceLimit = NULL;
+        if (coalescenceLimitName != "") {
+            coalescenceLimit = alignment->openGenome(coalescenceLimitName);
+            if (coalescenceLimit == NULL) {
+                throw hal_exception("coalescence limit genome " + coalescenceLimitName + " not found in alignment\n");
+            }
+        }
+        if (indexPath.empty()) {
+            indexPath = PairIndex::getDefaultPath(halPath, srcGenomeName, tgtGenomeName);
+        }
+        PairIndex::build(alignment, halPath, srcGenome, tgtGenome, indexPath, !noDupes, coalescenceLimit, numThreads);
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
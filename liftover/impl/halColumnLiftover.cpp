@@ -6,23 +6,59 @@
  */
 
 #include "halColumnLiftover.h"
+#include "halSegmentMapper.h"
+#include <algorithm>
 #include <cassert>
 #include <deque>
 
 using namespace std;
 using namespace hal;
 
-ColumnLiftover::ColumnLiftover() : Liftover() {
+ColumnLiftover::ColumnLiftover(bool byColumns) : Liftover(), _byColumns(byColumns) {
 }
 
 ColumnLiftover::~ColumnLiftover() {
 }
 
+void ColumnLiftover::visitBegin() {
+    if (_srcGenome->getNumTopSegments() > 0) {
+        _refSeg = _srcGenome->getTopSegmentIterator();
+        _lastIndex = (hal_index_t)_srcGenome->getNumTopSegments();
+    } else {
+        _refSeg = _srcGenome->getBottomSegmentIterator();
+        _lastIndex = (hal_index_t)_srcGenome->getNumBottomSegments();
+    }
+
+    // the column iterator searches the spanning tree of the source and
+    // target, so segments are mapped up to their MRCA and no further
+    set<const Genome *> inputSet;
+    inputSet.insert(_srcGenome);
+    inputSet.insert(_tgtGenome);
+    _mrca = getLowestCommonAncestor(inputSet);
+    inputSet.clear();
+    inputSet.insert(_mrca);
+    inputSet.insert(_tgtGenome);
+    _downwardPath.clear();
+    getGenomesInSpanningTree(inputSet, _downwardPath);
+}
+
 void ColumnLiftover::liftInterval(BedList &mappedBedLines) {
+    if (_byColumns || !_traverseDupes) {
+        liftIntervalByColumns(mappedBedLines);
+    } else {
+        liftIntervalBySegments(mappedBedLines);
+    }
+}
+
+void ColumnLiftover::liftIntervalByColumns(BedList &mappedBedLines) {
     PositionMap posCacheMap;
     PositionMap revCacheMap;
+    // the columns are the same in either direction, so walk them forward
+    // (the column iterator can fail to terminate when reversed) and flip
+    // the strand of what we find instead
+    bool flip = _bedLine._strand == '-';
     _colIt = _srcSequence->getColumnIterator(&_tgtSet, 0, _bedLine._start, _bedLine._end - 1, !_traverseDupes, false,
-                                             _bedLine._strand == '-', true);
+                                             false, true);
     while (true) {
         const ColumnMap *cMap = _colIt->getColumnMap();
         for (ColumnMap::const_iterator i = cMap->begin(); i != cMap->end(); ++i) {
@@ -33,7 +69,7 @@ void ColumnLiftover::liftInterval(BedList &mappedBedLines) {
                 SeqIndex seqIdx(seq, 0);
                 for (DNASet::const_iterator j = dSet->begin(); j != dSet->end(); ++j) {
                     pair<PositionMap::iterator, bool> res;
-                    if ((*j)->getReversed() == false) {
+                    if ((*j)->getReversed() == flip) {
                         res = posCacheMap.insert(pair<SeqIndex, PositionCache *>(seqIdx, NULL));
                     } else {
                         res = revCacheMap.insert(pair<SeqIndex, PositionCache *>(seqIdx, NULL));
@@ -63,8 +99,8 @@ void ColumnLiftover::liftInterval(BedList &mappedBedLines) {
             BedLine &outBedLine = mappedBedLines.back();
             outBedLine._blocks.clear();
             outBedLine._chrName = seq->getName();
-            outBedLine._start = k->second - seqStart;
-            outBedLine._end = k->first + 1 - seqStart;
+            outBedLine._start = k->_first - seqStart;
+            outBedLine._end = k->_last + 1 - seqStart;
             outBedLine._strand = _bedLine._strand == '.' ? '.' : '+';
             outBedLine._srcStart = NULL_INDEX; // not available from posMap
         }
@@ -82,11 +118,122 @@ void ColumnLiftover::liftInterval(BedList &mappedBedLines) {
             BedLine &outBedLine = mappedBedLines.back();
             outBedLine._blocks.clear();
             outBedLine._chrName = seq->getName();
-            outBedLine._start = k->second - seqStart;
-            outBedLine._end = k->first + 1 - seqStart;
+            outBedLine._start = k->_first - seqStart;
+            outBedLine._end = k->_last + 1 - seqStart;
             outBedLine._strand = _bedLine._strand == '.' ? '.' : '-';
             outBedLine._srcStart = NULL_INDEX; // not available from posMap
         }
         delete posCache;
     }
 }
+
+void ColumnLiftover::liftIntervalBySegments(BedList &mappedBedLines) {
+    _mappedSegments.clear();
+    hal_index_t globalStart = _bedLine._start + _srcSequence->getStartPosition();
+    hal_index_t globalEnd = _bedLine._end - 1 + _srcSequence->getStartPosition();
+    bool flip = _bedLine._strand == '-';
+
+    _refSeg->toSite(globalStart, false);
+    hal_offset_t startOffset = globalStart - _refSeg->getStartPosition();
+    hal_offset_t endOffset = 0;
+    if (globalEnd <= _refSeg->getEndPosition()) {
+        endOffset = _refSeg->getEndPosition() - globalEnd;
+    }
+    _refSeg->slice(startOffset, endOffset);
+
+    while (_refSeg->getArrayIndex() < _lastIndex && _refSeg->getStartPosition() <= globalEnd) {
+        if (flip == true) {
+            _refSeg->toReverseInPlace();
+        }
+        halMapSegment(_refSeg.get(), _mappedSegments, _tgtGenome, &_downwardPath, true, 0, _mrca, _mrca);
+        if (flip == true) {
+            _refSeg->toReverseInPlace();
+        }
+        _refSeg->toRight(globalEnd);
+    }
+
+    // the column iterator reports each target base once, in the column of
+    // the leftmost source base aligned to it, so a target base reached
+    // from several source paralogs only keeps the strand of the first.
+    // do the same by taking the mapped segments in source order and only
+    // keeping the target bases no earlier segment has covered.
+    vector<pair<hal_index_t, const MappedSegment *>> sourceOrder;
+    sourceOrder.reserve(_mappedSegments.size());
+    for (MappedSegmentSet::const_iterator i = _mappedSegments.begin(); i != _mappedSegments.end(); ++i) {
+        const SlicedSegment *source = (*i)->getSource();
+        sourceOrder.push_back(make_pair(min(source->getStartPosition(), source->getEndPosition()), i->get()));
+    }
+    stable_sort(sourceOrder.begin(), sourceOrder.end(),
+                [](const pair<hal_index_t, const MappedSegment *> &a, const pair<hal_index_t, const MappedSegment *> &b) {
+                    return a.first < b.first;
+                });
+
+    // the target ranges of the mapped segments, by sequence and strand
+    RangeMap posRangeMap;
+    RangeMap revRangeMap;
+    map<const Sequence *, CoveredMap> coveredMaps;
+    for (size_t i = 0; i < sourceOrder.size(); ++i) {
+        const MappedSegment *mapped = sourceOrder[i].second;
+        Interval range;
+        range._first = min(mapped->getStartPosition(), mapped->getEndPosition());
+        range._last = max(mapped->getStartPosition(), mapped->getEndPosition());
+        RangeMap &rangeMap = mapped->getReversed() ? revRangeMap : posRangeMap;
+        addUncovered(coveredMaps[mapped->getSequence()], range, rangeMap[SeqIndex(mapped->getSequence(), 0)]);
+    }
+    addRangeLines(posRangeMap, '+', mappedBedLines);
+    addRangeLines(revRangeMap, '-', mappedBedLines);
+}
+
+/* add the parts of range not in covered to ranges, and add range to
+ * covered, which is kept as disjoint intervals keyed on their first
+ * position */
+void ColumnLiftover::addUncovered(CoveredMap &covered, const Interval &range, IntervalSet &ranges) {
+    hal_index_t first = range._first;
+    hal_index_t last = range._last;
+    CoveredMap::iterator i = covered.upper_bound(first);
+    if (i != covered.begin() && prev(i)->second >= first - 1) {
+        --i;
+    }
+    hal_index_t pos = first;
+    while (i != covered.end() && i->first <= last + 1) {
+        if (i->first > pos) {
+            Interval piece = {pos, i->first - 1};
+            ranges.push_back(piece);
+        }
+        pos = max(pos, i->second + 1);
+        first = min(first, i->first);
+        last = max(last, i->second);
+        i = covered.erase(i);
+    }
+    if (pos <= range._last) {
+        Interval piece = {pos, range._last};
+        ranges.push_back(piece);
+    }
+    covered[first] = last;
+}
+
+/* merge the overlapping and abutting ranges of each sequence and add a
+ * line for each merged range */
+void ColumnLiftover::addRangeLines(RangeMap &rangeMap, char strand, BedList &mappedBedLines) {
+    for (RangeMap::iterator i = rangeMap.begin(); i != rangeMap.end(); ++i) {
+        const Sequence *seq = i->first.first;
+        hal_size_t seqStart = seq->getStartPosition();
+        IntervalSet &ranges = i->second;
+        sort(ranges.begin(), ranges.end(), [](const Interval &a, const Interval &b) { return a._first < b._first; });
+        for (size_t j = 0; j < ranges.size();) {
+            hal_index_t first = ranges[j]._first;
+            hal_index_t last = ranges[j]._last;
+            for (++j; j < ranges.size() && ranges[j]._first <= last + 1; ++j) {
+                last = max(last, ranges[j]._last);
+            }
+            mappedBedLines.push_back(_bedLine);
+            BedLine &outBedLine = mappedBedLines.back();
+            outBedLine._blocks.clear();
+            outBedLine._chrName = seq->getName();
+            outBedLine._start = first - seqStart;
+            outBedLine._end = last + 1 - seqStart;
+            outBedLine._strand = _bedLine._strand == '.' ? '.' : strand;
+            outBedLine._srcStart = NULL_INDEX;
+        }
+    }
+}
@@ -6,23 +6,30 @@
  */
 
 #include "halLiftover.h"
+#include "halParallel.h"
+#include <algorithm>
 #include <cassert>
 #include <deque>
+#include <numeric>
+#include <sstream>
 
 using namespace std;
 using namespace hal;
 
 Liftover::Liftover()
     : _outBedStream(NULL), _outPSL(false), _outPSLWithName(false), _srcGenome(NULL),
-      _tgtGenome(NULL) {
+      _tgtGenome(NULL), _batchSize(0), _numThreads(1) {
 }
 
 Liftover::~Liftover() {
+    clearWorkers();
 }
 
 void Liftover::convert(AlignmentConstPtr alignment, const Genome *srcGenome, istream *inBedStream, const Genome *tgtGenome,
                        ostream *outBedStream, int bedType, bool traverseDupes,
-                       bool outPSL, bool outPSLWithName, const Genome *coalescenceLimit) {
+                       bool outPSL, bool outPSLWithName, const Genome *coalescenceLimit, hal_size_t batchSize,
+                       hal_size_t numThreads) {
+    _alignment = alignment;
     _srcGenome = srcGenome;
     _tgtGenome = tgtGenome;
     _coalescenceLimit = coalescenceLimit;
@@ -31,9 +38,18 @@ void Liftover::convert(AlignmentConstPtr alignment, const Genome *srcGenome, ist
     _traverseDupes = traverseDupes;
     _outPSL = outPSL;
     _outPSLWithName = outPSLWithName;
+    _batchSize = batchSize;
+    _numThreads = numThreads;
     _missedSet.clear();
     _tgtSet.clear();
+    clearWorkers();
     assert(_srcGenome && inBedStream && tgtGenome && outBedStream);
+    if (_numThreads > 1) {
+        if (_batchSize == 0) {
+            throw hal_exception("lifting over with more than one thread requires a batch size");
+        }
+        checkSharedAccess(_alignment.get());
+    }
 
     _tgtSet.insert(tgtGenome);
 
@@ -48,7 +64,6 @@ void Liftover::visitLine() {
         // forcing to BED12 makes PSL code simpler
         _bedLine.expandToBed12();
     }
-    _outBedLines.clear();
     _srcSequence = _srcGenome->getSequence(_bedLine._chrName);
     if (_srcSequence == NULL) {
         pair<set<string>::iterator, bool> result = _missedSet.insert(_bedLine._chrName);
@@ -69,6 +84,25 @@ void Liftover::visitLine() {
         return;
     }
 
+    if (_batchSize == 0) {
+        liftLine();
+        writeLineResults(*_outBedStream);
+    } else {
+        _batchLines.push_back(_bedLine);
+        _batchSequences.push_back(_srcSequence);
+        if (_batchLines.size() >= _batchSize) {
+            liftBatch();
+        }
+    }
+}
+
+void Liftover::visitEOF() {
+    liftBatch();
+}
+
+/* lift _bedLine, whose source sequence is _srcSequence, into _outBedLines */
+void Liftover::liftLine() {
+    _outBedLines.clear();
     _mappedBlocks.clear();
     if (_bedLine._bedType <= 9) {
         liftInterval(_mappedBlocks);
@@ -88,19 +122,95 @@ void Liftover::visitLine() {
 
     cleanResults();
     _outBedLines.sort(BedLineSrcLess());
-    writeLineResults();
 }
 
-void Liftover::visitEOF() {
+/* lift the queued lines and write their results in the order the lines
+ * were read */
+void Liftover::liftBatch() {
+    if (_batchLines.empty()) {
+        return;
+    }
+    if (_numThreads <= 1) {
+        string output;
+        liftBatchLines(_batchLines, _batchSequences, 0, _batchLines.size(), output);
+        *_outBedStream << output;
+    } else {
+        size_t numTasks = min((size_t)_numThreads, _batchLines.size());
+        while (_workers.size() < numTasks) {
+            _workers.push_back(createWorker());
+        }
+        auto liftTask = [&](size_t i, string &output) {
+            _workers[i]->liftBatchLines(_batchLines, _batchSequences, i * _batchLines.size() / numTasks,
+                                        (i + 1) * _batchLines.size() / numTasks, output);
+        };
+        auto writeTask = [&](size_t i, string &output) { *_outBedStream << output; };
+        runOrderedTasks(numTasks, numTasks, liftTask, writeTask);
+    }
+    _batchLines.clear();
+    _batchSequences.clear();
+}
+
+/* lift lines [first, last) sorted by source position, then append their
+ * results to output in their original order.  the lines are swapped out
+ * of the vector while they are lifted */
+void Liftover::liftBatchLines(vector<BedLine> &lines, const vector<const Sequence *> &sequences, size_t first,
+                              size_t last, string &output) {
+    vector<size_t> order(last - first);
+    iota(order.begin(), order.end(), first);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sequences[a]->getStartPosition() + lines[a]._start < sequences[b]->getStartPosition() + lines[b]._start;
+    });
+
+    // the scanner reads each line over the previous one, so keep the last
+    // line read in place of the ones lifted
+    BedLine lastLine;
+    swap(lastLine, _bedLine);
+    vector<string> results(order.size());
+    ostringstream lineResults;
+    for (size_t i = 0; i < order.size(); ++i) {
+        swap(_bedLine, lines[order[i]]);
+        _srcSequence = sequences[order[i]];
+        liftLine();
+        lineResults.str(string());
+        writeLineResults(lineResults);
+        results[order[i] - first] = lineResults.str();
+    }
+    swap(lastLine, _bedLine);
+    for (size_t i = 0; i < results.size(); ++i) {
+        output += results[i];
+    }
+}
+
+/* a liftover for a worker thread with the same options as this one */
+Liftover *Liftover::createWorker() const {
+    Liftover *worker = newWorker();
+    worker->_alignment = _alignment;
+    worker->_bedType = _bedType;
+    worker->_traverseDupes = _traverseDupes;
+    worker->_outPSL = _outPSL;
+    worker->_outPSLWithName = _outPSLWithName;
+    worker->_srcGenome = _srcGenome;
+    worker->_tgtGenome = _tgtGenome;
+    worker->_coalescenceLimit = _coalescenceLimit;
+    worker->_tgtSet = _tgtSet;
+    worker->visitBegin();
+    return worker;
+}
+
+void Liftover::clearWorkers() {
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        delete _workers[i];
+    }
+    _workers.clear();
 }
 
-void Liftover::writeLineResults() {
+void Liftover::writeLineResults(ostream &os) {
     BedList::iterator i = _outBedLines.begin();
     for (; i != _outBedLines.end(); ++i) {
         if (_outPSL == false) {
-            i->write(*_outBedStream);
+            i->write(os);
         } else {
-            i->writePSL(*_outBedStream, _outPSLWithName);
+            i->writePSL(os, _outPSLWithName);
         }
     }
 }
@@ -39,6 +39,15 @@ static void initParser(CLParser &optionsParser) {
     optionsParser.addOption("bedType", "number of standard columns (3 to 12), columns beyond this are passed "
                             "through.  This only needs to be specified for BEDs with less than 12 columns and "
                             "having non-standard extra columns.", 0);
+    optionsParser.addOption("batchSize", "number of input lines to read before lifting them together in order of "
+                            "source position.  Results are still written in input order.  Set to 0 to lift each "
+                            "line as it is read", 100000);
+    optionsParser.addOption("numThreads", "number of threads used to lift each batch of input lines.  The output "
+                            "is the same as with a single thread.  Only supported for mmap HAL files", 1);
+    optionsParser.addOption("pairIndex", "pair index built by halBuildPairIndex to look up mappings in instead "
+                            "of walking the tree (default: halFile.srcGenome.tgtGenome.pairIndex, if it exists)",
+                            "");
+    optionsParser.addOptionFlag("noPairIndex", "don't use a pair index, even if one exists", false);
     optionsParser.setDescription("Map BED or PSL genome interval coordinates between "
                                  "two genomes.");
 }
@@ -56,8 +65,12 @@ int main(int argc, char **argv) {
     bool noDupes;
     bool append;
     int bedType;
+    hal_size_t batchSize;
+    hal_size_t numThreads;
     bool outPSL;
     bool outPSLWithName;
+    string pairIndexPath;
+    bool noPairIndex;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halFile");
@@ -76,8 +89,18 @@ int main(int argc, char **argv) {
         } else {
             bedType = 0;
         }
+        batchSize = optionsParser.getOption<hal_size_t>("batchSize");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads > 1 && batchSize == 0) {
+            throw hal_exception("--numThreads requires a --batchSize greater than 0");
+        }
         outPSL = optionsParser.getFlag("outPSL");
         outPSLWithName = optionsParser.getFlag("outPSLWithName");
+        pairIndexPath = optionsParser.getOption<string>("pairIndex");
+        noPairIndex = optionsParser.getFlag("noPairIndex");
+        if (noPairIndex && !pairIndexPath.empty()) {
+            throw hal_exception("--pairIndex and --noPairIndex cannot be used together");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -88,7 +111,8 @@ int main(int argc, char **argv) {
         if (outPSLWithName == true) {
             outPSL = true;
         }
-        AlignmentConstPtr alignment(openHalAlignment(halPath, &optionsParser));
+        AlignmentConstPtr alignment(
+            openHalAlignment(halPath, &optionsParser, (numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
         if (alignment->getNumGenomes() == 0) {
             throw hal_exception("hal alignment is empty");
         }
@@ -101,6 +125,8 @@ int main(int argc, char **argv) {
         if (tgtGenome == NULL) {
             throw hal_exception(string("tgtGenome, ") + tgtGenomeName + ", not found in alignment");
         }
+        // the source is usually sorted, but lifted regions land anywhere in the target
+        tgtGenome->adviseAccessPattern(ACCESS_PATTERN_RANDOM);
 
         const Genome *coalescenceLimit = NULL;
         if (coalescenceLimitName != "") {
@@ -135,9 +161,36 @@ int main(int argc, char **argv) {
             }
         }
 
-        BlockLiftover liftover;
+        // an index given explicitly must be usable, while one found at the
+        // default path is skipped with a warning if it isn't
+        PairIndex pairIndex;
+        bool explicitPairIndex = !pairIndexPath.empty();
+        if (!explicitPairIndex) {
+            pairIndexPath = PairIndex::getDefaultPath(halPath, srcGenomeName, tgtGenomeName);
+        }
+        if (!noPairIndex && (explicitPairIndex || ifstream(pairIndexPath.c_str()).good())) {
+            string problem;
+            try {
+                pairIndex.open(pairIndexPath);
+                problem = pairIndex.check(halPath, srcGenome, tgtGenome, !noDupes, coalescenceLimit);
+            } catch (hal_exception &e) {
+                if (explicitPairIndex) {
+                    throw;
+                }
+                problem = e.what();
+            }
+            if (!problem.empty()) {
+                if (explicitPairIndex) {
+                    throw hal_exception("Cannot use pair index " + pairIndexPath + ": " + problem);
+                }
+                cerr << "Warning: not using pair index " << pairIndexPath << ": " << problem << endl;
+                pairIndex.close();
+            }
+        }
+
+        BlockLiftover liftover(pairIndex.isOpen() ? &pairIndex : NULL);
         liftover.convert(alignment, srcGenome, srcBedPtr, tgtGenome, tgtBedPtr, bedType,
-                         !noDupes, outPSL, outPSLWithName, coalescenceLimit);
+                         !noDupes, outPSL, outPSLWithName, coalescenceLimit, batchSize, numThreads);
 
 
     } catch (hal_exception &e) {
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halPairIndex.h"
+#include "halParallel.h"
+#include "halSegmentMapper.h"
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+const char PairIndex::Magic[8] = {'H', 'A', 'L', 'P', 'I', 'D', 'X', '\0'};
+const hal_size_t PairIndex::Version;
+
+/* number of source segments mapped by each build task */
+static const hal_size_t BuildTaskSegments = 10000;
+
+static SegmentIteratorPtr getSegment(const Genome *genome, bool top, hal_index_t index) {
+    if (top) {
+        return genome->getTopSegmentIterator(index);
+    } else {
+        return genome->getBottomSegmentIterator(index);
+    }
+}
+
+static bool sameSegment(const SegmentIterator *a, const SegmentIterator *b) {
+    return a->getStartPosition() == b->getStartPosition() && a->getEndPosition() == b->getEndPosition() &&
+           a->getReversed() == b->getReversed();
+}
+
+PairIndex::PairIndex() : _data(NULL), _size(0), _header(NULL), _offsets(NULL), _records(NULL) {
+}
+
+PairIndex::~PairIndex() {
+    close();
+}
+
+string PairIndex::getDefaultPath(const string &halPath, const string &srcGenomeName, const string &tgtGenomeName) {
+    return halPath + "." + srcGenomeName + "." + tgtGenomeName + ".pairIndex";
+}
+
+void PairIndex::getHalStat(const string &halPath, hal_size_t &size, hal_index_t &modTime) {
+    struct stat halStat;
+    if (stat(halPath.c_str(), &halStat) == 0) {
+        size = halStat.st_size;
+        modTime = halStat.st_mtime;
+    } else {
+        // not a local file, so it can't be checked
+        size = 0;
+        modTime = 0;
+    }
+}
+
+void PairIndex::build(AlignmentConstPtr alignment, const string &halPath, const Genome *srcGenome,
+                      const Genome *tgtGenome, const string &indexPath, bool traverseDupes,
+                      const Genome *coalescenceLimit, hal_size_t numThreads) {
+    if (numThreads > 1) {
+        checkSharedAccess(alignment.get());
+    }
+    // the same traversal as BlockLiftover
+    bool srcTop = srcGenome->getNumTopSegments() > 0;
+    hal_size_t numSrcSegments = srcTop ? srcGenome->getNumTopSegments() : srcGenome->getNumBottomSegments();
+    set<const Genome *> inputSet;
+    inputSet.insert(srcGenome);
+    inputSet.insert(tgtGenome);
+    const Genome *mrca = getLowestCommonAncestor(inputSet);
+    if (coalescenceLimit == NULL) {
+        coalescenceLimit = mrca;
+    }
+    inputSet.clear();
+    inputSet.insert(coalescenceLimit);
+    inputSet.insert(tgtGenome);
+    set<const Genome *> downwardPath;
+    getGenomesInSpanningTree(inputSet, downwardPath);
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header._magic, Magic, sizeof(Magic));
+    header._version = Version;
+    getHalStat(halPath, header._halSize, header._halModTime);
+    header._traverseDupes = traverseDupes;
+    header._srcLength = srcGenome->getSequenceLength();
+    header._tgtLength = tgtGenome->getSequenceLength();
+    header._srcTop = srcTop;
+    header._numSrcSegments = numSrcSegments;
+    header._numTgtTopSegments = tgtGenome->getNumTopSegments();
+    header._numTgtBottomSegments = tgtGenome->getNumBottomSegments();
+    string names = srcGenome->getName() + '\0' + tgtGenome->getName() + '\0' + coalescenceLimit->getName() + '\0';
+    names.resize((names.size() + 7) / 8 * 8, '\0');
+    header._namesLength = names.size();
+
+    // written to a temporary file that is renamed to indexPath once it is
+    // complete, so a failed build never leaves a partial index where
+    // halLiftover looks for one, and readers of an older index keep it
+    string tmpPath = indexPath + ".tmp." + std::to_string(getpid());
+    ofstream indexFile(tmpPath.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!indexFile) {
+        throw hal_exception("Error opening pair index " + tmpPath + " for writing");
+    }
+    try {
+        // the header and offsets are written again once the records are known
+        vector<hal_size_t> offsets(numSrcSegments + 1, 0);
+        indexFile.write((const char *)&header, sizeof(Header));
+        indexFile.write(names.data(), names.size());
+        indexFile.write((const char *)&offsets[0], offsets.size() * sizeof(hal_size_t));
+
+        // each task maps a run of source segments and outputs, for each
+        // segment, its number of records followed by the records
+        size_t numTasks = (numSrcSegments + BuildTaskSegments - 1) / BuildTaskSegments;
+        auto mapTask = [&](size_t taskIndex, string &output) {
+            hal_index_t first = taskIndex * BuildTaskSegments;
+            hal_index_t last = min((hal_index_t)numSrcSegments, first + (hal_index_t)BuildTaskSegments);
+            SegmentIteratorPtr srcSeg = getSegment(srcGenome, srcTop, first);
+            MappedSegmentSet mappedSegments;
+            for (hal_index_t i = first; i < last; ++i, srcSeg->toRight()) {
+                mappedSegments.clear();
+                halMapSegment(srcSeg.get(), mappedSegments, tgtGenome, &downwardPath, traverseDupes, 0, coalescenceLimit,
+                              mrca);
+                hal_size_t numRecords = mappedSegments.size();
+                output.append((const char *)&numRecords, sizeof(hal_size_t));
+                for (MappedSegmentSet::const_iterator j = mappedSegments.begin(); j != mappedSegments.end(); ++j) {
+                    SlicedSegment *source = (*j)->getSource();
+                    SlicedSegment *target = (*j)->getTarget();
+                    if (source->getReversed() || source->getArrayIndex() != i) {
+                        throw hal_exception("Unexpected source for mapped segment of " + srcGenome->getName() +
+                                            " segment " + std::to_string(i));
+                    }
+                    Record record;
+                    record._srcStartOffset = source->getStartOffset();
+                    record._srcEndOffset = source->getEndOffset();
+                    record._tgtIndex = target->getArrayIndex();
+                    record._tgtStartOffset = target->getStartOffset();
+                    record._tgtEndOffset = target->getEndOffset();
+                    record._flags = (target->isTop() ? TargetTop : 0) | (target->getReversed() ? TargetReversed : 0);
+
+                    // make sure the mapped segment can be rebuilt from the record
+                    SegmentIteratorPtr tgtSeg = getSegment(tgtGenome, target->isTop(), record._tgtIndex);
+                    if (target->getReversed()) {
+                        tgtSeg->toReverseInPlace();
+                    }
+                    tgtSeg->slice(record._tgtStartOffset, record._tgtEndOffset);
+                    if (!sameSegment(tgtSeg.get(), (*j)->getTargetIterator())) {
+                        throw hal_exception("Unable to index mapped segment of " + srcGenome->getName() + " segment " +
+                                            std::to_string(i));
+                    }
+                    output.append((const char *)&record, sizeof(Record));
+                }
+            }
+        };
+        hal_size_t numRecords = 0;
+        hal_index_t segment = 0;
+        auto writeTask = [&](size_t taskIndex, string &output) {
+            for (size_t pos = 0; pos < output.size();) {
+                hal_size_t segmentRecords;
+                memcpy(&segmentRecords, output.data() + pos, sizeof(hal_size_t));
+                pos += sizeof(hal_size_t);
+                indexFile.write(output.data() + pos, segmentRecords * sizeof(Record));
+                pos += segmentRecords * sizeof(Record);
+                offsets[segment++] = numRecords;
+                numRecords += segmentRecords;
+            }
+        };
+        runOrderedTasks(numTasks, numThreads, mapTask, writeTask);
+        assert(segment == (hal_index_t)numSrcSegments);
+        offsets[segment] = numRecords;
+
+        header._numRecords = numRecords;
+        indexFile.seekp(0);
+        indexFile.write((const char *)&header, sizeof(Header));
+        indexFile.seekp(sizeof(Header) + names.size());
+        indexFile.write((const char *)&offsets[0], offsets.size() * sizeof(hal_size_t));
+        indexFile.close();
+        if (!indexFile) {
+            throw hal_exception("Error writing pair index " + tmpPath);
+        }
+        if (rename(tmpPath.c_str(), indexPath.c_str()) != 0) {
+            throw hal_exception("Error renaming pair index " + tmpPath + " to " + indexPath + ": " + strerror(errno));
+        }
+    } catch (...) {
+        indexFile.close();
+        unlink(tmpPath.c_str());
+        throw;
+    }
+}
+
+void PairIndex::open(const string &indexPath) {
+    close();
+    int fd = ::open(indexPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw hal_exception("Error opening pair index " + indexPath + ": " + strerror(errno));
+    }
+    struct stat indexStat;
+    if (fstat(fd, &indexStat) != 0) {
+        ::close(fd);
+        throw hal_exception("Error reading pair index " + indexPath + ": " + strerror(errno));
+    }
+    _size = indexStat.st_size;
+    if (_size < sizeof(Header)) {
+        ::close(fd);
+        throw hal_exception("Pair index " + indexPath + " is truncated");
+    }
+    void *data = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw hal_exception("Error mapping pair index " + indexPath + ": " + strerror(errno));
+    }
+    _data = (char *)data;
+    _header = (const Header *)_data;
+    if (memcmp(_header->_magic, Magic, sizeof(Magic)) != 0 || _header->_version != Version) {
+        close();
+        throw hal_exception(indexPath + " is not a version " + std::to_string(Version) + " pair index");
+    }
+    size_t namesStart = sizeof(Header);
+    size_t offsetsStart = namesStart + _header->_namesLength;
+    size_t recordsStart = offsetsStart + (_header->_numSrcSegments + 1) * sizeof(hal_size_t);
+    if (_header->_namesLength == 0 || _data[offsetsStart - 1] != '\0' ||
+        recordsStart + _header->_numRecords * sizeof(Record) != _size) {
+        close();
+        throw hal_exception("Pair index " + indexPath + " is truncated or corrupt");
+    }
+    const char *names = _data + namesStart;
+    _srcName = names;
+    names += _srcName.size() + 1;
+    _tgtName = names;
+    names += _tgtName.size() + 1;
+    _coalescenceLimitName = names;
+    _offsets = (const hal_size_t *)(_data + offsetsStart);
+    _records = (const Record *)(_data + recordsStart);
+}
+
+void PairIndex::close() {
+    if (_data != NULL) {
+        munmap(_data, _size);
+        _data = NULL;
+    }
+    _size = 0;
+    _header = NULL;
+    _offsets = NULL;
+    _records = NULL;
+}
+
+string PairIndex::check(const string &halPath, const Genome *srcGenome, const Genome *tgtGenome, bool traverseDupes,
+                        const Genome *coalescenceLimit) const {
+    assert(isOpen());
+    if (srcGenome->getName() != _srcName || tgtGenome->getName() != _tgtName) {
+        return "it is for lifting from " + _srcName + " to " + _tgtName;
+    }
+    if (coalescenceLimit == NULL) {
+        set<const Genome *> inputSet;
+        inputSet.insert(srcGenome);
+        inputSet.insert(tgtGenome);
+        coalescenceLimit = getLowestCommonAncestor(inputSet);
+    }
+    if (coalescenceLimit->getName() != _coalescenceLimitName) {
+        return "it was built with coalescence limit " + _coalescenceLimitName;
+    }
+    if ((_header->_traverseDupes != 0) != traverseDupes) {
+        return string("it was built ") + (_header->_traverseDupes != 0 ? "without" : "with") + " --noDupes";
+    }
+    bool srcTop = srcGenome->getNumTopSegments() > 0;
+    hal_size_t numSrcSegments = srcTop ? srcGenome->getNumTopSegments() : srcGenome->getNumBottomSegments();
+    hal_size_t halSize;
+    hal_index_t halModTime;
+    getHalStat(halPath, halSize, halModTime);
+    if (_header->_srcLength != srcGenome->getSequenceLength() || _header->_tgtLength != tgtGenome->getSequenceLength() ||
+        (_header->_srcTop != 0) != srcTop || _header->_numSrcSegments != numSrcSegments ||
+        _header->_numTgtTopSegments != tgtGenome->getNumTopSegments() ||
+        _header->_numTgtBottomSegments != tgtGenome->getNumBottomSegments() ||
+        (_header->_halSize != 0 && (_header->_halSize != halSize || _header->_halModTime != halModTime))) {
+        return "it was built from a different version of the alignment";
+    }
+    return "";
+}
+
+void PairIndex::mapSegment(const SegmentIterator *source, const Genome *tgtGenome, bool reversed,
+                           MappedSegmentSet &mappedSegments) const {
+    assert(isOpen() && source->getReversed() == false);
+    hal_index_t index = source->getArrayIndex();
+    assert(index >= 0 && index < (hal_index_t)_header->_numSrcSegments);
+    hal_size_t startOffset = source->getStartOffset();
+    hal_size_t endOffset = source->getEndOffset();
+    hal_size_t length = startOffset + source->getLength() + endOffset;
+    for (hal_size_t i = _offsets[index]; i < _offsets[index + 1]; ++i) {
+        const Record &record = _records[i];
+        // trim the mapped segment to the part of the source in the
+        // slice.  source and target are trimmed by the same amount at their
+        // starts, and at their ends, whichever their orientations
+        hal_size_t trimStart = startOffset > record._srcStartOffset ? startOffset - record._srcStartOffset : 0;
+        hal_size_t trimEnd = endOffset > record._srcEndOffset ? endOffset - record._srcEndOffset : 0;
+        if (record._srcStartOffset + trimStart + record._srcEndOffset + trimEnd >= length) {
+            continue;
+        }
+        SegmentIteratorPtr srcSeg = getSegment(source->getGenome(), source->isTop(), index);
+        srcSeg->slice(record._srcStartOffset + trimStart, record._srcEndOffset + trimEnd);
+        SegmentIteratorPtr tgtSeg = getSegment(tgtGenome, record._flags & TargetTop, record._tgtIndex);
+        if (record._flags & TargetReversed) {
+            tgtSeg->toReverseInPlace();
+        }
+        tgtSeg->slice(record._tgtStartOffset + trimStart, record._tgtEndOffset + trimEnd);
+        if (reversed) {
+            srcSeg->toReverseInPlace();
+            tgtSeg->toReverseInPlace();
+        }
+        halInsertMappedSegment(MappedSegmentPtr(new MappedSegment(srcSeg, tgtSeg)), mappedSegments);
+    }
+}
+
+hal_size_t PairIndex::getNumRecords() const {
+    return _header != NULL ? _header->_numRecords : 0;
+}
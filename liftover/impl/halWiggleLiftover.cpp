@@ -17,7 +17,7 @@ using namespace hal;
 const double WiggleLiftover::DefaultValue = 0.0;
 const hal_size_t WiggleLiftover::DefaultTileSize = 10000;
 
-WiggleLiftover::WiggleLiftover() {
+WiggleLiftover::WiggleLiftover() : _maxMemory(0), _hasBaseRun(false) {
 }
 
 WiggleLiftover::~WiggleLiftover() {
@@ -30,14 +30,18 @@ void WiggleLiftover::preloadOutput(AlignmentConstPtr alignment, const Genome *tg
 }
 
 void WiggleLiftover::convert(AlignmentConstPtr alignment, const Genome *srcGenome, istream *inputFile, const Genome *tgtGenome,
-                             ostream *outputFile, bool traverseDupes, bool unique) {
+                             ostream *outputFile, bool traverseDupes, bool unique, hal_size_t maxMemory,
+                             const string &tmpDir) {
     _alignment = alignment;
     _srcGenome = srcGenome;
     _tgtGenome = tgtGenome;
     _outStream = outputFile;
     _traverseDupes = traverseDupes;
     _unique = unique;
+    _maxMemory = maxMemory;
+    _tmpDir = tmpDir;
     _srcSequence = NULL;
+    _hasBaseRun = false;
 
     if (_srcGenome->getNumTopSegments() > 0) {
         _segment = _srcGenome->getTopSegmentIterator();
@@ -55,9 +59,16 @@ void WiggleLiftover::convert(AlignmentConstPtr alignment, const Genome *srcGenom
     if (_outVals.getGenomeSize() == 0) {
         _outVals.init(tgtGenome->getSequenceLength(), DefaultValue, DefaultTileSize);
     }
+    // preloaded values are kept apart as they are not combined with the
+    // default value (see write())
+    if (_maxMemory > 0 && _outVals.findNext(0) != NULL_INDEX) {
+        spill();
+        _hasBaseRun = true;
+    }
     scan(inputFile);
     write();
     _outVals.clear();
+    _runFile.close();
 }
 
 void WiggleLiftover::visitHeader() {
@@ -135,6 +146,9 @@ void WiggleLiftover::mapSegment() {
         mapFragments(fragments);
     }
     _cvals.clear();
+    if (_maxMemory > 0 && _outVals.getMemoryUsage() > _maxMemory) {
+        spill();
+    }
 }
 
 void WiggleLiftover::mapFragments(vector<MappedSegmentPtr> &fragments) {
@@ -158,7 +172,12 @@ void WiggleLiftover::mapFragments(vector<MappedSegmentPtr> &fragments) {
                     mpos = seg->getStartPosition() - j;
                 }
                 if (_cvIdx < _cvals.size() && _cvals[_cvIdx]._first <= pos && _cvals[_cvIdx]._last >= pos) {
-                    double val = std::max(_cvals[_cvIdx]._val, _outVals.get(mpos));
+                    // when spilling, the default value is only applied on
+                    // output, once all the runs are merged
+                    double val = _cvals[_cvIdx]._val;
+                    if (_maxMemory == 0 || _outVals.exists(mpos)) {
+                        val = std::max(val, _outVals.get(mpos));
+                    }
                     _outVals.set(mpos, val);
                 }
             }
@@ -166,33 +185,65 @@ void WiggleLiftover::mapFragments(vector<MappedSegmentPtr> &fragments) {
     }
 }
 
-void WiggleLiftover::write() {
-    const Sequence *outSequence = NULL;
-    hal_size_t ogSize = _tgtGenome->getSequenceLength();
-    bool needHeader = true;
-    hal_index_t prevPos = NULL_INDEX;
+/* write all the values in memory to a new run and free them */
+void WiggleLiftover::spill() {
+    if (!_runFile.isOpen()) {
+        _runFile.open(_tmpDir);
+    }
+    _runFile.beginRun();
+    for (hal_index_t pos = _outVals.findNext(0); pos != NULL_INDEX; pos = _outVals.findNext(pos + 1)) {
+        _runFile.add(pos, _outVals.get(pos));
+    }
+    _runFile.endRun();
     for (hal_size_t i = 0; i < _outVals.getNumTiles(); ++i) {
-        if (_outVals.isTileEmpty(i) == false) {
-            hal_index_t pos = i * _outVals.getTileSize();
-            for (hal_size_t j = 0; pos < ogSize && j < _outVals.getTileSize(); ++j, ++pos) {
-                if (_outVals.exists(pos) == true) {
-                    if (outSequence == NULL || pos < outSequence->getStartPosition() || pos > outSequence->getEndPosition()) {
-                        outSequence = _tgtGenome->getSequenceBySite(pos);
-                        assert(outSequence != NULL);
-                        needHeader = true;
-                    } else if (pos != prevPos + 1) {
-                        needHeader = true;
-                    }
-                    if (needHeader == true) {
-                        *_outStream << "fixedStep"
-                                    << "\tchrom=" << outSequence->getName()
-                                    << "\tstart=" << (1 + pos - outSequence->getStartPosition()) << "\tstep=1\n";
-                        needHeader = false;
-                    }
-                    *_outStream << _outVals.get(pos) << '\n';
-                    prevPos = pos;
-                }
-            }
+        _outVals.clearTile(i);
+    }
+}
+
+void WiggleLiftover::write() {
+    _outSequence = NULL;
+    _prevPos = NULL_INDEX;
+    if (!_runFile.isOpen()) {
+        for (hal_index_t pos = _outVals.findNext(0); pos != NULL_INDEX; pos = _outVals.findNext(pos + 1)) {
+            double val = _outVals.get(pos);
+            writeValue(pos, _maxMemory == 0 ? val : std::max(val, DefaultValue));
+        }
+        return;
+    }
+
+    // merge the runs, taking the maximum of the values at each position.
+    // lifted values are combined with the default value, as they are when
+    // they are not spilled, while preloaded ones are not
+    spill();
+    _runFile.beginMerge();
+    hal_index_t pos;
+    size_t run;
+    double val;
+    bool more = _runFile.next(pos, run, val);
+    while (more) {
+        hal_index_t curPos = pos;
+        double outVal = (_hasBaseRun && run == 0) ? val : std::max(val, DefaultValue);
+        while ((more = _runFile.next(pos, run, val)) && pos == curPos) {
+            outVal = std::max(outVal, val);
         }
+        writeValue(curPos, outVal);
     }
 }
+
+void WiggleLiftover::writeValue(hal_index_t pos, double val) {
+    bool needHeader = false;
+    if (_outSequence == NULL || pos < _outSequence->getStartPosition() || pos > _outSequence->getEndPosition()) {
+        _outSequence = _tgtGenome->getSequenceBySite(pos);
+        assert(_outSequence != NULL);
+        needHeader = true;
+    } else if (pos != _prevPos + 1) {
+        needHeader = true;
+    }
+    if (needHeader == true) {
+        *_outStream << "fixedStep"
+                    << "\tchrom=" << _outSequence->getName() << "\tstart=" << (1 + pos - _outSequence->getStartPosition())
+                    << "\tstep=1\n";
+    }
+    *_outStream << val << '\n';
+    _prevPos = pos;
+}
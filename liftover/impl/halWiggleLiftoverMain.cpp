@@ -29,6 +29,13 @@ static void initParser(CLParser &optionsParser) {
                                           " memory then overwritten, so this data can be lost "
                                           "in event of a crash",
                                 false);
+    optionsParser.addOption("maxMemory", "spill lifted values to a temporary file whenever they take more than "
+                                         "this many MB of memory, and merge them back on output.  0 keeps "
+                                         "all values in memory",
+                            0);
+    optionsParser.addOption("tmpDir", "directory for the temporary file used by --maxMemory.  defaults to "
+                                      "$TMPDIR or /tmp",
+                            "");
 #if 0
   optionsParser.addOptionFlag("unique",
                                "only map block if its left-most paralog is in"
@@ -54,6 +61,8 @@ int main(int argc, char **argv) {
     bool noDupes;
     bool append;
     bool unique;
+    hal_size_t maxMemory;
+    string tmpDir;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halFile");
@@ -63,6 +72,8 @@ int main(int argc, char **argv) {
         tgtWigPath = optionsParser.getArgument<string>("tgtWig");
         noDupes = optionsParser.getFlag("noDupes");
         append = optionsParser.getFlag("append");
+        maxMemory = optionsParser.getOption<hal_size_t>("maxMemory") * 1024 * 1024;
+        tmpDir = optionsParser.getOption<string>("tmpDir");
         //  unique = optionsParser.getFlag("unique");
         unique = false;
     } catch (exception &e) {
@@ -120,7 +131,7 @@ int main(int argc, char **argv) {
             }
         }
 
-        liftover.convert(alignment, srcGenome, srcWigPtr, tgtGenome, tgtWigPtr, !noDupes, unique);
+        liftover.convert(alignment, srcGenome, srcWigPtr, tgtGenome, tgtWigPtr, !noDupes, unique, maxMemory, tmpDir);
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
         return 1;
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halWiggleRunFile.h"
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+const size_t WiggleRunFile::MaxBlockLength = 65536;
+const size_t WiggleRunFile::ReadBufferLength = 8192;
+
+WiggleRunFile::WiggleRunFile() : _file(NULL), _fileSize(0), _inRun(false) {
+}
+
+WiggleRunFile::~WiggleRunFile() {
+    close();
+}
+
+void WiggleRunFile::open(const string &tmpDir) {
+    close();
+    string dir = tmpDir;
+    if (dir.empty()) {
+        const char *envDir = getenv("TMPDIR");
+        dir = envDir != NULL && *envDir != '\0' ? envDir : "/tmp";
+    }
+    string path = dir + "/halWiggleLiftover.XXXXXX";
+    vector<char> pathBuf(path.begin(), path.end());
+    pathBuf.push_back('\0');
+    int fd = mkstemp(&pathBuf[0]);
+    if (fd < 0) {
+        throw hal_exception("Error creating temporary file in " + dir + ": " + strerror(errno));
+    }
+    unlink(&pathBuf[0]);
+    _file = fdopen(fd, "w+b");
+    if (_file == NULL) {
+        ::close(fd);
+        throw hal_exception("Error opening temporary file in " + dir + ": " + strerror(errno));
+    }
+}
+
+void WiggleRunFile::close() {
+    if (_file != NULL) {
+        fclose(_file);
+        _file = NULL;
+    }
+    _runs.clear();
+    _fileSize = 0;
+    _inRun = false;
+    _blockValues.clear();
+    _heads = HeadQueue();
+}
+
+void WiggleRunFile::beginRun() {
+    assert(_file != NULL && !_inRun);
+    Run run;
+    run._begin = _fileSize;
+    run._end = _fileSize;
+    run._offset = _fileSize;
+    run._pos = NULL_INDEX;
+    run._blockRemaining = 0;
+    run._bufferIdx = 0;
+    _runs.push_back(run);
+    _blockValues.clear();
+    _inRun = true;
+}
+
+void WiggleRunFile::add(hal_index_t pos, double val) {
+    assert(_inRun);
+    if (!_blockValues.empty() &&
+        (pos != _block._first + (hal_index_t)_blockValues.size() || _blockValues.size() == MaxBlockLength)) {
+        assert(pos >= _block._first + (hal_index_t)_blockValues.size());
+        writeBlock();
+    }
+    if (_blockValues.empty()) {
+        _block._first = pos;
+    }
+    _blockValues.push_back(val);
+}
+
+void WiggleRunFile::endRun() {
+    assert(_inRun);
+    writeBlock();
+    _runs.back()._end = _fileSize;
+    _inRun = false;
+}
+
+void WiggleRunFile::writeBlock() {
+    if (_blockValues.empty()) {
+        return;
+    }
+    _block._length = _blockValues.size();
+    if (fwrite(&_block, sizeof(Block), 1, _file) != 1 ||
+        fwrite(&_blockValues[0], sizeof(double), _blockValues.size(), _file) != _blockValues.size()) {
+        throw hal_exception(string("Error writing temporary file: ") + strerror(errno));
+    }
+    _fileSize += sizeof(Block) + _blockValues.size() * sizeof(double);
+    _blockValues.clear();
+}
+
+void WiggleRunFile::beginMerge() {
+    assert(_file != NULL && !_inRun);
+    if (fflush(_file) != 0) {
+        throw hal_exception(string("Error writing temporary file: ") + strerror(errno));
+    }
+    _heads = HeadQueue();
+    for (size_t i = 0; i < _runs.size(); ++i) {
+        Run &run = _runs[i];
+        run._offset = run._begin;
+        run._blockRemaining = 0;
+        run._buffer.clear();
+        run._bufferIdx = 0;
+        if (advance(run)) {
+            _heads.push(Head(run._pos, i));
+        }
+    }
+}
+
+bool WiggleRunFile::next(hal_index_t &pos, size_t &run, double &val) {
+    if (_heads.empty()) {
+        return false;
+    }
+    pos = _heads.top().first;
+    run = _heads.top().second;
+    _heads.pop();
+    Run &r = _runs[run];
+    val = r._buffer[r._bufferIdx];
+    if (advance(r)) {
+        _heads.push(Head(r._pos, run));
+    } else {
+        vector<double>().swap(r._buffer);
+    }
+    return true;
+}
+
+/* move a run on to its next value, reading the next block header or the
+ * next chunk of values from the file as needed.  the first call positions
+ * the run on its first value.  returns false at the end of the run */
+bool WiggleRunFile::advance(Run &run) {
+    if (run._bufferIdx + 1 < run._buffer.size()) {
+        ++run._bufferIdx;
+        ++run._pos;
+        return true;
+    }
+    bool newBlock = run._blockRemaining == 0;
+    if (newBlock) {
+        if (run._offset >= run._end) {
+            return false;
+        }
+        Block block;
+        readAt(run._offset, &block, sizeof(Block));
+        run._offset += sizeof(Block);
+        run._pos = block._first;
+        run._blockRemaining = block._length;
+    } else {
+        ++run._pos;
+    }
+    size_t length = min((size_t)run._blockRemaining, ReadBufferLength);
+    run._buffer.resize(length);
+    readAt(run._offset, &run._buffer[0], length * sizeof(double));
+    run._offset += length * sizeof(double);
+    run._blockRemaining -= length;
+    run._bufferIdx = 0;
+    return true;
+}
+
+void WiggleRunFile::readAt(hal_size_t offset, void *data, size_t size) {
+    char *dest = (char *)data;
+    while (size > 0) {
+        ssize_t bytesRead = pread(fileno(_file), dest, size, offset);
+        if (bytesRead <= 0) {
+            throw hal_exception(string("Error reading temporary file: ") +
+                                (bytesRead == 0 ? "unexpected end of file" : strerror(errno)));
+        }
+        dest += bytesRead;
+        size -= bytesRead;
+        offset += bytesRead;
+    }
+}
@@ -9,6 +9,7 @@
 #define _HALBLOCKLIFTOVER_H
 
 #include "halLiftover.h"
+#include "halPairIndex.h"
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -18,22 +19,32 @@ namespace hal {
 
     class BlockLiftover : public Liftover {
       public:
-        BlockLiftover();
+        /** If a pair index is given, source segments are mapped by looking
+         * them up in it instead of with halMapSegment.  It must have been
+         * checked against the genomes and options passed to convert() */
+        BlockLiftover(const PairIndex *pairIndex = NULL);
         virtual ~BlockLiftover();
 
       protected:
+        Liftover *newWorker() const {
+            return new BlockLiftover(_pairIndex);
+        }
         void liftInterval(BedList &mappedBedLines);
         void visitBegin();
+        void moveToSite(hal_index_t position);
 
         void cleanTargetParalogies();
         void readPSLInfo(std::vector<MappedSegmentPtr> &fragments, BedLine &outBedLine);
 
       protected:
+        static const hal_size_t MaxSweepSteps = 4;
+
         MappedSegmentSet _mappedSegments;
         SegmentIteratorPtr _refSeg;
         hal_index_t _lastIndex;
         std::set<const Genome *> _downwardPath;
         const Genome *_mrca;
+        const PairIndex *_pairIndex;
     };
 }
 #endif
@@ -16,25 +16,55 @@
 
 namespace hal {
 
+    /** Lift intervals to every base they are aligned to in the target,
+     * merged into maximal intervals for each target sequence and strand.
+     * By default the source segments covering each interval are mapped to
+     * the target with halMapSegment and the mapped ranges merged, which
+     * costs time in proportion to the number of segments.  With byColumns,
+     * or when duplications are not traversed (the column iterator then
+     * also stops at non-canonical paralogs on the way up, which
+     * halMapSegment does not), the interval is walked column by column
+     * with a ColumnIterator instead, as originally implemented.  Both give
+     * the same intervals: a target base aligned to several bases of the
+     * interval is lifted once, on the strand of the leftmost of them. */
     class ColumnLiftover : public Liftover {
       public:
-        ColumnLiftover();
+        ColumnLiftover(bool byColumns = false);
         virtual ~ColumnLiftover();
 
       protected:
+        Liftover *newWorker() const {
+            return new ColumnLiftover(_byColumns);
+        }
+        void visitBegin();
         void liftInterval(BedList &mappedBedLines);
+        void liftIntervalByColumns(BedList &mappedBedLines);
+        void liftIntervalBySegments(BedList &mappedBedLines);
 
         typedef ColumnIterator::DNASet DNASet;
         typedef ColumnIterator::ColumnMap ColumnMap;
+        typedef PositionCache::Interval Interval;
         typedef PositionCache::IntervalSet IntervalSet;
 
         typedef std::pair<const Sequence *, hal_size_t> SeqIndex;
         typedef std::map<SeqIndex, PositionCache *> PositionMap;
+        typedef std::map<SeqIndex, IntervalSet> RangeMap;
+        typedef std::map<hal_index_t, hal_index_t> CoveredMap;
+
+        void addUncovered(CoveredMap &covered, const Interval &range, IntervalSet &ranges);
+        void addRangeLines(RangeMap &rangeMap, char strand, BedList &mappedBedLines);
 
       protected:
+        bool _byColumns;
         ColumnIteratorPtr _colIt;
         std::set<std::string> _missedSet;
         bool _outParalogy;
+
+        SegmentIteratorPtr _refSeg;
+        hal_index_t _lastIndex;
+        std::set<const Genome *> _downwardPath;
+        const Genome *_mrca;
+        MappedSegmentSet _mappedSegments;
     };
 }
 #endif
@@ -25,15 +25,25 @@ namespace hal {
         void convert(AlignmentConstPtr alignment, const Genome *srcGenome, std::istream *inputFile, const Genome *tgtGenome,
                      std::ostream *outputFile, int bedType = 0,
                      bool traverseDupes = true, bool outPSL = false, bool outPSLWithName = false,
-                     const Genome *coalescenceLimit = NULL);
+                     const Genome *coalescenceLimit = NULL, hal_size_t batchSize = 0, hal_size_t numThreads = 1);
 
       protected:
         typedef std::list<BedLine> BedList;
 
+        /* a new, unconfigured liftover of the same type, used for the
+         * worker threads */
+        virtual Liftover *newWorker() const = 0;
+        Liftover *createWorker() const;
+        void clearWorkers();
+
         virtual void visitBegin();
         virtual void visitLine();
         virtual void visitEOF();
-        virtual void writeLineResults();
+        virtual void liftLine();
+        virtual void liftBatch();
+        void liftBatchLines(std::vector<BedLine> &lines, const std::vector<const Sequence *> &sequences, size_t first,
+                            size_t last, std::string &output);
+        virtual void writeLineResults(std::ostream &os);
         virtual void assignBlocksToIntervals();
         virtual bool compatible(const BedLine &tgtBed, const BedLine &newBlock);
         virtual void flipBlocks(BedList &bedList);
@@ -62,6 +72,20 @@ namespace hal {
 
         ColumnIteratorPtr _colIt;
         std::set<std::string> _missedSet;
+
+        // when _batchSize > 0, input lines are queued with their source
+        // sequences and lifted _batchSize at a time in source order, so the
+        // segment iterators sweep forward instead of seeking for each line.
+        // results are still written in input order
+        hal_size_t _batchSize;
+        std::vector<BedLine> _batchLines;
+        std::vector<const Sequence *> _batchSequences;
+
+        // with _numThreads > 1, each batch is split into contiguous runs of
+        // lines that are lifted by _workers, one per thread, and written in
+        // order.  requires an alignment opened with READ_SHARED_ACCESS
+        hal_size_t _numThreads;
+        std::vector<Liftover *> _workers;
     };
 }
 #endif
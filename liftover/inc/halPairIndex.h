@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALPAIRINDEX_H
+#define _HALPAIRINDEX_H
+
+#include "hal.h"
+#include <string>
+
+namespace hal {
+
+    /** Precomputed mapping of every segment of a source genome to a target
+     * genome, so that liftover between the pair doesn't have to walk the
+     * tree for each query.
+     *
+     * The index is a file that is memory mapped when opened.  For each
+     * source segment, in order, it holds the segments halMapSegment finds
+     * for the whole source segment: the source and target offsets of each
+     * mapped segment, the target segment it falls in and its orientation.
+     * Looking up a source interval is then a search for its source segment
+     * in the alignment and a scan of that segment's records, which are
+     * sliced to the interval.  The results are the same as mapping the
+     * sliced source segment with halMapSegment.
+     *
+     * An index is only valid for the options it was built with (following
+     * duplications, coalescence limit) and for the HAL file it was built
+     * from, which is checked by its size and modification time. */
+    class PairIndex {
+      public:
+        PairIndex();
+        ~PairIndex();
+
+        /** Map every segment of srcGenome to tgtGenome and write the index
+         * to indexPath, which is only replaced once the index is complete.
+         * With numThreads > 1, the alignment must have been opened with
+         * READ_SHARED_ACCESS */
+        static void build(AlignmentConstPtr alignment, const std::string &halPath, const Genome *srcGenome,
+                          const Genome *tgtGenome, const std::string &indexPath, bool traverseDupes = true,
+                          const Genome *coalescenceLimit = NULL, hal_size_t numThreads = 1);
+
+        /** Path used for the index of a pair when none is given:
+         * halPath.srcGenome.tgtGenome.pairIndex */
+        static std::string getDefaultPath(const std::string &halPath, const std::string &srcGenomeName,
+                                          const std::string &tgtGenomeName);
+
+        void open(const std::string &indexPath);
+        void close();
+        bool isOpen() const {
+            return _data != NULL;
+        }
+
+        /** Check that the index can be used to lift from srcGenome to
+         * tgtGenome with the given options.  Returns an empty string if it
+         * can, otherwise the reason it can't */
+        std::string check(const std::string &halPath, const Genome *srcGenome, const Genome *tgtGenome,
+                          bool traverseDupes, const Genome *coalescenceLimit) const;
+
+        /** Add the mapping of a (possibly sliced) forward source segment
+         * iterator to mappedSegments, as halMapSegment would.  If reversed,
+         * the mapping of the reversed source segment is added instead */
+        void mapSegment(const SegmentIterator *source, const Genome *tgtGenome, bool reversed,
+                        MappedSegmentSet &mappedSegments) const;
+
+        hal_size_t getNumRecords() const;
+
+      protected:
+        static const char Magic[8];
+        static const hal_size_t Version = 1;
+
+        enum RecordFlags { TargetTop = 1, TargetReversed = 2 };
+
+        struct Header {
+            char _magic[8];
+            hal_size_t _version;
+            hal_size_t _halSize;
+            hal_index_t _halModTime;
+            hal_size_t _traverseDupes;
+            hal_size_t _srcLength;
+            hal_size_t _tgtLength;
+            hal_size_t _srcTop;
+            hal_size_t _numSrcSegments;
+            hal_size_t _numTgtTopSegments;
+            hal_size_t _numTgtBottomSegments;
+            hal_size_t _numRecords;
+            // NUL-terminated source, target and coalescence limit genome
+            // names follow the header, padded to a multiple of 8 bytes
+            hal_size_t _namesLength;
+        };
+
+        /* a mapped segment.  offsets are those of the source and target
+         * iterators, relative to the unsliced segments */
+        struct Record {
+            hal_size_t _srcStartOffset;
+            hal_size_t _srcEndOffset;
+            hal_index_t _tgtIndex;
+            hal_size_t _tgtStartOffset;
+            hal_size_t _tgtEndOffset;
+            hal_size_t _flags;
+        };
+
+        static void getHalStat(const std::string &halPath, hal_size_t &size, hal_index_t &modTime);
+
+        char *_data;
+        size_t _size;
+        const Header *_header;
+        std::string _srcName;
+        std::string _tgtName;
+        std::string _coalescenceLimitName;
+        // _numSrcSegments + 1 offsets into _records
+        const hal_size_t *_offsets;
+        const Record *_records;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
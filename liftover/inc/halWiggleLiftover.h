@@ -8,6 +8,7 @@
 #ifndef _HALWIGGLELIFTOVER_H
 #define _HALWIGGLELIFTOVER_H
 
+#include "halWiggleRunFile.h"
 #include "halWiggleScanner.h"
 #include "halWiggleTiles.h"
 #include <fstream>
@@ -17,6 +18,12 @@
 
 namespace hal {
 
+    /** Lift wiggle values between genomes, keeping the maximum value lifted
+     * to each target position.  Values are collected in tiles covering the
+     * target genome.  If maxMemory is given, the tiles are spilled to a
+     * run file in tmpDir whenever they hold more than maxMemory bytes
+     * after a source segment is lifted, and the runs are merged when the
+     * output is written. */
     class WiggleLiftover : public WiggleScanner {
       public:
         WiggleLiftover();
@@ -25,7 +32,8 @@ namespace hal {
         void preloadOutput(AlignmentConstPtr alignment, const Genome *tgtGenome, std::istream *inputFile);
 
         void convert(AlignmentConstPtr alignment, const Genome *srcGenome, std::istream *inputFile, const Genome *tgtGenome,
-                     std::ostream *outputFile, bool traverseDupes = true, bool unique = false);
+                     std::ostream *outputFile, bool traverseDupes = true, bool unique = false, hal_size_t maxMemory = 0,
+                     const std::string &tmpDir = "");
 
         static const double DefaultValue;
         static const hal_size_t DefaultTileSize;
@@ -37,7 +45,9 @@ namespace hal {
 
         void mapSegment();
         void mapFragments(std::vector<MappedSegmentPtr> &fragments);
+        void spill();
         void write();
+        void writeValue(hal_index_t pos, double val);
 
       protected:
         struct CoordVal {
@@ -52,6 +62,8 @@ namespace hal {
         std::ostream *_outStream;
         bool _traverseDupes;
         bool _unique;
+        hal_size_t _maxMemory;
+        std::string _tmpDir;
 
         const Genome *_srcGenome;
         const Genome *_tgtGenome;
@@ -64,6 +76,14 @@ namespace hal {
         ValVec _cvals;
         WiggleTiles<double> _outVals;
         hal_index_t _cvIdx;
+
+        // spilled values.  when the preloaded output is spilled, it is
+        // the first run
+        WiggleRunFile _runFile;
+        bool _hasBaseRun;
+
+        const Sequence *_outSequence;
+        hal_index_t _prevPos;
     };
 }
 #endif
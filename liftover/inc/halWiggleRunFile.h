@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALWIGGLERUNFILE_H
+#define _HALWIGGLERUNFILE_H
+
+#include "hal.h"
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+    /** Temporary file of sorted runs of wiggle values, used to spill values
+     * out of memory and merge them back in position order.  Each run is
+     * written as blocks of consecutive positions: the first position and
+     * the number of values, followed by the values.  The file is removed
+     * as soon as it is created, so it goes away when closed, even after a
+     * crash. */
+    class WiggleRunFile {
+      public:
+        WiggleRunFile();
+        ~WiggleRunFile();
+
+        /** Create the file in tmpDir, or in $TMPDIR or /tmp if empty */
+        void open(const std::string &tmpDir);
+        void close();
+        bool isOpen() const {
+            return _file != NULL;
+        }
+
+        /** Start a new run.  Values must be added in increasing order of
+         * position */
+        void beginRun();
+        void add(hal_index_t pos, double val);
+        void endRun();
+        size_t getNumRuns() const {
+            return _runs.size();
+        }
+
+        /** Start a k-way merge of all the runs */
+        void beginMerge();
+        /** Get the next value of the merge, ordered by position then run.
+         * Returns false when all the runs are exhausted */
+        bool next(hal_index_t &pos, size_t &run, double &val);
+
+      protected:
+        /* block header */
+        struct Block {
+            hal_index_t _first;
+            hal_size_t _length;
+        };
+        /* a run's extent in the file and its read state during a merge */
+        struct Run {
+            hal_size_t _begin;
+            hal_size_t _end;
+            hal_size_t _offset;
+            hal_index_t _pos;
+            hal_size_t _blockRemaining;
+            std::vector<double> _buffer;
+            size_t _bufferIdx;
+        };
+        /* (position, run) of the next value of each run, smallest on top */
+        typedef std::pair<hal_index_t, size_t> Head;
+        typedef std::priority_queue<Head, std::vector<Head>, std::greater<Head>> HeadQueue;
+
+        static const size_t MaxBlockLength;
+        static const size_t ReadBufferLength;
+
+        void writeBlock();
+        void readAt(hal_size_t offset, void *data, size_t size);
+        bool advance(Run &run);
+
+        std::FILE *_file;
+        std::vector<Run> _runs;
+        hal_size_t _fileSize;
+        bool _inRun;
+        Block _block;
+        std::vector<double> _blockValues;
+        HeadQueue _heads;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
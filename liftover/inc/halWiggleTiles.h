@@ -18,7 +18,12 @@ namespace hal {
 
     /** Memory structure to keep track of wiggle results by tiling the genome
      * into regular intervals.  The idea is that if we are only writing a
-     * subregion, then we don't bother allocating space for the whole genome
+     * subregion, then we don't bother allocating space for the whole genome.
+     *
+     * Each allocated tile holds its values along with a bitmap, one bit
+     * per position, of which values were set.  Tiles can be released
+     * individually once their values are no longer needed, and the
+     * memory held by all the tiles is tracked so that callers can bound it.
     */
     template <class T> class WiggleTiles {
       public:
@@ -44,24 +49,43 @@ namespace hal {
          * where it was not set, or if it was set with the default value */
         bool exists(hal_index_t pos) const;
 
+        /** First position at or after pos that was written to using set(),
+         * or NULL_INDEX if there is none.  Empty tiles and runs of unset
+         * positions are skipped without visiting each position */
+        hal_index_t findNext(hal_index_t pos) const;
+
+        /** Free a tile, forgetting all the values set in it */
+        void clearTile(hal_size_t tile);
+
         /** Methods to get basic structure info */
         hal_size_t getGenomeSize() const;
         hal_size_t getTileSize() const;
         hal_size_t getNumTiles() const;
         bool isTileEmpty(hal_size_t tile) const;
         T getDefaultValue() const;
+        /** Approximate memory held by the allocated tiles, in bytes */
+        hal_size_t getMemoryUsage() const;
 
       protected:
-        std::vector<std::vector<T>> _tiles;
-        std::vector<std::vector<bool>> _bits;
+        struct Tile {
+            std::vector<T> _values;
+            // bit i of word i / 64 is set if _values[i] was set
+            std::vector<uint64_t> _present;
+        };
+
+        hal_size_t getTileLength(hal_size_t tile) const;
+
+        std::vector<Tile> _tiles;
         hal_size_t _tileSize;
         hal_size_t _genomeSize;
         hal_size_t _lastTileSize;
+        hal_size_t _memoryUsage;
         T _defaultValue;
     };
 
     // INLINE METHODS
-    template <class T> inline WiggleTiles<T>::WiggleTiles() : _tileSize(0), _genomeSize(0), _lastTileSize(0) {
+    template <class T>
+    inline WiggleTiles<T>::WiggleTiles() : _tileSize(0), _genomeSize(0), _lastTileSize(0), _memoryUsage(0) {
     }
 
     template <class T> inline WiggleTiles<T>::~WiggleTiles() {
@@ -78,59 +102,91 @@ namespace hal {
         } else {
             _lastTileSize = _tileSize;
         }
-        for (size_t i = 0; i < _tiles.size(); ++i) {
-            _tiles[i].clear();
-            _bits[i].clear();
-        }
+        _tiles.clear();
         _tiles.resize(numTiles);
-        _bits.resize(numTiles);
+        _memoryUsage = 0;
     }
 
     template <class T> inline void WiggleTiles<T>::clear() {
         _tiles.clear();
-        _bits.clear();
         _tileSize = 0;
         _genomeSize = 0;
         _lastTileSize = 0;
+        _memoryUsage = 0;
+    }
+
+    template <class T> inline hal_size_t WiggleTiles<T>::getTileLength(hal_size_t tile) const {
+        return tile == _tiles.size() - 1 ? _lastTileSize : _tileSize;
     }
 
     template <class T> inline T WiggleTiles<T>::get(hal_index_t pos) const {
         assert(pos < _genomeSize);
         hal_size_t tile = pos / _tileSize;
         assert(tile < _tiles.size());
-        assert(_tiles[tile].size() == 0 || _tiles[tile].size() == _tileSize || _tiles[tile].size() == _lastTileSize);
-        if (_tiles[tile].size() == 0) {
+        assert(_tiles[tile]._values.size() == 0 || _tiles[tile]._values.size() == getTileLength(tile));
+        if (_tiles[tile]._values.size() == 0) {
             return _defaultValue;
         }
         hal_size_t offset = pos % _tileSize;
-        return _tiles[tile][offset];
+        return _tiles[tile]._values[offset];
     }
 
     template <class T> inline void WiggleTiles<T>::set(hal_index_t pos, T val) {
         assert(pos < _genomeSize);
         hal_size_t tile = pos / _tileSize;
         assert(tile < _tiles.size());
-        assert(_tiles[tile].size() == 0 || _tiles[tile].size() == _tileSize || _tiles[tile].size() == _lastTileSize);
-        if (_tiles[tile].size() == 0) {
-            hal_size_t len = tile == _tiles.size() - 1 ? _lastTileSize : _tileSize;
-            _tiles[tile].assign(len, _defaultValue);
-            _bits[tile].assign(len, false);
+        Tile &t = _tiles[tile];
+        assert(t._values.size() == 0 || t._values.size() == getTileLength(tile));
+        if (t._values.size() == 0) {
+            hal_size_t len = getTileLength(tile);
+            t._values.assign(len, _defaultValue);
+            t._present.assign((len + 63) / 64, 0);
+            _memoryUsage += len * sizeof(T) + t._present.size() * sizeof(uint64_t);
         }
         hal_size_t offset = pos % _tileSize;
-        _tiles[tile][offset] = val;
-        _bits[tile][offset] = true;
+        t._values[offset] = val;
+        t._present[offset / 64] |= (uint64_t)1 << (offset % 64);
     }
 
     template <class T> inline bool WiggleTiles<T>::exists(hal_index_t pos) const {
         assert(pos < _genomeSize);
         hal_size_t tile = pos / _tileSize;
         assert(tile < _tiles.size());
-        assert(_tiles[tile].size() == 0 || _tiles[tile].size() == _tileSize || _tiles[tile].size() == _lastTileSize);
-        if (_tiles[tile].size() == 0) {
+        const Tile &t = _tiles[tile];
+        if (t._values.size() == 0) {
             return false;
         }
         hal_size_t offset = pos % _tileSize;
-        return _bits[tile][offset];
+        return (t._present[offset / 64] >> (offset % 64)) & 1;
+    }
+
+    template <class T> inline hal_index_t WiggleTiles<T>::findNext(hal_index_t pos) const {
+        for (hal_size_t tile = pos / _tileSize; pos < (hal_index_t)_genomeSize; ++tile) {
+            const Tile &t = _tiles[tile];
+            hal_size_t offset = pos - tile * _tileSize;
+            if (t._values.size() > 0) {
+                for (hal_size_t word = offset / 64; word < t._present.size(); ++word) {
+                    // skip the bits for positions before offset
+                    uint64_t bits = t._present[word] & (~(uint64_t)0 << (offset % 64));
+                    if (bits != 0) {
+                        return tile * _tileSize + word * 64 + __builtin_ctzll(bits);
+                    }
+                    offset = (word + 1) * 64;
+                }
+            }
+            pos = (tile + 1) * _tileSize;
+        }
+        return NULL_INDEX;
+    }
+
+    template <class T> inline void WiggleTiles<T>::clearTile(hal_size_t tile) {
+        assert(tile < _tiles.size());
+        Tile &t = _tiles[tile];
+        if (t._values.size() > 0) {
+            _memoryUsage -= t._values.size() * sizeof(T) + t._present.size() * sizeof(uint64_t);
+            std::vector<T>().swap(t._values);
+            std::vector<uint64_t>().swap(t._present);
+        }
     }
 
     template <class T> inline hal_size_t WiggleTiles<T>::getGenomeSize() const {
@@ -147,12 +203,16 @@ namespace hal {
 
     template <class T> inline bool WiggleTiles<T>::isTileEmpty(hal_size_t tile) const {
         assert(tile < _tiles.size());
-        return _tiles[tile].empty();
+        return _tiles[tile]._values.empty();
     }
 
     template <class T> inline T WiggleTiles<T>::getDefaultValue() const {
         return _defaultValue;
     }
+
+    template <class T> inline hal_size_t WiggleTiles<T>::getMemoryUsage() const {
+        return _memoryUsage;
+    }
 }
 #endif
 // Local Variables:
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Benchmark ColumnLiftover lifting long intervals (such as whole genes or
+ * TADs) segment by segment against the original column by column path.
+ * Random intervals of the source genome are lifted to the target both ways;
+ * the time, the rate in source bases per second and the number of output
+ * lines are reported, and the outputs are checked to be identical.
+ */
+#include "halColumnLiftover.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdio.h>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    struct BenchArgs {
+        string halPath;
+        string srcGenomeName;
+        string tgtGenomeName;
+        hal_size_t numIntervals;
+        hal_size_t intervalLength;
+        unsigned seed;
+    };
+
+    /* BED6 lines of up to intervalLength bases starting at random places in
+     * the genome, clipped to the end of their sequence, on random strands */
+    string makeIntervals(const Genome *genome, const BenchArgs &args, hal_size_t &numBases) {
+        mt19937 rng(args.seed);
+        uniform_int_distribution<hal_index_t> startDist(0, genome->getSequenceLength() - 1);
+        const char strands[] = {'+', '-', '.'};
+        ostringstream bed;
+        numBases = 0;
+        for (hal_size_t i = 0; i < args.numIntervals; ++i) {
+            hal_index_t start = startDist(rng);
+            const Sequence *sequence = genome->getSequenceBySite(start);
+            start -= sequence->getStartPosition();
+            hal_index_t end = min(start + (hal_index_t)args.intervalLength, (hal_index_t)sequence->getSequenceLength());
+            char strand = strands[rng() % 3];
+            bed << sequence->getName() << '\t' << start << '\t' << end << "\tinterval" << i << "\t0\t" << strand << '\n';
+            numBases += end - start;
+        }
+        return bed.str();
+    }
+
+    string runBench(const char *name, bool byColumns, AlignmentConstPtr alignment, const Genome *srcGenome,
+                    const Genome *tgtGenome, const string &intervals, hal_size_t numBases, const BenchArgs &args) {
+        ColumnLiftover liftover(byColumns);
+        istringstream inStream(intervals);
+        ostringstream outStream;
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        liftover.convert(alignment, srcGenome, &inStream, tgtGenome, &outStream);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        string output = outStream.str();
+        size_t numLines = count(output.begin(), output.end(), '\n');
+        printf("%s\t%zu\t%zu\t%.3f\t%.0f\t%zu\n", name, (size_t)args.numIntervals, (size_t)numBases, elapsed,
+               numBases / elapsed, numLines);
+        return output;
+    }
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    optionsParser.addArgument("halFile", "input hal file");
+    optionsParser.addArgument("srcGenome", "genome to lift intervals from");
+    optionsParser.addArgument("tgtGenome", "genome to lift intervals to");
+    optionsParser.addOption("numIntervals", "number of random intervals to lift", 100);
+    optionsParser.addOption("intervalLength", "length of each interval", 100000);
+    optionsParser.addOption("seed", "random seed", 0);
+    optionsParser.setDescription("Benchmark lifting long intervals with ColumnLiftover segment by segment "
+                                 "against column by column.  Reports the number of intervals and source "
+                                 "bases lifted, the time in seconds, the source bases lifted per second and "
+                                 "the number of output lines, and fails if the outputs differ.");
+    BenchArgs args;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        args.halPath = optionsParser.getArgument<string>("halFile");
+        args.srcGenomeName = optionsParser.getArgument<string>("srcGenome");
+        args.tgtGenomeName = optionsParser.getArgument<string>("tgtGenome");
+        args.numIntervals = optionsParser.getOption<hal_size_t>("numIntervals");
+        args.intervalLength = optionsParser.getOption<hal_size_t>("intervalLength");
+        args.seed = optionsParser.getOption<unsigned>("seed");
+        if (args.intervalLength == 0) {
+            throw hal_exception("intervalLength must be greater than 0");
+        }
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+
+    try {
+        AlignmentConstPtr alignment(openHalAlignment(args.halPath, &optionsParser));
+        const Genome *srcGenome = alignment->openGenome(args.srcGenomeName);
+        if (srcGenome == NULL) {
+            throw hal_exception("srcGenome " + args.srcGenomeName + " not found in alignment");
+        }
+        const Genome *tgtGenome = alignment->openGenome(args.tgtGenomeName);
+        if (tgtGenome == NULL) {
+            throw hal_exception("tgtGenome " + args.tgtGenomeName + " not found in alignment");
+        }
+        hal_size_t numBases;
+        string intervals = makeIntervals(srcGenome, args, numBases);
+
+        printf("method\tintervals\tbases\tseconds\tbasesPerSecond\toutputLines\n");
+        string columnOutput = runBench("columns", true, alignment, srcGenome, tgtGenome, intervals, numBases, args);
+        string segmentOutput = runBench("segments", false, alignment, srcGenome, tgtGenome, intervals, numBases, args);
+        if (columnOutput != segmentOutput) {
+            throw hal_exception("column and segment liftover outputs differ");
+        }
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
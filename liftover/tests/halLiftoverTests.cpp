@@ -7,6 +7,10 @@
 #include "halApiTestSupport.h"
 #include "halLiftoverTests.h"
 #include "halBlockLiftover.h"
+#include "halColumnLiftover.h"
+#include "halWiggleLiftover.h"
+#include "halWiggleRunFile.h"
+#include "halWiggleTiles.h"
 #include <cstdio>
 
 using namespace std;
@@ -257,16 +261,20 @@ void BedLiftoverTest::liftAndCheck(AlignmentConstPtr alignment,
                                    const string& inBed,
                                    const string& expectBed,
                                    bool outPSL, bool outPSLWithName) {
-    BlockLiftover liftover;
-    stringstream bedFile(inBed);
-    stringstream outStream;
-    liftover.convert(alignment, srcGenome, &bedFile, tgtGenome, &outStream,
-                     0, true, outPSL, outPSLWithName);
-    if (outStream.str() != expectBed) {
-        cerr << "Got: " << endl << outStream.str() << endl;
-        cerr << "Expected: " << endl << expectBed << endl;
+    // lift line by line, and in batches that get reordered by source position
+    hal_size_t batchSizes[] = {0, 2, 100};
+    for (size_t i = 0; i < 3; ++i) {
+        BlockLiftover liftover;
+        stringstream bedFile(inBed);
+        stringstream outStream;
+        liftover.convert(alignment, srcGenome, &bedFile, tgtGenome, &outStream,
+                         0, true, outPSL, outPSLWithName, NULL, batchSizes[i]);
+        if (outStream.str() != expectBed) {
+            cerr << "Got (batch size " << batchSizes[i] << "): " << endl << outStream.str() << endl;
+            cerr << "Expected: " << endl << expectBed << endl;
+        }
+        CuAssertTrue(_testCase, outStream.str() == expectBed);
     }
-    CuAssertTrue(_testCase, outStream.str() == expectBed);
 }
 
 void BedLiftoverTest::testOneBranchLifts(AlignmentConstPtr alignment) {
@@ -434,6 +442,40 @@ void WiggleLiftoverTest::testOneBranchLifts(AlignmentConstPtr alignment) {
 void WiggleLiftoverTest::testMultiBranchLifts(AlignmentConstPtr alignment) {
 }
 
+// spilling after every segment gives the same output as keeping all the
+// values in memory, including when merging into preloaded values, some of
+// them below the default value
+void WiggleLiftoverTest::testSpilledLifts(AlignmentConstPtr alignment) {
+    const Genome *root = alignment->openGenome("root");
+    const Genome *leaf3 = alignment->openGenome("leaf3");
+    const string wig("fixedStep chrom=Sequence start=1 step=1\n"
+                     "1\n2\n3\n-4\n5\n"
+                     "fixedStep chrom=Sequence start=18 step=1\n"
+                     "6\n7\n8\n9\n-10\n11\n12\n"
+                     "fixedStep chrom=Sequence start=61 step=1\n"
+                     "13\n-14\n15\n16\n");
+    const string preload("fixedStep chrom=Sequence start=2 step=1\n"
+                         "-1\n20\n-2\n");
+    for (size_t i = 0; i < 2; ++i) {
+        string outputs[2];
+        for (size_t j = 0; j < 2; ++j) {
+            WiggleLiftover liftover;
+            if (i == 1) {
+                stringstream preloadFile(preload);
+                liftover.preloadOutput(alignment, root, &preloadFile);
+            }
+            stringstream wigFile(wig);
+            stringstream outStream;
+            liftover.convert(alignment, leaf3, &wigFile, root, &outStream, true, false, j);
+            outputs[j] = outStream.str();
+        }
+        CuAssertTrue(_testCase, !outputs[0].empty());
+        CuAssertTrue(_testCase, outputs[0] == outputs[1]);
+    }
+    alignment->closeGenome(root);
+    alignment->closeGenome(leaf3);
+}
+
 void WiggleLiftoverTest::createCallBack(AlignmentPtr alignment) {
     setupSharedAlignment(alignment);
 }
@@ -441,6 +483,52 @@ void WiggleLiftoverTest::createCallBack(AlignmentPtr alignment) {
 void WiggleLiftoverTest::checkCallBack(AlignmentConstPtr alignment) {
     testOneBranchLifts(alignment);
     testMultiBranchLifts(alignment);
+    testSpilledLifts(alignment);
+}
+
+void ColumnLiftoverTest::createCallBack(AlignmentPtr alignment) {
+    setupSharedAlignment(alignment);
+}
+
+/* lifting segment by segment gives the same intervals as walking the
+ * columns, on both strands */
+void ColumnLiftoverTest::checkCallBack(AlignmentConstPtr alignment) {
+    const char *names[] = {"root", "child1", "leaf1", "leaf2", "leaf3"};
+    hal_index_t ranges[][2] = {{0, 100}, {0, 20}, {3, 17}, {18, 47}, {22, 28}, {40, 70}, {55, 90}, {69, 100}};
+    const char strands[] = {'+', '-', '.'};
+    for (size_t i = 0; i < 5; ++i) {
+        const Genome *srcGenome = alignment->openGenome(names[i]);
+        hal_index_t length = srcGenome->getSequenceLength();
+        stringstream inBed;
+        for (size_t j = 0; j < 8; ++j) {
+            if (ranges[j][0] < length) {
+                for (size_t k = 0; k < 3; ++k) {
+                    inBed << "Sequence\t" << ranges[j][0] << "\t" << min(ranges[j][1], length) << "\tI" << j << "\t0\t"
+                          << strands[k] << "\n";
+                }
+            }
+        }
+        for (size_t j = 0; j < 5; ++j) {
+            if (j == i) {
+                continue;
+            }
+            const Genome *tgtGenome = alignment->openGenome(names[j]);
+            string outBeds[2];
+            for (size_t byColumns = 0; byColumns < 2; ++byColumns) {
+                ColumnLiftover liftover(byColumns);
+                stringstream bedFile(inBed.str());
+                stringstream outStream;
+                liftover.convert(alignment, srcGenome, &bedFile, tgtGenome, &outStream);
+                outBeds[byColumns] = outStream.str();
+            }
+            if (outBeds[0] != outBeds[1]) {
+                cerr << names[i] << " -> " << names[j] << " by segments: " << endl << outBeds[0] << endl;
+                cerr << "by columns: " << endl << outBeds[1] << endl;
+            }
+            CuAssertTrue(_testCase, !outBeds[1].empty());
+            CuAssertTrue(_testCase, outBeds[0] == outBeds[1]);
+        }
+    }
 }
 
 void halBedLiftoverTest(CuTest *testCase) {
@@ -452,6 +540,15 @@ void halBedLiftoverTest(CuTest *testCase) {
     }
 }
 
+void halColumnLiftoverTest(CuTest *testCase) {
+    try {
+        ColumnLiftoverTest tester;
+        tester.check(testCase);
+    } catch (...) {
+        CuAssertTrue(testCase, false);
+    }
+}
+
 void halWiggleLiftoverTest(CuTest *testCase) {
     try {
         WiggleLiftoverTest tester;
@@ -461,10 +558,84 @@ void halWiggleLiftoverTest(CuTest *testCase) {
     }
 }
 
+void halWiggleTilesTest(CuTest *testCase) {
+    WiggleTiles<double> tiles;
+    tiles.init(1000, -1.0, 100);
+    CuAssertTrue(testCase, tiles.getNumTiles() == 10);
+    CuAssertTrue(testCase, tiles.findNext(0) == NULL_INDEX);
+    CuAssertTrue(testCase, tiles.getMemoryUsage() == 0);
+    tiles.set(5, 1.0);
+    tiles.set(63, 2.0);
+    tiles.set(64, 3.0);
+    tiles.set(450, 4.0);
+    tiles.set(999, 5.0);
+    CuAssertTrue(testCase, tiles.exists(63) && tiles.exists(64) && !tiles.exists(65));
+    CuAssertTrue(testCase, tiles.get(64) == 3.0 && tiles.get(65) == -1.0 && tiles.get(500) == -1.0);
+    CuAssertTrue(testCase, tiles.findNext(0) == 5);
+    CuAssertTrue(testCase, tiles.findNext(6) == 63);
+    CuAssertTrue(testCase, tiles.findNext(64) == 64);
+    CuAssertTrue(testCase, tiles.findNext(65) == 450);
+    CuAssertTrue(testCase, tiles.findNext(451) == 999);
+    CuAssertTrue(testCase, tiles.findNext(1000) == NULL_INDEX);
+    CuAssertTrue(testCase, tiles.isTileEmpty(1) && !tiles.isTileEmpty(4));
+    hal_size_t memory = tiles.getMemoryUsage();
+    CuAssertTrue(testCase, memory > 0);
+    tiles.clearTile(4);
+    CuAssertTrue(testCase, tiles.isTileEmpty(4) && !tiles.exists(450));
+    CuAssertTrue(testCase, tiles.getMemoryUsage() < memory);
+    CuAssertTrue(testCase, tiles.findNext(65) == 999);
+}
+
+void halWiggleRunFileTest(CuTest *testCase) {
+    try {
+        WiggleRunFile runFile;
+        runFile.open("");
+        // runs with gaps, a shared position and a block longer than a
+        // read buffer
+        runFile.beginRun();
+        runFile.add(3, 1.0);
+        runFile.add(4, 2.0);
+        runFile.add(10, 3.0);
+        runFile.endRun();
+        runFile.beginRun();
+        runFile.endRun();
+        runFile.beginRun();
+        for (hal_index_t i = 4; i < 20004; ++i) {
+            runFile.add(i, (double)i);
+        }
+        runFile.endRun();
+        CuAssertTrue(testCase, runFile.getNumRuns() == 3);
+
+        runFile.beginMerge();
+        hal_index_t pos;
+        size_t run;
+        double val;
+        CuAssertTrue(testCase, runFile.next(pos, run, val) && pos == 3 && run == 0 && val == 1.0);
+        CuAssertTrue(testCase, runFile.next(pos, run, val) && pos == 4 && run == 0 && val == 2.0);
+        CuAssertTrue(testCase, runFile.next(pos, run, val) && pos == 4 && run == 2 && val == 4.0);
+        hal_index_t prevPos = pos;
+        size_t count = 0;
+        bool ordered = true;
+        while (runFile.next(pos, run, val)) {
+            ordered = ordered && pos >= prevPos && (run == 0 || val == (double)pos);
+            prevPos = pos;
+            ++count;
+        }
+        CuAssertTrue(testCase, ordered);
+        CuAssertTrue(testCase, count == 19999 + 1);
+        CuAssertTrue(testCase, prevPos == 20003);
+    } catch (...) {
+        CuAssertTrue(testCase, false);
+    }
+}
+
 CuSuite *halLiftoverTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, halBedLiftoverTest);
+    SUITE_ADD_TEST(suite, halColumnLiftoverTest);
     SUITE_ADD_TEST(suite, halWiggleLiftoverTest);
+    SUITE_ADD_TEST(suite, halWiggleTilesTest);
+    SUITE_ADD_TEST(suite, halWiggleRunFileTest);
     return suite;
 }
 
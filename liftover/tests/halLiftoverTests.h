@@ -37,6 +37,12 @@ struct WiggleLiftoverTest : public AlignmentTest {
     void checkCallBack(AlignmentConstPtr alignment);
     void testOneBranchLifts(AlignmentConstPtr alignment);
     void testMultiBranchLifts(AlignmentConstPtr alignment);
+    void testSpilledLifts(AlignmentConstPtr alignment);
+};
+
+struct ColumnLiftoverTest : public AlignmentTest {
+    void createCallBack(AlignmentPtr alignment);
+    void checkCallBack(AlignmentConstPtr alignment);
 };
 
 CuSuite *halLiftoverTestSuite();
@@ -32,7 +32,7 @@ MaxLodToken = "max"
 
 # Wrapper for halLodExtract
 def getHalLodExtractCmd(inHalPath, outHalPath, scale, keepSeq, inMemory,
-                     probeFrac, minSeqFrac, chunk, minCovFrac):
+                     probeFrac, minSeqFrac, chunk, minCovFrac, numThreads):
     cmd = "halLodExtract %s %s %s" % (inHalPath, outHalPath, scale)
     if keepSeq is True:
         cmd += " --keepSequences"
@@ -44,6 +44,8 @@ def getHalLodExtractCmd(inHalPath, outHalPath, scale, keepSeq, inMemory,
         cmd += " --minSeqFrac %f" % minSeqFrac
     if chunk is not None and chunk > 0:
         cmd += " --chunk %d" % chunk
+    if numThreads is not None and numThreads > 1:
+        cmd += " --numThreads %d" % numThreads
 
     return cmd
 
@@ -133,7 +135,8 @@ def formatOutHalPath(outLodPath, outHalPath, absPath):
 # Run halLodExtract for each level of detail.
 def createLods(halPath, outLodPath, outDir, maxBlock, scale, overwrite,
                maxDNA, absPath, trans, inMemory, probeFrac, minSeqFrac,
-               scaleCorFac, numProc, chunk, minLod0, cutOff, minCovFrac):
+               scaleCorFac, numProc, chunk, minLod0, cutOff, minCovFrac,
+               numThreads):
     lodFile = open(outLodPath, "w")
     lodFile.write("0 %s\n" % formatOutHalPath(outLodPath, halPath, absPath))
     steps, lastIsMax = getSteps(halPath, maxBlock, scale, minLod0, cutOff,
@@ -160,7 +163,8 @@ def createLods(halPath, outLodPath, outDir, maxBlock, scale, overwrite,
             lodExtractCmds.append(
                 getHalLodExtractCmd(srcPath, outHalPath, stepScale,
                                     keepSequences, inMemory, probeFrac,
-                                    minSeqFrac, chunk, minCovFrac))
+                                    minSeqFrac, chunk, minCovFrac,
+                                    numThreads))
         lodPath =  formatOutHalPath(outLodPath, outHalPath, absPath)
         if isMaxLod:
             lodPath = MaxLodToken
@@ -251,6 +255,9 @@ def main(argv=None):
                         type=float, default=1.0)
     parser.add_argument("--numProc", help="Number of concurrent processes",
                         type=int, default=1)
+    parser.add_argument("--numThreads", help="Number of threads used by "
+                        "each halLodExtract process (mmap HAL files only)",
+                        type=int, default=1)
     parser.add_argument("--chunk", help="Chunk size of output hal files.  ",
                         type=int, default=None)
     parser.add_argument("--minLod0", help="Override other parameters to "
@@ -290,7 +297,7 @@ def main(argv=None):
                args.maxBlock, args.scale, not args.resume, args.maxDNA,
                args.absPath, args.trans, args.inMemory, args.probeFrac,
                args.minSeqFrac, args.scaleCorFac, args.numProc, args.chunk,
-               args.minLod0, args.cutOff, args.minCovFrac)
+               args.minLod0, args.cutOff, args.minCovFrac, args.numThreads)
     
 if __name__ == "__main__":
     sys.exit(main())
@@ -5,6 +5,7 @@
  * Released under the MIT license, see LICENSE.txt
  */
 #include "halLodBlock.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <limits>
@@ -26,9 +27,6 @@ void LodBlock::addSegment(LodSegment *segment) {
 }
 
 void LodBlock::clear() {
-    for (SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        delete *i;
-    }
     _segments.clear();
 }
 
@@ -95,10 +93,11 @@ void LodBlock::mergeHead(LodBlock *adjBlock) {
     }
 }
 
-void LodBlock::insertNeighbours(vector<LodBlock *> &outList) {
+void LodBlock::insertNeighbours(vector<LodBlock *> &outList, LodArena<LodBlock> &blockArena,
+                                LodArena<LodSegment> &segmentArena) {
     LodBlock *lodBlock = NULL;
     while (true) {
-        lodBlock = insertNewTailNeighbour();
+        lodBlock = insertNewTailNeighbour(blockArena, segmentArena);
         if (lodBlock != NULL) {
             outList.push_back(lodBlock);
         } else {
@@ -106,7 +105,7 @@ void LodBlock::insertNeighbours(vector<LodBlock *> &outList) {
         }
     }
     while (true) {
-        lodBlock = insertNewHeadNeighbour();
+        lodBlock = insertNewHeadNeighbour(blockArena, segmentArena);
         if (lodBlock != NULL) {
             outList.push_back(lodBlock);
         } else {
@@ -117,14 +116,14 @@ void LodBlock::insertNeighbours(vector<LodBlock *> &outList) {
     assert(getMaxTailInsertionLen() == 0);
 }
 
-LodBlock *LodBlock::insertNewTailNeighbour() {
+LodBlock *LodBlock::insertNewTailNeighbour(LodArena<LodBlock> &blockArena, LodArena<LodSegment> &segmentArena) {
     LodBlock *newBlock = NULL;
     hal_size_t maxTailInsLen = getMaxTailInsertionLen();
     if (maxTailInsLen > 0) {
-        newBlock = new LodBlock();
+        newBlock = blockArena.create();
         for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
             if ((*i)->getTailAdjLen() >= maxTailInsLen) {
-                LodSegment *newSeg = (*i)->insertNewTailAdj(newBlock, maxTailInsLen);
+                LodSegment *newSeg = (*i)->insertNewTailAdj(newBlock, maxTailInsLen, segmentArena);
                 newBlock->_segments.push_back(newSeg);
             }
         }
@@ -132,14 +131,14 @@ LodBlock *LodBlock::insertNewTailNeighbour() {
     return newBlock;
 }
 
-LodBlock *LodBlock::insertNewHeadNeighbour() {
+LodBlock *LodBlock::insertNewHeadNeighbour(LodArena<LodBlock> &blockArena, LodArena<LodSegment> &segmentArena) {
     LodBlock *newBlock = NULL;
     hal_size_t maxHeadInsLen = getMaxHeadInsertionLen();
     if (maxHeadInsLen > 0) {
-        newBlock = new LodBlock();
+        newBlock = blockArena.create();
         for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
             if ((*i)->getHeadAdjLen() >= maxHeadInsLen) {
-                LodSegment *newSeg = (*i)->insertNewHeadAdj(newBlock, maxHeadInsLen);
+                LodSegment *newSeg = (*i)->insertNewHeadAdj(newBlock, maxHeadInsLen, segmentArena);
                 newBlock->_segments.push_back(newSeg);
             }
         }
@@ -150,16 +149,14 @@ LodBlock *LodBlock::insertNewHeadNeighbour() {
 hal_size_t LodBlock::getMaxTailExtensionLen() const {
     hal_size_t minTail = numeric_limits<hal_size_t>::max();
 
-    set<const LodSegment *> lookup;
     hal_size_t adjLen;
     for (LodBlock::SegmentConstIterator i = _segments.begin(); i != _segments.end(); ++i) {
         adjLen = (*i)->getTailAdjLen();
-        if ((*i)->getTailToTail() && lookup.find((*i)->getTailAdj()) != lookup.end()) {
+        if ((*i)->getTailToTail() && isEarlierSegment(i, (*i)->getTailAdj())) {
             // we have a tail to tail edge in the block.  can only extend half
             adjLen /= 2;
         }
         minTail = min(adjLen, minTail);
-        lookup.insert(*i);
     }
     return minTail;
 }
@@ -167,20 +164,23 @@ hal_size_t LodBlock::getMaxTailExtensionLen() const {
 hal_size_t LodBlock::getMaxHeadExtensionLen() const {
     hal_size_t minHead = numeric_limits<hal_size_t>::max();
 
-    set<const LodSegment *> lookup;
     hal_size_t adjLen;
     for (LodBlock::SegmentConstIterator i = _segments.begin(); i != _segments.end(); ++i) {
         adjLen = (*i)->getHeadAdjLen();
-        if ((*i)->getHeadToHead() && lookup.find((*i)->getHeadAdj()) != lookup.end()) {
+        if ((*i)->getHeadToHead() && isEarlierSegment(i, (*i)->getHeadAdj())) {
             // we have a head to head edge in the block.  can only extend half
             adjLen /= 2;
         }
         minHead = min(adjLen, minHead);
-        lookup.insert(*i);
     }
     return minHead;
 }
 
+bool LodBlock::isEarlierSegment(SegmentConstIterator pos, const LodSegment *segment) const {
+    // self edges are rare, so only search the block when the segment is in it
+    return segment->getBlock() == this && std::find(_segments.begin(), pos, segment) != pos;
+}
+
 hal_size_t LodBlock::getMaxTailInsertionLen() const {
     hal_size_t minNZTail = numeric_limits<hal_size_t>::max();
     hal_size_t adjLen;
@@ -10,6 +10,7 @@
 #include <cassert>
 #include <deque>
 #include <limits>
+#include <sstream>
 extern "C" {
 #include "sonLibTree.h"
 }
@@ -17,7 +18,7 @@ extern "C" {
 using namespace std;
 using namespace hal;
 
-LodExtract::LodExtract() {
+LodExtract::LodExtract() : _graph(NULL) {
 }
 
 LodExtract::~LodExtract() {
@@ -25,7 +26,7 @@ LodExtract::~LodExtract() {
 
 void LodExtract::createInterpolatedAlignment(AlignmentConstPtr inAlignment, AlignmentPtr outAlignment, double scale,
                                              const string &tree, const string &rootName, bool keepSequences, bool allSequences,
-                                             double probeFrac, double minSeqFrac) {
+                                             double probeFrac, double minSeqFrac, hal_size_t numThreads) {
     _inAlignment = inAlignment;
     _outAlignment = outAlignment;
     _keepSequences = keepSequences;
@@ -37,6 +38,10 @@ void LodExtract::createInterpolatedAlignment(AlignmentConstPtr inAlignment, Alig
     createTree(newTree, rootName);
     cout << "tree = " << _outAlignment->getNewickTree() << endl;
 
+    // internal nodes in breadth-first order, which is the order they must
+    // be written in since each node's dimensions are set with its parent's
+    vector<string> internalNames;
+    vector<vector<string>> internalChildNames;
     deque<string> bfQueue;
     bfQueue.push_front(_outAlignment->getRootName());
     while (!bfQueue.empty()) {
@@ -44,12 +49,41 @@ void LodExtract::createInterpolatedAlignment(AlignmentConstPtr inAlignment, Alig
         bfQueue.pop_back();
         vector<string> childNames = _outAlignment->getChildNames(genomeName);
         if (!childNames.empty()) {
-            convertInternalNode(genomeName, scale);
+            internalNames.push_back(genomeName);
+            internalChildNames.push_back(childNames);
             for (size_t childIdx = 0; childIdx < childNames.size(); childIdx++) {
                 bfQueue.push_back(childNames[childIdx]);
             }
         }
     }
+
+    // the graphs only read the input alignment, so they are built on
+    // worker threads, while the output is written on this one.  the
+    // progress messages of each build are printed when it is written.
+    if (numThreads > 1) {
+        checkSharedAccess(_inAlignment.get());
+    }
+    vector<LodGraph *> graphs(internalNames.size(), NULL);
+    try {
+        runOrderedTasks(internalNames.size(), numThreads,
+                        [&](size_t nodeIdx, string &output) {
+                            ostringstream progress;
+                            graphs[nodeIdx] = buildGraph(internalNames[nodeIdx], internalChildNames[nodeIdx], scale, progress);
+                            output = progress.str();
+                        },
+                        [&](size_t nodeIdx, string &output) {
+                            cout << output;
+                            convertInternalNode(internalNames[nodeIdx], internalChildNames[nodeIdx], graphs[nodeIdx]);
+                            delete graphs[nodeIdx];
+                            graphs[nodeIdx] = NULL;
+                        },
+                        numThreads);
+    } catch (...) {
+        for (size_t i = 0; i < graphs.size(); ++i) {
+            delete graphs[i];
+        }
+        throw;
+    }
 }
 
 void LodExtract::createTree(const string &tree, const string &rootName) {
@@ -119,10 +153,10 @@ void LodExtract::createTree(const string &tree, const string &rootName) {
     stTree_destruct(root);
 }
 
-void LodExtract::convertInternalNode(const string &genomeName, double scale) {
+LodGraph *LodExtract::buildGraph(const string &genomeName, const vector<string> &childNames, double scale,
+                                  ostream &progress) const {
     const Genome *parent = _inAlignment->openGenome(genomeName);
     assert(parent != NULL);
-    vector<string> childNames = _outAlignment->getChildNames(genomeName);
     vector<const Genome *> children;
     for (hal_size_t i = 0; i < childNames.size(); ++i) {
         children.push_back(_inAlignment->openGenome(childNames[i]));
@@ -130,7 +164,25 @@ void LodExtract::convertInternalNode(const string &genomeName, double scale) {
     const Genome *grandParent = NULL; // TEMP HACK  parent->getParent();
     hal_size_t minAvgBlockSize = getMinAvgBlockSize(parent, children, grandParent);
     hal_size_t step = (hal_size_t)(scale * minAvgBlockSize);
-    _graph.build(_inAlignment, parent, children, grandParent, step, _allSequences, _probeFrac, _minSeqFrac);
+    LodGraph *graph = new LodGraph();
+    try {
+        graph->build(_inAlignment, parent, children, grandParent, step, _allSequences, _probeFrac, _minSeqFrac, progress);
+    } catch (...) {
+        delete graph;
+        throw;
+    }
+    return graph;
+}
+
+void LodExtract::convertInternalNode(const string &genomeName, const vector<string> &childNames, LodGraph *graph) {
+    const Genome *parent = _inAlignment->openGenome(genomeName);
+    assert(parent != NULL);
+    vector<const Genome *> children;
+    for (hal_size_t i = 0; i < childNames.size(); ++i) {
+        children.push_back(_inAlignment->openGenome(childNames[i]));
+    }
+    const Genome *grandParent = NULL; // TEMP HACK  parent->getParent();
+    _graph = graph;
 
     map<const Sequence *, hal_size_t> segmentCounts;
     countSegmentsInGraph(segmentCounts);
@@ -146,7 +198,8 @@ void LodExtract::convertInternalNode(const string &genomeName, double scale) {
     // if we're gonna print anything out, do it before this:
     // (not necesssary but by closing genomes we erase their hdf5 caches
     // which can make a difference on huge trees
-    _graph.erase();
+    _graph->erase();
+    _graph = NULL;
     _outAlignment->closeGenome(_outAlignment->openGenome(parent->getName()));
     _inAlignment->closeGenome(parent);
     for (hal_size_t i = 0; i < children.size(); ++i) {
@@ -164,8 +217,8 @@ void LodExtract::countSegmentsInGraph(map<const Sequence *, hal_size_t> &segment
     const LodSegment *segment;
     pair<map<const Sequence *, hal_size_t>::iterator, bool> res;
 
-    for (hal_size_t blockIdx = 0; blockIdx < _graph.getNumBlocks(); ++blockIdx) {
-        block = _graph.getBlock(blockIdx);
+    for (hal_size_t blockIdx = 0; blockIdx < _graph->getNumBlocks(); ++blockIdx) {
+        block = _graph->getBlock(blockIdx);
         for (hal_size_t segIdx = 0; segIdx < block->getNumSegments(); ++segIdx) {
             segment = block->getSegment(segIdx);
             res = segmentCounts.insert(pair<const Sequence *, hal_size_t>(segment->getSequence(), 0));
@@ -176,7 +229,7 @@ void LodExtract::countSegmentsInGraph(map<const Sequence *, hal_size_t> &segment
 
     // add unsampled non-zero sequences to dimensions, by looking for
     // sequences who have telomeres but no segments.
-    const LodBlock *telomeres = _graph.getTelomeres();
+    const LodBlock *telomeres = _graph->getTelomeres();
     for (hal_size_t telIdx = 0; telIdx < telomeres->getNumSegments(); ++telIdx) {
         segment = telomeres->getSegment(telIdx);
         if (segment->getSequence()->getSequenceLength() > 0) {
@@ -299,14 +352,14 @@ void LodExtract::writeSegments(const Genome *inParent, const vector<const Genome
                 bottom = const_pointer_cast<BottomSegmentIterator>(outSequence->getBottomSegmentIterator());
                 outSegment = bottom;
             }
-            const LodGraph::SegmentSet *segSet = _graph.getSegmentSet(inSequence);
-            assert(segSet != NULL);
-            LodGraph::SegmentSet::const_iterator segIt = segSet->begin();
-            if (segSet->size() > 2) {
+            const LodGraph::SegmentList *segList = _graph->getSegmentList(inSequence);
+            assert(segList != NULL);
+            LodGraph::SegmentList::const_iterator segIt = segList->begin();
+            if (segList->size() > 2) {
                 // skip left telomere
                 ++segIt;
                 // use to skip right telomere:
-                LodGraph::SegmentSet::const_iterator segLast = segSet->end();
+                LodGraph::SegmentList::const_iterator segLast = segList->end();
                 --segLast;
 
                 // FOR EVERY SEGMENT IN SEQUENCE
@@ -319,7 +372,7 @@ void LodExtract::writeSegments(const Genome *inParent, const vector<const Genome
                     outSegment->toRight();
                 }
             } else if (outSequence->getSequenceLength() > 0) {
-                assert(segSet->size() == 2);
+                assert(segList->size() == 2);
                 writeUnsampledSequence(outSequence, outSegment);
             }
         }
@@ -358,9 +411,9 @@ void LodExtract::writeHomologies(const Genome *inParent, const vector<const Geno
     TopSegmentIteratorPtr top = outChild->getTopSegmentIterator();
 
     // FOR EVERY BLOCK
-    for (hal_size_t blockIdx = 0; blockIdx < _graph.getNumBlocks(); ++blockIdx) {
+    for (hal_size_t blockIdx = 0; blockIdx < _graph->getNumBlocks(); ++blockIdx) {
         SegmentMap segMap;
-        const LodBlock *block = _graph.getBlock(blockIdx);
+        const LodBlock *block = _graph->getBlock(blockIdx);
 
         for (hal_size_t segIdx = 0; segIdx < block->getNumSegments(); ++segIdx) {
             const LodSegment *segment = block->getSegment(segIdx);
@@ -39,6 +39,10 @@ static void initParser(CLParser &optionsParser) {
                                                 "By default, small sequences may be skipped if "
                                                 "they fall within the step size.",
                                 false);
+    optionsParser.addOption("numThreads", "Number of threads used to build the graphs of "
+                                          "different internal nodes concurrently.  Only "
+                                          "supported for mmap input HAL files.",
+                            1);
     optionsParser.setDescription("Generate a new HAL file at a coarser "
                                  "Level of Detail (LOD) by interpolation. "
                                  "The scale parameter is used to estimate "
@@ -59,6 +63,7 @@ int main(int argc, char **argv) {
     bool allSequences;
     double probeFrac;
     double minSeqFrac;
+    hal_size_t numThreads;
     try {
         optionsParser.parseOptions(argc, argv);
         inHalPath = optionsParser.getArgument<string>("inHalPath");
@@ -70,6 +75,7 @@ int main(int argc, char **argv) {
         allSequences = optionsParser.getFlag("allSequences");
         probeFrac = optionsParser.getOption<double>("probeFrac");
         minSeqFrac = optionsParser.getOption<double>("minSeqFrac");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
         if (allSequences == true) {
             minSeqFrac = 0.;
         }
@@ -79,7 +85,8 @@ int main(int argc, char **argv) {
         return 1;
     }
     try {
-        AlignmentConstPtr inAlignment(openHalAlignment(inHalPath, &optionsParser));
+        AlignmentConstPtr inAlignment(
+            openHalAlignment(inHalPath, &optionsParser, (numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
         if (inAlignment->getNumGenomes() == 0) {
             throw hal_exception("Input hal alignment is empty");
         }
@@ -101,7 +108,7 @@ int main(int argc, char **argv) {
 
         LodExtract lodExtract;
         lodExtract.createInterpolatedAlignment(inAlignment, outAlignment, scale, outTree, rootName, keepSequences,
-                                               allSequences, probeFrac, minSeqFrac);
+                                               allSequences, probeFrac, minSeqFrac, numThreads);
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
         return 1;
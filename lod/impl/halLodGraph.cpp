@@ -23,22 +23,20 @@ LodGraph::~LodGraph() {
 }
 
 void LodGraph::erase() {
-    for (SequenceMapIterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
-        delete smi->second;
-    }
+    _scanMap.clear();
     _seqMap.clear();
-    for (BlockIterator bi = _blocks.begin(); bi != _blocks.end(); ++bi) {
-        delete *bi;
-    }
     _blocks.clear();
     _parent = NULL;
     _grandParent = NULL;
     _genomes.clear();
     _telomeres.clear();
+    _blockArena.clear();
+    _segmentArena.clear();
 }
 
 void LodGraph::build(AlignmentConstPtr alignment, const Genome *parent, const vector<const Genome *> &children,
-                     const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac) {
+                     const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac,
+                     ostream &progress) {
     erase();
     _alignment = AlignmentConstPtr(alignment);
     _parent = parent;
@@ -60,18 +58,27 @@ void LodGraph::build(AlignmentConstPtr alignment, const Genome *parent, const ve
         _genomes.insert(_grandParent);
     }
 
-    for (set<const Genome *>::iterator gi = _genomes.begin(); gi != _genomes.end(); ++gi) {
-        scanGenome(*gi);
+    // scan in tree order rather than in the (address) order of _genomes,
+    // since the columns sampled from one genome affect those sampled from
+    // the next, and the graph must not depend on where genomes were
+    // allocated (nor on which thread built it)
+    scanGenome(_parent);
+    for (vector<const Genome *>::const_iterator child = children.begin(); child != children.end(); ++child) {
+        scanGenome(*child);
+    }
+    if (_grandParent != NULL) {
+        scanGenome(_grandParent);
     }
 
+    buildSegmentLists();
     computeAdjacencies();
-    printDimensions(cout);
+    printDimensions(progress);
     optimizeByExtension();
-    printDimensions(cout);
+    printDimensions(progress);
     optimizeByMerging();
-    printDimensions(cout);
+    printDimensions(progress);
     optimizeByInsertion();
-    printDimensions(cout);
+    printDimensions(progress);
     assert(checkCoverage() == true);
 }
 
@@ -150,6 +157,10 @@ void LodGraph::evaluateColumn(ColumnIteratorPtr colIt, hal_size_t &outDeltaMax,
     for (; colMapIt != colMap->end() && !breakOut; ++colMapIt) {
         const ColumnIterator::DNASet *dnaSet = colMapIt->second;
         const Sequence *sequence = colMapIt->first;
+        if (dnaSet->empty()) {
+            // left over from a previous column
+            continue;
+        }
         if (sequence->getSequenceLength() <= _minSeqLen) {
             // we never want to align two leaves through a disappeared
             // contig in parent
@@ -162,15 +173,13 @@ void LodGraph::evaluateColumn(ColumnIteratorPtr colIt, hal_size_t &outDeltaMax,
         } else {
             outMinSeqLen = std::min(outMinSeqLen, sequence->getSequenceLength());
             ColumnIterator::DNASet::const_iterator dnaIt = dnaSet->begin();
-            if (!dnaSet->empty()) {
-                genomeSet.insert(sequence->getGenome());
-            }
+            genomeSet.insert(sequence->getGenome());
             for (; dnaIt != dnaSet->end() && !breakOut; ++dnaIt) {
                 hal_index_t pos = (*dnaIt)->getArrayIndex();
                 LodSegment segment(NULL, sequence, pos, false);
-                SequenceMapIterator smi = _seqMap.find(sequence);
-                if (smi != _seqMap.end()) {
-                    SegmentSet *segmentSet = smi->second;
+                ScanMapIterator smi = _scanMap.find(sequence);
+                if (smi != _scanMap.end()) {
+                    SegmentSet *segmentSet = &smi->second;
                     SegmentIterator si = segmentSet->lower_bound(&segment);
                     SegmentSet::value_compare segPLess = segmentSet->key_comp();
                     if (si == segmentSet->end()) {
@@ -214,45 +223,30 @@ bool LodGraph::bestColumn(hal_size_t probeStep, hal_size_t delta, hal_size_t num
 }
 
 void LodGraph::addTelomeres(const Sequence *sequence) {
-    SequenceMapIterator smi = _seqMap.find(sequence);
-    SegmentSet *segSet = NULL;
-    if (smi == _seqMap.end()) {
-        segSet = new SegmentSet();
-        _seqMap.insert(pair<const Sequence *, SegmentSet *>(sequence, segSet));
-    } else {
-        segSet = smi->second;
-    }
+    SegmentSet *segSet = &_scanMap[sequence];
 
-    LodSegment *segment = new LodSegment(&_telomeres, sequence, sequence->getStartPosition() - 1, false);
+    LodSegment *segment = _segmentArena.create(&_telomeres, sequence, sequence->getStartPosition() - 1, false);
     _telomeres.addSegment(segment);
     segSet->insert(segment);
-    segment = new LodSegment(&_telomeres, sequence, sequence->getEndPosition() + 1, false);
+    segment = _segmentArena.create(&_telomeres, sequence, sequence->getEndPosition() + 1, false);
     _telomeres.addSegment(segment);
     segSet->insert(segment);
 }
 
 void LodGraph::createColumn(ColumnIteratorPtr colIt) {
-    LodBlock *block = new LodBlock();
+    LodBlock *block = _blockArena.create();
     const ColumnIterator::ColumnMap *colMap = colIt->getColumnMap();
     ColumnIterator::ColumnMap::const_iterator colMapIt = colMap->begin();
     for (; colMapIt != colMap->end(); ++colMapIt) {
         const Sequence *sequence = colMapIt->first;
         if (sequence->getSequenceLength() > _minSeqLen) {
-            SequenceMapIterator smi = _seqMap.find(sequence);
-            SegmentSet *segSet = NULL;
-            if (smi == _seqMap.end()) {
-                segSet = new SegmentSet();
-                ;
-                _seqMap.insert(pair<const Sequence *, SegmentSet *>(sequence, segSet));
-            } else {
-                segSet = smi->second;
-            }
+            SegmentSet *segSet = &_scanMap[sequence];
 
             const ColumnIterator::DNASet *dnaSet = colMapIt->second;
             for (ColumnIterator::DNASet::const_iterator dnaIt = dnaSet->begin(); dnaIt != dnaSet->end(); ++dnaIt) {
                 hal_index_t pos = (*dnaIt)->getArrayIndex();
                 bool reversed = (*dnaIt)->getReversed();
-                LodSegment *segment = new LodSegment(block, sequence, pos, reversed);
+                LodSegment *segment = _segmentArena.create(block, sequence, pos, reversed);
                 block->addSegment(segment);
                 assert(segSet->find(segment) == segSet->end());
                 segSet->insert(segment);
@@ -263,17 +257,20 @@ void LodGraph::createColumn(ColumnIteratorPtr colIt) {
     _blocks.push_back(block);
 }
 
+void LodGraph::buildSegmentLists() {
+    // free each set as soon as it's copied to keep the peak down
+    for (ScanMapIterator smi = _scanMap.begin(); smi != _scanMap.end(); _scanMap.erase(smi++)) {
+        SegmentList &segList = _seqMap[smi->first];
+        segList.assign(smi->second.begin(), smi->second.end());
+    }
+}
+
 void LodGraph::computeAdjacencies() {
     for (SequenceMapIterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
-        SegmentIterator si = smi->second->begin();
-        SegmentIterator siNext;
-        for (; si != smi->second->end(); ++si) {
-            siNext = si;
-            ++siNext;
-            if (siNext != smi->second->end()) {
-                assert((*si)->overlaps(**siNext) == false);
-                (*si)->addEdgeFromRightToLeft(*siNext);
-            }
+        SegmentList &segList = smi->second;
+        for (size_t i = 1; i < segList.size(); ++i) {
+            assert(segList[i - 1]->overlaps(*segList[i]) == false);
+            segList[i - 1]->addEdgeFromRightToLeft(segList[i]);
         }
     }
 }
@@ -300,16 +297,6 @@ void LodGraph::optimizeByMerging() {
     for (BlockIterator bi = mergeList.begin(); bi != mergeList.end(); ++bi) {
         LodBlock *adjBlock = (*bi)->getHeadMergePartner();
         if (adjBlock != NULL) {
-            for (hal_size_t segIdx = 0; segIdx < adjBlock->getNumSegments(); ++segIdx) {
-                // blah - need to clean interface but this is harmless for now
-                LodSegment *seg = const_cast<LodSegment *>(adjBlock->getSegment(segIdx));
-                SequenceMapIterator mapIt = _seqMap.find(seg->getSequence());
-                assert(mapIt != _seqMap.end());
-                SegmentIterator setIt = mapIt->second->find(seg);
-                assert(setIt != mapIt->second->end());
-                assert(*setIt == seg);
-                mapIt->second->erase(setIt);
-            }
             (*bi)->mergeHead(adjBlock);
         }
     }
@@ -319,31 +306,54 @@ void LodGraph::optimizeByMerging() {
             _blocks.push_back(*bi);
         }
     }
+
+    // the merged segments are left in the blocks that were emptied by
+    // merging: take them out of the sorted lists in one pass
+    for (SequenceMapIterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
+        SegmentList &segList = smi->second;
+        SegmentList::iterator last = segList.begin();
+        for (SegmentList::iterator si = segList.begin(); si != segList.end(); ++si) {
+            if ((*si)->getBlock()->getNumSegments() > 0) {
+                *last++ = *si;
+            }
+        }
+        segList.erase(last, segList.end());
+    }
 }
 
 void LodGraph::optimizeByInsertion() {
     vector<LodBlock *> newBlocks;
+    size_t numOldBlocks = _blocks.size();
     BlockIterator startPoint = _blocks.begin();
     // seems more convoluted than necessary but I had problems with ?iterators?
     // doing it more simply.
     while (startPoint != _blocks.end()) {
         newBlocks.clear();
         for (BlockIterator bi = _blocks.begin(); bi != _blocks.end(); ++bi) {
-            (*bi)->insertNeighbours(newBlocks);
+            (*bi)->insertNeighbours(newBlocks, _blockArena, _segmentArena);
         }
         startPoint = _blocks.end();
         --startPoint;
         _blocks.insert(_blocks.end(), newBlocks.begin(), newBlocks.end());
+        ++startPoint;
+    }
 
-        // need to get the new segments into the sorted structure too!
-        for (BlockIterator bi = newBlocks.begin(); bi != newBlocks.end(); ++bi) {
-            for (hal_size_t i = 0; i < (*bi)->getNumSegments(); ++i) {
-                // blah - need to clean interface but this is harmless for now
-                LodSegment *seg = const_cast<LodSegment *>((*bi)->getSegment(i));
-                _seqMap.find(seg->getSequence())->second->insert(seg);
-            }
+    // need to get the new segments into the sorted lists too!  they are
+    // only looked up after all the insertions, so add them all at once
+    // and sort the lists that got any.
+    for (BlockIterator bi = _blocks.begin() + numOldBlocks; bi != _blocks.end(); ++bi) {
+        for (hal_size_t i = 0; i < (*bi)->getNumSegments(); ++i) {
+            // blah - need to clean interface but this is harmless for now
+            LodSegment *seg = const_cast<LodSegment *>((*bi)->getSegment(i));
+            assert(_seqMap.find(seg->getSequence()) != _seqMap.end());
+            _seqMap.find(seg->getSequence())->second.push_back(seg);
+        }
+    }
+    for (SequenceMapIterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
+        SegmentList &segList = smi->second;
+        if (!std::is_sorted(segList.begin(), segList.end(), LodSegmentPLess())) {
+            std::sort(segList.begin(), segList.end(), LodSegmentPLess());
         }
-        ++startPoint;
     }
 }
 
@@ -29,7 +29,8 @@ const unsigned long LodManager::MaxAgeSec = 432000;
 // hal/lod/halLodInterpolate.py)
 const string LodManager::MaxLodToken = "max";
 
-LodManager::LodManager() : _options(NULL), _maxLodLowerBound((hal_size_t)numeric_limits<hal_index_t>::max()) {
+LodManager::LodManager()
+    : _options(NULL), _maxLodLowerBound((hal_size_t)numeric_limits<hal_index_t>::max()), _sharedAccess(false) {
     // FIXME: the way options work is weird.
 }
 
@@ -41,7 +42,7 @@ LodManager::~LodManager() {
     }
 }
 
-void LodManager::loadLODFile(const string &lodPath, const CLParser *options) {
+void LodManager::loadLODFile(const string &lodPath, const CLParser *options, bool sharedAccess) {
     _options = options;
     _map.clear();
 
@@ -99,14 +100,18 @@ void LodManager::loadLODFile(const string &lodPath, const CLParser *options) {
     }
 
     checkMap(lodPath);
+    // probing the format of every file is only needed for shared access
+    _sharedAccess = sharedAccess && detectSharedAccess();
 }
 
-void LodManager::loadSingeHALFile(const string &halPath, const CLParser *options) {
+void LodManager::loadSingeHALFile(const string &halPath, const CLParser *options, bool sharedAccess) {
     _options = options;
     _map.clear();
     _map.insert(pair<hal_size_t, PathAlign>(0, PathAlign(halPath, AlignmentConstPtr())));
     _maxLodLowerBound = (hal_size_t)numeric_limits<hal_index_t>::max();
     checkMap(halPath);
+    // probing the format of every file is only needed for shared access
+    _sharedAccess = sharedAccess && detectSharedAccess();
 }
 
 AlignmentConstPtr LodManager::getAlignment(hal_size_t queryLength, bool needDNA) {
@@ -119,13 +124,15 @@ AlignmentConstPtr LodManager::getAlignment(hal_size_t queryLength, bool needDNA)
         --mapIt;
     }
     assert(mapIt->first <= queryLength);
+    lock_guard<mutex> lock(_mutex);
     AlignmentConstPtr &alignment = mapIt->second.second;
     if (mapIt->first == _maxLodLowerBound) {
         throw hal_exception("Query length " + std::to_string(queryLength) + " above maximum LOD size of " +
                             std::to_string(getMaxQueryLength()));
     }
     if (alignment.get() == NULL) {
-        alignment = AlignmentConstPtr(openHalAlignment(mapIt->second.first, _options));
+        alignment = AlignmentConstPtr(
+            openHalAlignment(mapIt->second.first, _options, _sharedAccess ? READ_SHARED_ACCESS : READ_ACCESS));
         checkAlignment(mapIt->first, mapIt->second.first, alignment);
     }
     assert(mapIt->second.second.get() != NULL);
@@ -165,6 +172,23 @@ void LodManager::checkMap(const string &lodPath) {
     }
 }
 
+/* alignments are only shared if all of them are mmap.  Errors are left to
+ * be reported when the alignment is opened. */
+bool LodManager::detectSharedAccess() const {
+    for (AlignmentMap::const_iterator mapIt = _map.begin(); mapIt != _map.end(); ++mapIt) {
+        if (mapIt->second.first != MaxLodToken) {
+            try {
+                if (detectHalAlignmentFormat(mapIt->second.first, _options) != STORAGE_FORMAT_MMAP) {
+                    return false;
+                }
+            } catch (exception &e) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void LodManager::checkAlignment(hal_size_t minQuery, const string &path, AlignmentConstPtr alignment) {
     if (alignment->getNumGenomes() == 0) {
         throw hal_exception("No genomes found in base alignment specified in " + path);
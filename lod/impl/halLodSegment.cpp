@@ -64,11 +64,11 @@ void LodSegment::extendHead(hal_size_t extLen) {
     assert(overlaps(*_headAdj) == false);
 }
 
-LodSegment *LodSegment::insertNewHeadAdj(LodBlock *block, hal_size_t newLen) {
+LodSegment *LodSegment::insertNewHeadAdj(LodBlock *block, hal_size_t newLen, LodArena<LodSegment> &arena) {
     assert(newLen > 0);
     hal_index_t newTailPos = getHeadPos();
     newTailPos += getFlipped() ? -1 : 1;
-    LodSegment *newSeg = new LodSegment(block, getSequence(), newTailPos, getFlipped());
+    LodSegment *newSeg = arena.create(block, getSequence(), newTailPos, getFlipped());
     bool headToHead = getHeadToHead();
     newSeg->_headAdj = _headAdj;
     if (headToHead) {
@@ -88,11 +88,11 @@ LodSegment *LodSegment::insertNewHeadAdj(LodBlock *block, hal_size_t newLen) {
     return newSeg;
 }
 
-LodSegment *LodSegment::insertNewTailAdj(LodBlock *block, hal_size_t newLen) {
+LodSegment *LodSegment::insertNewTailAdj(LodBlock *block, hal_size_t newLen, LodArena<LodSegment> &arena) {
     assert(newLen > 0);
     hal_index_t newHeadPos = getTailPos();
     newHeadPos += getFlipped() ? 1 : -1;
-    LodSegment *newSeg = new LodSegment(block, getSequence(), newHeadPos, getFlipped());
+    LodSegment *newSeg = arena.create(block, getSequence(), newHeadPos, getFlipped());
     bool tailToTail = getTailToTail();
     newSeg->_tailAdj = _tailAdj;
     if (tailToTail) {
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALLODARENA_H
+#define _HALLODARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace hal {
+
+    /* Arena that the Level of Detail graph allocates its segments and
+     * blocks from.  Objects are constructed in large chunks, never moved,
+     * and are only destroyed all at once when the arena is cleared, so
+     * building a graph doesn't have to allocate and free each of its
+     * (many, small) objects separately.
+     */
+    template <typename T> class LodArena {
+      public:
+        LodArena() : _size(0) {
+        }
+        ~LodArena() {
+            clear();
+        }
+
+        /** Construct a new object in the arena.  It stays valid until the
+         * arena is cleared */
+        template <typename... Args> T *create(Args &&... args) {
+            if (_size == _chunks.size() * ChunkSize) {
+                _chunks.push_back(static_cast<T *>(::operator new(ChunkSize * sizeof(T))));
+            }
+            T *object = _chunks[_size / ChunkSize] + _size % ChunkSize;
+            new (object) T(std::forward<Args>(args)...);
+            ++_size;
+            return object;
+        }
+
+        /** Destroy all the objects and free their memory */
+        void clear() {
+            for (size_t i = 0; i < _size; ++i) {
+                (_chunks[i / ChunkSize] + i % ChunkSize)->~T();
+            }
+            for (size_t i = 0; i < _chunks.size(); ++i) {
+                ::operator delete(_chunks[i]);
+            }
+            _chunks.clear();
+            _size = 0;
+        }
+
+        size_t size() const {
+            return _size;
+        }
+
+      protected:
+        static const size_t ChunkSize = 4096;
+
+        std::vector<T *> _chunks;
+        size_t _size;
+
+      private:
+        LodArena(const LodArena &);
+        const LodArena &operator=(const LodArena &) const;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -28,8 +28,9 @@ namespace hal {
     };
 
     /* A block is a list of homolgous segments.  All these segments must
-     * be the same length.  The block's destructor will free all segments
-     * it contains.
+     * be the same length.  The segments (and the blocks themselves) are
+     * allocated from the graph's arenas, so the block doesn't free the
+     * segments it contains.
      */
     class LodBlock {
         friend std::ostream &operator<<(std::ostream &os, const LodBlock &block);
@@ -70,14 +71,16 @@ namespace hal {
         /** Insert new blocks as neighbours until all adjacencies have length
          * 0.  (if there are no self edges, at most 1 head block and 1 tail
          * block are created.  If there are self edges, it can take multiple
-         * blocks to reduce all the edge  lengths */
-        void insertNeighbours(std::vector<LodBlock *> &outList);
+         * blocks to reduce all the edge  lengths.  New blocks and segments
+         * are allocated from the given arenas */
+        void insertNeighbours(std::vector<LodBlock *> &outList, LodArena<LodBlock> &blockArena,
+                              LodArena<LodSegment> &segmentArena);
 
       protected:
         /** Create a new block and insert it as a neighbour.  All adjacencies
          * of this block become 0. */
-        LodBlock *insertNewTailNeighbour();
-        LodBlock *insertNewHeadNeighbour();
+        LodBlock *insertNewTailNeighbour(LodArena<LodBlock> &blockArena, LodArena<LodSegment> &segmentArena);
+        LodBlock *insertNewHeadNeighbour(LodArena<LodBlock> &blockArena, LodArena<LodSegment> &segmentArena);
 
         /** Get the maximum length to extend the block.  This is equivalent
          * to the minimum adjacency length, except that adjacencies between
@@ -93,6 +96,9 @@ namespace hal {
         hal_size_t getMaxHeadInsertionLen() const;
         hal_size_t getMaxTailInsertionLen() const;
 
+        /** Test if segment is in this block before pos */
+        bool isEarlierSegment(SegmentConstIterator pos, const LodSegment *segment) const;
+
         SegmentList _segments;
 
       private:
@@ -10,6 +10,7 @@
 
 #include "hal.h"
 #include "halLodGraph.h"
+#include "halParallel.h"
 #include <iostream>
 #include <map>
 #include <set>
@@ -27,7 +28,12 @@ namespace hal {
      *
      * The output alignment is created from an arbitrary subset of genomes from
      * the input, linked together in an arbitrary tree.  By default, the
-     * identical tree is used. */
+     * identical tree is used.
+     *
+     * The graphs of different internal nodes are independent, so with
+     * numThreads > 1 they are built concurrently from an input alignment
+     * opened with READ_SHARED_ACCESS, and written in order on the calling
+     * thread. */
     class LodExtract {
       public:
         LodExtract();
@@ -35,7 +41,8 @@ namespace hal {
 
         void createInterpolatedAlignment(AlignmentConstPtr inAlignment, AlignmentPtr outAlignment, double scale,
                                          const std::string &tree, const std::string &rootName, bool keepSequences,
-                                         bool allSequences, double probeFrac, double minSeqFrac);
+                                         bool allSequences, double probeFrac, double minSeqFrac,
+                                         hal_size_t numThreads = 1);
 
       protected:
         typedef std::set<const LodSegment *, LodSegmentPLess> SegmentSet;
@@ -43,7 +50,10 @@ namespace hal {
 
       protected:
         void createTree(const std::string &tree, const std::string &rootName);
-        void convertInternalNode(const std::string &genomeName, double scale);
+        LodGraph *buildGraph(const std::string &genomeName, const std::vector<std::string> &childNames, double scale,
+                             std::ostream &progress) const;
+        void convertInternalNode(const std::string &genomeName, const std::vector<std::string> &childNames,
+                                 LodGraph *graph);
         void countSegmentsInGraph(std::map<const Sequence *, hal_size_t> &segmentCounts);
         void writeDimensions(const std::map<const Sequence *, hal_size_t> &segmentCounts, const std::string &parentName,
                              const std::vector<std::string> &childNames);
@@ -60,7 +70,8 @@ namespace hal {
         AlignmentConstPtr _inAlignment;
         AlignmentPtr _outAlignment;
 
-        LodGraph _graph;
+        // graph of the internal node being written
+        LodGraph *_graph;
         bool _keepSequences;
         bool _allSequences;
         double _probeFrac;
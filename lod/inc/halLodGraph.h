@@ -9,6 +9,7 @@
 #define _HALLODGRAPH_H
 
 #include "hal.h"
+#include "halLodArena.h"
 #include "halLodBlock.h"
 #include "halLodSegment.h"
 #include <iostream>
@@ -21,8 +22,7 @@ namespace hal {
 
     class LodGraph {
       public:
-        typedef std::set<LodSegment *, LodSegmentPLess> SegmentSet;
-        typedef SegmentSet::iterator SegmentIterator;
+        typedef std::vector<LodSegment *> SegmentList;
 
         LodGraph();
         ~LodGraph();
@@ -31,15 +31,19 @@ namespace hal {
 
         const LodBlock *getBlock(hal_size_t index) const;
         hal_size_t getNumBlocks() const;
-        const SegmentSet *getSegmentSet(const Sequence *sequence) const;
+        /** Segments of a sequence, sorted by position, with its
+         * telomeres at either end */
+        const SegmentList *getSegmentList(const Sequence *sequence) const;
         const LodBlock *getTelomeres() const;
 
         /** Build the LOD graph for a given subtree of the alignment.  The
          * entire graph is stored in memory in a special structure (ie not within
          * HAL).  The step parameter dictates how coarse-grained the interpolation
-         * is:  every step bases are sampled.  */
+         * is:  every step bases are sampled.  The graph's dimensions after
+         * each pass are printed to progress.  */
         void build(AlignmentConstPtr alignment, const Genome *parent, const std::vector<const Genome *> &children,
-                   const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac);
+                   const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac,
+                   std::ostream &progress = std::cout);
 
         /** Help debuggin and tuning */
         void printDimensions(std::ostream &os) const;
@@ -54,7 +58,12 @@ namespace hal {
         typedef BlockList::iterator BlockIterator;
         typedef BlockList::const_iterator BlockConstIterator;
 
-        typedef std::map<const Sequence *, SegmentSet *> SequenceMap;
+        typedef std::set<LodSegment *, LodSegmentPLess> SegmentSet;
+        typedef SegmentSet::iterator SegmentIterator;
+        typedef std::map<const Sequence *, SegmentSet> ScanMap;
+        typedef ScanMap::iterator ScanMapIterator;
+
+        typedef std::map<const Sequence *, SegmentList> SequenceMap;
         typedef SequenceMap::iterator SequenceMapIterator;
 
         /** Read a HAL genome into sequence graph */
@@ -80,7 +89,11 @@ namespace hal {
         /** Add an entire sequence as unaliged segment */
         void createUnaligedSegment(const Sequence *sequence);
 
-        /** compute the adjacencies using the SegmentSets */
+        /** Replace the SegmentSets used while scanning by sorted
+         * SegmentLists */
+        void buildSegmentLists();
+
+        /** compute the adjacencies using the SegmentLists */
         void computeAdjacencies();
 
         /** First optimization pass: Maximally extend all blocks */
@@ -106,14 +119,20 @@ namespace hal {
         // fraction of edge to greedily extend
         double _extendFraction;
 
+        // all segments and blocks of the graph are allocated here
+        LodArena<LodSegment> _segmentArena;
+        LodArena<LodBlock> _blockArena;
+
         // the alignment blocks
         BlockList _blocks;
 
-        // the telomeres all get put in one block.  the block structure
-        // is used only to make sure they get freed.
+        // the telomeres all get put in one block.
         LodBlock _telomeres;
 
-        // nodes sorted by sequence
+        // nodes sorted by sequence, while scanning the genomes
+        ScanMap _scanMap;
+
+        // nodes sorted by sequence, once the genomes are scanned
         SequenceMap _seqMap;
 
         // sample all sequences no matter how small they are
@@ -137,9 +156,9 @@ namespace hal {
         return _blocks.size();
     }
 
-    inline const LodGraph::SegmentSet *LodGraph::getSegmentSet(const Sequence *sequence) const {
+    inline const LodGraph::SegmentList *LodGraph::getSegmentList(const Sequence *sequence) const {
         assert(_seqMap.find(sequence) != _seqMap.end());
-        return _seqMap.find(sequence)->second;
+        return &_seqMap.find(sequence)->second;
     }
 
     inline const LodBlock *LodGraph::getTelomeres() const {
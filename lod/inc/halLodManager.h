@@ -11,6 +11,7 @@
 #include "hal.h"
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -19,7 +20,8 @@ namespace hal {
     class CLParser;
 
     /** This is a container that keeps track of LOD alignments as generated
-     * by halLodExtract.py
+     * by halLodExtract.py.  Alignments are opened on first use; getAlignment()
+     * may be called from multiple threads.
      */
     class LodManager {
       public:
@@ -27,18 +29,22 @@ namespace hal {
         virtual ~LodManager();
 
         /** Load series of alignments specified in the lodPath file.  Options
-         * from the given CLParser are applied if specified.
+         * from the given CLParser are applied if specified.  If sharedAccess
+         * is true and all the files are mmap, they are opened with
+         * READ_SHARED_ACCESS, so they may be queried from several threads.
+         * This loads every genome when an alignment is opened, so it is only
+         * done when asked for.
          *
          * If the paths of the HAL files are relative (do not begin with /) then
          * they will be concatenated to the directory of lodPath.  If they
          * are absolute (beginning with /) then they will be opened directly.
          * Paths that contain ":/" are assumed to be
          * web addressed of some sort and considered absolute. */
-        void loadLODFile(const std::string &lodPath, const CLParser *options = NULL);
+        void loadLODFile(const std::string &lodPath, const CLParser *options = NULL, bool sharedAccess = false);
 
         /** Just use the given HAL file for everything.  Same as if we gave a
          * lodFile containing only "0 halPath"*/
-        void loadSingeHALFile(const std::string &halPath, const CLParser *options = NULL);
+        void loadSingeHALFile(const std::string &halPath, const CLParser *options = NULL, bool sharedAccess = false);
 
         AlignmentConstPtr getAlignment(hal_size_t queryLength, bool needDNA);
 
@@ -48,6 +54,13 @@ namespace hal {
         /** Any query greater than this is disabled */
         hal_size_t getMaxQueryLength() const;
 
+        /** Was shared access asked for and are all the alignments in mmap
+         * format, and so opened with READ_SHARED_ACCESS so that they may be
+         * queried concurrently? */
+        bool isSharedAccess() const {
+            return _sharedAccess;
+        }
+
         /** Maximum age of a URL in seconds such that we dont try to
          * preload headers for all the HAL files */
         static const unsigned long MaxAgeSec;
@@ -58,6 +71,7 @@ namespace hal {
       private:
         std::string resolvePath(const std::string &lodPath, const std::string &halPath);
         void checkMap(const std::string &lodPath);
+        bool detectSharedAccess() const;
         void checkAlignment(hal_size_t minQuery, const std::string &path, AlignmentConstPtr alignment);
         void preloadAlignments();
 
@@ -67,6 +81,8 @@ namespace hal {
         const CLParser *_options;
         AlignmentMap _map;
         hal_size_t _maxLodLowerBound;
+        bool _sharedAccess;
+        std::mutex _mutex; // protects opening of alignments
     };
 
     inline hal_size_t LodManager::getMaxQueryLength() const {
@@ -9,6 +9,7 @@
 #define _HALLODSEGMENT_H
 
 #include "hal.h"
+#include "halLodArena.h"
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
@@ -82,9 +83,9 @@ namespace hal {
          * will connect to whatever this's head connected to. The
          * new segment will have 0 distance from this segment, and
          * it's length is given by the parameter.  The new segment
-         * is then returned */
-        LodSegment *insertNewHeadAdj(LodBlock *block, hal_size_t newLen);
-        LodSegment *insertNewTailAdj(LodBlock *block, hal_size_t newLen);
+         * is allocated from arena and then returned */
+        LodSegment *insertNewHeadAdj(LodBlock *block, hal_size_t newLen, LodArena<LodSegment> &arena);
+        LodSegment *insertNewTailAdj(LodBlock *block, hal_size_t newLen, LodArena<LodSegment> &arena);
 
         /** Merge the head adjacency segment to this segment.  That segment
          * should then get taken out of consideration */
@@ -18,7 +18,8 @@ using namespace hal;
 static void initParser(CLParser &optionsParser) {
     optionsParser.addArgument("halFile", "input hal file");
     optionsParser.addArgument("mafFile", "output maf file (or \"stdout\" to "
-                                         "pipe to standard output)");
+                                         "pipe to standard output).  Written BGZF compressed "
+                                         "if the name ends in .gz or .bgz");
     optionsParser.addOption("refGenome", "name of reference genome (root if empty)", "");
     optionsParser.addOption("refSequence", "name of reference sequence within reference genome"
                                            " (all sequences if empty)",
@@ -63,6 +64,15 @@ static void initParser(CLParser &optionsParser) {
                                 false);
     optionsParser.addOptionFlag("keepEmptyRefBlocks", "keep blocks that contain no reference sequence",
                                 false);
+    optionsParser.addOption("numThreads", "number of threads used to convert the alignment.  Reference sequences "
+                                          "are converted in parallel and written in order.  With --unique, they are "
+                                          "also split into shards of --shardLength bases, and MAF blocks are broken "
+                                          "at shard boundaries. Requires an mmap HAL file. "
+                                          "Also the number of threads compressing .gz or .bgz output",
+                            1);
+    optionsParser.addOption("shardLength",
+                            "length of reference shards converted by each thread with --numThreads and --unique",
+                            MafExport::defaultShardLength);
 
     optionsParser.setDescription("Convert hal database to maf.");
 }
@@ -90,6 +100,8 @@ class MafOptions {
     bool onlyOrthologs;
     bool keepEmptyRefBlocks;
     hal_index_t maxBlockLen;
+    hal_size_t numThreads;
+    hal_size_t shardLength;
 };
 
 /* This empty string options specified using the old convention of '""' rather than
@@ -168,18 +180,8 @@ static void hal2maf(AlignmentConstPtr alignment, const MafOptions &opts) {
         }
     }
 
-    ios_base::openmode openFlags = ios_base::out;
-    if (opts.append == true) {
-        openFlags |= ios_base::app;
-    }
-    ofstream mafFileStream;
-    if (opts.mafPath != "stdout") {
-        mafFileStream.open(opts.mafPath, openFlags);
-        if (!mafFileStream) {
-            throw hal_exception("Error opening " + opts.mafPath);
-        }
-    }
-    ostream &mafStream = opts.mafPath != "stdout" ? mafFileStream : cout;
+    OutputFile mafFile(opts.mafPath, opts.numThreads, opts.append);
+    ostream &mafStream = mafFile.getStream();
 
     MafExport mafExport;
     mafExport.setMaxRefGap(opts.maxRefGap);
@@ -192,6 +194,8 @@ static void hal2maf(AlignmentConstPtr alignment, const MafOptions &opts) {
     mafExport.setPrintTree(opts.printTree);
     mafExport.setOnlyOrthologs(opts.onlyOrthologs);
     mafExport.setKeepEmptyRefBlocks(opts.keepEmptyRefBlocks);
+    mafExport.setNumThreads(opts.numThreads);
+    mafExport.setShardLength(opts.shardLength);
 
     if (opts.refTargetsPath != "") {
         hal2mafWithTargets(opts, alignment, refGenome, targetSet, mafExport, mafStream);
@@ -200,19 +204,17 @@ static void hal2maf(AlignmentConstPtr alignment, const MafOptions &opts) {
     } else if (refSequence != NULL) {
         mafExport.convertSequence(mafStream, alignment, refSequence, opts.start, opts.length, targetSet);
     } else {
-        for (SequenceIteratorPtr seqIt(refGenome->getSequenceIterator()); not seqIt->atEnd(); seqIt->toNext()) {
-            mafExport.convertSequence(mafStream, alignment, seqIt->getSequence(), opts.start, opts.length, targetSet);
-        }
+        mafExport.convertGenome(mafStream, alignment, refGenome, targetSet);
     }
-    if (opts.mafPath != "stdout") {
-        // dont want to leave a size 0 file when there's not ouput because
-        // it can make some scripts (ie that process a maf for each contig)
-        // obnoxious (presently the case for halPhlyoPTrain which uses
-        // hal2mafMP --splitBySequence). FIXME: this can also break stuff that
-        // has dependencies, so drop it.
-        if (mafFileStream.tellp() == (streampos)0) {
-            std::remove(opts.mafPath.c_str());
-        }
+    // dont want to leave a size 0 file when there's not ouput because
+    // it can make some scripts (ie that process a maf for each contig)
+    // obnoxious (presently the case for halPhlyoPTrain which uses
+    // hal2mafMP --splitBySequence). FIXME: this can also break stuff that
+    // has dependencies, so drop it.
+    bool emptyFile = !mafFile.isStdout() && mafStream.tellp() == (streampos)0;
+    mafFile.close();
+    if (emptyFile) {
+        std::remove(opts.mafPath.c_str());
     }
 }
 
@@ -242,6 +244,8 @@ int main(int argc, char **argv) {
         opts.maxBlockLen = optionsParser.getOption<hal_index_t>("maxBlockLen");
         opts.onlyOrthologs = optionsParser.getFlag("onlyOrthologs");
         opts.keepEmptyRefBlocks = optionsParser.getFlag("keepEmptyRefBlocks");
+        opts.numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        opts.shardLength = optionsParser.getOption<hal_size_t>("shardLength");
 
         if (((opts.length != 0) || (opts.start != 0)) && (opts.refSequenceName == "")) {
             throw hal_exception("--start and --length require --refSequenceName");
@@ -261,7 +265,8 @@ int main(int argc, char **argv) {
         exit(1);
     }
     try {
-        AlignmentConstPtr alignment(openHalAlignment(opts.halPath, &optionsParser));
+        AlignmentConstPtr alignment(
+            openHalAlignment(opts.halPath, &optionsParser, (opts.numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
         if (alignment->getNumGenomes() == 0) {
             throw hal_exception("hal alignmenet is empty");
         }
@@ -15,7 +15,7 @@ using namespace hal;
 
 const hal_index_t MafBlock::defaultMaxLength = 1000;
 
-MafBlock::MafBlock(hal_index_t maxLength) : _maxLength(maxLength), _fullNames(false), _tree(NULL) {
+MafBlock::MafBlock(hal_index_t maxLength) : _maxLength(maxLength), _numColumns(0), _fullNames(false), _tree(NULL) {
     if (_maxLength <= 0) {
         _maxLength = numeric_limits<hal_index_t>::max();
     }
@@ -36,6 +36,7 @@ MafBlock::~MafBlock() {
 void MafBlock::resetEntries() {
     _reference = NULL;
     _refIndex = NULL_INDEX;
+    _numColumns = 0;
     Entries::iterator i = _entries.begin();
     Entries::iterator next;
     MafBlockEntry *e;
@@ -72,7 +73,8 @@ void MafBlock::resetEntries() {
             e->_start = NULL_INDEX;
             e->_strand = '+';
             e->_length = 0;
-            e->_sequence->clear();
+            e->_runs.clear();
+            e->_numColumns = 0;
         }
         i = next;
     }
@@ -101,33 +103,65 @@ void MafBlock::initEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIter
         entry->_strand = '+';
     }
     if (clearSequence == true) {
-        entry->_sequence->clear();
+        entry->_runs.clear();
+        entry->_numColumns = 0;
     }
     entry->_tree = NULL;
 }
 
-inline void MafBlock::updateEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIteratorPtr dna) {
-    if (dna.get() != NULL) {
-        if (entry->_start == NULL_INDEX) {
-            initEntry(entry, sequence, dna, false);
-        }
-        assert(entry->_name == getName(sequence));
-        assert(entry->_strand == (dna->getReversed() ? '-' : '+'));
-        assert(entry->_srcLength == (hal_index_t)sequence->getSequenceLength());
+/* add the base of dna to the entry's row, in the block's next column.
+ * the row is only extended by a run, gaps are left for writeSequences() */
+inline void MafBlock::updateEntry(MafBlockEntry *entry, const Sequence *sequence, const DnaIteratorPtr &dna) {
+    if (entry->_start == NULL_INDEX) {
+        initEntry(entry, sequence, dna, false);
+    }
+    assert(entry->_genome == sequence->getGenome());
+    assert(entry->_strand == (dna->getReversed() ? '-' : '+'));
+    assert(entry->_srcLength == (hal_index_t)sequence->getSequenceLength());
 
-        ++entry->_length;
+    if (entry->_length == 0) {
+        entry->_dnaStart = dna->getArrayIndex();
+    }
+    ++entry->_length;
 
-        assert(dna->getReversed() == true ||
-               (hal_index_t)(dna->getArrayIndex() - sequence->getStartPosition()) ==
-                   (hal_index_t)(entry->_start + entry->_length - 1));
+    assert(dna->getReversed() == true ||
+           (hal_index_t)(dna->getArrayIndex() - sequence->getStartPosition()) ==
+               (hal_index_t)(entry->_start + entry->_length - 1));
 
-        assert(dna->getReversed() == false ||
-               (hal_index_t)(entry->_srcLength - 1 - (dna->getArrayIndex() - sequence->getStartPosition())) ==
-                   (hal_index_t)(entry->_start + entry->_length - 1));
+    assert(dna->getReversed() == false ||
+           (hal_index_t)(entry->_srcLength - 1 - (dna->getArrayIndex() - sequence->getStartPosition())) ==
+               (hal_index_t)(entry->_start + entry->_length - 1));
 
-        entry->_sequence->append(dna->getBase());
+    hal_size_t gaps = _numColumns - entry->_numColumns;
+    if (gaps == 0 && not entry->_runs.empty()) {
+        ++entry->_runs.back()._bases;
     } else {
-        entry->_sequence->append('-');
+        MafBlockRun run = {gaps, 1};
+        entry->_runs.push_back(run);
+    }
+    entry->_numColumns = _numColumns + 1;
+}
+
+/* write the rows of all entries from their runs: the bases of each entry
+ * are copied from the genome at once, and the gaps filled in between */
+void MafBlock::writeSequences() const {
+    for (Entries::const_iterator e = _entries.begin(); e != _entries.end(); ++e) {
+        MafBlockEntry *entry = e->second;
+        entry->_sequence->clear();
+        if (not entry->_runs.empty()) {
+            hal_index_t dnaFirst = entry->_strand == '+' ? entry->_dnaStart : entry->_dnaStart - (entry->_length - 1);
+            entry->_genome->getSubString(_dnaBuffer, dnaFirst, entry->_length);
+            if (entry->_strand == '-') {
+                reverseComplement(_dnaBuffer);
+            }
+        }
+        const char *bases = _dnaBuffer.data();
+        for (size_t i = 0; i < entry->_runs.size(); ++i) {
+            entry->_sequence->appendGaps(entry->_runs[i]._gaps);
+            entry->_sequence->append(bases, entry->_runs[i]._bases);
+            bases += entry->_runs[i]._bases;
+        }
+        entry->_sequence->appendGaps(_numColumns - entry->_numColumns);
     }
 }
 
@@ -367,6 +401,10 @@ void MafBlock::initBlock(ColumnIteratorPtr col, bool fullNames, bool printTree)
     }
 }
 
+/* add the bases of the column to their entries.  blocks are still built
+ * column by column from the column iterator, with an updateEntry() call
+ * per base, and that walk is most of the time hal2maf takes.  only the
+ * row strings are built from runs, in writeSequences(). */
 void MafBlock::appendColumn(ColumnIteratorPtr col) {
     const ColumnMap *colMap = col->getColumnMap();
     Entries::iterator e = _entries.begin();
@@ -374,24 +412,21 @@ void MafBlock::appendColumn(ColumnIteratorPtr col) {
     DNASet::const_iterator d;
     const Sequence *sequence;
 
+    // entries without a base in the column get their gap when the next
+    // base is added or when the rows are written
     for (; c != colMap->end(); ++c) {
         sequence = c->first;
         for (d = c->second->begin(); d != c->second->end(); ++d) {
-            while (e->first != sequence && e != _entries.end()) {
-                updateEntry(e->second, NULL, DnaIteratorPtr());
+            while (e != _entries.end() && e->first != sequence) {
                 ++e;
             }
             assert(e != _entries.end());
             assert(e->first == sequence);
-            assert(e->second->_name == getName(sequence));
             updateEntry(e->second, sequence, *d);
             ++e;
         }
     }
-
-    for (; e != _entries.end(); ++e) {
-        updateEntry(e->second, NULL, DnaIteratorPtr());
-    }
+    ++_numColumns;
 }
 
 // Q: When can we append a column?
@@ -482,6 +517,8 @@ static void printTreeEntries(stTree *tree, ostream &os) {
 }
 
 ostream &MafBlock::printBlockWithTree(ostream &os) const {
+    writeSequences();
+
     // Sort tree so that the reference comes first.
     prioritizeNodeInTree(_reference->_tree);
 
@@ -497,6 +534,7 @@ ostream &MafBlock::printBlockWithTree(ostream &os) const {
 
 // todo: fast way of reference first.
 ostream &MafBlock::printBlock(ostream &os) const {
+    writeSequences();
     os << "a\n";
 
     assert(_reference != NULL);
@@ -8,10 +8,25 @@
 #include "halMafExport.h"
 #include <cassert>
 #include <deque>
+#include <sstream>
 
 using namespace std;
 using namespace hal;
 
+const hal_size_t MafExport::defaultShardLength = 1000000;
+
+/* check if a column has no bases, which happens when toSite() finds every
+ * site in its range was already visited */
+static bool isEmptyColumn(ColumnIteratorPtr colIt) {
+    const ColumnIterator::ColumnMap *colMap = colIt->getColumnMap();
+    for (ColumnIterator::ColumnMap::const_iterator i = colMap->begin(); i != colMap->end(); ++i) {
+        if (not i->second->empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void MafExport::writeHeader() {
     assert(_mafStream != NULL);
     // sometimes tellp() returns -1
@@ -43,58 +58,119 @@ void MafExport::convertSequence(ostream &mafStream, AlignmentConstPtr alignment,
         writeHeader();
     }
 
+    if (_numThreads > 1) {
+        vector<Shard> shards;
+        addShards(shards, seq, startPosition, length);
+        convertShards(mafStream, shards, targets);
+    } else {
+        convertRange(mafStream, _mafBlock, seq, startPosition, lastPosition, targets, _unique);
+    }
+}
+
+void MafExport::convertGenome(ostream &mafStream, AlignmentConstPtr alignment, const Genome *genome,
+                              const set<const Genome *> &targets) {
+    if (_numThreads <= 1) {
+        for (SequenceIteratorPtr seqIt(genome->getSequenceIterator()); not seqIt->atEnd(); seqIt->toNext()) {
+            convertSequence(mafStream, alignment, seqIt->getSequence(), 0, 0, targets);
+        }
+        return;
+    }
+    _mafStream = &mafStream;
+    _alignment = alignment;
+    if (!_append) {
+        writeHeader();
+    }
+    vector<Shard> shards;
+    for (SequenceIteratorPtr seqIt(genome->getSequenceIterator()); not seqIt->atEnd(); seqIt->toNext()) {
+        const Sequence *seq = seqIt->getSequence();
+        if (seq->getSequenceLength() > 0) {
+            addShards(shards, seq, 0, seq->getSequenceLength());
+        }
+    }
+    convertShards(mafStream, shards, targets);
+}
+
+void MafExport::addShards(vector<Shard> &shards, const Sequence *seq, hal_index_t startPosition, hal_size_t length) {
+    hal_index_t endPosition = startPosition + (hal_index_t)length;
+    // without unique, a range can't be split: a column is written from every
+    // range it touches, so the pieces wouldn't add up to the whole range.
+    vector<hal_index_t> shardStarts = shardRange(startPosition, length, _unique ? _shardLength : length);
+    for (size_t i = 0; i < shardStarts.size(); ++i) {
+        Shard shard;
+        shard._sequence = seq;
+        shard._start = shardStarts[i];
+        shard._last = ((i + 1 < shardStarts.size()) ? shardStarts[i + 1] : endPosition) - 1;
+        shards.push_back(shard);
+    }
+}
+
+void MafExport::convertShards(ostream &mafStream, const vector<Shard> &shards, const set<const Genome *> &targets) {
+    checkSharedAccess(_alignment.get());
+    auto convertShard = [&](size_t i, string &output) {
+        const Shard &shard = shards[i];
+        ostringstream shardStream;
+        MafBlock mafBlock;
+        mafBlock.setMaxLength(_maxBlockLength);
+        convertRange(shardStream, mafBlock, shard._sequence, shard._start, shard._last, targets, _unique);
+        output = shardStream.str();
+    };
+    auto writeShard = [&](size_t i, string &output) { mafStream << output; };
+    runOrderedTasks(shards.size(), _numThreads, convertShard, writeShard);
+    mafStream.flush();
+}
+
+/* convert range of a sequence, which is in sequence coordinates */
+void MafExport::convertRange(ostream &mafStream, MafBlock &mafBlock, const Sequence *seq, hal_index_t startPosition,
+                             hal_index_t lastPosition, const set<const Genome *> &targets, bool unique) {
     ColumnIteratorPtr colIt = seq->getColumnIterator(&targets, _maxRefGap, startPosition, lastPosition, _noDupes, _noAncestors,
                                                      false, // reverseStrand,
-                                                     _unique,
+                                                     unique,
                                                      _onlyOrthologs);
 
     hal_size_t appendCount = 0;
-    if (_unique == false || colIt->isCanonicalOnRef() == true) {
-        _mafBlock.initBlock(colIt, _ucscNames, _printTree);
-        assert(_mafBlock.canAppendColumn(colIt) == true);
-        _mafBlock.appendColumn(colIt);
+    if (unique == false || colIt->isCanonicalOnRef() == true) {
+        mafBlock.initBlock(colIt, _ucscNames, _printTree);
+        assert(mafBlock.canAppendColumn(colIt) == true);
+        mafBlock.appendColumn(colIt);
         ++appendCount;
     }
-    size_t numBlocks = 0;
     while (colIt->lastColumn() == false) {
         colIt->toRight();
-        if (_unique == false || colIt->isCanonicalOnRef() == true) {
+        if (unique == false || colIt->isCanonicalOnRef() == true) {
             if (appendCount == 0) {
-                _mafBlock.initBlock(colIt, _ucscNames, _printTree);
-                assert(_mafBlock.canAppendColumn(colIt) == true);
+                mafBlock.initBlock(colIt, _ucscNames, _printTree);
+                assert(mafBlock.canAppendColumn(colIt) == true);
             }
-            if (_mafBlock.canAppendColumn(colIt) == false) {
-                // erase empty entries from the column.  helps when there are
-                // millions of sequences (ie from fastas with lots of scaffolds)
-                if (numBlocks++ % 1000 == 0) {
-                    colIt->defragment();
-                }
-                if ((appendCount > 0) and (_keepEmptyRefBlocks or (not _mafBlock.referenceIsAllGaps()))) {
-                    mafStream << _mafBlock << '\n';
+            if (mafBlock.canAppendColumn(colIt) == false) {
+                if ((appendCount > 0) and (_keepEmptyRefBlocks or (not mafBlock.referenceIsAllGaps()))) {
+                    mafStream << mafBlock << '\n';
                 }
-                _mafBlock.initBlock(colIt, _ucscNames, _printTree);
-                assert(_mafBlock.canAppendColumn(colIt) == true);
+                mafBlock.initBlock(colIt, _ucscNames, _printTree);
+                assert(mafBlock.canAppendColumn(colIt) == true);
             }
-            _mafBlock.appendColumn(colIt);
+            mafBlock.appendColumn(colIt);
             ++appendCount;
         }
     }
     // if nothing was ever added (seems to happen in corner case where
     // all columns violate unique), mafBlock ostream operator will crash
     // so we do following check
-    if ((appendCount > 0) and (_keepEmptyRefBlocks or (not _mafBlock.referenceIsAllGaps()))) {
-        mafStream << _mafBlock << endl;
+    if ((appendCount > 0) and (_keepEmptyRefBlocks or (not mafBlock.referenceIsAllGaps()))) {
+        mafStream << mafBlock << endl;
     }
 }
 
 void MafExport::convertEntireAlignment(ostream &mafStream, AlignmentConstPtr alignment) {
     hal_size_t appendCount = 0;
-    size_t numBlocks = 0;
 
     _mafStream = &mafStream;
     _alignment = alignment;
 
     writeHeader();
+    if (_numThreads > 1) {
+        convertEntireAlignmentThreaded(mafStream);
+        return;
+    }
 
     // Load in all leaves from alignment
     vector<const Genome *> leafGenomes = getLeafGenomes(alignment.get());
@@ -113,16 +189,14 @@ void MafExport::convertEntireAlignment(ostream &mafStream, AlignmentConstPtr ali
         // already been visited.
         colIt->toSite(0, genome->getSequenceLength() - 1);
         for (;;) {
+            if (isEmptyColumn(colIt)) {
+                break; // everything was already visited
+            }
             if (appendCount == 0) {
                 _mafBlock.initBlock(colIt, _ucscNames, _printTree);
                 assert(_mafBlock.canAppendColumn(colIt) == true);
             }
             if (_mafBlock.canAppendColumn(colIt) == false) {
-                // erase empty entries from the column.  helps when there are
-                // millions of sequences (ie from fastas with lots of scaffolds)
-                if (numBlocks++ % 1000 == 0) {
-                    colIt->defragment();
-                }
                 if (appendCount > 0) {
                     mafStream << _mafBlock << '\n';
                 }
@@ -156,3 +230,102 @@ void MafExport::convertEntireAlignment(ostream &mafStream, AlignmentConstPtr ali
         mafStream << _mafBlock << endl;
     }
 }
+
+/* Leaf genomes must still be done one after the other, since each one skips
+ * the columns visited by the previous ones, however each genome is split into
+ * shards that run concurrently, starting from a copy of the visit cache. The
+ * caches of all shards are then merged for use by the next genome. */
+void MafExport::convertEntireAlignmentThreaded(ostream &mafStream) {
+    checkSharedAccess(_alignment.get());
+    vector<const Genome *> leafGenomes = getLeafGenomes(_alignment.get());
+
+    ColumnIterator::VisitCache visitCache;
+    for (hal_size_t i = 0; i < leafGenomes.size(); i++) {
+        const Genome *genome = leafGenomes[i];
+        hal_size_t genomeLength = genome->getSequenceLength();
+        if (genomeLength == 0) {
+            continue;
+        }
+        ColumnIterator::VisitCache genomeVisitCache;
+        for (ColumnIterator::VisitCache::iterator it = visitCache.begin(); it != visitCache.end(); it++) {
+            genomeVisitCache[it->first] = new PositionCache(*it->second);
+        }
+        mutex genomeVisitCacheMutex;
+        vector<hal_index_t> shardStarts = shardRange(0, genomeLength, _shardLength);
+        auto convertShard = [&](size_t j, string &output) {
+            hal_index_t lastPosition = ((j + 1 < shardStarts.size()) ? shardStarts[j + 1] : (hal_index_t)genomeLength) - 1;
+            ostringstream shardStream;
+            convertLeafShard(shardStream, genome, shardStarts[j], lastPosition, visitCache, genomeVisitCache,
+                             genomeVisitCacheMutex);
+            output = shardStream.str();
+        };
+        auto writeShard = [&](size_t j, string &output) { mafStream << output; };
+        runOrderedTasks(shardStarts.size(), _numThreads, convertShard, writeShard);
+
+        for (ColumnIterator::VisitCache::iterator it = visitCache.begin(); it != visitCache.end(); it++) {
+            delete it->second;
+        }
+        visitCache.swap(genomeVisitCache);
+    }
+    for (ColumnIterator::VisitCache::iterator it = visitCache.begin(); it != visitCache.end(); it++) {
+        delete it->second;
+    }
+    mafStream.flush();
+}
+
+/* Convert columns of a leaf genome in the range [startPosition, lastPosition]
+ * (genome coordinates) that were not visited in previous genomes.  Columns are
+ * only reported by the shard containing their left-most base in this
+ * genome. */
+void MafExport::convertLeafShard(ostream &mafStream, const Genome *genome, hal_index_t startPosition,
+                                 hal_index_t lastPosition, const ColumnIterator::VisitCache &visitCache,
+                                 ColumnIterator::VisitCache &genomeVisitCache, mutex &genomeVisitCacheMutex) {
+    MafBlock mafBlock;
+    mafBlock.setMaxLength(_maxBlockLength);
+    ColumnIteratorPtr colIt = genome->getColumnIterator(NULL, 0, startPosition, lastPosition, _noDupes, _noAncestors,
+                                                        false, // reverseStrand
+                                                        true,  // unique
+                                                        _onlyOrthologs);
+    // the iterator takes ownership of the copy
+    ColumnIterator::VisitCache shardVisitCache;
+    for (ColumnIterator::VisitCache::const_iterator it = visitCache.begin(); it != visitCache.end(); it++) {
+        shardVisitCache[it->first] = new PositionCache(*it->second);
+    }
+    colIt->setVisitCache(&shardVisitCache);
+    colIt->toSite(startPosition, lastPosition);
+
+    hal_size_t appendCount = 0;
+    for (;;) {
+        if ((not isEmptyColumn(colIt)) and colIt->isCanonicalOnRef()) {
+            if (appendCount == 0) {
+                mafBlock.initBlock(colIt, _ucscNames, _printTree);
+                assert(mafBlock.canAppendColumn(colIt) == true);
+            }
+            if (mafBlock.canAppendColumn(colIt) == false) {
+                mafStream << mafBlock << '\n';
+                mafBlock.initBlock(colIt, _ucscNames, _printTree);
+                assert(mafBlock.canAppendColumn(colIt) == true);
+            }
+            mafBlock.appendColumn(colIt);
+            appendCount++;
+        }
+        if (colIt->lastColumn()) {
+            break;
+        }
+        colIt->toRight();
+    }
+    if (appendCount > 0) {
+        mafStream << mafBlock << '\n';
+    }
+
+    lock_guard<mutex> lock(genomeVisitCacheMutex);
+    ColumnIterator::VisitCache *newVisitCache = colIt->getVisitCache();
+    for (ColumnIterator::VisitCache::iterator it = newVisitCache->begin(); it != newVisitCache->end(); it++) {
+        ColumnIterator::VisitCache::iterator cacheIt = genomeVisitCache.find(it->first);
+        if (cacheIt == genomeVisitCache.end()) {
+            genomeVisitCache[it->first] = new PositionCache(*it->second);
+        } else {
+            cacheIt->second->merge(*it->second);
+        }
+    }
+}
@@ -11,6 +11,7 @@
 #include "hal.h"
 #include "sonLib.h"
 #include <cstdlib>
+#include <cstring>
 #include <deque>
 #include <iostream>
 #include <map>
@@ -41,6 +42,16 @@ namespace hal {
             }
             _buf[_len++] = c;
         }
+        void append(const char *s, size_t n) {
+            reserve(_len + n);
+            memcpy(_buf + _len, s, n);
+            _len += n;
+        }
+        void appendGaps(size_t n) {
+            reserve(_len + n);
+            memset(_buf + _len, '-', n);
+            _len += n;
+        }
 
         void clear() {
             _len = 0;
@@ -51,6 +62,11 @@ namespace hal {
         }
 
       private:
+        void reserve(size_t cap) {
+            while (_cap < cap) {
+                growBuf();
+            }
+        }
         void growBuf() {
             // always allow for zero-byte terminator
             _cap = (_cap + 1) * 2 - 1;
@@ -67,11 +83,17 @@ namespace hal {
         size_t _len;
     };
 
+    /* a run of gap columns followed by a run of bases in a block row */
+    struct MafBlockRun {
+        hal_size_t _gaps;
+        hal_size_t _bases;
+    };
+
     struct MafBlockEntry {
         // we hack to keep a global buffer list to reduce
         // allocs and frees as entries get created and destroyed
         inline MafBlockEntry(std::vector<MafBlockString *> &buffers)
-            : _buffers(buffers), _genome(NULL), _lastUsed(0) {
+            : _buffers(buffers), _genome(NULL), _lastUsed(0), _numColumns(0) {
             if (_buffers.empty() == false) {
                 _sequence = _buffers.back();
                 _buffers.pop_back();
@@ -91,14 +113,9 @@ namespace hal {
             }
         }
 
-        /* is the string all gaps */
+        /* is the row all gaps */
         bool allGaps() const {
-            for (const char *p = _sequence->str(); *p != '\0'; p++) {
-                if (*p != '-') {
-                    return false;
-                }
-            }
-            return true;
+            return _runs.empty();
         }
 
         std::vector<MafBlockString *> &_buffers;
@@ -109,6 +126,12 @@ namespace hal {
         char _strand;
         short _lastUsed;
         hal_index_t _srcLength;
+        // the row is built as runs of gaps and bases, the bases being
+        // contiguous in the genome from _dnaStart, and is only written
+        // to _sequence when the block is printed
+        std::vector<MafBlockRun> _runs;
+        hal_size_t _numColumns;
+        hal_index_t _dnaStart;
         MafBlockString *_sequence;
         // The node corresponding to this entry (if we are printing trees)
         stTree *_tree;
@@ -148,7 +171,8 @@ namespace hal {
       protected:
         void resetEntries();
         void initEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIteratorPtr dna, bool clearSequence = true);
-        void updateEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIteratorPtr dna);
+        void updateEntry(MafBlockEntry *entry, const Sequence *sequence, const DnaIteratorPtr &dna);
+        void writeSequences() const;
         stTree *buildTree(ColumnIteratorPtr colIt, bool modifyEntries);
         void buildTreeR(BottomSegmentIteratorPtr botIt, stTree *tree, bool modifyEntries);
         stTree *getTreeNode(SegmentIteratorPtr segIt, bool modifyEntries);
@@ -162,6 +186,9 @@ namespace hal {
         std::vector<MafBlockString *> _stringBuffers;
         hal_index_t _maxLength;
         hal_index_t _refIndex;
+        // number of columns appended to the block
+        hal_size_t _numColumns;
+        mutable std::string _dnaBuffer;
         bool _fullNames;
         bool _printTree;
         stTree *_tree;
@@ -10,6 +10,7 @@
 
 #include "halMafBlock.h"
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -18,10 +19,14 @@ namespace hal {
 
     class MafExport {
       public:
+        /* default size of the reference chunks handed to each thread */
+        static const hal_size_t defaultShardLength;
+
         MafExport():
             _mafStream(NULL), _maxRefGap(0), _noDupes(false), _noAncestors(false),
             _ucscNames(false), _unique(false), _append(false), _printTree(false),
-            _onlyOrthologs(false), _keepEmptyRefBlocks(false) {
+            _onlyOrthologs(false), _keepEmptyRefBlocks(false), _maxBlockLength(MafBlock::defaultMaxLength),
+            _numThreads(1), _shardLength(defaultShardLength) {
         }
         
         virtual ~MafExport() {
@@ -30,10 +35,19 @@ namespace hal {
         void convertSequence(std::ostream &mafStream, AlignmentConstPtr alignment, const Sequence *seq,
                              hal_index_t startPosition, hal_size_t length, const std::set<const Genome *> &targets);
 
+        // Convert all sequences of the reference genome, as if convertSequence
+        // was called on each one.  With multiple threads, all sequences are
+        // sharded together so that small scaffolds are also run in parallel.
+        void convertGenome(std::ostream &mafStream, AlignmentConstPtr alignment, const Genome *genome,
+                           const std::set<const Genome *> &targets);
+
         // Convert all columns in the leaf genomes to MAF. Each column is
         // reported exactly once regardless of the unique setting, although
         // this may change in the future. Likewise, maxRefGap has no
-        // effect, although noDupes will work.
+        // effect, although noDupes will work.  With multiple threads, leaf
+        // genomes are still visited in order, but each is split into shards;
+        // columns reached from two shards only through duplications may
+        // then be reported by both.
         void convertEntireAlignment(std::ostream &mafStream, AlignmentConstPtr alignment);
 
         void setMaxRefGap(hal_size_t maxRefGap) {
@@ -55,6 +69,7 @@ namespace hal {
             _append = append;
         }
         void setMaxBlockLength(hal_index_t maxLength) {
+            _maxBlockLength = maxLength;
             _mafBlock.setMaxLength(maxLength);
         }
         void setPrintTree(bool printTree) {
@@ -67,8 +82,40 @@ namespace hal {
             _keepEmptyRefBlocks = keepEmptyRefBlocks;
         }
 
+        // With more than one thread, reference sequences are converted
+        // concurrently, each with its own column iterator on the shared
+        // alignment, and written in reference order.  With unique set,
+        // sequences are also split into shards of shardLength bases.  MAF
+        // blocks are then broken at shard boundaries, and columns are
+        // assigned to the shard containing their left-most reference base,
+        // so the output is equivalent to concatenating hal2mafMP.py slices.
+        // Without unique, the output is the same as with one thread.
+        // Requires an alignment opened with READ_SHARED_ACCESS.
+        void setNumThreads(hal_size_t numThreads) {
+            _numThreads = numThreads;
+        }
+        void setShardLength(hal_size_t shardLength) {
+            _shardLength = shardLength;
+        }
+
       protected:
+        // a piece of the reference converted by a single column iterator
+        struct Shard {
+            const Sequence *_sequence;
+            hal_index_t _start; // sequence coordinates
+            hal_index_t _last;
+        };
+
         void writeHeader();
+        void convertShards(std::ostream &mafStream, const std::vector<Shard> &shards,
+                           const std::set<const Genome *> &targets);
+        void addShards(std::vector<Shard> &shards, const Sequence *seq, hal_index_t startPosition, hal_size_t length);
+        void convertRange(std::ostream &mafStream, MafBlock &mafBlock, const Sequence *seq, hal_index_t startPosition,
+                          hal_index_t lastPosition, const std::set<const Genome *> &targets, bool unique);
+        void convertEntireAlignmentThreaded(std::ostream &mafStream);
+        void convertLeafShard(std::ostream &mafStream, const Genome *genome, hal_index_t startPosition,
+                              hal_index_t lastPosition, const ColumnIterator::VisitCache &visitCache,
+                              ColumnIterator::VisitCache &genomeVisitCache, std::mutex &genomeVisitCacheMutex);
 
       protected:
         AlignmentConstPtr _alignment;
@@ -83,6 +130,9 @@ namespace hal {
         bool _printTree;
         bool _onlyOrthologs;
         bool _keepEmptyRefBlocks;
+        hal_index_t _maxBlockLength;
+        hal_size_t _numThreads;
+        hal_size_t _shardLength;
     };
 }
 
@@ -11,12 +11,41 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <unordered_set>
 
 using namespace std;
 using namespace hal;
 
-static void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames);
+static const hal_size_t DefaultShardLength = 10000000;
+
+/* a genome converted to PAF.  The bottom segments of its parent with
+ * paralogous children are found by the first of its shards to run and
+ * shared by the others */
+struct PafGenome {
+    string name;
+    size_t lastShard;
+    once_flag parentSetOnce;
+    unordered_set<hal_index_t> parentSet;
+    bool foundMatch;
+};
+
+/* range of top segments of a genome converted by one task.  Shards start
+ * at sequence boundaries, which PAF lines never cross, so the output
+ * doesn't depend on them.  endIndex is NULL_INDEX for the end of the
+ * genome */
+struct PafShard {
+    size_t genomeIndex;
+    hal_index_t startIndex;
+    hal_index_t endIndex;
+    bool foundMatch;
+};
+
+static void getParentSet(const Genome *genome, unordered_set<hal_index_t> &parentSet);
+static bool genome2PAF(ostream &outStream, const Genome *genome, const unordered_set<hal_index_t> &parentSet,
+                       hal_index_t startIndex, hal_index_t endIndex, bool fullNames);
 
 static void initParser(CLParser &optionsParser) {
     optionsParser.addArgument("inHalPath", "input hal file");
@@ -28,9 +57,36 @@ static void initParser(CLParser &optionsParser) {
                                 "for output names.  By default, the UCSC convention of Genome.Sequence "
                                 "is used",
                                 false);
+    optionsParser.addOption("outPaf", "output PAF file (stdout if none).  Written BGZF compressed if the name "
+                            "ends in .gz or .bgz",
+                            "stdout");
+    optionsParser.addOption("numThreads", "number of threads used to convert the branches.  Genomes are split "
+                            "into shards of whole sequences of about --shardLength bases, which are written in "
+                            "order.  Requires an mmap HAL file.  Also the number of threads compressing .gz or "
+                            ".bgz output",
+                            1);
+    optionsParser.addOption("shardLength", "length of genome shards converted by each thread with --numThreads",
+                            DefaultShardLength);
     optionsParser.setDescription("Export pairwise alignment (with no softclips) of each branch to PAF");
 }
 
+/* split a genome into shards of whole sequences of at least shardLength
+ * bases (except the last) */
+static void addGenomeShards(const Genome *genome, size_t genomeIndex, hal_size_t shardLength, vector<PafShard> &shards) {
+    hal_index_t startIndex = 0;
+    hal_size_t length = 0;
+    for (SequenceIteratorPtr seqIt = genome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
+        const Sequence *sequence = seqIt->getSequence();
+        if (length >= shardLength && sequence->getNumTopSegments() > 0) {
+            shards.push_back({genomeIndex, startIndex, sequence->getTopSegmentArrayIndex(), false});
+            startIndex = sequence->getTopSegmentArrayIndex();
+            length = 0;
+        }
+        length += sequence->getSequenceLength();
+    }
+    shards.push_back({genomeIndex, startIndex, (hal_index_t)genome->getNumTopSegments(), false});
+}
+
 int main(int argc, char **argv) {
     CLParser optionsParser;
     initParser(optionsParser);
@@ -38,12 +94,21 @@ int main(int argc, char **argv) {
     string halPath;
     string rootGenomeName;
     bool fullNames;
+    string pafPath;
+    hal_size_t numThreads;
+    hal_size_t shardLength;
 
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("inHalPath");
         rootGenomeName = optionsParser.getOption<string>("rootGenome");
         fullNames = !optionsParser.getFlag("onlySequenceNames");
+        pafPath = optionsParser.getOption<string>("outPaf");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        shardLength = optionsParser.getOption<hal_size_t>("shardLength");
+        if (shardLength == 0) {
+            throw hal_exception("--shardLength must be greater than 0");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -51,7 +116,8 @@ int main(int argc, char **argv) {
     }
 
     try {
-        AlignmentConstPtr alignment(openHalAlignment(halPath, &optionsParser));
+        AlignmentConstPtr alignment(
+            openHalAlignment(halPath, &optionsParser, (numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
         if (alignment->getNumGenomes() == 0) {
             throw hal_exception("input hal alignmenet is empty");
         }
@@ -68,30 +134,68 @@ int main(int argc, char **argv) {
             throw hal_exception(string("Root genome, ") + rootGenomeName + 
                                 ", not found in alignment");
         }
-        const Genome* parentGenome = rootGenome;
 
+        // genomes below the root, breadth first
+        vector<unique_ptr<PafGenome>> genomes;
         vector<string> childs = alignment->getChildNames(rootGenome->getName());
         deque<string> queue(childs.begin(), childs.end());
-
         while (!queue.empty()) {
-            string childName = queue.front();
+            genomes.push_back(unique_ptr<PafGenome>(new PafGenome()));
+            genomes.back()->name = queue.front();
+            genomes.back()->foundMatch = false;
             queue.pop_front();
-            const Genome* childGenome = alignment->openGenome(childName);
-            string parentName = alignment->getParentName(childName);
-            if (parentName != parentGenome->getName()) {
-                alignment->closeGenome(parentGenome);
-                parentGenome = childGenome->getParent();
-            }
-
-            genome2PAF(cout, childGenome, fullNames);
+            childs = alignment->getChildNames(genomes.back()->name);
+            queue.insert(queue.end(), childs.begin(), childs.end());
+        }
 
-            childs = alignment->getChildNames(childName);
-            for (int i = 0; i < childs.size(); ++i) {
-                queue.push_back(childs[i]);
+        // a single thread converts whole genomes, which only need to be
+        // opened when they're converted
+        vector<PafShard> shards;
+        if (numThreads > 1) {
+            checkSharedAccess(alignment.get());
+        }
+        for (size_t i = 0; i < genomes.size(); ++i) {
+            if (numThreads > 1) {
+                addGenomeShards(alignment->openGenome(genomes[i]->name), i, shardLength, shards);
+            } else {
+                shards.push_back({i, 0, NULL_INDEX, false});
             }
-
-            alignment->closeGenome(childGenome);
+            genomes[i]->lastShard = shards.size() - 1;
         }
+
+        OutputFile pafFile(pafPath, numThreads);
+        auto convertShard = [&](size_t i, string &output) {
+            PafShard &shard = shards[i];
+            PafGenome &pafGenome = *genomes[shard.genomeIndex];
+            const Genome *genome = alignment->openGenome(pafGenome.name);
+            call_once(pafGenome.parentSetOnce, getParentSet, genome, ref(pafGenome.parentSet));
+            hal_index_t endIndex = shard.endIndex != NULL_INDEX ? shard.endIndex : genome->getNumTopSegments();
+            stringstream outStream;
+            shard.foundMatch = genome2PAF(outStream, genome, pafGenome.parentSet, shard.startIndex, endIndex, fullNames);
+            output = outStream.str();
+        };
+        auto writeShard = [&](size_t i, string &output) {
+            pafFile.getStream() << output;
+            PafGenome &pafGenome = *genomes[shards[i].genomeIndex];
+            pafGenome.foundMatch = pafGenome.foundMatch || shards[i].foundMatch;
+            if (i == pafGenome.lastShard) {
+                if (!pafGenome.foundMatch) {
+                    cerr << "Warning [hal2paf]: no alignment blocks found for genome " << pafGenome.name << endl;
+                }
+                unordered_set<hal_index_t>().swap(pafGenome.parentSet);
+                // all of the genome's shards are done (closing does nothing
+                // for a shared alignment)
+                const Genome *genome = alignment->openGenome(pafGenome.name);
+                const Genome *parentGenome = genome->getParent();
+                alignment->closeGenome(genome);
+                if (shards[i].genomeIndex + 1 == genomes.size() ||
+                    alignment->getParentName(genomes[shards[i].genomeIndex + 1]->name) != parentGenome->getName()) {
+                    alignment->closeGenome(parentGenome);
+                }
+            }
+        };
+        runOrderedTasks(shards.size(), numThreads, convertShard, writeShard);
+        pafFile.close();
     }
     catch(exception& e) {
         cerr << e.what() << endl;
@@ -102,15 +206,25 @@ int main(int argc, char **argv) {
     return 0;
 }
 
-/// scan to next match, returning false if not found
+/* find the bottom segments of the parent that have paralogous children in
+ * the genome */
+static void getParentSet(const Genome *genome, unordered_set<hal_index_t> &parentSet) {
+    for (TopSegmentIteratorPtr topIt = genome->getTopSegmentIterator(); not topIt->atEnd(); topIt->toRight()) {
+        if (topIt->tseg()->hasNextParalogy() && topIt->tseg()->isCanonicalParalog()) {
+            parentSet.insert(topIt->tseg()->getParentIndex());
+        }
+    }
+}
+
+/// scan to next match before endIndex, returning false if not found
 static bool nextMatch(const TopSegmentIteratorPtr& topIt1, const BottomSegmentIteratorPtr& botIt1,
-                      TopSegmentIteratorPtr& topIt2,  BottomSegmentIteratorPtr& botIt2) {
+                      TopSegmentIteratorPtr& topIt2,  BottomSegmentIteratorPtr& botIt2, hal_index_t endIndex) {
     // set the second iterators to match the first, without re-allocating
     topIt2->copy(topIt1);
     botIt2->copy(botIt2);
 
     // scan til next match
-    for (topIt2->toRight(); not topIt2->atEnd(); topIt2->toRight()) {
+    for (topIt2->toRight(); topIt2->getArrayIndex() < endIndex; topIt2->toRight()) {
         if (topIt2->tseg()->hasParent()) {
             // return on any kind of match
             botIt2->toParent(topIt2);
@@ -193,24 +307,21 @@ static size_t countSnps(TopSegmentIteratorPtr& topIt, BottomSegmentIteratorPtr&
     return num_snps;
 }
 
-void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames) {
-    TopSegmentIteratorPtr topIt1 = genome->getTopSegmentIterator();
-    TopSegmentIteratorPtr topIt2 = genome->getTopSegmentIterator();
-    TopSegmentIteratorPtr topIt3 = genome->getTopSegmentIterator();
+/// write the PAF lines starting in top segments [startIndex, endIndex) of
+/// the genome, returning false if there are none
+bool genome2PAF(ostream &outStream, const Genome *genome, const unordered_set<hal_index_t> &parentSet,
+                hal_index_t startIndex, hal_index_t endIndex, bool fullNames) {
+    if (startIndex >= endIndex) {
+        return false;
+    }
+    TopSegmentIteratorPtr topIt1 = genome->getTopSegmentIterator(startIndex);
+    TopSegmentIteratorPtr topIt2 = genome->getTopSegmentIterator(startIndex);
+    TopSegmentIteratorPtr topIt3 = genome->getTopSegmentIterator(startIndex);
     BottomSegmentIteratorPtr botIt1 = genome->getParent()->getBottomSegmentIterator();
     BottomSegmentIteratorPtr botIt2 = genome->getParent()->getBottomSegmentIterator();
     BottomSegmentIteratorPtr botIt3 = genome->getParent()->getBottomSegmentIterator();
     bool found_match = false;
 
-    // this is used to remember which bottom segments have children in presence of duplications
-    unordered_set<hal_index_t> parentSet;
-    for (; not topIt1->atEnd(); topIt1->toRight()) {
-        if (topIt1->tseg()->hasNextParalogy() && topIt1->tseg()->isCanonicalParalog()) {
-            parentSet.insert(topIt1->tseg()->getParentIndex());
-        }
-    }
-    topIt1->copy(topIt2);
-
     // find the first match
     if (topIt1->tseg()->hasParent()) {
         // it's either at position 0
@@ -222,11 +333,10 @@ void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames) {
     }
     if (!found_match) {
         // or we have to seek for it
-        found_match = nextMatch(topIt1, botIt1, topIt2, botIt2);
+        found_match = nextMatch(topIt1, botIt1, topIt2, botIt2, endIndex);
         if (!found_match) {
-            cerr << "Warning [hal2paf]: no alignment blocks found for genome " << genome->getName() << endl;
             // don't bother printing out empty records
-            return;
+            return false;
         }
         topIt1->copy(topIt2);
         botIt1->copy(botIt2);
@@ -266,7 +376,7 @@ void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames) {
 
             cat = 'o';
             // advance topit2/botit2 to next match
-            found_match = nextMatch(topIt1, botIt1, topIt2, botIt2);
+            found_match = nextMatch(topIt1, botIt1, topIt2, botIt2, endIndex);
             if (found_match) {
                 cat = blockCat(topIt1, botIt1, topIt2, botIt2, topIt3, botIt3, parentSet);
                 int64_t len = 0;
@@ -327,4 +437,5 @@ void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames) {
                   << 255 << "\t"
                   << "cg:Z:" << cigar_string << endl;
     }
+    return true;
 }
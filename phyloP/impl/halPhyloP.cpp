@@ -219,15 +219,6 @@ void PhyloP::processSequence(const Sequence *sequence, hal_index_t start, hal_si
         if (step == 1) {
             /** Move the iterator one position to the right */
             colIt->toRight();
-
-            /** This is some tuning code that will probably be hidden from
-             * the interface at some point.  It is a good idea to use for now
-             * though */
-            // erase empty entries from the column.  helps when there are
-            // millions of sequences (ie from fastas with lots of scaffolds)
-            if (pos % 1000 == 0) {
-                colIt->defragment();
-            }
         } else {
             /** Reset the iterator to a non-contiguous position */
             colIt->toSite(pos, last - 1);
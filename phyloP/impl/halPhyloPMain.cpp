@@ -30,7 +30,8 @@ static void initParser(CLParser &optionsParser) {
     optionsParser.addArgument("refGenome", "reference genome to scan");
     optionsParser.addArgument("modPath", "input neutral model file");
     optionsParser.addArgument("outWiggle", "output wig file (or \"stdout\""
-                                           " to pipe to standard output)");
+                                           " to pipe to standard output).  Written BGZF compressed"
+                                           " if the name ends in .gz or .bgz");
     optionsParser.addOption("refSequence", "sequence name to export ("
                                            "all sequences by default)",
                             "\"\"");
@@ -139,14 +140,8 @@ int main(int argc, char **argv) {
             }
         }
 
-        ofstream ofile;
-        ostream &outStream = wigPath == "stdout" ? cout : ofile;
-        if (wigPath != "stdout") {
-            ofile.open(wigPath.c_str());
-            if (!ofile) {
-                throw hal_exception(string("Error opening output file ") + wigPath);
-            }
-        }
+        OutputFile wigFile(wigPath);
+        ostream &outStream = wigFile.getStream();
 
         // set the precision of floating point output
         outStream.setf(ios::fixed, ios::floatfield);
@@ -170,6 +165,7 @@ int main(int argc, char **argv) {
         } else {
             printGenome(&phyloP, refGenome, refSequence, start, length, step);
         }
+        wigFile.close();
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
         return 1;
@@ -1,23 +1,74 @@
 #include "hal.h"
 #include "halCLParser.h"
+#include "halLeafMapping.h"
+#include <algorithm>
 
 using namespace std;
 using namespace hal;
 
+/** Add count sites covered depth times to a histogram, whose element k
+ * is the number of sites covered at least k + 1 times */
+static void addDepth(vector<hal_size_t> &histogram, hal_size_t depth, hal_size_t count) {
+    if (histogram.size() < depth) {
+        histogram.resize(depth, 0);
+    }
+    for (size_t k = 0; k < depth; k++) {
+        histogram[k] += count;
+    }
+}
+
+/** Count how many bases of a reference segment each leaf genome covers
+ * exactly d times, in basesAtDepth[leaf][d].  The reference intervals of
+ * the mapped segments are swept to find the runs of bases with the same
+ * depth. */
+static void countSegmentCoverage(vector<vector<hal_size_t>> &basesAtDepth, const vector<MappedSegmentSet> &leafSegments) {
+    basesAtDepth.resize(leafSegments.size());
+    vector<pair<hal_index_t, hal_index_t>> events;
+    for (size_t j = 0; j < leafSegments.size(); j++) {
+        events.clear();
+        for (MappedSegmentSet::const_iterator it = leafSegments[j].begin(); it != leafSegments[j].end(); it++) {
+            const SlicedSegment *source = (*it)->getSource();
+            hal_index_t first = min(source->getStartPosition(), source->getEndPosition());
+            hal_index_t last = max(source->getStartPosition(), source->getEndPosition());
+            events.push_back(make_pair(first, 1));
+            events.push_back(make_pair(last + 1, -1));
+        }
+        sort(events.begin(), events.end());
+        vector<hal_size_t> &counts = basesAtDepth[j];
+        hal_index_t depth = 0;
+        for (size_t k = 0; k < events.size(); k++) {
+            if (depth > 0) {
+                if (counts.size() <= (size_t)depth) {
+                    counts.resize(depth + 1, 0);
+                }
+                counts[depth] += events[k].first - events[k - 1].first;
+            }
+            depth += events[k].second;
+        }
+        assert(depth == 0);
+    }
+}
+
 int main(int argc, char **argv) {
     CLParser optionsParser;
-    optionsParser.setDescription("Calculate coverage by sampling bases.");
+    optionsParser.setDescription("Calculate coverage by sampling bases, or of every base with --exact.");
     optionsParser.addArgument("halFile", "path to hal file to analyze");
     optionsParser.addArgument("refGenome", "genome to calculate coverage on");
     optionsParser.addOption("numSamples", "Number of bases to sample when calculating coverage", 1000000);
     optionsParser.addOption("seed", "Random seed (integer)", 0);
     optionsParser.addOptionFlag("bySequence", "provide coverage breakdown by sequence in reference genome", false);
-    
+    optionsParser.addOptionFlag("exact", "count the coverage of every base instead of sampling, by mapping each "
+                                "reference segment to every leaf genome", false);
+    optionsParser.addOption("numThreads", "number of threads used to count the coverage of different reference "
+                            "sequences with --exact.  Requires an mmap HAL file", 1);
+
     string path;
     string refGenome;
     hal_size_t numSamples;
     int64_t seed;
     bool bySequence;
+    bool exact;
+    hal_size_t numThreads;
     try {
         optionsParser.parseOptions(argc, argv);
         path = optionsParser.getArgument<string>("halFile");
@@ -25,6 +76,11 @@ int main(int argc, char **argv) {
         numSamples = optionsParser.getOption<hal_size_t>("numSamples");
         seed = optionsParser.getOption<int64_t>("seed");
         bySequence = optionsParser.getFlag("bySequence");
+        exact = optionsParser.getFlag("exact");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads > 1 && !exact) {
+            throw hal_exception("--numThreads can only be used with --exact");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -38,7 +94,8 @@ int main(int argc, char **argv) {
     }
     st_randomSeed(seed);
 
-    AlignmentConstPtr alignment(openHalAlignment(path, &optionsParser));
+    AlignmentConstPtr alignment(
+        openHalAlignment(path, &optionsParser, (numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
     const Genome *ref = alignment->openGenome(refGenome);
     vector<const Genome *> leafGenomes = getLeafGenomes(alignment.get());
 
@@ -57,46 +114,59 @@ int main(int argc, char **argv) {
         }
     }
 
-    hal_size_t maxDepth = 0;
-
     map<const Genome*, vector<hal_size_t>>& genome_coverage = coverage_by_sequence[NULL];
-    for (hal_size_t i = 0; i < numSamples; i++) {
-        // Sample (with replacement) a random position in the reference genome.
-        hal_index_t pos = st_randomInt64(0, ref->getSequenceLength());
-        SegmentIteratorPtr refSeg = ref->getTopSegmentIterator();
-        refSeg->toSite(pos, true);
-        assert(refSeg->getLength() == 1);
-        map<const Genome*, vector<hal_size_t>>* sequence_coverage = NULL;
-        if (bySequence) {
-            sequence_coverage = &coverage_by_sequence[refSeg->getSequence()];
-        }
-        for (size_t j = 0; j < leafGenomes.size(); j++) {
-            const Genome *leafGenome = leafGenomes[j];
-            MappedSegmentSet segments;
-            halMapSegmentSP(refSeg, segments, leafGenome, NULL, true, 0, NULL, NULL);
-            vector<hal_size_t> &histogram = genome_coverage[leafGenome];
-            hal_size_t depth = segments.size();
-            if (depth > maxDepth) {
-                maxDepth = depth;
-            }
-            if (histogram.size() < depth) {
-                histogram.resize(depth, 0);
+    if (exact) {
+        // every reference segment is mapped to each leaf genome once, and
+        // the bases each sequence has at each depth are added to the
+        // histograms in order on this thread
+        LeafMapping leafMapping(alignment.get(), ref);
+        const vector<const Sequence *> &refSequences = leafMapping.getRefSequences();
+        vector<vector<vector<hal_size_t>>> basesAtDepth(refSequences.size());
+        auto countSegment = [&](size_t i, const SegmentIterator *refSeg, const vector<MappedSegmentSet> &leafSegments) {
+            countSegmentCoverage(basesAtDepth[i], leafSegments);
+        };
+        auto mergeSequence = [&](size_t i) {
+            for (size_t j = 0; j < basesAtDepth[i].size(); j++) {
+                const Genome *leafGenome = leafMapping.getLeafGenomes()[j];
+                for (size_t depth = 1; depth < basesAtDepth[i][j].size(); depth++) {
+                    addDepth(genome_coverage[leafGenome], depth, basesAtDepth[i][j][depth]);
+                    if (bySequence) {
+                        addDepth(coverage_by_sequence[refSequences[i]][leafGenome], depth, basesAtDepth[i][j][depth]);
+                    }
+                }
             }
-            for (size_t k = 0; k < depth; k++) {
-                histogram[k] += 1;
+            basesAtDepth[i].clear();
+        };
+        leafMapping.mapSequences(numThreads, countSegment, mergeSequence);
+    } else {
+        for (hal_size_t i = 0; i < numSamples; i++) {
+            // Sample (with replacement) a random position in the reference genome.
+            hal_index_t pos = st_randomInt64(0, ref->getSequenceLength());
+            SegmentIteratorPtr refSeg = ref->getTopSegmentIterator();
+            refSeg->toSite(pos, true);
+            assert(refSeg->getLength() == 1);
+            map<const Genome*, vector<hal_size_t>>* sequence_coverage = NULL;
+            if (bySequence) {
+                sequence_coverage = &coverage_by_sequence[refSeg->getSequence()];
             }
-            if (sequence_coverage) {
-                vector<hal_size_t> &seq_histogram = sequence_coverage->at(leafGenome);
-                if (seq_histogram.size() < depth) {
-                    seq_histogram.resize(depth, 0);
-                }
-                for (size_t k = 0; k < depth; k++) {
-                    seq_histogram[k] += 1;
+            for (size_t j = 0; j < leafGenomes.size(); j++) {
+                const Genome *leafGenome = leafGenomes[j];
+                MappedSegmentSet segments;
+                halMapSegmentSP(refSeg, segments, leafGenome, NULL, true, 0, NULL, NULL);
+                hal_size_t depth = segments.size();
+                addDepth(genome_coverage[leafGenome], depth, 1);
+                if (sequence_coverage) {
+                    addDepth(sequence_coverage->at(leafGenome), depth, 1);
                 }
             }
         }
     }
 
+    hal_size_t maxDepth = 0;
+    for (map<const Genome*, vector<hal_size_t>>::iterator it = genome_coverage.begin(); it != genome_coverage.end(); it++) {
+        maxDepth = max(maxDepth, (hal_size_t)it->second.size());
+    }
+
     cout << "Genome";
     for (hal_size_t i = 0; i < maxDepth; i++) {
         cout << ", sitesCovered" << i + 1 << "Times";
@@ -108,10 +178,11 @@ int main(int argc, char **argv) {
             cout << "\nCoverage on " << refseq->getName() << endl;
         }
         map<const Genome*, vector<hal_size_t>>& coverage = coverage_by_sequence[refseq];
-        for (map<const Genome *, vector<hal_size_t>>::iterator it = coverage.begin(); it != coverage.end(); it++) {
-            string name = it->first->getName();
-            cout << name;
-            vector<hal_size_t> histogram = it->second;
+        // in the order of the tree, as genome addresses depend on the order
+        // they were opened in
+        for (size_t j = 0; j < leafGenomes.size(); j++) {
+            cout << leafGenomes[j]->getName();
+            vector<hal_size_t> histogram = coverage[leafGenomes[j]];
             for (hal_size_t i = 0; i < maxDepth; i++) {
                 if (i < histogram.size()) {
                     cout << ", " << histogram[i];
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halLeafMapping.h"
+#include <string>
+
+using namespace std;
+using namespace hal;
+
+LeafMapping::LeafMapping(const Alignment *alignment, const Genome *refGenome)
+    : _alignment(alignment), _leafGenomes(hal::getLeafGenomes(alignment)) {
+    for (size_t i = 0; i < _leafGenomes.size(); i++) {
+        set<const Genome *> inputSet = {refGenome, _leafGenomes[i]};
+        _mrcas.push_back(getLowestCommonAncestor(inputSet));
+        inputSet = {_leafGenomes[i], _mrcas.back()};
+        _paths.push_back(set<const Genome *>());
+        getGenomesInSpanningTree(inputSet, _paths.back());
+    }
+    for (SequenceIteratorPtr si = refGenome->getSequenceIterator(); !si->atEnd(); si->toNext()) {
+        _refSequences.push_back(si->getSequence());
+    }
+}
+
+void LeafMapping::mapSequences(size_t numThreads, const SegmentFunc &segmentFunc, const SequenceDoneFunc &doneFunc) const {
+    if (numThreads > 1) {
+        checkSharedAccess(_alignment);
+    }
+    auto mapTask = [&](size_t i, string &output) { mapSequence(i, segmentFunc); };
+    auto doneTask = [&](size_t i, string &output) { doneFunc(i); };
+    runOrderedTasks(_refSequences.size(), numThreads, mapTask, doneTask);
+}
+
+void LeafMapping::mapSequence(size_t sequenceIndex, const SegmentFunc &segmentFunc) const {
+    const Sequence *sequence = _refSequences[sequenceIndex];
+    // the root has no top segments, it is mapped from its bottom segments
+    bool top = sequence->getGenome()->getParent() != NULL;
+    hal_size_t numSegments = top ? sequence->getNumTopSegments() : sequence->getNumBottomSegments();
+    if (numSegments == 0) {
+        return;
+    }
+    SegmentIteratorPtr refSeg;
+    if (top) {
+        refSeg = sequence->getTopSegmentIterator();
+    } else {
+        refSeg = sequence->getBottomSegmentIterator();
+    }
+
+    vector<MappedSegmentSet> leafSegments(_leafGenomes.size());
+    for (hal_size_t i = 0; i < numSegments; i++) {
+        for (size_t j = 0; j < _leafGenomes.size(); j++) {
+            leafSegments[j].clear();
+            halMapSegment(refSeg.get(), leafSegments[j], _leafGenomes[j], &_paths[j], true, 0, NULL, _mrcas[j]);
+        }
+        segmentFunc(sequenceIndex, refSeg.get(), leafSegments);
+        refSeg->toRight();
+    }
+}
@@ -1,26 +1,96 @@
 #include "hal.h"
 #include "halCLParser.h"
+#include "halLeafMapping.h"
+#include <algorithm>
 
 using namespace std;
 using namespace hal;
 
+// Genome -> <# of identical bases to ref, # of total bases aligned to ref>
+typedef map<const Genome *, pair<hal_size_t, hal_size_t>> IdentityStats;
+
+/** Add the bases of a reference segment aligned to, and identical to,
+ * each leaf genome to counts[leaf].  As when sampling, only bases aligned
+ * to a single base of the leaf are counted, and bases that are N in
+ * either genome are skipped. */
+static void countSegmentIdentity(vector<pair<hal_size_t, hal_size_t>> &counts, const SegmentIterator *refSeg,
+                                 const vector<MappedSegmentSet> &leafSegments) {
+    counts.resize(leafSegments.size(), make_pair(0, 0));
+    string refString;
+    string tgtString;
+    vector<hal_index_t> depthChange;
+    refSeg->getString(refString);
+    hal_index_t refStart = refSeg->getStartPosition();
+    for (size_t j = 0; j < leafSegments.size(); j++) {
+        const MappedSegmentSet &segments = leafSegments[j];
+        if (segments.empty()) {
+            continue;
+        }
+        // number of leaf bases each reference base is aligned to
+        depthChange.assign(refString.size() + 1, 0);
+        for (MappedSegmentSet::const_iterator it = segments.begin(); it != segments.end(); it++) {
+            const SlicedSegment *source = (*it)->getSource();
+            depthChange[min(source->getStartPosition(), source->getEndPosition()) - refStart]++;
+            depthChange[max(source->getStartPosition(), source->getEndPosition()) - refStart + 1]--;
+        }
+        for (size_t k = 1; k < depthChange.size(); k++) {
+            depthChange[k] += depthChange[k - 1];
+        }
+        for (MappedSegmentSet::const_iterator it = segments.begin(); it != segments.end(); it++) {
+            const SlicedSegment *source = (*it)->getSource();
+            size_t first = min(source->getStartPosition(), source->getEndPosition()) - refStart;
+            size_t last = max(source->getStartPosition(), source->getEndPosition()) - refStart;
+            (*it)->getString(tgtString);
+            if (source->getReversed()) {
+                // line the target bases up with the forward reference
+                reverseComplement(tgtString);
+            }
+            // compare the runs of bases only aligned to this segment
+            size_t k = first;
+            while (k <= last) {
+                if (depthChange[k] != 1) {
+                    k++;
+                    continue;
+                }
+                size_t runStart = k;
+                while (k <= last && depthChange[k] == 1) {
+                    k++;
+                }
+                dnaCountIdentical(refString.data() + runStart, tgtString.data() + (runStart - first), k - runStart,
+                                  counts[j].second, counts[j].first);
+            }
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     CLParser optionsParser;
-    optionsParser.setDescription("Calculate % identity by sampling bases.");
+    optionsParser.setDescription("Calculate % identity by sampling bases, or of every base with --exact.");
     optionsParser.addArgument("halFile", "path to hal file to analyze");
     optionsParser.addArgument("refGenome", "genome to calculate coverage on");
     optionsParser.addOption("numSamples", "Number of bases to sample when calculating % ID", 1000000);
     optionsParser.addOption("seed", "Random seed (integer)", 0);
+    optionsParser.addOptionFlag("exact", "compare every base instead of sampling, by mapping each reference segment "
+                                "to every leaf genome", false);
+    optionsParser.addOption("numThreads", "number of threads used to compare different reference sequences with "
+                            "--exact.  Requires an mmap HAL file", 1);
     string path;
     string refGenome;
     hal_size_t numSamples;
     int64_t seed;
+    bool exact;
+    hal_size_t numThreads;
     try {
         optionsParser.parseOptions(argc, argv);
         path = optionsParser.getArgument<string>("halFile");
         refGenome = optionsParser.getArgument<string>("refGenome");
         numSamples = optionsParser.getOption<hal_size_t>("numSamples");
         seed = optionsParser.getOption<int64_t>("seed");
+        exact = optionsParser.getFlag("exact");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads > 1 && !exact) {
+            throw hal_exception("--numThreads can only be used with --exact");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -34,55 +104,77 @@ int main(int argc, char **argv) {
     }
     st_randomSeed(seed);
 
-    AlignmentConstPtr alignment(openHalAlignment(path, &optionsParser));
+    AlignmentConstPtr alignment(
+        openHalAlignment(path, &optionsParser, (numThreads > 1) ? READ_SHARED_ACCESS : READ_ACCESS));
     const Genome *ref = alignment->openGenome(refGenome);
     vector<const Genome *> leafGenomes = getLeafGenomes(alignment.get());
 
-    // Genome -> <# of identical bases to ref, # of total bases aligned to ref>
-    map<const Genome *, pair<hal_size_t, hal_size_t>> idStats;
+    IdentityStats idStats;
     for (size_t i = 0; i < leafGenomes.size(); i++) {
         idStats.insert(make_pair(leafGenomes[i], make_pair(0, 0)));
     }
 
-    for (hal_size_t i = 0; i < numSamples; i++) {
-        // Sample (with replacement) a random position in the reference genome.
-        hal_index_t pos = st_randomInt64(0, ref->getSequenceLength());
-        SegmentIteratorPtr refSeg = ref->getTopSegmentIterator();
-        refSeg->toSite(pos, true);
-        assert(refSeg->getLength() == 1);
-        string refString;
-        refSeg->getString(refString);
-        assert(refString.size() == 1);
-        if (toupper(refString[0]) == 'N') {
-            continue;
-        }
-        for (size_t j = 0; j < leafGenomes.size(); j++) {
-            const Genome *leafGenome = leafGenomes[j];
-            MappedSegmentSet segments;
-            halMapSegmentSP(refSeg, segments, leafGenome, NULL, true, 0, NULL, NULL);
-            if (segments.size() == 1) {
-                auto i = segments.begin();
-                string tgtString;
-                (*i)->getString(tgtString);
-                if (toupper(tgtString[0]) == 'N') {
-                    continue;
-                }
-                bool identical = toupper(refString[0]) == toupper(tgtString[0]);
-                auto mapIt = idStats.find(leafGenome);
-                if (identical) {
-                    mapIt->second.first++;
+    if (exact) {
+        // every reference segment is mapped to each leaf genome once, and
+        // the counts of each sequence are added to the totals in order on
+        // this thread
+        LeafMapping leafMapping(alignment.get(), ref);
+        vector<vector<pair<hal_size_t, hal_size_t>>> partialCounts(leafMapping.getRefSequences().size());
+        auto countSegment = [&](size_t i, const SegmentIterator *refSeg, const vector<MappedSegmentSet> &leafSegments) {
+            countSegmentIdentity(partialCounts[i], refSeg, leafSegments);
+        };
+        auto mergeSequence = [&](size_t i) {
+            for (size_t j = 0; j < partialCounts[i].size(); j++) {
+                pair<hal_size_t, hal_size_t> &stats = idStats[leafMapping.getLeafGenomes()[j]];
+                stats.first += partialCounts[i][j].first;
+                stats.second += partialCounts[i][j].second;
+            }
+            partialCounts[i].clear();
+        };
+        leafMapping.mapSequences(numThreads, countSegment, mergeSequence);
+    } else {
+        for (hal_size_t i = 0; i < numSamples; i++) {
+            // Sample (with replacement) a random position in the reference genome.
+            hal_index_t pos = st_randomInt64(0, ref->getSequenceLength());
+            SegmentIteratorPtr refSeg = ref->getTopSegmentIterator();
+            refSeg->toSite(pos, true);
+            assert(refSeg->getLength() == 1);
+            string refString;
+            refSeg->getString(refString);
+            assert(refString.size() == 1);
+            if (toupper(refString[0]) == 'N') {
+                continue;
+            }
+            for (size_t j = 0; j < leafGenomes.size(); j++) {
+                const Genome *leafGenome = leafGenomes[j];
+                MappedSegmentSet segments;
+                halMapSegmentSP(refSeg, segments, leafGenome, NULL, true, 0, NULL, NULL);
+                if (segments.size() == 1) {
+                    auto i = segments.begin();
+                    string tgtString;
+                    (*i)->getString(tgtString);
+                    if (toupper(tgtString[0]) == 'N') {
+                        continue;
+                    }
+                    bool identical = toupper(refString[0]) == toupper(tgtString[0]);
+                    auto mapIt = idStats.find(leafGenome);
+                    if (identical) {
+                        mapIt->second.first++;
+                    }
+                    mapIt->second.second++;
                 }
-                mapIt->second.second++;
             }
         }
     }
 
     cout << "Genome, IdenticalSites, AlignedSites, PercentIdentity" << endl;
 
-    for (map<const Genome *, pair<hal_size_t, hal_size_t>>::iterator it = idStats.begin(); it != idStats.end(); it++) {
-        string name = it->first->getName();
-        hal_size_t identicalBases = it->second.first;
-        hal_size_t alignedBases = it->second.second;
+    // in the order of the tree, as genome addresses depend on the order
+    // they were opened in
+    for (size_t j = 0; j < leafGenomes.size(); j++) {
+        string name = leafGenomes[j]->getName();
+        hal_size_t identicalBases = idStats[leafGenomes[j]].first;
+        hal_size_t alignedBases = idStats[leafGenomes[j]].second;
         cout << name << ", "
              << identicalBases << ", "
              << alignedBases << ", "
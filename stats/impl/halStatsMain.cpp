@@ -617,9 +617,6 @@ void printPercentID(ostream &os, AlignmentConstPtr alignment, const string &geno
             delete it->second.first;
             delete it->second.second;
         }
-        if (colIt->getReferenceSequencePosition() % 1000 == 0) {
-            colIt->defragment();
-        }
         if (colIt->lastColumn()) {
             // Break here--the column iterator will crash if we try to go further.
             break;
@@ -643,6 +640,7 @@ void printCoverage(ostream &os, AlignmentConstPtr alignment, const string &genom
     if (!refGenome) {
         throw hal_exception("Genome " + genomeName + " does not exist.");
     }
+    refGenome->adviseAccessPattern(ACCESS_PATTERN_SEQUENTIAL);
 
     ColumnIteratorPtr colIt = refGenome->getColumnIterator(NULL, 0, 0, NULL_INDEX, false, false, false, true);
     map<const Genome *, vector<hal_size_t> *> histograms;
@@ -682,9 +680,6 @@ void printCoverage(ostream &os, AlignmentConstPtr alignment, const string &genom
                 (*histogram)[i] = histogram->at(i) + numSitesMapped[refGenome];
             }
         }
-        if (colIt->getReferenceSequencePosition() % 1000 == 0) {
-            colIt->defragment();
-        }
         if (colIt->lastColumn()) {
             // Break here--the column iterator will crash if we try to go further.
             break;
@@ -799,9 +794,6 @@ static void printAllCoverage(ostream &os, AlignmentConstPtr alignment) {
                     }
                 }
             }
-            if (colIt->getReferenceSequencePosition() % 1000 == 0) {
-                colIt->defragment();
-            }
             if (colIt->lastColumn()) {
                 // Break here--the column iterator will crash if we try to go further.
                 break;
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALLEAFMAPPING_H
+#define _HALLEAFMAPPING_H
+
+#include "hal.h"
+#include <functional>
+#include <set>
+#include <vector>
+
+namespace hal {
+
+    /** Map every segment of a reference genome to each leaf genome of the
+     * alignment, as done by halCoverage --exact and halPctId --exact.
+     * Each reference segment is mapped to each leaf once, through the
+     * most recent common ancestor of the two.  The sequences of the
+     * reference are mapped by separate tasks, so they can be run on
+     * several threads when the alignment was opened with
+     * READ_SHARED_ACCESS. */
+    class LeafMapping {
+      public:
+        /** Called with a reference segment and the segments it maps to in
+         * each leaf genome, in the order of getLeafGenomes().  It may be
+         * called from any thread, but all the calls for one sequence are
+         * from the same thread. */
+        typedef std::function<void(size_t sequenceIndex, const SegmentIterator *refSeg,
+                                   const std::vector<MappedSegmentSet> &leafSegments)>
+            SegmentFunc;
+        /** Called on the calling thread, in sequence order, once all the
+         * segments of a sequence have been mapped */
+        typedef std::function<void(size_t sequenceIndex)> SequenceDoneFunc;
+
+        LeafMapping(const Alignment *alignment, const Genome *refGenome);
+
+        const std::vector<const Genome *> &getLeafGenomes() const {
+            return _leafGenomes;
+        }
+        const std::vector<const Sequence *> &getRefSequences() const {
+            return _refSequences;
+        }
+
+        /** Map the segments of each reference sequence */
+        void mapSequences(size_t numThreads, const SegmentFunc &segmentFunc, const SequenceDoneFunc &doneFunc) const;
+
+      protected:
+        void mapSequence(size_t sequenceIndex, const SegmentFunc &segmentFunc) const;
+
+        const Alignment *_alignment;
+        std::vector<const Genome *> _leafGenomes;
+        std::vector<const Genome *> _mrcas;
+        std::vector<std::set<const Genome *>> _paths;
+        std::vector<const Sequence *> _refSequences;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -10,9 +10,12 @@ bool is_not_overlapping_ordered_pair(const PslBlock &a, const PslBlock &b, const
            b.tStart - a.tEnd < threshold;
 }
 
+// Assumes queryGroup is sorted by qStart, so the scan stops at the first
+// block that starts too far after pos to be chained to it
 std::vector<int> get_next(const int pos, const std::vector<PslBlock> &queryGroup, const hal_size_t maxAnchorDistance) {
     std::vector<int> f;
-    for (auto i = pos + 1; i < (int)queryGroup.size(); ++i) {
+    const hal_size_t qLimit = queryGroup[pos].qEnd + maxAnchorDistance;
+    for (auto i = pos + 1; i < (int)queryGroup.size() && queryGroup[i].qStart < qLimit; ++i) {
         if (is_not_overlapping_ordered_pair(queryGroup[pos], queryGroup[i], maxAnchorDistance)) {
             if (f.empty())
                 f.push_back(i);
@@ -29,74 +32,98 @@ std::vector<int> get_next(const int pos, const std::vector<PslBlock> &queryGroup
     return f;
 }
 
-// *dag* is represented as a map:  vertex -> its possible next vertices;
-// *hidden_vertices* is a set of vertices that are already in paths;
-// Weight of an edge equals length of the next psl block;
-// Weight of a vertex equals estimated weight:
-// w_j < w_i + w_e(ij) => w_j must be updated
-// Also keeps track of how we came to this state:
-// (prev_vertex, weight)
-std::map<int, std::pair<int, hal_size_t>> weigh_dag(const std::vector<PslBlock> &group, std::map<int, std::vector<int>> &dag,
-                                                    const std::set<int> &hiddenVertices, const hal_size_t maxAnchorDistance) {
-    std::map<int, std::pair<int, hal_size_t>> weightedDag;
+SyntenyDag::SyntenyDag(const std::vector<PslBlock> &group, const hal_size_t maxAnchorDistance) :
+    _group(group), _nextStarts(group.size() + 1, 0), _prevStarts(group.size() + 1, 0),
+    _prevVertex(group.size(), -1), _weight(group.size(), 0), _hidden(group.size(), false) {
+    // edges are stored as the flattened next and previous lists of each
+    // vertex, both in increasing vertex order
     for (int i = 0; i < (int)group.size(); ++i) {
-        if (hiddenVertices.count(i))
-            continue;
-        std::vector<int> nexts;
-        if (not dag.count(i)) {
-            nexts = get_next(i, group, maxAnchorDistance);
-            dag[i] = nexts;
-        } else {
-            nexts = dag[i];
-        }
-        // If this vertex was never visited then its weight equals to its size.
-        // Intuition: otherwise we will never count its size
-        if (not weightedDag.count(i))
-            weightedDag[i] = std::make_pair(-1, group[i].size);
+        auto nexts = get_next(i, group, maxAnchorDistance);
+        _nexts.insert(_nexts.end(), nexts.begin(), nexts.end());
+        _nextStarts[i + 1] = _nexts.size();
         for (auto j : nexts) {
-            if (hiddenVertices.count(j))
-                continue;
-            auto alternativeWeight = weightedDag[i].second + group[j].size;
-            if (not weightedDag.count(j) or weightedDag[j].second < alternativeWeight)
-                // Remembers previous vertex itself and
-                // its corresponding weight:
-                // previous vertex w_i + weight of the next edge
-                weightedDag[j] = std::make_pair(i, alternativeWeight);
+            _prevStarts[j + 1]++;
         }
     }
-    return weightedDag;
+    for (size_t i = 0; i < group.size(); ++i) {
+        _prevStarts[i + 1] += _prevStarts[i];
+    }
+    _prevs.resize(_nexts.size());
+    std::vector<size_t> prevEnds(_prevStarts.begin(), _prevStarts.end() - 1);
+    for (int i = 0; i < (int)group.size(); ++i) {
+        for (size_t e = _nextStarts[i]; e < _nextStarts[i + 1]; ++e) {
+            _prevs[prevEnds[_nexts[e]]++] = i;
+        }
+    }
+    // edges only go forward, so one pass in vertex order weighs the dag
+    for (int i = 0; i < (int)group.size(); ++i) {
+        weigh_vertex(i, _prevVertex[i], _weight[i]);
+        _ranked.insert(std::make_pair(_weight[i], i));
+    }
 }
 
-int get_maxed_vertex(const std::map<int, std::pair<int, hal_size_t>> &weightedDag) {
-    hal_size_t maxWeight = weightedDag.cbegin()->second.second;
-    int maxPos = weightedDag.cbegin()->first;
-    for (auto it = weightedDag.cbegin(); it != weightedDag.cend(); ++it) {
-        if (it->second.second >= maxWeight) {
-            maxWeight = it->second.second;
-            maxPos = it->first;
+// Weight of a vertex: the heaviest of its visible previous vertices' weights
+// plus its size, or just its size if it has none.  Ties go to the earliest
+// previous vertex.
+void SyntenyDag::weigh_vertex(const int v, int &prevVertex, hal_size_t &weight) const {
+    prevVertex = -1;
+    weight = _group[v].size;
+    bool found = false;
+    for (size_t e = _prevStarts[v]; e < _prevStarts[v + 1]; ++e) {
+        auto p = _prevs[e];
+        if (_hidden[p])
+            continue;
+        auto alternativeWeight = _weight[p] + _group[v].size;
+        if (not found or weight < alternativeWeight) {
+            prevVertex = p;
+            weight = alternativeWeight;
+            found = true;
         }
     }
-    return maxPos;
 }
 
-std::vector<PslBlock> traceback(std::map<int, std::pair<int, hal_size_t>> &weightedDag, std::set<int> &hiddenVertices,
-                                const std::vector<PslBlock> &group) {
-    // Chooses the path of the heaviest weight
-    auto startVertex = get_maxed_vertex(weightedDag);
-    std::vector<int> path = {startVertex};
-    auto prevVertex = weightedDag[startVertex].first;
-    while (prevVertex != -1) {
-        path.push_back(prevVertex);
-        prevVertex = weightedDag[prevVertex].first;
+std::vector<int> SyntenyDag::extract_path() {
+    // Chooses the path of the heaviest weight, the last vertex on ties
+    std::vector<int> path;
+    if (_ranked.empty()) {
+        return path;
     }
-    hiddenVertices.insert(path.begin(), path.end());
-    std::vector<PslBlock> pslBlockPath;
-    std::transform(path.begin(), path.end(), std::back_inserter(pslBlockPath), [group](int x) -> PslBlock { return group[x]; });
-    std::reverse(pslBlockPath.begin(), pslBlockPath.end());
-    return pslBlockPath;
+    for (auto v = _ranked.rbegin()->second; v != -1; v = _prevVertex[v]) {
+        path.push_back(v);
+    }
+    std::reverse(path.begin(), path.end());
+
+    // Hides the path, then reweighs only the vertices downstream of it, in
+    // vertex order, for as long as their weights keep changing
+    std::set<int> dirty;
+    for (auto v : path) {
+        _ranked.erase(std::make_pair(_weight[v], v));
+        _hidden[v] = true;
+    }
+    for (auto v : path) {
+        dirty.insert(_nexts.begin() + _nextStarts[v], _nexts.begin() + _nextStarts[v + 1]);
+    }
+    while (not dirty.empty()) {
+        auto v = *dirty.begin();
+        dirty.erase(dirty.begin());
+        if (_hidden[v])
+            continue;
+        int prevVertex;
+        hal_size_t weight;
+        weigh_vertex(v, prevVertex, weight);
+        if (prevVertex == _prevVertex[v] && weight == _weight[v])
+            continue;
+        _ranked.erase(std::make_pair(_weight[v], v));
+        _prevVertex[v] = prevVertex;
+        _weight[v] = weight;
+        _ranked.insert(std::make_pair(weight, v));
+        dirty.insert(_nexts.begin() + _nextStarts[v], _nexts.begin() + _nextStarts[v + 1]);
+    }
+    return path;
 }
+
 struct {
-    bool operator()(PslBlock a, PslBlock b) const {
+    bool operator()(const PslBlock &a, const PslBlock &b) const {
         if (a.qStart < b.qStart)
             return true;
         else if (a.qStart == b.qStart) {
@@ -109,28 +136,31 @@ struct {
 std::vector<std::vector<PslBlock>> dag_merge(const std::vector<PslBlock> &blocks, const hal_size_t minBlockBreath,
                                              const hal_size_t maxAnchorDistance) {
     std::map<std::string, std::vector<PslBlock>> blocksByQName;
-    for (auto block : blocks)
+    for (const auto &block : blocks)
         blocksByQName[block.qName].push_back(block);
     std::vector<std::vector<PslBlock>> paths;
-    for (auto pairs : blocksByQName) {
-        std::vector<PslBlock> group = pairs.second;
-        std::string qName = pairs.first;
-        std::map<int, std::vector<int>> dag;
-        std::set<int> hiddenVertices;
+    for (auto &pairs : blocksByQName) {
+        std::vector<PslBlock> &group = pairs.second;
         std::sort(group.begin(), group.end(), qStartLess);
-        while (hiddenVertices.size() != group.size()) {
-            auto weightedDag = weigh_dag(group, dag, hiddenVertices, maxAnchorDistance);
-            auto path = traceback(weightedDag, hiddenVertices, group);
+        SyntenyDag dag(group, maxAnchorDistance);
+        while (true) {
+            auto path = dag.extract_path();
             if (path.empty()) {
                 break;
             }
-            auto qLen = path.back().qEnd - path[0].qStart;
-            auto tLen = path.back().tEnd - path[0].tStart;
+            const PslBlock &first = group[path[0]];
+            const PslBlock &last = group[path.back()];
+            auto qLen = last.qEnd - first.qStart;
+            auto tLen = last.tEnd - first.tStart;
             if (qLen >= minBlockBreath && tLen >= minBlockBreath) {
-                // if (qLen >= minBlockBreath && tLen >= minBlockBreath){
-                paths.push_back(path);
+                std::vector<PslBlock> pslBlockPath;
+                for (auto v : path) {
+                    pslBlockPath.push_back(group[v]);
+                }
+                paths.push_back(pslBlockPath);
             }
         }
+        group.clear();
     }
     return paths;
 }
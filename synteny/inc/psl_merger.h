@@ -29,13 +29,34 @@ bool is_not_overlapping_ordered_pair(const PslBlock &a, const PslBlock &b, const
 
 std::vector<int> get_next(const int pos, const std::vector<PslBlock> &queryGroup, const hal_size_t maxAnchorDistance = 5000);
 
-std::map<int, std::pair<int, hal_size_t>> weigh_dag(const std::vector<PslBlock> &group, std::map<int, std::vector<int>> &dag,
-                                                    const std::set<int> &hiddenVertices, const hal_size_t maxAnchorDistance);
+// The dag of a query group: a vertex per psl block, with edges to the blocks
+// that get_next finds can follow it.  The weight of a vertex is that of the
+// heaviest path ending at it, where a path weighs the sum of its blocks'
+// sizes.  Paths are extracted heaviest first; extracting one hides its
+// vertices and only reweighs the vertices downstream of them, instead of
+// the whole dag.
+class SyntenyDag {
+  public:
+    SyntenyDag(const std::vector<PslBlock> &group, const hal_size_t maxAnchorDistance);
 
-int get_maxed_vertex(const std::map<int, std::pair<int, int>> &weightedDag);
+    // Returns the heaviest path of visible vertices and hides them, or an
+    // empty path once all vertices are hidden
+    std::vector<int> extract_path();
 
-std::vector<PslBlock> traceback(std::map<int, std::pair<int, hal_size_t>> &weightedDag, std::set<int> &hiddenVertices,
-                                const std::vector<PslBlock> &group);
+  private:
+    void weigh_vertex(const int v, int &prevVertex, hal_size_t &weight) const;
+
+    const std::vector<PslBlock> &_group;
+    std::vector<int> _nexts;
+    std::vector<size_t> _nextStarts;
+    std::vector<int> _prevs;
+    std::vector<size_t> _prevStarts;
+    std::vector<int> _prevVertex;
+    std::vector<hal_size_t> _weight;
+    std::vector<bool> _hidden;
+    // (weight, vertex) of the visible vertices
+    std::set<std::pair<hal_size_t, int>> _ranked;
+};
 
 std::vector<std::vector<PslBlock>> dag_merge(const std::vector<PslBlock> &blocks, const hal_size_t minBlockBreath,
                                              const hal_size_t maxAnchorDistance);
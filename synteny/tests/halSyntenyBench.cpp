@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Benchmark dag_merge on synthetic PSL blocks, like those of a fragmented
+ * assembly: runs of small, closely spaced syntenic blocks broken by
+ * rearrangements, with scattered blocks from repeats in between.  The time
+ * and the number of synteny blocks made are reported.  Unless skipped, the
+ * blocks are also merged with the original algorithm, which reweighs the
+ * whole dag after extracting each path, and the outputs are checked to be
+ * identical.
+ */
+#include "halCLParser.h"
+#include "psl_merger.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    struct BenchArgs {
+        hal_size_t numChroms;
+        hal_size_t numBlocks;
+        hal_size_t maxAnchorDistance;
+        hal_size_t minBlockSize;
+        bool skipOriginal;
+        unsigned seed;
+    };
+
+    vector<PslBlock> makeBlocks(const BenchArgs &args) {
+        mt19937 rng(args.seed);
+        const hal_size_t numTChroms = 20;
+        const hal_size_t tChromSize = 200000000;
+        vector<PslBlock> blocks;
+        for (hal_size_t c = 0; c < args.numChroms; c++) {
+            string qName = "query" + to_string(c);
+            hal_size_t qPos = 0;
+            string tName = "target0";
+            hal_size_t tPos = 0;
+            string strand = "+";
+            for (hal_size_t i = 0; i < args.numBlocks; i++) {
+                hal_size_t size = 20 + rng() % 480;
+                if (rng() % 50 == 0) {
+                    // rearrangement
+                    tName = "target" + to_string(rng() % numTChroms);
+                    tPos = rng() % tChromSize;
+                    strand = rng() % 2 ? "+" : "-";
+                }
+                if (rng() % 20 == 0) {
+                    // repeat
+                    blocks.push_back(PslBlock(qPos + rng() % 200, rng() % tChromSize, size, rng() % 2 ? "+" : "-", qName,
+                                              "target" + to_string(rng() % numTChroms), 0, tChromSize));
+                    continue;
+                }
+                qPos += rng() % (rng() % 100 == 0 ? 20000 : 400);
+                tPos += rng() % (rng() % 100 == 0 ? 20000 : 400);
+                blocks.push_back(PslBlock(qPos, tPos, size, strand, qName, tName, 0, tChromSize));
+                qPos += size;
+                tPos += size;
+            }
+        }
+        shuffle(blocks.begin(), blocks.end(), rng);
+        return blocks;
+    }
+
+    /* the original dag_merge, which reweighs the whole dag of a query group
+     * after extracting each path */
+    vector<vector<PslBlock>> originalDagMerge(const vector<PslBlock> &blocks, hal_size_t minBlockBreath,
+                                              hal_size_t maxAnchorDistance) {
+        map<string, vector<PslBlock>> blocksByQName;
+        for (const auto &block : blocks) {
+            blocksByQName[block.qName].push_back(block);
+        }
+        vector<vector<PslBlock>> paths;
+        for (auto &pairs : blocksByQName) {
+            vector<PslBlock> &group = pairs.second;
+            sort(group.begin(), group.end(), [](const PslBlock &a, const PslBlock &b) {
+                return a.qStart < b.qStart || (a.qStart == b.qStart && a.tStart < b.tStart);
+            });
+            map<int, vector<int>> dag;
+            set<int> hiddenVertices;
+            while (hiddenVertices.size() != group.size()) {
+                map<int, pair<int, hal_size_t>> weightedDag;
+                for (int i = 0; i < (int)group.size(); ++i) {
+                    if (hiddenVertices.count(i)) {
+                        continue;
+                    }
+                    if (not dag.count(i)) {
+                        dag[i] = get_next(i, group, maxAnchorDistance);
+                    }
+                    if (not weightedDag.count(i)) {
+                        weightedDag[i] = make_pair(-1, group[i].size);
+                    }
+                    for (auto j : dag[i]) {
+                        if (hiddenVertices.count(j)) {
+                            continue;
+                        }
+                        auto alternativeWeight = weightedDag[i].second + group[j].size;
+                        if (not weightedDag.count(j) or weightedDag[j].second < alternativeWeight) {
+                            weightedDag[j] = make_pair(i, alternativeWeight);
+                        }
+                    }
+                }
+                auto maxIt = weightedDag.cbegin();
+                for (auto it = weightedDag.cbegin(); it != weightedDag.cend(); ++it) {
+                    if (it->second.second >= maxIt->second.second) {
+                        maxIt = it;
+                    }
+                }
+                vector<PslBlock> path;
+                for (int v = maxIt->first; v != -1; v = weightedDag[v].first) {
+                    path.push_back(group[v]);
+                    hiddenVertices.insert(v);
+                }
+                reverse(path.begin(), path.end());
+                if (path.back().qEnd - path[0].qStart >= minBlockBreath &&
+                    path.back().tEnd - path[0].tStart >= minBlockBreath) {
+                    paths.push_back(path);
+                }
+            }
+        }
+        return paths;
+    }
+
+    bool samePaths(const vector<vector<PslBlock>> &a, const vector<vector<PslBlock>> &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].size() != b[i].size()) {
+                return false;
+            }
+            for (size_t j = 0; j < a[i].size(); j++) {
+                if (a[i][j].get_description() != b[i][j].get_description() || a[i][j].strand != b[i][j].strand) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template <typename MergeFunc>
+    vector<vector<PslBlock>> runBench(const char *name, MergeFunc merge, const vector<PslBlock> &blocks,
+                                      const BenchArgs &args) {
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        vector<vector<PslBlock>> paths = merge(blocks, args.minBlockSize, args.maxAnchorDistance);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        printf("%s\t%zu\t%.3f\t%.0f\t%zu\n", name, blocks.size(), elapsed, blocks.size() / elapsed, paths.size());
+        return paths;
+    }
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    optionsParser.addOption("numChroms", "number of query chromosomes", 2);
+    optionsParser.addOption("numBlocks", "number of blocks on each query chromosome", 100000);
+    optionsParser.addOption("maxAnchorDistance", "upper bound on distance for syntenic psl blocks", 5000);
+    optionsParser.addOption("minBlockSize", "lower bound on synteny block length", 5000);
+    optionsParser.addOptionFlag("skipOriginal", "don't run the original algorithm, which is quadratic in the number "
+                                "of blocks", false);
+    optionsParser.addOption("seed", "random seed", 0);
+    optionsParser.setDescription("Benchmark merging synthetic PSL blocks into synteny blocks.  Reports the number of "
+                                 "blocks, the time in seconds, the blocks merged per second and the number of "
+                                 "synteny blocks, and fails if the outputs of the two algorithms differ.");
+    BenchArgs args;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        args.numChroms = optionsParser.getOption<hal_size_t>("numChroms");
+        args.numBlocks = optionsParser.getOption<hal_size_t>("numBlocks");
+        args.maxAnchorDistance = optionsParser.getOption<hal_size_t>("maxAnchorDistance");
+        args.minBlockSize = optionsParser.getOption<hal_size_t>("minBlockSize");
+        args.skipOriginal = optionsParser.getFlag("skipOriginal");
+        args.seed = optionsParser.getOption<unsigned>("seed");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+
+    try {
+        vector<PslBlock> blocks = makeBlocks(args);
+        printf("method\tblocks\tseconds\tblocksPerSecond\tsyntenyBlocks\n");
+        auto paths = runBench("incremental", dag_merge, blocks, args);
+        if (not args.skipOriginal) {
+            auto originalPaths = runBench("original", originalDagMerge, blocks, args);
+            if (not samePaths(paths, originalPaths)) {
+                throw hal_exception("incremental and original synteny blocks differ");
+            }
+        }
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}